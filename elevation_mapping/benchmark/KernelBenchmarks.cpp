@@ -0,0 +1,406 @@
+/*
+ * KernelBenchmarks.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ *
+ *   Microbenchmarks of the hot kernels of the mapping pipeline, parameterized over the map size, the resolution, the
+ *   number of points and the fill ratio of the map. Map sizes are given in m, resolutions in mm and fill ratios in %.
+ */
+
+#include "SyntheticScene.hpp"
+
+#include "elevation_mapping/ElevationMap.hpp"
+#include "elevation_mapping/PointCloudConversion.hpp"
+#include "elevation_mapping/RobotMotionMapUpdater.hpp"
+#include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
+#include "elevation_mapping/sensor_processors/LaserSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/PerfectSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/StereoSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/StructuredLightSensorProcessor.hpp"
+
+// STL
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Benchmark
+#include <benchmark/benchmark.h>
+
+// PCL
+#include <pcl/common/transforms.h>
+
+// ROS
+#include <geometry_msgs/TransformStamped.h>
+#include <ros/ros.h>
+
+namespace elevation_mapping {
+
+/*!
+ * Sets up the map and the sensor processors for the kernel benchmarks, with access to their internals.
+ */
+class KernelBenchmarkAccess {
+ public:
+  //! Sensor types of the sensor processor benchmarks, indexed by the benchmark argument.
+  static const std::vector<std::string>& getSensorTypes() {
+    static const std::vector<std::string> sensorTypes{"laser", "perfect", "stereo", "structured_light"};
+    return sensorTypes;
+  }
+
+  /*!
+   * Creates a map centered at the origin, with the variance limits of the node for the resolution.
+   * @param length the side length of the map [m].
+   * @param resolution the resolution of the map [m/cell].
+   * @return the map.
+   */
+  static std::unique_ptr<ElevationMap> createMap(double length, double resolution) {
+    ros::NodeHandle nodeHandle("~");
+    auto map = std::make_unique<ElevationMap>(nodeHandle);
+    map->setFrameId("map");
+    map->setGeometry(grid_map::Length(length, length), resolution, grid_map::Position::Zero());
+    map->minVariance_ = std::pow(0.003, 2);
+    map->maxVariance_ = std::pow(0.03, 2);
+    map->multiHeightNoise_ = std::pow(0.003, 2);
+    map->minHorizontalVariance_ = std::pow(resolution / 2.0, 2);
+    map->maxHorizontalVariance_ = 0.5;
+    return map;
+  }
+
+  /*!
+   * Creates a sensor processor with the parameters of a typical sensor, the sensor mounted on the robot at the start of the
+   * synthetic trajectory. The transformations are static, such that they are found for every time stamp.
+   * @param nodeHandle the node handle of the sensor processor, has to outlive it.
+   * @param sensorType the type of the sensor processor.
+   * @return the sensor processor, nullptr if the type does not exist.
+   */
+  static SensorProcessorBase::Ptr createSensorProcessor(ros::NodeHandle& nodeHandle, const std::string& sensorType) {
+    const SensorProcessorBase::GeneralParameters generalParameters("base", "map");
+    SensorProcessorBase::Ptr sensorProcessor;
+    if (sensorType == "structured_light") {
+      sensorProcessor = std::make_unique<StructuredLightSensorProcessor>(nodeHandle, generalParameters);
+    } else if (sensorType == "stereo") {
+      sensorProcessor = std::make_unique<StereoSensorProcessor>(nodeHandle, generalParameters);
+    } else if (sensorType == "laser") {
+      sensorProcessor = std::make_unique<LaserSensorProcessor>(nodeHandle, generalParameters);
+    } else if (sensorType == "perfect") {
+      sensorProcessor = std::make_unique<PerfectSensorProcessor>(nodeHandle, generalParameters);
+    } else {
+      return nullptr;
+    }
+    if (!sensorProcessor->readParameters()) {
+      return nullptr;
+    }
+    for (const auto& parameter : SyntheticScene::getSensorParameters(sensorType)) {
+      sensorProcessor->sensorParameters_[parameter.first] = parameter.second;
+    }
+    setStaticTransform(*sensorProcessor, SyntheticScene::getRobotPose(0.0), "map", "base");
+    setStaticTransform(*sensorProcessor, SyntheticScene::getSensorPose(getGeometry(sensorType)), "base", "sensor");
+    return sensorProcessor;
+  }
+
+  //! Gets the geometry of the synthetic point clouds for a sensor type.
+  static SyntheticScene::SensorGeometry getGeometry(const std::string& sensorType) {
+    return sensorType == "laser" ? SyntheticScene::SensorGeometry::Laser : SyntheticScene::SensorGeometry::Camera;
+  }
+
+ private:
+  static void setStaticTransform(SensorProcessorBase& sensorProcessor, const Eigen::Affine3d& transform, const std::string& parentFrameId,
+                                 const std::string& childFrameId) {
+    geometry_msgs::TransformStamped message;
+    message.header.frame_id = parentFrameId;
+    message.child_frame_id = childFrameId;
+    message.transform.translation.x = transform.translation().x();
+    message.transform.translation.y = transform.translation().y();
+    message.transform.translation.z = transform.translation().z();
+    const Eigen::Quaterniond rotation(transform.linear());
+    message.transform.rotation.x = rotation.x();
+    message.transform.rotation.y = rotation.y();
+    message.transform.rotation.z = rotation.z();
+    message.transform.rotation.w = rotation.w();
+    sensorProcessor.transformListener_.getTF2BufferPtr()->setTransform(message, "benchmark", true);
+  }
+};
+
+}  // namespace elevation_mapping
+
+namespace {
+
+using elevation_mapping::ElevationMap;
+using elevation_mapping::KernelBenchmarkAccess;
+using elevation_mapping::PointCloudType;
+using elevation_mapping::SyntheticScene;
+
+//! Start of the simulated time, the time steps between the iterations are those of a 10 Hz sensor.
+const ros::Time startTime(1000.0);
+constexpr double timeStep = 0.1;
+
+//! Height variance of the points [m^2].
+constexpr float pointVariance = 1e-4;
+
+/*!
+ * Point cloud in map frame, with its variances and the pose of its sensor.
+ */
+struct MapFramePointCloud {
+  PointCloudType::Ptr pointCloud{new PointCloudType};
+  Eigen::VectorXf variances;
+  Eigen::Affine3d sensorToMap = Eigen::Affine3d::Identity();
+
+  std::vector<ElevationMap::PointCloudMeasurement> getMeasurements(const ros::Time& timeStamp) const {
+    return {ElevationMap::PointCloudMeasurement(pointCloud, variances, timeStamp, sensorToMap)};
+  }
+};
+
+/*!
+ * Generates a synthetic laser point cloud of the robot at the start of its trajectory, in map frame.
+ */
+MapFramePointCloud generateLaserPointCloud(std::size_t numberOfPoints, double maxRange) {
+  MapFramePointCloud result;
+  result.sensorToMap = SyntheticScene::getRobotPose(0.0) * SyntheticScene::getSensorPose(SyntheticScene::SensorGeometry::Laser);
+  SyntheticScene scene;
+  sensor_msgs::PointCloud2 message;
+  scene.generatePointCloud(result.sensorToMap, SyntheticScene::SensorGeometry::Laser, numberOfPoints, maxRange, message);
+  PointCloudType pointCloudSensorFrame;
+  elevation_mapping::fromPointCloud2Message(message, pointCloudSensorFrame);
+  // The map does not expect invalid points, the sensor processors remove them.
+  PointCloudType validPoints;
+  validPoints.reserve(pointCloudSensorFrame.size());
+  for (const auto& point : pointCloudSensorFrame) {
+    if (std::isfinite(point.x) && std::isfinite(point.y) && std::isfinite(point.z)) {
+      validPoints.push_back(point);
+    }
+  }
+  pcl::transformPointCloud(validPoints, *result.pointCloud, result.sensorToMap.cast<float>());
+  result.variances.setConstant(result.pointCloud->size(), pointVariance);
+  return result;
+}
+
+/*!
+ * Generates a point on the terrain for the given ratio of the cells of a map, seen by a sensor above the map center.
+ */
+MapFramePointCloud generateFillPointCloud(ElevationMap& map, double fillRatio) {
+  MapFramePointCloud result;
+  result.sensorToMap.translation() = Eigen::Vector3d(0.0, 0.0, 1.0);
+  const grid_map::GridMap& rawMap = map.getRawGridMap();
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (grid_map::GridMapIterator iterator(rawMap); !iterator.isPastEnd(); ++iterator) {
+    if (uniform(generator) >= fillRatio) {
+      continue;
+    }
+    grid_map::Position position;
+    rawMap.getPosition(*iterator, position);
+    elevation_mapping::PointXYZRGBConfidenceRatio point;
+    point.x = static_cast<float>(position.x());
+    point.y = static_cast<float>(position.y());
+    point.z = static_cast<float>(SyntheticScene::getHeight(position.x(), position.y()));
+    result.pointCloud->push_back(point);
+  }
+  result.variances.setConstant(result.pointCloud->size(), pointVariance);
+  return result;
+}
+
+/*!
+ * Creates a map and adds a point for the given ratio of its cells.
+ */
+std::unique_ptr<ElevationMap> createFilledMap(const benchmark::State& state, double fillRatio) {
+  auto map = KernelBenchmarkAccess::createMap(static_cast<double>(state.range(0)), 1e-3 * static_cast<double>(state.range(1)));
+  ros::Time::setNow(startTime);
+  map->add(generateFillPointCloud(*map, fillRatio).getMeasurements(startTime));
+  return map;
+}
+
+//! Arguments: map length [m], resolution [mm], number of points.
+void BM_Add(benchmark::State& state) {
+  const double length = static_cast<double>(state.range(0));
+  auto map = KernelBenchmarkAccess::createMap(length, 1e-3 * static_cast<double>(state.range(1)));
+  const MapFramePointCloud pointCloud = generateLaserPointCloud(static_cast<std::size_t>(state.range(2)), length / 2.0);
+  ros::Time time = startTime;
+  for (auto _ : state) {
+    ros::Time::setNow(time);
+    benchmark::DoNotOptimize(map->add(pointCloud.getMeasurements(time)));
+    time += ros::Duration(timeStep);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pointCloud.pointCloud->size()));
+}
+BENCHMARK(BM_Add)
+    ->ArgNames({"length", "resolution", "points"})
+    ->Args({6, 40, 30000})
+    ->Args({6, 40, 300000})
+    ->Args({20, 50, 300000})
+    ->Args({12, 20, 100000})
+    ->Unit(benchmark::kMillisecond);
+
+//! Arguments: map length [m], resolution [mm], fill ratio [%]. Fuses the entire map.
+void BM_Fuse(benchmark::State& state) {
+  auto map = createFilledMap(state, 1e-2 * static_cast<double>(state.range(2)));
+  for (auto _ : state) {
+    state.PauseTiming();
+    {
+      boost::recursive_mutex::scoped_lock scopedLock(map->getRawDataMutex());
+      map->markRawMapModified();
+    }
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(map->fuseAll());
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(map->getRawGridMap().getSize().prod()));
+}
+BENCHMARK(BM_Fuse)
+    ->ArgNames({"length", "resolution", "fill"})
+    ->Args({6, 40, 10})
+    ->Args({6, 40, 100})
+    ->Args({12, 20, 50})
+    ->Args({20, 50, 100})
+    ->Unit(benchmark::kMillisecond);
+
+//! Arguments: map length [m], resolution [mm], fill ratio [%].
+void BM_MotionUpdate(benchmark::State& state) {
+  auto map = createFilledMap(state, 1e-2 * static_cast<double>(state.range(2)));
+  ros::NodeHandle nodeHandle("~");
+  elevation_mapping::RobotMotionMapUpdater robotMotionMapUpdater(nodeHandle);
+  robotMotionMapUpdater.readParameters();
+  // The pose covariance grows like the one of an odometry.
+  elevation_mapping::RobotMotionMapUpdater::PoseCovariance covariance = elevation_mapping::RobotMotionMapUpdater::PoseCovariance::Zero();
+  double time = 0.0;
+  for (auto _ : state) {
+    time += timeStep;
+    covariance.diagonal().head(3).setConstant(1e-4 * time);
+    covariance.diagonal().tail(3).setConstant(5e-5 * time);
+    const Eigen::Affine3d robotPose = SyntheticScene::getRobotPose(time);
+    const elevation_mapping::RobotMotionMapUpdater::Pose pose(kindr::Position3D(robotPose.translation()),
+                                                            kindr::RotationQuaternionPD(Eigen::Quaterniond(robotPose.linear())));
+    benchmark::DoNotOptimize(robotMotionMapUpdater.update(*map, pose, covariance, startTime + ros::Duration(time)));
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(map->getRawGridMap().getSize().prod()));
+}
+BENCHMARK(BM_MotionUpdate)
+    ->ArgNames({"length", "resolution", "fill"})
+    ->Args({6, 40, 10})
+    ->Args({6, 40, 100})
+    ->Args({12, 20, 50})
+    ->Args({20, 50, 100})
+    ->Unit(benchmark::kMillisecond);
+
+//! Arguments: map length [m], resolution [mm], number of points. Every iteration cleans up after one added point cloud.
+void BM_VisibilityCleanup(benchmark::State& state) {
+  const double length = static_cast<double>(state.range(0));
+  auto map = KernelBenchmarkAccess::createMap(length, 1e-3 * static_cast<double>(state.range(1)));
+  const MapFramePointCloud pointCloud = generateLaserPointCloud(static_cast<std::size_t>(state.range(2)), length / 2.0);
+  ros::Time time = startTime;
+  for (auto _ : state) {
+    state.PauseTiming();
+    ros::Time::setNow(time);
+    map->add(pointCloud.getMeasurements(time));
+    state.ResumeTiming();
+    map->visibilityCleanup(time);
+    time += ros::Duration(timeStep);
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pointCloud.pointCloud->size()));
+}
+BENCHMARK(BM_VisibilityCleanup)
+    ->ArgNames({"length", "resolution", "points"})
+    ->Args({6, 40, 30000})
+    ->Args({12, 20, 100000})
+    ->Args({20, 50, 300000})
+    ->Unit(benchmark::kMillisecond);
+
+//! Arguments: number of values. Builds the distribution like the fusion of one cell.
+void BM_WecdfCompute(benchmark::State& state) {
+  std::mt19937 generator(0);
+  std::normal_distribution<float> values(0.0f, 0.1f);
+  std::uniform_real_distribution<double> weights(0.0, 1.0);
+  std::vector<std::pair<float, double>> data(static_cast<std::size_t>(state.range(0)));
+  for (auto& point : data) {
+    point = {values(generator), weights(generator)};
+  }
+  elevation_mapping::WeightedEmpiricalCumulativeDistributionFunction<float> wecdf;
+  for (auto _ : state) {
+    wecdf.clear();
+    for (const auto& point : data) {
+      wecdf.add(point.first, point.second);
+    }
+    benchmark::DoNotOptimize(wecdf.compute());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_WecdfCompute)->ArgName("values")->RangeMultiplier(4)->Range(4, 1024);
+
+//! Arguments: number of values. Evaluates the quantiles of the upper and lower bounds of the fusion.
+void BM_WecdfQuantile(benchmark::State& state) {
+  std::mt19937 generator(0);
+  std::normal_distribution<float> values(0.0f, 0.1f);
+  std::uniform_real_distribution<double> weights(0.0, 1.0);
+  elevation_mapping::WeightedEmpiricalCumulativeDistributionFunction<float> wecdf;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    wecdf.add(values(generator), weights(generator));
+  }
+  wecdf.compute();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(wecdf.quantile(0.05));
+    benchmark::DoNotOptimize(wecdf.quantile(0.95));
+  }
+  state.SetItemsProcessed(2 * state.iterations());
+}
+BENCHMARK(BM_WecdfQuantile)->ArgName("values")->RangeMultiplier(4)->Range(4, 1024);
+
+//! Arguments: sensor type (index into KernelBenchmarkAccess::getSensorTypes()), number of points. Measures the single pass of
+//! the sensor processor, which filters, transforms and computes the variances of the points.
+void BM_SensorProcessor(benchmark::State& state) {
+  const std::string& sensorType = KernelBenchmarkAccess::getSensorTypes().at(static_cast<std::size_t>(state.range(0)));
+  state.SetLabel(sensorType);
+  ros::NodeHandle nodeHandle("~");
+  elevation_mapping::SensorProcessorBase::Ptr sensorProcessor = KernelBenchmarkAccess::createSensorProcessor(nodeHandle, sensorType);
+  if (!sensorProcessor) {
+    state.SkipWithError("The sensor processor could not be created.");
+    return;
+  }
+  const SyntheticScene::SensorGeometry geometry = KernelBenchmarkAccess::getGeometry(sensorType);
+  SyntheticScene scene;
+  sensor_msgs::PointCloud2 message;
+  scene.generatePointCloud(SyntheticScene::getRobotPose(0.0) * SyntheticScene::getSensorPose(geometry), geometry,
+                           static_cast<std::size_t>(state.range(1)), 3.0, message);
+  message.header.stamp = startTime;
+  message.header.frame_id = "sensor";
+  PointCloudType::Ptr pointCloud(new PointCloudType);
+  elevation_mapping::fromPointCloud2Message(message, *pointCloud);
+  PointCloudType::Ptr pointCloudMapFrame(new PointCloudType);
+  Eigen::VectorXf variances;
+  Eigen::Matrix<double, 6, 6> robotPoseCovariance = Eigen::Matrix<double, 6, 6>::Zero();
+  robotPoseCovariance.diagonal().tail(3).setConstant(5e-5);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sensorProcessor->process(pointCloud, robotPoseCovariance, pointCloudMapFrame, variances, "sensor"));
+  }
+  state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(pointCloud->size()));
+}
+BENCHMARK(BM_SensorProcessor)
+    ->ArgNames({"sensor", "points"})
+    ->Args({0, 76800})
+    ->Args({0, 307200})
+    ->Args({1, 76800})
+    ->Args({1, 307200})
+    ->Args({2, 76800})
+    ->Args({2, 307200})
+    ->Args({3, 76800})
+    ->Args({3, 307200})
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "elevation_mapping_kernel_benchmarks", ros::init_options::NoSigintHandler | ros::init_options::NoRosout);
+  elevation_mapping::SyntheticScene::setUpRosWithoutMaster();
+  // The map reports its resizing and timing on info level.
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn)) {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return EXIT_FAILURE;
+  }
+  benchmark::RunSpecifiedBenchmarks();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,539 @@
+/*
+ * PipelineBenchmark.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ *
+ *   Replays synthetic point clouds or a rosbag through the mapping pipeline as fast as possible and reports the throughput
+ *   and the latencies of the pipeline stages.
+ */
+
+#include "SyntheticScene.hpp"
+
+#include "elevation_mapping/ElevationMap.hpp"
+#include "elevation_mapping/PointCloudConversion.hpp"
+#include "elevation_mapping/RobotMotionMapUpdater.hpp"
+#include "elevation_mapping/sensor_processors/LaserSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/PerfectSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/StereoSensorProcessor.hpp"
+#include "elevation_mapping/sensor_processors/StructuredLightSensorProcessor.hpp"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ROS
+#include <geometry_msgs/PoseWithCovarianceStamped.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <kindr_ros/kindr_ros.hpp>
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <tf/tfMessage.h>
+
+namespace elevation_mapping {
+
+/*!
+ * Drives the elevation map and a sensor processor like the elevation mapping node does for a synchronous input source,
+ * without subscribers and timers. The simulated time follows the time stamps of the point clouds.
+ */
+class PipelineBenchmark {
+ public:
+  //! Configuration of a benchmark run.
+  struct Scenario {
+    std::string name;
+    //! Type of the sensor processor, as in the input sources configuration.
+    std::string sensorType;
+    //! Side length [m] and resolution [m/cell] of the map.
+    double length;
+    double resolution;
+    //! Points per synthetic point cloud, their maximal distance from the sensor [m], and the rate of the point clouds [Hz].
+    std::size_t numberOfPoints;
+    double maxRange;
+    double scanRate;
+    //! Number of point clouds to integrate, 0 for all point clouds of a rosbag.
+    int numberOfScans;
+    //! The map is fused and the visibility cleanup runs after every so many point clouds, never for 0.
+    int fusionInterval;
+    int visibilityCleanupInterval;
+  };
+
+  //! Rosbag to replay instead of the synthetic point clouds.
+  struct RosbagOptions {
+    std::string file;
+    std::string pointCloudTopic = "/points";
+    //! Topic of the geometry_msgs/PoseWithCovarianceStamped robot poses, without motion updates if empty.
+    std::string poseTopic;
+    std::string mapFrameId = "odom";
+    std::string robotBaseFrameId = "base";
+  };
+
+  /*!
+   * Constructor.
+   * @param nodeHandle the node handle to read the parameters of the map and the sensor processor from, if there is a ROS master.
+   */
+  explicit PipelineBenchmark(ros::NodeHandle nodeHandle) : nodeHandle_(std::move(nodeHandle)) {}
+
+  /*!
+   * Gets the reference scenarios, which cover the supported sensor models with typical map sizes and point cloud sizes.
+   * @return the scenarios.
+   */
+  static const std::vector<Scenario>& getReferenceScenarios() {
+    static const std::vector<Scenario> scenarios{
+        {"laser_small", "laser", 6.0, 0.04, 30000, 3.0, 10.0, 100, 10, 10},
+        {"laser_large", "laser", 20.0, 0.05, 300000, 10.0, 10.0, 50, 10, 10},
+        {"perfect_fine", "perfect", 12.0, 0.02, 100000, 6.0, 10.0, 50, 10, 10},
+        {"stereo_fine", "stereo", 4.0, 0.01, 76800, 2.0, 15.0, 100, 10, 10},
+        {"structured_light", "structured_light", 4.0, 0.02, 307200, 3.0, 30.0, 60, 10, 10},
+    };
+    return scenarios;
+  }
+
+  /*!
+   * Runs a scenario with synthetic point clouds.
+   * @param scenario the scenario.
+   * @return true if successful.
+   */
+  bool runSynthetic(const Scenario& scenario) {
+    if (!setup(scenario, "map", "base")) {
+      return false;
+    }
+    const SyntheticScene::SensorGeometry geometry =
+        scenario.sensorType == "laser" ? SyntheticScene::SensorGeometry::Laser : SyntheticScene::SensorGeometry::Camera;
+    const Eigen::Affine3d sensorPose = SyntheticScene::getSensorPose(geometry);
+    setTransform(sensorPose, ros::Time(0), "base", "sensor", true);
+
+    SyntheticScene scene;
+    sensor_msgs::PointCloud2 message;
+    geometry_msgs::PoseWithCovarianceStamped pose;
+    // Typical uncertainties of an odometry, the variances of the position [m^2] and of the orientation [rad^2].
+    for (int i = 0; i < 3; ++i) {
+      pose.pose.covariance[7 * i] = 1e-4;
+      pose.pose.covariance[7 * (i + 3)] = 5e-5;
+    }
+    const ros::Time startTime(1000.0);
+    for (int scan = 0; scan < scenario.numberOfScans; ++scan) {
+      const double time = scan / scenario.scanRate;
+      const ros::Time timeStamp = startTime + ros::Duration(time);
+      const Eigen::Affine3d robotPose = SyntheticScene::getRobotPose(time);
+      setTransform(robotPose, timeStamp, "map", "base", false);
+      pose.header.stamp = timeStamp;
+      const Eigen::Quaterniond robotOrientation(robotPose.linear());
+      pose.pose.pose.position.x = robotPose.translation().x();
+      pose.pose.pose.position.y = robotPose.translation().y();
+      pose.pose.pose.position.z = robotPose.translation().z();
+      pose.pose.pose.orientation.x = robotOrientation.x();
+      pose.pose.pose.orientation.y = robotOrientation.y();
+      pose.pose.pose.orientation.z = robotOrientation.z();
+      pose.pose.pose.orientation.w = robotOrientation.w();
+
+      // The generation of the point cloud is not measured.
+      scene.generatePointCloud(robotPose * sensorPose, geometry, scenario.numberOfPoints, scenario.maxRange, message);
+      message.header.stamp = timeStamp;
+      message.header.frame_id = "sensor";
+      if (!integrate(message, &pose, scenario)) {
+        return false;
+      }
+    }
+    printReport(scenario);
+    return true;
+  }
+
+  /*!
+   * Runs a scenario with the point clouds of a rosbag. The transformations are taken from the /tf and /tf_static topics, and
+   * the point clouds wait for their transformations like in the node.
+   * @param scenario the scenario, the synthetic point cloud parameters are not used.
+   * @param options the rosbag to replay.
+   * @return true if successful.
+   */
+  bool runRosbag(const Scenario& scenario, const RosbagOptions& options) {
+    rosbag::Bag bag;
+    try {
+      bag.open(options.file, rosbag::bagmode::Read);
+    } catch (const rosbag::BagException& exception) {
+      ROS_ERROR("Could not open the rosbag %s: %s", options.file.c_str(), exception.what());
+      return false;
+    }
+    if (!setup(scenario, options.mapFrameId, options.robotBaseFrameId)) {
+      return false;
+    }
+
+    std::vector<std::string> topics{options.pointCloudTopic, "/tf", "/tf_static"};
+    if (!options.poseTopic.empty()) {
+      topics.push_back(options.poseTopic);
+    }
+    rosbag::View view(bag, rosbag::TopicQuery(topics));
+    // Robot poses by time stamp, like the pose cache of the node.
+    std::map<ros::Time, geometry_msgs::PoseWithCovarianceStamped::ConstPtr> poses;
+    for (const rosbag::MessageInstance& messageInstance : view) {
+      if (messageInstance.getTopic() == "/tf" || messageInstance.getTopic() == "/tf_static") {
+        const tf::tfMessage::ConstPtr transforms = messageInstance.instantiate<tf::tfMessage>();
+        if (transforms) {
+          for (const geometry_msgs::TransformStamped& transform : transforms->transforms) {
+            sensorProcessor_->transformListener_.getTF2BufferPtr()->setTransform(transform, "rosbag",
+                                                                                messageInstance.getTopic() == "/tf_static");
+          }
+        }
+        continue;
+      }
+      if (messageInstance.getTopic() == options.poseTopic) {
+        const geometry_msgs::PoseWithCovarianceStamped::ConstPtr pose = messageInstance.instantiate<geometry_msgs::PoseWithCovarianceStamped>();
+        if (pose) {
+          poses[pose->header.stamp] = pose;
+        }
+        continue;
+      }
+      const sensor_msgs::PointCloud2::ConstPtr pointCloud = messageInstance.instantiate<sensor_msgs::PointCloud2>();
+      if (!pointCloud) {
+        continue;
+      }
+      sensorProcessor_->deferPointCloud(pointCloud);
+      sensor_msgs::PointCloud2ConstPtr readyPointCloud;
+      while ((readyPointCloud = sensorProcessor_->takeReadyPointCloud())) {
+        const geometry_msgs::PoseWithCovarianceStamped* pose = nullptr;
+        if (!options.poseTopic.empty()) {
+          auto poseAfter = poses.upper_bound(readyPointCloud->header.stamp);
+          if (poseAfter == poses.begin()) {
+            ROS_WARN_THROTTLE(5, "No robot pose for the point cloud at time %f, skipping it.", readyPointCloud->header.stamp.toSec());
+            map_->getPipelineStatistics().addDroppedFrames(sensorProcessor_->getSourceName());
+            continue;
+          }
+          pose = std::prev(poseAfter)->second.get();
+          poses.erase(poses.begin(), std::prev(poseAfter));
+        }
+        if (!integrate(*readyPointCloud, pose, scenario)) {
+          map_->getPipelineStatistics().addDroppedFrames(sensorProcessor_->getSourceName());
+        }
+        if (scenario.numberOfScans > 0 && numberOfScans_ >= static_cast<std::size_t>(scenario.numberOfScans)) {
+          printReport(scenario);
+          return true;
+        }
+      }
+    }
+    printReport(scenario);
+    return true;
+  }
+
+ private:
+  /*!
+   * Creates the map, the sensor processor and the motion updater of a scenario.
+   * @return true if successful.
+   */
+  bool setup(const Scenario& scenario, const std::string& mapFrameId, const std::string& robotBaseFrameId) {
+    // Destroy the previous map first, it joins the threads of its pools.
+    map_.reset();
+    map_ = std::make_unique<ElevationMap>(nodeHandle_);
+    map_->setFrameId(mapFrameId);
+    map_->setGeometry(grid_map::Length(scenario.length, scenario.length), scenario.resolution, grid_map::Position::Zero());
+    // The same parameters and defaults as the node.
+    nodeHandle_.param("min_variance", map_->minVariance_, pow(0.003, 2));
+    nodeHandle_.param("max_variance", map_->maxVariance_, pow(0.03, 2));
+    nodeHandle_.param("mahalanobis_distance_threshold", map_->mahalanobisDistanceThreshold_, 2.5);
+    nodeHandle_.param("multi_height_noise", map_->multiHeightNoise_, pow(0.003, 2));
+    nodeHandle_.param("min_horizontal_variance", map_->minHorizontalVariance_, pow(scenario.resolution / 2.0, 2));
+    nodeHandle_.param("max_horizontal_variance", map_->maxHorizontalVariance_, 0.5);
+    nodeHandle_.param("enable_visibility_cleanup", map_->enableVisibilityCleanup_, true);
+    nodeHandle_.param("scanning_duration", map_->scanningDuration_, 1.0);
+    nodeHandle_.param("lazy_motion_update", map_->enableLazyMotionUpdate_, false);
+    nodeHandle_.param("fusion_kernel_quantization", map_->fusionKernelQuantization_, 0.0);
+
+    const SensorProcessorBase::GeneralParameters generalParameters(robotBaseFrameId, mapFrameId);
+    sensorProcessor_.reset();
+    if (scenario.sensorType == "structured_light") {
+      sensorProcessor_ = std::make_unique<StructuredLightSensorProcessor>(nodeHandle_, generalParameters);
+    } else if (scenario.sensorType == "stereo") {
+      sensorProcessor_ = std::make_unique<StereoSensorProcessor>(nodeHandle_, generalParameters);
+    } else if (scenario.sensorType == "laser") {
+      sensorProcessor_ = std::make_unique<LaserSensorProcessor>(nodeHandle_, generalParameters);
+    } else if (scenario.sensorType == "perfect") {
+      sensorProcessor_ = std::make_unique<PerfectSensorProcessor>(nodeHandle_, generalParameters);
+    } else {
+      ROS_ERROR("The sensor type %s is not available.", scenario.sensorType.c_str());
+      return false;
+    }
+    if (!sensorProcessor_->readParameters()) {
+      return false;
+    }
+    // The sensor parameters which are not on the parameter server are taken from the configurations of typical sensors.
+    for (const auto& parameter : SyntheticScene::getSensorParameters(scenario.sensorType)) {
+      if (!nodeHandle_.hasParam("sensor_processor/" + parameter.first)) {
+        sensorProcessor_->sensorParameters_[parameter.first] = parameter.second;
+      }
+    }
+    sensorProcessor_->setPipelineStatistics(&map_->getPipelineStatistics(), scenario.sensorType);
+
+    robotMotionMapUpdater_ = std::make_unique<RobotMotionMapUpdater>(nodeHandle_);
+    if (!robotMotionMapUpdater_->readParameters()) {
+      return false;
+    }
+    numberOfScans_ = 0;
+    numberOfPoints_ = 0;
+    duration_ = ros::WallDuration(0.0);
+    return true;
+  }
+
+  /*!
+   * Sets a transformation in the tf buffer of the sensor processor.
+   */
+  void setTransform(const Eigen::Affine3d& transform, const ros::Time& timeStamp, const std::string& parentFrameId,
+                    const std::string& childFrameId, bool isStatic) {
+    geometry_msgs::TransformStamped message;
+    message.header.stamp = timeStamp;
+    message.header.frame_id = parentFrameId;
+    message.child_frame_id = childFrameId;
+    message.transform.translation.x = transform.translation().x();
+    message.transform.translation.y = transform.translation().y();
+    message.transform.translation.z = transform.translation().z();
+    const Eigen::Quaterniond rotation(transform.linear());
+    message.transform.rotation.x = rotation.x();
+    message.transform.rotation.y = rotation.y();
+    message.transform.rotation.z = rotation.z();
+    message.transform.rotation.w = rotation.w();
+    sensorProcessor_->transformListener_.getTF2BufferPtr()->setTransform(message, "benchmark", isStatic);
+  }
+
+  /*!
+   * Converts, processes and adds a point cloud to the map, then fuses the map and runs the visibility cleanup if they are due.
+   * Only this is measured.
+   * @param message the point cloud.
+   * @param pose the pose of the robot, without motion update if nullptr.
+   * @param scenario the scenario.
+   * @return true if successful.
+   */
+  bool integrate(const sensor_msgs::PointCloud2& message, const geometry_msgs::PoseWithCovarianceStamped* pose, const Scenario& scenario) {
+    ros::Time::setNow(message.header.stamp);
+    const ros::WallTime startTime = ros::WallTime::now();
+    PipelineStatistics& statistics = map_->getPipelineStatistics();
+
+    SensorProcessorBase::ScanBuffersPtr scanBuffers = sensorProcessor_->acquireScanBuffers();
+    {
+      PipelineStatistics::ScopedTimer timer(&statistics, sensorProcessor_->getSourceName(), PipelineStage::Conversion);
+      if (!fromPointCloud2Message(message, *scanBuffers->pointCloud)) {
+        ROS_ERROR("Could not convert the point cloud message.");
+        return false;
+      }
+    }
+    // Covariance is stored in row-major in ROS: http://docs.ros.org/api/geometry_msgs/html/msg/PoseWithCovariance.html
+    Eigen::Matrix<double, 6, 6> robotPoseCovariance = Eigen::Matrix<double, 6, 6>::Zero();
+    if (pose != nullptr) {
+      robotPoseCovariance = Eigen::Map<const Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(pose->pose.covariance.data(), 6, 6);
+    }
+    if (!sensorProcessor_->process(scanBuffers->pointCloud, robotPoseCovariance, scanBuffers->pointCloudMapFrame, scanBuffers->variances,
+                                   message.header.frame_id)) {
+      ROS_ERROR("Point cloud could not be processed.");
+      return false;
+    }
+
+    {
+      boost::recursive_mutex::scoped_lock scopedLock(map_->getRawDataMutex());
+      {
+        // The map follows the robot base, whose position is known from the processing.
+        PipelineStatistics::ScopedTimer timer(&statistics, "map", PipelineStage::Move);
+        map_->move(sensorProcessor_->translationMapToBaseInMapFrame_.toImplementation().head(2));
+      }
+      if (pose != nullptr) {
+        RobotMotionMapUpdater::Pose robotPose;
+        kindr_ros::convertFromRosGeometryMsg(pose->pose.pose, robotPose);
+        PipelineStatistics::ScopedTimer timer(&statistics, "map", PipelineStage::Prediction);
+        robotMotionMapUpdater_->update(*map_, robotPose, robotPoseCovariance, message.header.stamp);
+      }
+      const PointCloudType::Ptr& pointCloudMapFrame = scanBuffers->pointCloudMapFrame;
+      std::vector<ElevationMap::PointCloudMeasurement> measurements;
+      measurements.emplace_back(pointCloudMapFrame, scanBuffers->variances.head(pointCloudMapFrame->size()), message.header.stamp,
+                                sensorProcessor_->transformationSensorToMap_);
+      if (!map_->add(measurements)) {
+        ROS_ERROR("Adding point cloud to elevation map failed.");
+        return false;
+      }
+    }
+    ++numberOfScans_;
+    numberOfPoints_ += static_cast<std::size_t>(message.width) * message.height;
+
+    if (scenario.fusionInterval > 0 && numberOfScans_ % scenario.fusionInterval == 0) {
+      boost::recursive_mutex::scoped_lock scopedLock(map_->getFusedDataMutex());
+      map_->fuseAll();
+    }
+    if (scenario.visibilityCleanupInterval > 0 && numberOfScans_ % scenario.visibilityCleanupInterval == 0) {
+      map_->visibilityCleanup(message.header.stamp);
+    }
+    duration_ += ros::WallTime::now() - startTime;
+    return true;
+  }
+
+  /*!
+   * Prints the throughput and the latencies of the stages of the last run.
+   */
+  void printReport(const Scenario& scenario) const {
+    const double seconds = std::max(duration_.toSec(), 1e-9);
+    std::printf("%s: %s, %.1f x %.1f m at %.3f m\n", scenario.name.c_str(), scenario.sensorType.c_str(), scenario.length, scenario.length,
+                scenario.resolution);
+    std::printf("  %zu scans, %zu points in %.3f s: %.1f scans/s, %.3f Mpoints/s\n", numberOfScans_, numberOfPoints_, seconds,
+                numberOfScans_ / seconds, 1e-6 * numberOfPoints_ / seconds);
+    std::printf("  %-18s %-20s %8s %10s %10s %10s %10s %10s\n", "group", "stage", "count", "mean [ms]", "p50 [ms]", "p90 [ms]", "p99 [ms]",
+                "max [ms]");
+
+    std::vector<diagnostic_msgs::DiagnosticStatus> status;
+    map_->getPipelineStatistics().getStatus("", status);
+    for (const auto& groupStatus : status) {
+      std::map<std::string, std::string> values;
+      for (const auto& keyValue : groupStatus.values) {
+        values[keyValue.key] = keyValue.value;
+      }
+      for (std::size_t stage = 0; stage < numberOfPipelineStages; ++stage) {
+        const std::string name = PipelineStatistics::getStageName(static_cast<PipelineStage>(stage));
+        if (values.count(name + " count") == 0) {
+          continue;
+        }
+        std::printf("  %-18s %-20s %8s %10s %10s %10s %10s %10s\n", groupStatus.name.c_str(), name.c_str(), values[name + " count"].c_str(),
+                    values[name + " mean [ms]"].c_str(), values[name + " p50 [ms]"].c_str(), values[name + " p90 [ms]"].c_str(),
+                    values[name + " p99 [ms]"].c_str(), values[name + " max [ms]"].c_str());
+      }
+      if (values["dropped_frames"] != "0") {
+        std::printf("  %-18s %s dropped frames\n", groupStatus.name.c_str(), values["dropped_frames"].c_str());
+      }
+    }
+    std::printf("\n");
+    std::fflush(stdout);
+  }
+
+  //! ROS node handle.
+  ros::NodeHandle nodeHandle_;
+
+  //! The pipeline of the current scenario.
+  std::unique_ptr<ElevationMap> map_;
+  SensorProcessorBase::Ptr sensorProcessor_;
+  std::unique_ptr<RobotMotionMapUpdater> robotMotionMapUpdater_;
+
+  //! Number of integrated point clouds and points, and the time spent for them.
+  std::size_t numberOfScans_ = 0;
+  std::size_t numberOfPoints_ = 0;
+  ros::WallDuration duration_;
+};
+
+}  // namespace elevation_mapping
+
+namespace {
+
+void printUsage() {
+  std::printf(
+      "Usage: elevation_mapping_benchmark [options]\n"
+      "  --scenario <name>         Run a reference scenario, can be repeated. Default: all reference scenarios.\n"
+      "  --list                    List the reference scenarios.\n"
+      "  --scans <n>               Number of point clouds per scenario, 0 for the whole rosbag.\n"
+      "  --rosbag <file>           Replay a rosbag instead of the synthetic point clouds.\n"
+      "  --topic <topic>           Point cloud topic of the rosbag. Default: /points.\n"
+      "  --pose-topic <topic>      Robot pose topic of the rosbag, without motion updates if not given.\n"
+      "  --map-frame <frame>       Map frame of the rosbag. Default: odom.\n"
+      "  --base-frame <frame>      Robot base frame of the rosbag. Default: base.\n"
+      "  --sensor <type>           Sensor processor for the rosbag. Default: laser.\n"
+      "  --length <m>              Side length of the map for the rosbag. Default: 10.\n"
+      "  --resolution <m>          Resolution of the map for the rosbag. Default: 0.05.\n"
+      "  --fusion-interval <n>     Fuse the map every n point clouds, 0 for never. Default: 10.\n"
+      "  --cleanup-interval <n>    Run the visibility cleanup every n point clouds, 0 for never. Default: 10.\n"
+      "Without a ROS master, the parameters of the map and the sensor processor take their default values. With a master, they are\n"
+      "read from the private namespace of the node, e.g. fusion_num_threads.\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "elevation_mapping_benchmark", ros::init_options::NoSigintHandler | ros::init_options::NoRosout);
+
+  using elevation_mapping::PipelineBenchmark;
+  std::vector<std::string> scenarioNames;
+  PipelineBenchmark::RosbagOptions rosbagOptions;
+  PipelineBenchmark::Scenario rosbagScenario{"rosbag", "laser", 10.0, 0.05, 0, 0.0, 0.0, 0, 10, 10};
+  int numberOfScans = -1;
+  int fusionInterval = -1;
+  int visibilityCleanupInterval = -1;
+  for (int i = 1; i < argc; ++i) {
+    const std::string argument(argv[i]);
+    if (argument == "--list") {
+      for (const auto& scenario : PipelineBenchmark::getReferenceScenarios()) {
+        std::printf("%-18s %-18s %5.1f m %6.3f m %8zu points %4d scans\n", scenario.name.c_str(), scenario.sensorType.c_str(),
+                    scenario.length, scenario.resolution, scenario.numberOfPoints, scenario.numberOfScans);
+      }
+      return EXIT_SUCCESS;
+    }
+    if (argument == "--help" || argument == "-h" || i + 1 >= argc) {
+      printUsage();
+      return argument == "--help" || argument == "-h" ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    const std::string value(argv[++i]);
+    if (argument == "--scenario") {
+      scenarioNames.push_back(value);
+    } else if (argument == "--scans") {
+      numberOfScans = std::atoi(value.c_str());
+    } else if (argument == "--rosbag") {
+      rosbagOptions.file = value;
+    } else if (argument == "--topic") {
+      rosbagOptions.pointCloudTopic = value;
+    } else if (argument == "--pose-topic") {
+      rosbagOptions.poseTopic = value;
+    } else if (argument == "--map-frame") {
+      rosbagOptions.mapFrameId = value;
+    } else if (argument == "--base-frame") {
+      rosbagOptions.robotBaseFrameId = value;
+    } else if (argument == "--sensor") {
+      rosbagScenario.sensorType = value;
+    } else if (argument == "--length") {
+      rosbagScenario.length = std::atof(value.c_str());
+    } else if (argument == "--resolution") {
+      rosbagScenario.resolution = std::atof(value.c_str());
+    } else if (argument == "--fusion-interval") {
+      fusionInterval = std::atoi(value.c_str());
+    } else if (argument == "--cleanup-interval") {
+      visibilityCleanupInterval = std::atoi(value.c_str());
+    } else {
+      printUsage();
+      return EXIT_FAILURE;
+    }
+  }
+
+  elevation_mapping::SyntheticScene::setUpRosWithoutMaster();
+  ros::NodeHandle nodeHandle("~");
+  PipelineBenchmark benchmark(nodeHandle);
+
+  const auto applyOverrides = [&](PipelineBenchmark::Scenario& scenario) {
+    if (numberOfScans >= 0) {
+      scenario.numberOfScans = numberOfScans;
+    }
+    if (fusionInterval >= 0) {
+      scenario.fusionInterval = fusionInterval;
+    }
+    if (visibilityCleanupInterval >= 0) {
+      scenario.visibilityCleanupInterval = visibilityCleanupInterval;
+    }
+  };
+
+  if (!rosbagOptions.file.empty()) {
+    applyOverrides(rosbagScenario);
+    return benchmark.runRosbag(rosbagScenario, rosbagOptions) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  const auto& referenceScenarios = PipelineBenchmark::getReferenceScenarios();
+  for (const std::string& name : scenarioNames) {
+    if (std::none_of(referenceScenarios.begin(), referenceScenarios.end(),
+                     [&](const PipelineBenchmark::Scenario& scenario) { return scenario.name == name; })) {
+      ROS_ERROR("The scenario %s does not exist, see --list.", name.c_str());
+      return EXIT_FAILURE;
+    }
+  }
+  bool success = true;
+  for (PipelineBenchmark::Scenario scenario : referenceScenarios) {
+    if (!scenarioNames.empty() && std::find(scenarioNames.begin(), scenarioNames.end(), scenario.name) == scenarioNames.end()) {
+      continue;
+    }
+    applyOverrides(scenario);
+    success = benchmark.runSynthetic(scenario) && success;
+  }
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,158 @@
+/*
+ * SyntheticScene.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "SyntheticScene.hpp"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// ROS
+#include <ros/ros.h>
+
+namespace elevation_mapping {
+
+namespace {
+
+//! Radius of the trajectory of the robot [m] and its speed [m/s].
+constexpr double trajectoryRadius = 5.0;
+constexpr double robotSpeed = 1.0;
+
+//! Minimal horizontal distance of the points from the sensor [m].
+constexpr double minRange = 0.4;
+
+//! Horizontal field of view of the camera [rad].
+constexpr double cameraFieldOfView = 86.0 * M_PI / 180.0;
+
+sensor_msgs::PointField makeField(const std::string& name, uint32_t offset) {
+  sensor_msgs::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = sensor_msgs::PointField::FLOAT32;
+  field.count = 1;
+  return field;
+}
+
+}  // namespace
+
+SyntheticScene::SyntheticScene(unsigned int seed) : generator_(seed) {}
+
+double SyntheticScene::getHeight(double x, double y) {
+  // Steps of 0.15 m on a checkerboard of 1.5 m tiles.
+  const int tile = static_cast<int>(std::floor(x / 1.5)) + static_cast<int>(std::floor(y / 1.5));
+  const double step = ((tile % 4) + 4) % 4 == 0 ? 0.15 : 0.0;
+  return 0.3 * std::sin(0.4 * x) * std::cos(0.3 * y) + step;
+}
+
+Eigen::Affine3d SyntheticScene::getRobotPose(double time) {
+  const double angle = robotSpeed * time / trajectoryRadius;
+  const double x = trajectoryRadius * std::sin(angle);
+  const double y = trajectoryRadius * (1.0 - std::cos(angle));
+  Eigen::Affine3d pose(Eigen::AngleAxisd(angle, Eigen::Vector3d::UnitZ()));
+  pose.translation() = Eigen::Vector3d(x, y, getHeight(x, y) + 0.4);
+  return pose;
+}
+
+Eigen::Affine3d SyntheticScene::getSensorPose(SensorGeometry geometry) {
+  if (geometry == SensorGeometry::Laser) {
+    return Eigen::Affine3d(Eigen::Translation3d(0.0, 0.0, 0.5));
+  }
+  // Optical frame: x to the right, y down and z forward.
+  Eigen::Matrix3d opticalRotation;
+  opticalRotation << 0.0, 0.0, 1.0, -1.0, 0.0, 0.0, 0.0, -1.0, 0.0;
+  Eigen::Affine3d pose(Eigen::AngleAxisd(30.0 * M_PI / 180.0, Eigen::Vector3d::UnitY()) * opticalRotation);
+  pose.translation() = Eigen::Vector3d(0.3, 0.0, 0.3);
+  return pose;
+}
+
+std::map<std::string, double> SyntheticScene::getSensorParameters(const std::string& sensorType) {
+  if (sensorType == "laser") {
+    // config/sensor_processors/velodyne_HDL-32E.yaml
+    return {{"min_radius", 0.018}, {"beam_angle", 0.0006}, {"beam_constant", 0.0015}};
+  }
+  if (sensorType == "stereo") {
+    // config/sensor_processors/aslam.yaml
+    return {{"p_1", 0.03287},  {"p_2", -0.0001276},   {"p_3", 0.4850},
+            {"p_4", 399.1046}, {"p_5", 0.000006735}, {"lateral_factor", 0.001376915},
+            {"depth_to_disparity_factor", 47.3}};
+  }
+  if (sensorType == "structured_light") {
+    // config/sensor_processors/realsense_d435.yaml
+    return {{"cutoff_min_depth", 0.2},   {"cutoff_max_depth", 3.25}, {"normal_factor_a", 0.000611}, {"normal_factor_b", 0.003587},
+            {"normal_factor_c", 0.3515}, {"normal_factor_d", 0.0},   {"normal_factor_e", 1.0},      {"lateral_factor", 0.01576}};
+  }
+  return {};
+}
+
+void SyntheticScene::setUpRosWithoutMaster() {
+  if (ros::master::check()) {
+    return;
+  }
+  ros::master::setRetryTimeout(ros::WallDuration(0.001));
+  if (ros::console::set_logger_level("ros.roscpp", ros::console::levels::Fatal)) {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+}
+
+void SyntheticScene::generatePointCloud(const Eigen::Affine3d& sensorToMap, SensorGeometry geometry, std::size_t numberOfPoints,
+                                        double maxRange, sensor_msgs::PointCloud2& message) {
+  // The camera has an organized point cloud with an aspect ratio of 4:3.
+  if (geometry == SensorGeometry::Camera) {
+    message.width = std::max<uint32_t>(static_cast<uint32_t>(std::round(std::sqrt(4.0 / 3.0 * numberOfPoints))), 1);
+    message.height = std::max<uint32_t>(static_cast<uint32_t>(numberOfPoints / message.width), 1);
+  } else {
+    message.width = static_cast<uint32_t>(numberOfPoints);
+    message.height = 1;
+  }
+  message.fields = {makeField("x", 0), makeField("y", 4), makeField("z", 8), makeField("intensity", 12)};
+  message.is_bigendian = false;
+  message.is_dense = false;
+  message.point_step = 16;
+  message.row_step = message.width * message.point_step;
+  message.data.resize(static_cast<std::size_t>(message.row_step) * message.height);
+
+  const Eigen::Vector3d sensorPosition = sensorToMap.translation();
+  const Eigen::Vector3d forward = sensorToMap.linear() * (geometry == SensorGeometry::Camera ? Eigen::Vector3d::UnitZ() : Eigen::Vector3d::UnitX());
+  const double heading = std::atan2(forward.y(), forward.x());
+  const Eigen::Affine3d mapToSensor = sensorToMap.inverse();
+
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> noise(0.0, 0.01);
+  for (uint32_t row = 0; row < message.height; ++row) {
+    for (uint32_t col = 0; col < message.width; ++col) {
+      double azimuth = 0.0;
+      double distance = 0.0;
+      if (geometry == SensorGeometry::Camera) {
+        // The upper rows see the far terrain.
+        azimuth = (0.5 - (col + 0.5) / message.width) * cameraFieldOfView;
+        distance = minRange + (maxRange - minRange) * (1.0 - (row + 0.5) / message.height);
+      } else {
+        azimuth = 2.0 * M_PI * col / message.width;
+        distance = minRange + (maxRange - minRange) * uniform(generator_);
+      }
+      Eigen::Vector3d pointMapFrame;
+      pointMapFrame.x() = sensorPosition.x() + distance * std::cos(heading + azimuth);
+      pointMapFrame.y() = sensorPosition.y() + distance * std::sin(heading + azimuth);
+      pointMapFrame.z() = getHeight(pointMapFrame.x(), pointMapFrame.y()) + noise(generator_);
+
+      const double type = uniform(generator_);
+      if (type < 0.02) {
+        pointMapFrame.z() += 0.5 + uniform(generator_);
+      }
+      Eigen::Vector3f point = (mapToSensor * pointMapFrame).cast<float>();
+      if (type > 0.98) {
+        point.setConstant(std::numeric_limits<float>::quiet_NaN());
+      }
+      const float fields[4] = {point.x(), point.y(), point.z(), 100.0f};
+      std::memcpy(message.data.data() + row * message.row_step + col * message.point_step, fields, sizeof(fields));
+    }
+  }
+}
+
+}  // namespace elevation_mapping
@@ -0,0 +1,97 @@
+/*
+ * SyntheticScene.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <map>
+#include <random>
+#include <string>
+
+// Eigen
+#include <Eigen/Geometry>
+
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+namespace elevation_mapping {
+
+/*!
+ * Deterministic terrain and robot trajectory to generate point clouds for the benchmarks, without a sensor or a rosbag.
+ * The terrain has smooth hills and steps, the robot drives on a circle of 5 m radius at 1 m/s.
+ */
+class SyntheticScene {
+ public:
+  //! Geometry of the simulated sensor.
+  enum class SensorGeometry {
+    //! Rotating laser scanner, 360 deg around the vertical axis of the sensor frame.
+    Laser,
+    //! Forward looking depth camera with the optical axis along z of the sensor frame, organized point clouds.
+    Camera
+  };
+
+  /*!
+   * Constructor.
+   * @param seed the seed of the measurement noise, the same seed generates the same point clouds.
+   */
+  explicit SyntheticScene(unsigned int seed = 0);
+
+  /*!
+   * Gets the terrain height.
+   * @param x the x-coordinate in the map frame [m].
+   * @param y the y-coordinate in the map frame [m].
+   * @return the height [m].
+   */
+  static double getHeight(double x, double y);
+
+  /*!
+   * Gets the pose of the robot base in the map frame.
+   * @param time the time since the start of the trajectory [s].
+   * @return the pose.
+   */
+  static Eigen::Affine3d getRobotPose(double time);
+
+  /*!
+   * Gets the pose of the sensor in the robot base frame.
+   * @param geometry the geometry of the sensor.
+   * @return the pose, the laser is mounted 0.5 m above the base, the camera 0.3 m above and pitched down by 30 deg.
+   */
+  static Eigen::Affine3d getSensorPose(SensorGeometry geometry);
+
+  /*!
+   * Gets the parameters of a sensor model from the configuration of a typical sensor.
+   * @param sensorType the type of the sensor processor, as in the input sources configuration.
+   * @return the parameters by name, empty for the perfect sensor.
+   */
+  static std::map<std::string, double> getSensorParameters(const std::string& sensorType);
+
+  /*!
+   * Prepares ROS to run the benchmarks without a master, after ros::init(). If no master is running, the advertisements and
+   * subscriptions of the map and the sensor processors time out right away instead of waiting for one. roscpp logs an error
+   * for every call that times out, so the roscpp logger is restricted to fatal messages. Does nothing if a master is running.
+   */
+  static void setUpRosWithoutMaster();
+
+  /*!
+   * Generates a point cloud of the terrain around the sensor. The message has the fields x, y, z and a padding intensity like
+   * most drivers, 2% of the points are invalid (NaN) and 2% are outliers above the terrain.
+   * @param[in] sensorToMap the pose of the sensor in the map frame.
+   * @param[in] geometry the geometry of the sensor.
+   * @param[in] numberOfPoints the number of points.
+   * @param[in] maxRange the maximal horizontal distance of the points from the sensor [m].
+   * @param[out] message the point cloud in the sensor frame, the header is not set.
+   */
+  void generatePointCloud(const Eigen::Affine3d& sensorToMap, SensorGeometry geometry, std::size_t numberOfPoints, double maxRange,
+                          sensor_msgs::PointCloud2& message);
+
+ private:
+  //! Generator of the measurement noise.
+  std::mt19937 generator_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,103 @@
+/*
+ * CellPointAggregate.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+
+namespace elevation_mapping {
+
+/*!
+ * Reduction of the points of one point cloud which fall into the same map cell to at most three representatives, such that
+ * dense point clouds need far fewer updates of the cell.
+ *
+ * The points within the Mahalanobis distance threshold of the cell elevation are reduced to their inverse-variance
+ * weighted mean with the combined variance 1 / sum(1 / variance_i). Fusing this mean with the cell gives the same result as
+ * fusing the points one after the other. The points outside of the threshold are represented by the lowest and the highest
+ * of them, which are handled by the multiple height rules of the map instead. The error of the reduction is bounded by
+ * the threshold, since the threshold of a sequential update only narrows while the points are fused.
+ */
+class CellPointAggregate {
+ public:
+  //! A representative point.
+  struct Representative {
+    //! Height of the point [m].
+    float height;
+    //! Height variance of the point [m^2].
+    float variance;
+    //! Lowest height plus three standard deviations of the represented points, for the visibility cleanup [m].
+    float heightPlusUncertainty;
+    //! Index of the point whose color represents the points.
+    std::size_t pointIndex;
+  };
+
+  /*!
+   * Starts the reduction of the points of a cell with an elevation.
+   * @param elevation the elevation of the cell [m].
+   * @param variance the variance of the cell [m^2].
+   * @param mahalanobisDistanceThreshold the Mahalanobis distance threshold of the multiple height rules.
+   */
+  void reset(float elevation, float variance, float mahalanobisDistanceThreshold);
+
+  /*!
+   * Adds a point of the cell.
+   * @param height the height of the point [m].
+   * @param variance the height variance of the point [m^2].
+   * @param pointIndex the index of the point.
+   */
+  void add(float height, float variance, std::size_t pointIndex);
+
+  /*!
+   * Checks whether there are points within the threshold.
+   * @return true if getMean() is valid.
+   */
+  bool hasMean() const { return meanWeight_ > 0.0f; }
+
+  /*!
+   * Gets the weighted mean of the points within the threshold. The color is the one of the last of these points.
+   * @return the mean.
+   */
+  Representative getMean() const;
+
+  /*!
+   * Gets the number of points outside of the threshold.
+   * @return the number of outliers.
+   */
+  std::size_t getNumberOfOutliers() const { return numberOfOutliers_; }
+
+  /*!
+   * Gets the lowest of the points outside of the threshold, only valid if there are outliers.
+   * @return the lowest outlier.
+   */
+  const Representative& getLowestOutlier() const { return lowestOutlier_; }
+
+  /*!
+   * Gets the highest of the points outside of the threshold, only valid if there are outliers. It is the same point as
+   * the lowest outlier if there is only one.
+   * @return the highest outlier.
+   */
+  const Representative& getHighestOutlier() const { return highestOutlier_; }
+
+ private:
+  //! The cell elevation and the squared threshold scaled by the cell variance.
+  float elevation_ = 0.0f;
+  float thresholdVariance_ = 0.0f;
+
+  //! Sums of the inverse variances and of the weighted heights (relative to the cell elevation) of the points within the
+  //! threshold.
+  float meanWeight_ = 0.0f;
+  float weightedHeightSum_ = 0.0f;
+  float meanHeightPlusUncertainty_ = 0.0f;
+  std::size_t meanPointIndex_ = 0;
+
+  std::size_t numberOfOutliers_ = 0;
+  Representative lowestOutlier_{};
+  Representative highestOutlier_{};
+};
+
+}  // namespace elevation_mapping
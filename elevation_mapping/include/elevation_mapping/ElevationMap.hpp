@@ -8,6 +8,14 @@
 
 #pragma once
 
+// STL
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 // Grid Map
 #include <grid_map_ros/grid_map_ros.hpp>
 
@@ -25,7 +33,17 @@
 #include <ros/ros.h>
 
 // Elevation Mapping
+#include "elevation_mapping/FusedMapPyramid.hpp"
+#include "elevation_mapping/FusionScheduler.hpp"
+#include "elevation_mapping/GridMapDeltaPublisher.hpp"
+#include "elevation_mapping/MapLayers.hpp"
+#include "elevation_mapping/MapSnapshotFile.hpp"
+#include "elevation_mapping/PipelineStatistics.hpp"
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
+#include "elevation_mapping/ThreadPool.hpp"
+#include "elevation_mapping/TileStore.hpp"
+#include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
+#include "elevation_mapping/WeightedExtremeQuantiles.hpp"
 #include "elevation_mapping/postprocessing/PostprocessorPool.hpp"
 
 namespace elevation_mapping {
@@ -62,20 +80,60 @@ class ElevationMap {
    * @param transformationSensorToMap
    * @return true if successful.
    */
-  bool add(const PointCloudType::Ptr pointCloud, Eigen::VectorXf& pointCloudVariances, const ros::Time& timeStamp,
-           const Eigen::Affine3d& transformationSensorToMap);
+  bool add(const PointCloudType::Ptr pointCloud, const Eigen::Ref<const Eigen::VectorXf>& pointCloudVariances,
+           const ros::Time& timeStamp, const Eigen::Affine3d& transformationSensorToMap);
+
+  /*!
+   * Point cloud of one sensor, to be added to the map together with others.
+   */
+  struct PointCloudMeasurement {
+    PointCloudMeasurement(PointCloudType::Ptr pointCloud, const Eigen::Ref<const Eigen::VectorXf>& variances, const ros::Time& timeStamp,
+                          const Eigen::Affine3d& transformationSensorToMap)
+        : pointCloud(std::move(pointCloud)),
+          variances(variances),
+          timeStamp(timeStamp),
+          sensorTranslation(transformationSensorToMap.translation()) {}
+    //! Point cloud data.
+    PointCloudType::Ptr pointCloud;
+    //! Variances of the points.
+    Eigen::Ref<const Eigen::VectorXf> variances;
+    //! Time of the point cloud.
+    ros::Time timeStamp;
+    //! Position of the sensor in the map frame.
+    grid_map::Position3 sensorTranslation;
+  };
+
+  /*!
+   * Add the measurements of several point clouds to the elevation map in one pass. The cells get the same values as when adding
+   * the point clouds one after the other, in the given order, but the clean-up only runs once.
+   * @param measurements the point clouds.
+   * @return true if successful.
+   */
+  bool add(const std::vector<PointCloudMeasurement>& measurements);
+
+  /*!
+   * Variance update of the map cells caused by the uncertainty of the robot motion.
+   * The rotational part only depends on the yaw uncertainty, its Jacobian is affine in the cell position.
+   */
+  struct MotionVarianceUpdate {
+    //! Variance increments (x, y, z) from the translational uncertainty, the same for all cells.
+    Eigen::Vector3f translationVariance;
+    //! Variance of the yaw angle.
+    float yawVariance;
+    //! Yaw axis in the map frame.
+    Eigen::Vector3f yawAxis;
+    //! Position of the map origin w.r.t. the robot, the position of a cell w.r.t. the robot is mapPosition + (x, y, height).
+    Eigen::Vector3d mapPosition;
+  };
 
   /*!
-   * Update the elevation map with variance update data.
-   * @param varianceUpdate the variance update in vertical direction.
-   * @param horizontalVarianceUpdateX the variance update in horizontal x-direction.
-   * @param horizontalVarianceUpdateY the variance update in horizontal y-direction.
-   * @param horizontalVarianceUpdateXY the correlated variance update in horizontal xy-direction.
+   * Update the variances of all valid cells of the elevation map. With the lazy motion update enabled, the update is only
+   * accumulated and applied to a cell when it is read (by add(), fusion, snapshots and getRawGridMap()).
+   * @param motionUpdate the variance update.
    * @param time the time of the update.
    * @return true if successful.
    */
-  bool update(const grid_map::Matrix& varianceUpdate, const grid_map::Matrix& horizontalVarianceUpdateX,
-              const grid_map::Matrix& horizontalVarianceUpdateY, const grid_map::Matrix& horizontalVarianceUpdateXY, const ros::Time& time);
+  bool update(const MotionVarianceUpdate& motionUpdate, const ros::Time& time);
 
   /*!
    * Triggers the fusion of the entire elevation map.
@@ -84,13 +142,46 @@ class ElevationMap {
   bool fuseAll();
 
   /*!
-   * Fuses the elevation map for a certain rectangular area.
+   * Fuses the elevation map within the fusion time budget. The tiles of the map are fused in the order of their priority,
+   * first the tiles in recently requested areas (see fuseArea()), then the tiles by their distance to the center of the
+   * map, which follows the track point. The tiles which are not fused within the budget are fused in the following calls,
+   * until then their cells are invalid in the fused map. Fuses the entire map if no budget is set.
+   * @return true if successful.
+   */
+  bool fuseWithinTimeBudget();
+
+  /*!
+   * Fuses the elevation map for a certain rectangular area. The area is fused first by fuseWithinTimeBudget() for a while.
    * @param position the center position of the area to fuse.
    * @param length the sides lengths of the area to fuse.
    * @return true if successful.
    */
   bool fuseArea(const Eigen::Vector2d& position, const Eigen::Array2d& length);
 
+  /*!
+   * Fuses a rectangular area of the elevation map and serializes it directly from the fused map. The response of the
+   * last request is reused if it is repeated and neither the raw nor the fused map have changed since.
+   * @param position the center position of the submap.
+   * @param length the side lengths of the submap.
+   * @param layers the layers of the submap, all layers if empty.
+   * @param[out] message the submap message.
+   * @return true if successful, false if the submap is outside of the map or a layer does not exist.
+   */
+  bool getFusedSubmap(const grid_map::Position& position, const grid_map::Length& length, const std::vector<std::string>& layers,
+                      grid_map_msgs::GridMap& message);
+
+  /*!
+   * Fuses a rectangular area of the elevation map and gets it from a level of the fused map pyramid.
+   * @param level the level of the pyramid, 0 for the fused map as with getFusedSubmap().
+   * @param position the center position of the submap.
+   * @param length the side lengths of the submap.
+   * @param layers the layers of the submap, all layers if empty.
+   * @param[out] message the submap message.
+   * @return true if successful, false if the level or a layer does not exist or the submap is outside of the map.
+   */
+  bool getFusedSubmapOfLevel(int level, const grid_map::Position& position, const grid_map::Length& length,
+                             const std::vector<std::string>& layers, grid_map_msgs::GridMap& message);
+
   /*!
    * Clears all data of the elevation map (data and time).
    * @return true if successful.
@@ -98,18 +189,45 @@ class ElevationMap {
   bool clear();
 
   /*!
-   * Removes parts of the map based on visibility criterion with ray tracing.
-   * @param transformationSensorToMap
+   * Removes parts of the map based on visibility criterion with ray tracing. Only the rays of the cells updated
+   * since the last cleanup are traced, grouped by their sensor origin and in parallel.
    * @param updatedTime
    */
   void visibilityCleanup(const ros::Time& updatedTime);
 
   /*!
-   * Move the grid map w.r.t. to the grid map frame.
+   * Move the grid map w.r.t. to the grid map frame. With a tile store, the cells leaving the map are written to the
+   * store, and the new cells are read from it.
    * @param position the new location of the elevation map in the map frame.
    */
   void move(const Eigen::Vector2d& position);
 
+  /*!
+   * Enables the tile store, which keeps the cells leaving the map on disk. Fills the empty cells of the map
+   * from the store. Must be called after the geometry of the map has been set.
+   * @param directory the directory of the tile files.
+   * @param tileSize the side length of a tile in cells.
+   * @param maxNumberOfMappedTiles the maximal number of tiles which are memory-mapped at a time.
+   * @return true if successful.
+   */
+  bool enableTileStore(const std::string& directory, int tileSize, int maxNumberOfMappedTiles);
+
+  /*!
+   * Writes a snapshot of the raw map to a binary snapshot file, without fusing it. The raw map is only locked to take
+   * the snapshot.
+   * @param path the path of the file.
+   * @return true if successful.
+   */
+  bool saveSnapshot(const std::string& path);
+
+  /*!
+   * Replaces the raw map with the raw map of a binary snapshot file, an instant warm start without a fusion. The
+   * geometry of the map is set to the one of the snapshot.
+   * @param path the path of the file.
+   * @return true if successful, false if the file cannot be read or misses a layer or is in another frame.
+   */
+  bool loadSnapshot(const std::string& path);
+
   /*!
    * Publishes the (latest) raw elevation map. Optionally, if a postprocessing pipeline was configured,
    * the map is postprocessed before publishing.
@@ -131,16 +249,23 @@ class ElevationMap {
   bool publishVisibilityCleanupMap();
 
   /*!
-   * Gets a reference to the raw grid map.
+   * Gets a reference to the raw grid map. Pending motion updates are applied first.
    * @return the raw grid map.
    */
   grid_map::GridMap& getRawGridMap();
 
   /*!
-   * Sets a raw grid map.
+   * Sets a raw grid map. Adapts the geometry of the maps if the size or the resolution differ, erases the lowest scan
+   * layers in the compact storage mode and discards the pending motion updates.
    * @param map The input raw grid map to set.
    */
-  void setRawGridMap(const grid_map::GridMap& map);
+  void setRawGridMap(grid_map::GridMap map);
+
+  /*!
+   * Marks the entire raw map as modified, such that all cells are fused again.
+   * Has to be called after modifying the raw map through getRawGridMap().
+   */
+  void markRawMapModified();
 
   /*!
    * Gets a reference to the fused grid map.
@@ -154,6 +279,28 @@ class ElevationMap {
    */
   void setFusedGridMap(const grid_map::GridMap& map);
 
+  /*!
+   * Gets an immutable snapshot of the raw grid map. The snapshot is shared by all callers
+   * until the raw map is modified, and can be held without blocking updates of the map.
+   * @return the raw grid map snapshot.
+   */
+  std::shared_ptr<const grid_map::GridMap> getRawMapSnapshot();
+
+  /*!
+   * Gets the latest snapshot of the raw grid map without waiting for a writer of the map. If the raw map is locked by
+   * another thread, e.g. during the integration of a point cloud, the last snapshot taken is returned, which may miss
+   * the latest modifications. Only waits for the raw map if no snapshot has been taken yet.
+   * @return the raw grid map snapshot.
+   */
+  std::shared_ptr<const grid_map::GridMap> getLatestRawMapSnapshot();
+
+  /*!
+   * Gets an immutable snapshot of the fused grid map, including the "uncertainty_range" layer.
+   * The snapshot is shared by all callers until the fused map is modified.
+   * @return the fused grid map snapshot.
+   */
+  std::shared_ptr<const grid_map::GridMap> getFusedMapSnapshot();
+
   /*!
    * Gets the time of last map update.
    * @return time of the last map update.
@@ -187,6 +334,12 @@ class ElevationMap {
    */
   boost::recursive_mutex& getFusedDataMutex();
 
+  /*!
+   * Gets the statistics of the mapping pipeline.
+   * @return the statistics. Thread safe.
+   */
+  PipelineStatistics& getPipelineStatistics() { return pipelineStatistics_; }
+
   /*!
    * Gets the raw data mutex.
    * @return reference to the raw data mutex.
@@ -241,19 +394,207 @@ class ElevationMap {
   void setRawSubmapHeight(const grid_map::Position& initPosition, float mapHeight, double lengthInXSubmap, double lengthInYSubmap,
                           double margin);
 
+  /*!
+   * Replaces the cells of the raw map with the cells of a map at the same positions, except where the mask layer of the
+   * map is NaN. If the cells of the map are aligned with the cells of the raw map, the overlap is copied block-wise.
+   * The raw map is only locked for the copy.
+   * @param sourceMap the map to copy from. Its start index is reset.
+   * @param maskLayer the name of the mask layer, which is not copied. The map is copied without a mask if the layer does not exist.
+   * @return the layers of the map which do not exist in the raw map and were not copied.
+   */
+  std::vector<std::string> maskedReplace(grid_map::GridMap& sourceMap, const std::string& maskLayer);
+
   friend class ElevationMapping;
+  friend class ElevationMapTest;
+  friend class KernelBenchmarkAccess;
+  friend class PipelineBenchmark;
 
  private:
   /*!
    * Fuses a region of the map.
    * @param topLeftIndex the top left index of the region.
    * @param size the size (in number of cells) of the region.
+   * @param copyOnlyRegion if true, only the raw data the region depends on is copied instead of the entire raw map.
+   * @param timeBudget if positive, only the pending tiles of the fusion scheduler are fused, in the order of their
+   * priority, until the time budget [s] is used up. The region must then be the entire map.
    * @return true if successful.
    */
-  bool fuse(const grid_map::Index& topLeftIndex, const grid_map::Index& size);
+  bool fuse(const grid_map::Index& topLeftIndex, const grid_map::Index& size, bool copyOnlyRegion = false, double timeBudget = 0.0);
+
+  /*!
+   * Copies the raw data a region of the fused map depends on, i.e. the region grown by the error ellipses of its
+   * cells, to the raw map area copy.
+   * @param topLeftIndex the top left index of the region.
+   * @param size the size (in number of cells) of the region.
+   */
+  void copyRawMapArea(const grid_map::Index& topLeftIndex, const grid_map::Index& size);
+
+  /*!
+   * Computes how far the error ellipses of the cells of a region reach.
+   * @param map the raw map data.
+   * @param topLeftIndex the top left index of the region.
+   * @param size the size (in number of cells) of the region.
+   * @return the maximal reach of an error ellipse from its cell (in number of cells).
+   */
+  int getFusionRadius(const grid_map::GridMap& map, const grid_map::Index& topLeftIndex, const grid_map::Index& size) const;
+
+  /*!
+   * Computes how far an error ellipse reaches from its cell.
+   * @param maxEigenvalueBound the bound of the largest eigenvalue of the horizontal covariance [m^2].
+   * @param resolution the resolution of the map [m].
+   * @return the reach (in number of cells).
+   */
+  int getFusionRadius(float maxEigenvalueBound, double resolution) const;
 
   /*!
-   * Cleans the elevation map data to stay within the specified bounds.
+   * Bounds the largest eigenvalue of the horizontal covariances of the cells of a region.
+   * @param map the raw map data.
+   * @param topLeftIndex the top left index of the region.
+   * @param size the size (in number of cells) of the region.
+   * @return the bound [m^2].
+   */
+  float getMaxEigenvalueBound(const grid_map::GridMap& map, const grid_map::Index& topLeftIndex, const grid_map::Index& size) const;
+
+  /*!
+   * Computes how far the error ellipses of the cells of a map reach, to invalidate the fused cells which depend on the
+   * modified tiles. Only the bounds of the modified tiles are computed again, the others are cached. Must be called by
+   * every fusion, with the fused map mutex locked.
+   * @param map the raw map data.
+   * @param dirtyTiles the tiles modified since the last fusion.
+   * @return the maximal reach of an error ellipse from its cell (in number of cells).
+   */
+  int getInvalidationRadius(const grid_map::GridMap& map, const TileMask& dirtyTiles);
+
+  //! Weights of the raw cells in the error ellipse of a horizontal covariance, relative to the fused cell.
+  struct FusionKernel {
+    //! Index offsets of the raw cells, in the order they are fused.
+    std::vector<grid_map::Index> offsets;
+    std::vector<float> weights;
+  };
+
+  //! Quantized horizontal covariance (x, y, xy) a fusion kernel is computed for.
+  using FusionKernelKey = std::array<int64_t, 3>;
+  struct FusionKernelKeyHash {
+    std::size_t operator()(const FusionKernelKey& key) const {
+      std::size_t hash = 0;
+      for (const int64_t value : key) {
+        hash = hash * 1000003u ^ std::hash<int64_t>()(value);
+      }
+      return hash;
+    }
+  };
+
+  //! Buffers of fuseCell(), reused for all cells fused by the same thread.
+  struct FusionBuffers {
+    Eigen::ArrayXf means;
+    Eigen::ArrayXf weights;
+    WeightedEmpiricalCumulativeDistributionFunction<float> lowerBoundDistribution;
+    WeightedEmpiricalCumulativeDistributionFunction<float> upperBoundDistribution;
+    WeightedExtremeQuantiles<float> lowerBoundQuantiles;
+    WeightedExtremeQuantiles<float> upperBoundQuantiles;
+    std::unordered_map<FusionKernelKey, FusionKernel, FusionKernelKeyHash> kernels;
+  };
+
+  /*!
+   * Gets the fusion kernel of a horizontal covariance from the cache of the calling thread, computes it if necessary.
+   * @param horizontalVarianceX, horizontalVarianceY, horizontalVarianceXY the horizontal covariance of the fused cell.
+   * @param buffers the buffers of the calling thread.
+   * @return the fusion kernel.
+   */
+  const FusionKernel& getFusionKernel(float horizontalVarianceX, float horizontalVarianceY, float horizontalVarianceXY,
+                                      FusionBuffers& buffers);
+
+  /*!
+   * Computes the weights of the raw cells within the error ellipse of a horizontal covariance.
+   * @param covariance the horizontal covariance matrix.
+   * @param resolution the map resolution.
+   * @param[out] kernel the fusion kernel.
+   */
+  void computeFusionKernel(const Eigen::Matrix2d& covariance, double resolution, FusionKernel& kernel);
+
+  /*!
+   * Fuses a single cell of the map. Only writes to the given cell of the fused map,
+   * such that different cells can be fused in parallel.
+   * @param rawMapCopy the raw map data to fuse.
+   * @param rawLayers the layers of the raw map data.
+   * @param fusedLayers the layers of the fused map.
+   * @param index the index of the cell to fuse.
+   * @param buffers the buffers of the calling thread.
+   */
+  void fuseCell(const grid_map::GridMap& rawMapCopy, const ConstRawMapLayers& rawLayers, const FusedMapLayers& fusedLayers,
+                const grid_map::Index& index, FusionBuffers& buffers);
+
+  /*!
+   * Marks a region of the raw map as modified.
+   * @param topLeftIndex the top left (buffer) index of the region.
+   * @param size the size (in number of cells) of the region.
+   */
+  void markRawMapModified(const grid_map::Index& topLeftIndex, const grid_map::Size& size);
+
+  /*!
+   * Fills the empty cells of a region of the raw map with the data of the underlying map.
+   * The filled cells do not receive the pending motion updates.
+   * @param region the region of the raw map buffer.
+   */
+  void fillFromUnderlyingMap(const grid_map::BufferRegion& region);
+
+  /*!
+   * Writes the cells of the raw map which will leave the map when moving it to the tile store.
+   * @param position the new location of the map.
+   */
+  void storeLeavingCells(const grid_map::Position& position);
+
+  /*!
+   * Fills the empty cells of a region of the raw map with the data of the tile store.
+   * The filled cells do not receive the pending motion updates.
+   * @param region the region of the raw map buffer.
+   */
+  void loadFromTileStore(const grid_map::BufferRegion& region);
+
+  //! Accumulated motion variance updates. The horizontal variances are quadratic forms of the cell position,
+  //! X in (y, height, 1), Y in (x, height, 1) and XY is the bilinear form (y, height, 1) * XY * (x, height, 1)^T.
+  struct MotionVarianceAccumulator {
+    Eigen::Vector3d translationVariance = Eigen::Vector3d::Zero();
+    Eigen::Matrix3d horizontalVarianceX = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d horizontalVarianceY = Eigen::Matrix3d::Zero();
+    Eigen::Matrix3d horizontalVarianceXY = Eigen::Matrix3d::Zero();
+  };
+
+  /*!
+   * Accumulates a motion variance update instead of applying it (lazy motion update).
+   * @param motionUpdate the variance update.
+   */
+  void accumulateMotionUpdate(const MotionVarianceUpdate& motionUpdate);
+
+  /*!
+   * Applies the motion updates accumulated since the cell was last updated. Only writes to the given cell,
+   * such that different cells can be updated in parallel.
+   * @param index the index of the cell.
+   * @param elevation the elevation of the cell, nothing is applied if it is invalid.
+   * @param variance, horizontalVarianceX, horizontalVarianceY, horizontalVarianceXY the variances of the cell.
+   * @return true if the variances of the cell changed.
+   */
+  bool applyPendingMotionUpdate(const grid_map::Index& index, float elevation, float& variance, float& horizontalVarianceX,
+                                float& horizontalVarianceY, float& horizontalVarianceXY);
+
+  /*!
+   * Applies all pending motion updates to the raw map.
+   */
+  void applyPendingMotionUpdates();
+
+  /*!
+   * Discards the pending motion updates, e.g. after the raw map data has been replaced.
+   */
+  void resetPendingMotionUpdates();
+
+  /*!
+   * @return true if there are accumulated motion updates which have not been applied to all cells.
+   */
+  bool hasPendingMotionUpdates() const { return motionUpdateHistory_.size() > 1; }
+
+  /*!
+   * Cleans the elevation map data to stay within the specified bounds. The cells written by add() and update() are
+   * clamped there, this only clamps the tiles modified from outside since the last call.
    * @return true if successful.
    */
   bool clean();
@@ -264,6 +605,58 @@ class ElevationMap {
    */
   void resetFusedData();
 
+  //! Mask with one entry per fusion tile of the map buffer.
+  using TileMask = Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic>;
+
+  //! Ray of the visibility cleanup from the sensor position to the lowest scan point of a cell, in the map frame.
+  struct VisibilityCleanupRay {
+    Eigen::Vector3f sensorPosition;
+    grid_map::Position cellPosition;
+    float lowestScanPoint;
+    //! True if the ray has been deferred from a previous cleanup, because the time budget was exceeded.
+    bool isDeferred;
+  };
+
+  /*!
+   * Collects the rays of the cells updated since the last visibility cleanup and resets their lowest scan points.
+   * Must be called with the raw map mutex locked.
+   * @param[out] rays the rays, appended.
+   */
+  void collectVisibilityCleanupRays(std::vector<VisibilityCleanupRay>& rays);
+
+  //! Layer of the compact storage mode, holding quantized values.
+  using CompactLayer = Eigen::Matrix<int16_t, Eigen::Dynamic, Eigen::Dynamic>;
+
+  //! Lowest scan points and the sensor positions they were measured from, in the compact storage mode. The heights
+  //! are stored in the map frame, the horizontal sensor positions relative to the cell.
+  struct CompactLowestScanLayers {
+    CompactLayer lowestScanPoint;
+    CompactLayer sensorX;
+    CompactLayer sensorY;
+    CompactLayer sensorZ;
+
+    /*!
+     * Resizes the layers and clears all cells.
+     * @param size the size of the map buffer.
+     */
+    void resize(const grid_map::Size& size);
+
+    /*!
+     * Clears a region of the layers.
+     * @param startIndex the top left (buffer) index of the region.
+     * @param size the size (in number of cells) of the region.
+     */
+    void clear(const grid_map::Index& startIndex, const grid_map::Size& size);
+  };
+
+  /*!
+   * Clears the fused data of all cells which depend on modified raw data.
+   * @param bufferSize the size of the raw map buffer.
+   * @param dirtyTiles the tiles of the raw map modified since the last fusion.
+   * @param radiusInCells the maximal reach of an error ellipse of the fused cells (in number of cells).
+   */
+  void invalidateFusedData(const grid_map::Size& bufferSize, const TileMask& dirtyTiles, int radiusInCells);
+
   /*!
    * Cumulative distribution function.
    * @param x the argument value.
@@ -282,24 +675,122 @@ class ElevationMap {
   //! Fused elevation map as grid map.
   grid_map::GridMap fusedMap_;
 
-  //! Visibility cleanup debug map.
-  grid_map::GridMap visibilityCleanupMap_;
+  //! Tiles of the raw map buffer modified since the last fusion. Protected by the raw map mutex.
+  TileMask dirtyTiles_;
+
+  //! Bounds of the largest eigenvalue of the horizontal covariances per tile of the raw map buffer, as of the last fusion.
+  //! The bound of a tile stays valid until it is modified. Protected by the fused map mutex.
+  Eigen::ArrayXXf tileEigenvalueBounds_;
+
+  //! Tiles of the raw map buffer modified from outside of add() and update(), whose variances have to be clamped by the
+  //! next clean(). Protected by the raw map mutex.
+  TileMask cleanupTiles_;
+
+  //! Modification counters of the cell data of the raw and fused map, protected by the corresponding mutex. They are only
+  //! increased when cells may have changed, not when only the time stamp is set or unchanged cells are fused again.
+  std::size_t rawMapVersion_;
+  std::size_t fusedMapVersion_;
+
+  //! Shared snapshots of the raw and fused map, and the modification counter they were taken at. The raw map snapshot is
+  //! only replaced with both the raw map mutex and rawMapSnapshotMutex_ locked, such that it can be read with either.
+  std::shared_ptr<const grid_map::GridMap> rawMapSnapshot_;
+  std::mutex rawMapSnapshotMutex_;
+  std::size_t rawMapSnapshotVersion_;
+  std::shared_ptr<const grid_map::GridMap> fusedMapSnapshot_;
+  std::size_t fusedMapSnapshotVersion_;
+
+  //! Copy of the raw map layers used for fusion, only up to date around the last area fused with fuseArea().
+  //! Protected by the fused map mutex.
+  grid_map::GridMap rawMapAreaCopy_;
+
+  //! Last response of getFusedSubmap(), with its request and the modification counters it was computed at.
+  //! Protected by the fused map mutex.
+  struct FusedSubmapCache {
+    bool isValid = false;
+    grid_map::Position position;
+    grid_map::Length length;
+    std::vector<std::string> layers;
+    std::size_t rawMapVersion = 0;
+    std::size_t fusedMapVersion = 0;
+    grid_map_msgs::GridMap message;
+  };
+  FusedSubmapCache fusedSubmapCache_;
+
+  //! Downsampled levels of the fused map, updated after every fusion. Protected by the fused map mutex.
+  FusedMapPyramid fusedMapPyramid_;
+
+  //! Visibility cleanup debug data, the raw map snapshot used and the computed max. height layer.
+  std::shared_ptr<const grid_map::GridMap> visibilityCleanupRawMap_;
+  grid_map::Matrix visibilityCleanupMaxHeight_;
 
   //! Underlying map, used for ground truth maps, multi-robot mapping etc.
   grid_map::GridMap underlyingMap_;
 
+  //! Latencies, queue depths and dropped frames of the mapping pipeline, shared with the postprocessor pool and the input sources.
+  PipelineStatistics pipelineStatistics_;
+
   //! Thread Pool to handle raw map postprocessing filter pipelines.
   PostprocessorPool postprocessorPool_;
 
+  //! Thread pool to fuse the tiles of the elevation map in parallel.
+  ThreadPool fusionThreadPool_;
+
+  //! Buffers of fuseCell(), one per thread of the fusion thread pool. Protected by the fused map mutex.
+  std::vector<FusionBuffers> fusionBuffers_;
+
+  //! Resolution and covariance quantization step the cached fusion kernels have been computed for.
+  double fusionKernelResolution_;
+  double fusionKernelQuantizationStep_;
+
+  //! Order and progress of the fusion within the time budget. Protected by the fused map mutex.
+  FusionScheduler fusionScheduler_;
+
+  //! Thread pool to integrate disjoint cells of a point cloud in parallel.
+  ThreadPool integrationThreadPool_;
+
+  //! Buffers of add(), reused for every point cloud. Protected by the raw map mutex.
+  std::vector<uint64_t> cellPointKeys_;
+  std::vector<std::size_t> chunkBegins_;
+
+  //! Lowest scan point layers in the compact storage mode, instead of the float layers of the raw map.
+  //! Protected by the raw map mutex.
+  CompactLowestScanLayers compactLowestScanLayers_;
+
+  //! Tiles which contain cells with a lowest scan point since the last visibility cleanup. Protected by the raw map mutex.
+  TileMask visibilityCleanupTiles_;
+
+  //! Rays deferred to the next visibility cleanup because the time budget was exceeded. Protected by the raw map mutex.
+  std::vector<VisibilityCleanupRay> deferredVisibilityCleanupRays_;
+
+  //! Thread pool to trace the rays of the visibility cleanup in parallel.
+  ThreadPool visibilityCleanupThreadPool_;
+
+  //! Max. height layers of the visibility cleanup, one per thread of its thread pool. Only used by visibilityCleanup().
+  std::vector<grid_map::Matrix> visibilityCleanupMaxHeights_;
+
+  //! Cell positions of the rows and columns of the map buffer w.r.t. the robot, used by update(). Protected by the raw map mutex.
+  Eigen::ArrayXf cellPositionsX_;
+  Eigen::ArrayXf cellPositionsY_;
+
+  //! Cumulative motion updates since all cells were last brought up to date, and the entry of this history each cell
+  //! has been updated to. Only used with the lazy motion update, protected by the raw map mutex.
+  std::vector<MotionVarianceAccumulator> motionUpdateHistory_;
+  Eigen::Matrix<uint32_t, Eigen::Dynamic, Eigen::Dynamic> motionUpdateStamps_;
+
   //! True if underlying map has been set, false otherwise.
   bool hasUnderlyingMap_;
 
+  //! Store of the raw map cells outside of the map, if enabled. Protected by the raw map mutex.
+  std::unique_ptr<TileStore> tileStore_;
+
   //! Pose of the elevation map frame w.r.t. the inertial parent frame of the robot (e.g. world, map etc.).
   kindr::HomTransformQuatD pose_;
 
   //! ROS publishers. Publishing of the raw elevation map is handled by the postprocessing pool.
   ros::Publisher elevationMapFusedPublisher_;
   ros::Publisher visibilityCleanupMapPublisher_;
+  std::unique_ptr<GridMapDeltaPublisher> elevationMapFusedDeltaPublisher_;
+  std::vector<ros::Publisher> elevationMapLevelPublishers_;
 
   //! Mutex lock for fused map.
   boost::recursive_mutex fusedMapMutex_;
@@ -327,7 +818,14 @@ class ElevationMap {
   bool enableVisibilityCleanup_;
   bool enableContinuousCleanup_;
   double visibilityCleanupDuration_;
+  double visibilityCleanupTimeBudget_;
   double scanningDuration_;
+  bool enableLazyMotionUpdate_;
+  bool enablePointAggregation_;
+  double fusionKernelQuantization_;
+  bool enableFastFusion_;
+  double fusionTimeBudget_;
+  bool enableCompactLayers_;
 };
 
 }  // namespace elevation_mapping
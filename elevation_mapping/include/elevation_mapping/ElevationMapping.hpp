@@ -29,11 +29,18 @@
 // Boost
 #include <boost/thread.hpp>
 
+// STL
+#include <atomic>
+#include <vector>
+
 // Elevation Mapping
 #include "elevation_mapping/ElevationMap.hpp"
+#include "elevation_mapping/GetPipelineStatistics.h"
+#include "elevation_mapping/GetSubmapOfLevel.h"
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
 #include "elevation_mapping/RobotMotionMapUpdater.hpp"
 #include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
+#include "elevation_mapping/input_sources/InputScheduler.hpp"
 #include "elevation_mapping/input_sources/InputSourceManager.hpp"
 #include "elevation_mapping/sensor_processors/SensorProcessorBase.hpp"
 
@@ -62,7 +69,8 @@ class ElevationMapping {
   /*!
    * Callback function for new data to be added to the elevation map.
    *
-   * @param pointCloudMsg    The point cloud to be fused with the existing data.
+   * @param pointCloudMsg    The point cloud to be fused with the existing data. If nullptr, only the deferred point clouds
+   *                         of the sensor processor are retried.
    * @param publishPointCloud If true, publishes the pointcloud after updating the map.
    * @param sensorProcessor_ The sensorProcessor to use in this callback.
    */
@@ -86,6 +94,13 @@ class ElevationMapping {
    */
   void publishFusedMapCallback(const ros::TimerEvent& timerEvent);
 
+  /*!
+   * Callback function for the diagnostics timer. Publishes the pipeline statistics.
+   *
+   * @param timerEvent    The timer event.
+   */
+  void publishDiagnosticsCallback(const ros::TimerEvent& timerEvent);
+
   /*!
    * Callback function for cleaning map based on visibility ray tracing.
    *
@@ -93,6 +108,13 @@ class ElevationMapping {
    */
   void visibilityCleanupCallback(const ros::TimerEvent& timerEvent);
 
+  /*!
+   * Callback function for the periodic checkpoint of the raw map to the snapshot file.
+   *
+   * @param timerEvent  The timer event.
+   */
+  void snapshotCheckpointCallback(const ros::TimerEvent& timerEvent);
+
   /*!
    * ROS service callback function to trigger the fusion of the entire
    * elevation map.
@@ -112,6 +134,15 @@ class ElevationMapping {
    */
   bool getFusedSubmapServiceCallback(grid_map_msgs::GetGridMap::Request& request, grid_map_msgs::GetGridMap::Response& response);
 
+  /*!
+   * ROS service callback function to return a submap of a level of the fused map pyramid.
+   *
+   * @param request     The ROS service request defining the level, location and size of the submap.
+   * @param response    The ROS service response containing the requested submap.
+   * @return true if successful.
+   */
+  bool getSubmapOfLevelServiceCallback(GetSubmapOfLevel::Request& request, GetSubmapOfLevel::Response& response);
+
   /*!
    * ROS service callback function to return a submap of the raw elevation map.
    *
@@ -179,6 +210,34 @@ class ElevationMapping {
    */
   bool loadMapServiceCallback(grid_map_msgs::ProcessFile::Request& request, grid_map_msgs::ProcessFile::Response& response);
 
+  /*!
+   * ROS service callback function to save the raw map to a binary snapshot file, without fusing it.
+   *
+   * @param request   The ROS service request, the snapshot file parameter is used if the file path is empty.
+   * @param response  The ROS service response.
+   * @return true if successful.
+   */
+  bool saveSnapshotServiceCallback(grid_map_msgs::ProcessFile::Request& request, grid_map_msgs::ProcessFile::Response& response);
+
+  /*!
+   * ROS service callback function to load the raw map from a binary snapshot file.
+   *
+   * @param request     The ROS service request, the snapshot file parameter is used if the file path is empty.
+   * @param response    The ROS service response.
+   * @return true if successful.
+   */
+  bool loadSnapshotServiceCallback(grid_map_msgs::ProcessFile::Request& request, grid_map_msgs::ProcessFile::Response& response);
+
+  /*!
+   * ROS service callback function to return the latencies, queue depths and dropped frames of the mapping pipeline.
+   *
+   * @param request     The ROS service request, optionally resetting the statistics.
+   * @param response    The ROS service response containing one diagnostic status per input source, for the map and for the
+   *                    postprocessing.
+   * @return true if successful.
+   */
+  bool getPipelineStatisticsServiceCallback(GetPipelineStatistics::Request& request, GetPipelineStatistics::Response& response);
+
  private:
   /*!
    * Reads and verifies the ROS parameters.
@@ -219,6 +278,104 @@ class ElevationMapping {
    */
   void visibilityCleanupThread();
 
+  /*!
+   * Separate thread for writing and reading snapshots.
+   */
+  void runSnapshotThread();
+
+  /*!
+   * A processed point cloud, ready to be integrated into the elevation map.
+   */
+  struct ProcessedPointCloud {
+    //! Processed point cloud in map frame and its variances, returned to the sensor processor on destruction.
+    SensorProcessorBase::ScanBuffersPtr scanBuffers;
+    //! Sensor processor that produced the point cloud.
+    const SensorProcessorBase* sensorProcessor = nullptr;
+    //! Time stamp of the point cloud.
+    ros::Time timeStamp;
+    //! Transformation from sensor to map frame at the time of the point cloud.
+    Eigen::Affine3d transformationSensorToMap = Eigen::Affine3d::Identity();
+    //! If true, publishes the map after integrating the point cloud.
+    bool publishPointCloud = false;
+    //! Number of points passed to the sensor processor, after thinning out the point cloud.
+    std::size_t numberOfProcessedPoints = 0;
+    //! Time spent on processing these points, in s. The conversion of the message is not included.
+    double processingDuration = 0.0;
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+  using ProcessedPointClouds = std::vector<ProcessedPointCloud, Eigen::aligned_allocator<ProcessedPointCloud>>;
+
+  /*!
+   * Processes the deferred point clouds of a sensor processor whose transformations are available, and integrates them or
+   * queues them for integration.
+   *
+   * @param publishPointCloud If true, publishes the map after integrating the point clouds.
+   * @param sensorProcessor The sensor processor of the point clouds.
+   */
+  void processReadyPointClouds(bool publishPointCloud, const SensorProcessorBase::Ptr& sensorProcessor);
+
+  /*!
+   * Converts a point cloud message, thins it out to the point budget and processes it with the sensor processor. Does not access
+   * the raw map.
+   *
+   * @param pointCloudMsg The point cloud message.
+   * @param sensorProcessor The sensor processor to use.
+   * @param pointBudget The maximal number of points to process.
+   * @param processedPointCloud The processed point cloud.
+   * @return true if successful.
+   */
+  bool processPointCloud(const sensor_msgs::PointCloud2ConstPtr& pointCloudMsg, const SensorProcessorBase::Ptr& sensorProcessor,
+                         std::size_t pointBudget, ProcessedPointCloud& processedPointCloud);
+
+  /*!
+   * Integrates a batch of processed point clouds into the elevation map. The map location and motion prediction updates are done
+   * once for the whole batch, at the time of its latest point cloud.
+   *
+   * @param processedPointClouds The processed point clouds.
+   */
+  void integratePointClouds(const ProcessedPointClouds& processedPointClouds);
+
+  /*!
+   * Integrates processed point clouds in the order of their time stamps. Point clouds whose time stamps are within the time tolerance
+   * of the oldest point cloud of a batch are integrated together.
+   *
+   * @param processedPointClouds The processed point clouds, sorted on return.
+   */
+  void integratePointCloudsInBatches(ProcessedPointClouds& processedPointClouds);
+
+  /*!
+   * Reduces a point cloud to evenly spaced points, if it has more points than the budget. The other points of organized point
+   * clouds are invalidated instead of removed.
+   *
+   * @param pointBudget The maximal number of points.
+   * @param pointCloud The point cloud before processing.
+   * @return The number of points left.
+   */
+  static std::size_t decimatePointCloud(std::size_t pointBudget, PointCloudType& pointCloud);
+
+  /*!
+   * Reports the processing and integration times and the latencies of integrated point clouds to the input scheduler.
+   *
+   * @param processedPointClouds The point clouds integrated together.
+   * @param integrationDuration The time spent on integrating them, in s.
+   */
+  void reportIntegration(const ProcessedPointClouds& processedPointClouds, double integrationDuration);
+
+  /*!
+   * Queues a processed point cloud for the integration thread. A pending point cloud of the same sensor processor that was not
+   * integrated yet is replaced, so a slow integration cannot queue up data.
+   *
+   * @param processedPointCloud The processed point cloud.
+   */
+  void queuePointCloudForIntegration(ProcessedPointCloud&& processedPointCloud);
+
+  /*!
+   * Separate thread integrating the queued point clouds in the order of their time stamps. The oldest queued point cloud is
+   * integrated together with the queued point clouds within the time tolerance of it.
+   */
+  void runIntegrationThread();
+
   /*!
    * Update the elevation map from the robot motion up to a certain time.
    *
@@ -245,6 +402,12 @@ class ElevationMapping {
    */
   void stopMapUpdateTimer();
 
+  /*!
+   * Gets the time of the last point cloud update, thread-safe.
+   * @return the time of the last point cloud update.
+   */
+  ros::Time getLastPointCloudUpdateTime() const;
+
   /*!
    * Initializes a submap around the robot of the elevation map with a constant height.
    */
@@ -261,6 +424,9 @@ class ElevationMapping {
  protected:
   //! Input sources.
   InputSourceManager inputSources_;
+
+  //! Skips point clouds of the input sources to keep the latency of the map within a budget.
+  InputScheduler inputScheduler_;
   //! ROS subscribers.
   ros::Subscriber pointCloudSubscriber_;  //!< Deprecated, use input_source instead.
   message_filters::Subscriber<geometry_msgs::PoseWithCovarianceStamped> robotPoseSubscriber_;
@@ -268,6 +434,7 @@ class ElevationMapping {
   //! ROS service servers.
   ros::ServiceServer fusionTriggerService_;
   ros::ServiceServer fusedSubmapService_;
+  ros::ServiceServer submapOfLevelService_;
   ros::ServiceServer rawSubmapService_;
   ros::ServiceServer enableUpdatesService_;
   ros::ServiceServer disableUpdatesService_;
@@ -275,6 +442,9 @@ class ElevationMapping {
   ros::ServiceServer maskedReplaceService_;
   ros::ServiceServer saveMapService_;
   ros::ServiceServer loadMapService_;
+  ros::ServiceServer saveSnapshotService_;
+  ros::ServiceServer loadSnapshotService_;
+  ros::ServiceServer pipelineStatisticsService_;
 
   //! Callback thread for the fusion services.
   boost::thread fusionServiceThread_;
@@ -314,14 +484,16 @@ class ElevationMapping {
   //! If true, robot motion updates are ignored.
   bool ignoreRobotMotionUpdates_;
 
-  //! If false, elevation mapping stops updating
-  bool updatesEnabled_;
+  //! If false, elevation mapping stops updating. Set by the services, read by the input processing threads.
+  std::atomic<bool> updatesEnabled_;
 
-  //! Time of the last point cloud update.
+  //! Time of the last point cloud update. Protected by its mutex, see getLastPointCloudUpdateTime().
   ros::Time lastPointCloudUpdateTime_;
+  mutable boost::mutex lastPointCloudUpdateTimeMutex_;
 
-  //! Timer for the robot motion update.
+  //! Timer for the robot motion update. Protected by its mutex, it is reset from the input processing threads.
   ros::Timer mapUpdateTimer_;
+  boost::mutex mapUpdateTimerMutex_;
 
   //! Maximum time that the map will not be updated.
   ros::Duration maxNoUpdateDuration_;
@@ -339,6 +511,13 @@ class ElevationMapping {
   //! If map is fused after every change for debugging/analysis purposes.
   bool isContinuouslyFusing_;
 
+  //! Timer and publisher for the diagnostics of the pipeline statistics.
+  ros::Timer diagnosticsTimer_;
+  ros::Publisher diagnosticsPublisher_;
+
+  //! Duration between two diagnostics messages, zero if they are not published.
+  ros::Duration diagnosticsTimerDuration_;
+
   //! Timer for the raytracing cleanup.
   ros::Timer visibilityCleanupTimer_;
 
@@ -351,8 +530,31 @@ class ElevationMapping {
   //! Callback thread for raytracing cleanup.
   boost::thread visibilityCleanupThread_;
 
-  //! Becomes true when corresponding poses and point clouds can be found
-  bool receivedFirstMatchingPointcloudAndPose_;
+  //! Snapshot file of the raw map, for the warm start and the checkpoints. Empty if disabled.
+  std::string snapshotFile_;
+
+  //! Timer and duration of the checkpoints of the raw map to the snapshot file, zero if disabled.
+  ros::Timer snapshotCheckpointTimer_;
+  ros::Duration snapshotCheckpointTimerDuration_;
+
+  //! Callback queue and thread for the snapshot services and checkpoints, which write to disk.
+  ros::CallbackQueue snapshotQueue_;
+  boost::thread snapshotThread_;
+
+  //! Becomes true when corresponding poses and point clouds can be found. Shared by the input processing threads.
+  std::atomic<bool> receivedFirstMatchingPointcloudAndPose_;
+
+  //! If true, input sources are processed on their own threads and integrated on the integration thread.
+  bool asynchronousInputProcessing_;
+
+  //! Point clouds waiting for integration, at most one per sensor processor. Protected by the integration queue mutex.
+  ProcessedPointClouds integrationQueue_;
+  boost::mutex integrationQueueMutex_;
+  boost::condition_variable integrationQueueCondition_;
+  bool isStoppingIntegration_;
+
+  //! Thread integrating the processed point clouds of all input sources.
+  boost::thread integrationThread_;
 
   //! Name of the mask layer used in the masked replace service
   std::string maskedReplaceServiceMaskLayerName_;
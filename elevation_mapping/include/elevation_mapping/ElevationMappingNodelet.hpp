@@ -0,0 +1,41 @@
+/*
+ * ElevationMappingNodelet.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <memory>
+
+// ROS
+#include <nodelet/nodelet.h>
+
+// Elevation Mapping
+#include "elevation_mapping/ElevationMapping.hpp"
+
+namespace elevation_mapping {
+
+/*!
+ * Runs elevation mapping as a nodelet, such that point clouds from nodelets in the same manager are received and the maps
+ * are published to them as shared pointers, without serialization. It reads the same parameters as the node, from its
+ * private namespace. The callbacks run on the threads of the nodelet manager, num_callback_threads is not used.
+ */
+class ElevationMappingNodelet : public nodelet::Nodelet {
+ public:
+  ElevationMappingNodelet() = default;
+  ~ElevationMappingNodelet() override = default;
+
+ private:
+  /*!
+   * Sets up elevation mapping in the namespace of the nodelet.
+   */
+  void onInit() override;
+
+  //! Elevation mapping.
+  std::unique_ptr<ElevationMapping> elevationMapping_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,116 @@
+/*
+ * FusedMapPyramid.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <vector>
+
+// Eigen
+#include <Eigen/Core>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+namespace elevation_mapping {
+
+/*!
+ * Level-of-detail pyramid of the fused map, for consumers which only need coarse data, e.g. far from the robot. Level l
+ * has a 2^l times coarser resolution than the fused map. A cell of a level covers 2^l x 2^l cells of the fused map, its
+ * elevation is the mean of their elevations and its bounds are the extremes of their bounds. The cells of the levels are
+ * aligned with the cells of the fused map and follow its moves. Only the cells which depend on modified tiles of the
+ * fused map are computed again. Not thread-safe.
+ */
+class FusedMapPyramid {
+ public:
+  //! Maximal number of levels, the cells of the coarsest level cover at most one tile of the fused map.
+  static constexpr int maxNumberOfLevels = 5;
+
+  /*!
+   * Constructor.
+   * @param numberOfLevels the number of levels without the fused map itself, 0 disables the pyramid.
+   */
+  explicit FusedMapPyramid(int numberOfLevels);
+
+  /*!
+   * Gets the number of levels.
+   * @return the number of levels without the fused map itself.
+   */
+  int getNumberOfLevels() const { return static_cast<int>(levels_.size()); }
+
+  /*!
+   * Marks a region of the fused map as modified.
+   * @param topLeftIndex the top left (buffer) index of the region.
+   * @param size the size (in number of cells) of the region.
+   */
+  void markModified(const grid_map::Index& topLeftIndex, const grid_map::Size& size);
+
+  /*!
+   * Marks the entire fused map as modified.
+   */
+  void markAllModified();
+
+  /*!
+   * Updates the levels with the modified cells of the fused map and moves them with the fused map.
+   * @param fusedMap the fused map, with the layers "elevation", "upper_bound" and "lower_bound".
+   */
+  void update(const grid_map::GridMap& fusedMap);
+
+  /*!
+   * Gets a level of the pyramid.
+   * @param level the level, from 1 to the number of levels.
+   * @return the map of the level, with the layers "elevation", "upper_bound" and "lower_bound".
+   */
+  const grid_map::GridMap& getLevel(int level) const { return levels_.at(level - 1).map; }
+
+ private:
+  using CellMask = Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic>;
+
+  //! A level of the pyramid.
+  struct Level {
+    //! Number of cells of the fused map per cell of the level, in each direction.
+    int factor;
+    grid_map::GridMap map;
+    //! The cells of the level which have to be computed regardless of the modified tiles, in buffer indices.
+    CellMask staleCells;
+  };
+
+  /*!
+   * Sets the geometry of the levels for the geometry of the fused map and marks all cells as modified.
+   * @param fusedMap the fused map.
+   */
+  void initialize(const grid_map::GridMap& fusedMap);
+
+  /*!
+   * Computes the cells of a level which depend on modified tiles of the fused map.
+   * @param fusedMap the fused map.
+   * @param level the level.
+   */
+  void updateLevel(const grid_map::GridMap& fusedMap, Level& level) const;
+
+  /*!
+   * Gets the tiles of the fused map which a range of cells of a dimension overlaps.
+   * @param firstIndex the first unwrapped index of the range, can be outside of the map.
+   * @param length the number of cells of the range.
+   * @param bufferSize the size of the buffer dimension of the fused map.
+   * @param bufferStartIndex the start index of the buffer dimension of the fused map.
+   * @return the (buffer) tile indices, empty if the range does not overlap the map.
+   */
+  static std::vector<int> getOverlappedTiles(int firstIndex, int length, int bufferSize, int bufferStartIndex);
+
+  //! The grid maps hold fixed-size Eigen members, which need an aligned allocator.
+  std::vector<Level, Eigen::aligned_allocator<Level>> levels_;
+
+  //! Size and resolution of the fused map the levels are set up for.
+  grid_map::Size fusedMapSize_;
+  double fusedMapResolution_;
+
+  //! Tiles of the fused map modified since the last update.
+  CellMask modifiedTiles_;
+};
+
+}  // namespace elevation_mapping
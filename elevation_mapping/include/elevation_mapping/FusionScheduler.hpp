@@ -0,0 +1,120 @@
+/*
+ * FusionScheduler.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <vector>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+// Eigen
+#include <Eigen/Core>
+
+namespace elevation_mapping {
+
+/*!
+ * Schedules the fusion of the map tile by tile, for the fusion within a time budget. Keeps track of the tiles which
+ * may contain cells that are not fused yet and orders them by priority: first the tiles which overlap recently
+ * requested regions, then the tiles by their distance to a center, e.g. the track point. The tiles which are not fused
+ * within the budget of a cycle stay pending for the next one.
+ *
+ * The tiles are the square blocks of the circular buffer of the map. Not thread-safe.
+ */
+class FusionScheduler {
+ public:
+  using TileMask = Eigen::Array<bool, Eigen::Dynamic, Eigen::Dynamic>;
+
+  /*!
+   * Constructor.
+   * @param tileSize the side length of the tiles, in cells.
+   * @param priorityRegionDuration the time during which a requested region is fused first [s].
+   */
+  explicit FusionScheduler(int tileSize, double priorityRegionDuration = 5.0);
+
+  /*!
+   * Adds a requested region, which is fused first for the priority region duration.
+   * @param position the center of the region.
+   * @param length the side lengths of the region.
+   * @param time the time of the request [s].
+   */
+  void addPriorityRegion(const grid_map::Position& position, const grid_map::Length& length, double time);
+
+  /*!
+   * Marks all tiles of a map as pending.
+   * @param numberOfTiles the number of tiles per dimension.
+   */
+  void markAllPending(const grid_map::Size& numberOfTiles);
+
+  /*!
+   * Marks tiles as pending, e.g. after their fused data has been cleared.
+   * @param tiles the tiles to mark, with true for the tiles to fuse again.
+   */
+  void markPending(const TileMask& tiles);
+
+  /*!
+   * Marks a tile as fused.
+   * @param tile the index of the tile.
+   */
+  void markFused(const grid_map::Index& tile);
+
+  /*!
+   * Marks all tiles of a map as fused, after the entire map has been fused.
+   * @param numberOfTiles the number of tiles per dimension.
+   */
+  void markAllFused(const grid_map::Size& numberOfTiles);
+
+  /*!
+   * Checks whether a tile is pending. Tiles outside of the tracked tiles, e.g. before the first fusion, are pending.
+   * @param tile the index of the tile.
+   * @return true if the tile may contain cells that are not fused yet.
+   */
+  bool isPending(const grid_map::Index& tile) const;
+
+  /*!
+   * Gets the pending tiles in the order in which they should be fused. All tiles are pending if the number of tiles of
+   * the map has changed.
+   * @param map the map, only its geometry is used.
+   * @param center the position around which the tiles are fused first.
+   * @param time the current time [s].
+   * @return the indices of the pending tiles, in the order of their priority.
+   */
+  std::vector<grid_map::Index> getPendingTiles(const grid_map::GridMap& map, const grid_map::Position& center, double time);
+
+ private:
+  //! A requested region.
+  struct PriorityRegion {
+    grid_map::Position position;
+    grid_map::Length length;
+    double time;
+  };
+
+  /*!
+   * Gets the extents of a tile along a dimension of the map. A tile which contains the start of the circular buffer
+   * covers two intervals at opposite borders of the map.
+   * @param map the map.
+   * @param tile the index of the tile along the dimension.
+   * @param dimension 0 for the rows (x), 1 for the columns (y).
+   * @return the intervals [min, max] of positions covered by the tile, one or two.
+   */
+  std::vector<Eigen::Vector2d> getTileExtents(const grid_map::GridMap& map, int tile, int dimension) const;
+
+  //! Side length of the tiles, in cells.
+  int tileSize_;
+
+  //! Time during which a requested region is fused first [s].
+  double priorityRegionDuration_;
+
+  //! Regions requested within the priority region duration.
+  std::vector<PriorityRegion> priorityRegions_;
+
+  //! Tiles which may contain cells that are not fused yet.
+  TileMask pendingTiles_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,155 @@
+/*
+ * GridMapDeltaCoding.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+// Elevation Mapping
+#include "elevation_mapping/GridMapDelta.h"
+
+namespace elevation_mapping {
+
+/*!
+ * Encodes a sequence of grid maps as delta messages. The map is split into square tiles in the index space of the map,
+ * and a message only contains the tiles with a cell which changed since it was last sent. Every given number of
+ * messages, and whenever the geometry or the layers of the map change, a keyframe with the full map is sent. Not
+ * thread-safe.
+ */
+class GridMapDeltaEncoder {
+ public:
+  /*!
+   * Constructor.
+   * @param tileSize the side length of a tile in cells.
+   * @param layers the layers to send losslessly. If empty, all layers of the map which are not quantized are sent.
+   * @param quantizedLayers the layers to send quantized to 16 bit, relative to the range of the values of each tile.
+   * @param keyframeInterval the number of messages from one keyframe to the next, 0 to only send keyframes on request.
+   * @param maxMessageSize the approximate maximal size of a delta message in bytes, 0 for no limit. Changed tiles which
+   *                       do not fit are sent with the next messages. Keyframes are never limited.
+   */
+  GridMapDeltaEncoder(int tileSize, std::vector<std::string> layers, std::vector<std::string> quantizedLayers, int keyframeInterval,
+                      std::size_t maxMessageSize);
+
+  /*!
+   * Encodes the changes of the map since the previous message.
+   * @param map the map.
+   * @param[out] message the delta message.
+   * @return true if successful, false if a layer is missing in the map.
+   */
+  bool encode(const grid_map::GridMap& map, GridMapDelta& message);
+
+  /*!
+   * Makes the next message a keyframe, e.g. when a new receiver connects.
+   */
+  void requestKeyframe();
+
+ private:
+  /*!
+   * Checks if a tile changed since it was last sent.
+   * @param map the map.
+   * @param tileIndex the unwrapped index of the top left cell of the tile.
+   * @param tileSize the size of the tile.
+   * @return true if any cell of the tile changed.
+   */
+  bool hasTileChanged(const grid_map::GridMap& map, const grid_map::Index& tileIndex, const grid_map::Size& tileSize) const;
+
+  /*!
+   * Adds a tile to the message and remembers its cells as sent.
+   * @param map the map.
+   * @param tileIndex the unwrapped index of the top left cell of the tile.
+   * @param tileSize the size of the tile.
+   * @param[out] tile the encoded tile.
+   */
+  void encodeTile(const grid_map::GridMap& map, const grid_map::Index& tileIndex, const grid_map::Size& tileSize, GridMapDeltaTile& tile);
+
+  //! Side length of a tile in cells.
+  int tileSize_;
+
+  //! Configured lossless and quantized layers.
+  std::vector<std::string> configuredLayers_;
+  std::vector<std::string> quantizedLayers_;
+
+  //! Lossless layers of the last message.
+  std::vector<std::string> layers_;
+
+  //! Number of messages from one keyframe to the next.
+  int keyframeInterval_;
+
+  //! Approximate maximal size of a delta message [bytes].
+  std::size_t maxMessageSize_;
+
+  //! Last sent values of every cell, before quantization.
+  grid_map::GridMap sentMap_;
+
+  //! Sequence number of the next message.
+  uint32_t sequence_;
+
+  //! Number of messages since the last keyframe.
+  int numberOfMessagesSinceKeyframe_;
+
+  //! True if the next message has to be a keyframe.
+  bool isKeyframeRequested_;
+
+  //! Tile at which the search for changed tiles starts, such that tiles deferred by the size limit are sent first.
+  std::size_t firstTile_;
+};
+
+/*!
+ * Reconstructs a grid map from the delta messages of a GridMapDeltaEncoder. Decoding starts at the first keyframe, and
+ * restarts at the next keyframe if a message is lost. Not thread-safe.
+ */
+class GridMapDeltaDecoder {
+ public:
+  /*!
+   * Constructor.
+   */
+  GridMapDeltaDecoder();
+
+  /*!
+   * Applies a delta message to the map.
+   * @param message the delta message.
+   * @return true if the map was updated, false if the message was skipped while waiting for a keyframe.
+   */
+  bool decode(const GridMapDelta& message);
+
+  /*!
+   * @return true if a keyframe has been decoded and no message was lost since.
+   */
+  bool hasMap() const { return hasMap_; }
+
+  /*!
+   * @return the reconstructed map.
+   */
+  const grid_map::GridMap& getMap() const { return map_; }
+
+ private:
+  /*!
+   * Writes a tile to the map.
+   * @param message the delta message.
+   * @param tile the tile.
+   * @return true if successful, false if the tile is inconsistent with the message.
+   */
+  bool decodeTile(const GridMapDelta& message, const GridMapDeltaTile& tile);
+
+  //! Reconstructed map.
+  grid_map::GridMap map_;
+
+  //! True if the map is up to date with the messages.
+  bool hasMap_;
+
+  //! Sequence number of the last decoded message.
+  uint32_t sequence_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,66 @@
+/*
+ * GridMapDeltaPublisher.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <memory>
+#include <string>
+
+// Boost
+#include <boost/thread/mutex.hpp>
+
+// ROS
+#include <ros/ros.h>
+
+// Elevation Mapping
+#include "elevation_mapping/GridMapDeltaCoding.hpp"
+
+namespace elevation_mapping {
+
+/*!
+ * Publishes a grid map as delta messages on the topic <topic>_delta, if delta publishing is enabled by the parameters.
+ * A keyframe is sent whenever a new subscriber connects. Thread-safe.
+ */
+class GridMapDeltaPublisher {
+ public:
+  /*!
+   * Constructor.
+   * @param nodeHandle the node handle to read the parameters from and to advertise the topic.
+   * @param topic the topic of the full grid map.
+   */
+  GridMapDeltaPublisher(ros::NodeHandle& nodeHandle, const std::string& topic);
+
+  /*!
+   * Publishes the changes of the map since the previous message.
+   * @param map the map.
+   * @return true if a message was published.
+   */
+  bool publish(const grid_map::GridMap& map);
+
+  /*!
+   * @return true if delta publishing is enabled and someone listens to the delta topic.
+   */
+  bool hasSubscribers() const;
+
+ private:
+  /*!
+   * Requests a keyframe for a new subscriber.
+   */
+  void subscriberConnectCallback(const ros::SingleSubscriberPublisher& subscriber);
+
+  //! Encoder, only set if delta publishing is enabled.
+  std::unique_ptr<GridMapDeltaEncoder> encoder_;
+
+  //! Publisher of the delta messages.
+  ros::Publisher publisher_;
+
+  //! Mutex lock for the encoder.
+  boost::mutex encoderMutex_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,181 @@
+/*
+ * MapLayers.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+namespace elevation_mapping {
+
+//! The fixed layers of the raw map. The basic layers come first.
+enum class RawMapLayer : std::size_t {
+  Elevation,
+  Variance,
+  HorizontalVarianceX,
+  HorizontalVarianceY,
+  HorizontalVarianceXY,
+  Color,
+  Time,
+  DynamicTime,
+  LowestScanPoint,
+  SensorXAtLowestScan,
+  SensorYAtLowestScan,
+  SensorZAtLowestScan
+};
+
+//! The fixed layers of the fused map. The basic layers come first.
+enum class FusedMapLayer : std::size_t { Elevation, UpperBound, LowerBound, Color };
+
+//! Names and number of the layers of a fixed layer set.
+template <typename Layer>
+struct MapLayerTraits;
+
+template <>
+struct MapLayerTraits<RawMapLayer> {
+  static constexpr std::size_t numberOfLayers = 12;
+  static constexpr std::size_t numberOfBasicLayers = 2;
+  static constexpr const char* getName(RawMapLayer layer) {
+    switch (layer) {
+      case RawMapLayer::Elevation:
+        return "elevation";
+      case RawMapLayer::Variance:
+        return "variance";
+      case RawMapLayer::HorizontalVarianceX:
+        return "horizontal_variance_x";
+      case RawMapLayer::HorizontalVarianceY:
+        return "horizontal_variance_y";
+      case RawMapLayer::HorizontalVarianceXY:
+        return "horizontal_variance_xy";
+      case RawMapLayer::Color:
+        return "color";
+      case RawMapLayer::Time:
+        return "time";
+      case RawMapLayer::DynamicTime:
+        return "dynamic_time";
+      case RawMapLayer::LowestScanPoint:
+        return "lowest_scan_point";
+      case RawMapLayer::SensorXAtLowestScan:
+        return "sensor_x_at_lowest_scan";
+      case RawMapLayer::SensorYAtLowestScan:
+        return "sensor_y_at_lowest_scan";
+      case RawMapLayer::SensorZAtLowestScan:
+        return "sensor_z_at_lowest_scan";
+    }
+    return "";
+  }
+};
+
+template <>
+struct MapLayerTraits<FusedMapLayer> {
+  static constexpr std::size_t numberOfLayers = 4;
+  static constexpr std::size_t numberOfBasicLayers = 3;
+  static constexpr const char* getName(FusedMapLayer layer) {
+    switch (layer) {
+      case FusedMapLayer::Elevation:
+        return "elevation";
+      case FusedMapLayer::UpperBound:
+        return "upper_bound";
+      case FusedMapLayer::LowerBound:
+        return "lower_bound";
+      case FusedMapLayer::Color:
+        return "color";
+    }
+    return "";
+  }
+};
+
+/*!
+ * Gets the names of the layers of a fixed layer set, to create a grid map with these layers.
+ * @param onlyBasicLayers if true, only the names of the basic layers are returned.
+ * @return the names of the layers, in the order of the layer enum.
+ */
+template <typename Layer>
+std::vector<std::string> getMapLayerNames(bool onlyBasicLayers = false) {
+  using Traits = MapLayerTraits<Layer>;
+  std::size_t numberOfLayers = Traits::numberOfLayers;
+  if (onlyBasicLayers) {
+    numberOfLayers = Traits::numberOfBasicLayers;
+  }
+  std::vector<std::string> names;
+  for (std::size_t i = 0; i < numberOfLayers; ++i) {
+    names.emplace_back(Traits::getName(static_cast<Layer>(i)));
+  }
+  return names;
+}
+
+/*!
+ * Handles to the layers of a fixed layer set of a grid map, resolved once from the layer names, such that accessing a
+ * layer in a loop over cells does not look up its name. The map keeps its named layers for publishing and
+ * postprocessing. The handles stay valid as long as no layers are added to or removed from the map, and the map is
+ * not moved in memory, copied over or swapped.
+ *
+ * Layers of the set which do not exist in the map (e.g. the lowest scan point layers in the compact storage mode) have
+ * no handle, see has().
+ */
+template <typename Layer, typename Matrix = grid_map::Matrix>
+class MapLayers {
+ public:
+  using Traits = MapLayerTraits<Layer>;
+  using GridMap = typename std::conditional<std::is_const<Matrix>::value, const grid_map::GridMap, grid_map::GridMap>::type;
+
+  /*!
+   * Resolves the handles of the layers.
+   * @param map the map, whose basic layers must be the basic layers of the layer set.
+   */
+  explicit MapLayers(GridMap& map) {
+    for (std::size_t i = 0; i < Traits::numberOfLayers; ++i) {
+      const std::string name = Traits::getName(static_cast<Layer>(i));
+      layers_[i] = map.exists(name) ? &map.get(name) : nullptr;
+    }
+  }
+
+  /*!
+   * Checks whether the layer exists in the map.
+   * @param layer the layer.
+   * @return true if the layer has a handle.
+   */
+  bool has(Layer layer) const { return layers_[static_cast<std::size_t>(layer)] != nullptr; }
+
+  /*!
+   * Gets the data of a layer, which must exist in the map.
+   * @param layer the layer.
+   * @return the data of the layer.
+   */
+  Matrix& operator[](Layer layer) const { return *layers_[static_cast<std::size_t>(layer)]; }
+
+  /*!
+   * Checks whether a cell has finite values in all basic layers, like grid_map::GridMap::isValid().
+   * @param index the index of the cell.
+   * @return true if the cell is valid.
+   */
+  bool isValid(const grid_map::Index& index) const {
+    for (std::size_t i = 0; i < Traits::numberOfBasicLayers; ++i) {
+      if (!std::isfinite((*layers_[i])(index(0), index(1)))) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+ private:
+  std::array<Matrix*, Traits::numberOfLayers> layers_;
+};
+
+using RawMapLayers = MapLayers<RawMapLayer>;
+using ConstRawMapLayers = MapLayers<RawMapLayer, const grid_map::Matrix>;
+using FusedMapLayers = MapLayers<FusedMapLayer>;
+
+}  // namespace elevation_mapping
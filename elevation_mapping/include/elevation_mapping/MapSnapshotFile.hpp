@@ -0,0 +1,38 @@
+/*
+ * MapSnapshotFile.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <string>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+namespace elevation_mapping {
+
+/*!
+ * Writes a grid map to a binary snapshot file. The file consists of a header with the geometry, the frame, the timestamp
+ * and the layers of the map, followed by the data of every layer, contiguous in the order of the circular buffer and
+ * aligned to 64 bytes. The file is written next to the path and renamed when complete, such that an existing snapshot
+ * is only replaced by a complete one.
+ * @param map the map.
+ * @param path the path of the file.
+ * @return true if successful.
+ */
+bool writeMapSnapshot(const grid_map::GridMap& map, const std::string& path);
+
+/*!
+ * Reads a grid map from a binary snapshot file. The file is memory-mapped and the layer data is copied into the buffers
+ * of the map, including the start index of the circular buffer.
+ * @param path the path of the file.
+ * @param[out] map the map.
+ * @return true if successful, false if the file cannot be read or has a different format.
+ */
+bool readMapSnapshot(const std::string& path, grid_map::GridMap& map);
+
+}  // namespace elevation_mapping
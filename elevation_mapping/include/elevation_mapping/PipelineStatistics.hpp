@@ -0,0 +1,218 @@
+/*
+ * PipelineStatistics.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <array>
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// Boost
+#include <boost/thread.hpp>
+
+// ROS
+#include <diagnostic_msgs/DiagnosticStatus.h>
+#include <ros/ros.h>
+
+namespace elevation_mapping {
+
+//! Stages of the mapping pipeline whose latencies are recorded.
+enum class PipelineStage {
+  Conversion,
+  TfWait,
+  Filtering,
+  Variance,
+  Move,
+  Prediction,
+  Add,
+  Clean,
+  Fuse,
+  VisibilityCleanup,
+  Postprocess,
+  Publish,
+  LockWait,
+  LockHold
+};
+
+//! Number of pipeline stages.
+constexpr std::size_t numberOfPipelineStages = static_cast<std::size_t>(PipelineStage::LockHold) + 1;
+
+/*!
+ * Histogram of latencies with logarithmically spaced buckets, four per octave from 1 us to about 16 s. The percentiles are
+ * given as the upper bound of their bucket, so they overestimate by at most 19%.
+ */
+class LatencyHistogram {
+ public:
+  /*!
+   * Adds a latency.
+   * @param duration the latency, in s.
+   */
+  void add(double duration);
+
+  /*!
+   * Gets a percentile of the latencies.
+   * @param fraction the fraction of the latencies below the percentile, in [0, 1].
+   * @return the percentile, in s, or 0 if there are no latencies.
+   */
+  double getPercentile(double fraction) const;
+
+  /*!
+   * Gets the mean of the latencies.
+   * @return the mean, in s, or 0 if there are no latencies.
+   */
+  double getMean() const { return count_ > 0 ? sum_ / static_cast<double>(count_) : 0.0; }
+
+  //! Number of latencies.
+  std::size_t getCount() const { return count_; }
+
+  //! Maximum latency, in s.
+  double getMax() const { return max_; }
+
+ private:
+  static constexpr int bucketsPerOctave = 4;
+  static constexpr int numberOfBuckets = 24 * bucketsPerOctave;
+
+  //! Number of latencies per bucket. Bucket i holds the latencies up to 2^((i + 1) / bucketsPerOctave) us, the last one all longer latencies.
+  std::array<std::size_t, numberOfBuckets> buckets_{};
+  std::size_t count_ = 0;
+  double sum_ = 0.0;
+  double max_ = 0.0;
+};
+
+/*!
+ * Latencies, queue depths and dropped frames of the mapping pipeline. The measurements are grouped, e.g. by input source, and
+ * reported as one diagnostic status per group. Thread safe, recording a measurement only takes a short lock.
+ */
+class PipelineStatistics {
+ public:
+  /*!
+   * Measures the duration of a stage from construction to destruction and records it, if there are statistics.
+   */
+  class ScopedTimer {
+   public:
+    /*!
+     * Constructor, starts the measurement.
+     * @param statistics the statistics to record in, may be nullptr.
+     * @param group the group of the measurement.
+     * @param stage the measured stage.
+     */
+    ScopedTimer(PipelineStatistics* statistics, std::string group, PipelineStage stage);
+
+    /*!
+     * Destructor, records the measurement.
+     */
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    PipelineStatistics* statistics_;
+    std::string group_;
+    PipelineStage stage_;
+    ros::WallTime startTime_;
+  };
+
+  /*!
+   * Scoped lock of a map mutex which records the time waited for the mutex and the time it was held, as the stages
+   * lock_wait and lock_hold of a group, if there are statistics.
+   */
+  class ScopedLock {
+   public:
+    /*!
+     * Constructor, locks the mutex.
+     * @param mutex the mutex.
+     * @param statistics the statistics to record in, may be nullptr.
+     * @param group the group of the measurement, e.g. "raw_map".
+     */
+    ScopedLock(boost::recursive_mutex& mutex, PipelineStatistics* statistics, std::string group);
+
+    /*!
+     * Destructor, unlocks the mutex if it is still locked.
+     */
+    ~ScopedLock();
+
+    ScopedLock(const ScopedLock&) = delete;
+    ScopedLock& operator=(const ScopedLock&) = delete;
+
+    /*!
+     * Unlocks the mutex before the end of the scope and records the hold time.
+     */
+    void unlock();
+
+   private:
+    boost::recursive_mutex::scoped_lock lock_;
+    PipelineStatistics* statistics_;
+    std::string group_;
+    ros::WallTime lockTime_;
+  };
+
+  /*!
+   * Gets the name of a stage, as used in the diagnostics.
+   * @param stage the stage.
+   * @return the name, e.g. "tf_wait".
+   */
+  static const char* getStageName(PipelineStage stage);
+
+  /*!
+   * Records the latency of a stage.
+   * @param group the group of the measurement.
+   * @param stage the stage.
+   * @param duration the latency, in s.
+   */
+  void addDuration(const std::string& group, PipelineStage stage, double duration);
+
+  /*!
+   * Records dropped frames.
+   * @param group the group which dropped the frames.
+   * @param numberOfFrames the number of dropped frames.
+   */
+  void addDroppedFrames(const std::string& group, std::size_t numberOfFrames = 1);
+
+  /*!
+   * Records the current depth of a queue.
+   * @param group the group of the queue.
+   * @param queue the name of the queue.
+   * @param depth the number of waiting elements.
+   */
+  void setQueueDepth(const std::string& group, const std::string& queue, std::size_t depth);
+
+  /*!
+   * Gets the statistics as diagnostic status, one per group.
+   * @param prefix prefix of the names of the status, e.g. the node name.
+   * @param status the status, appended.
+   */
+  void getStatus(const std::string& prefix, std::vector<diagnostic_msgs::DiagnosticStatus>& status) const;
+
+  /*!
+   * Clears all measurements.
+   */
+  void reset();
+
+ private:
+  //! Current and maximum depth of a queue.
+  struct QueueDepth {
+    std::size_t current = 0;
+    std::size_t max = 0;
+  };
+
+  //! Measurements of a group.
+  struct Group {
+    std::array<LatencyHistogram, numberOfPipelineStages> latencies;
+    std::size_t numberOfDroppedFrames = 0;
+    std::map<std::string, QueueDepth> queueDepths;
+  };
+
+  //! Measurements by group name, protected by mutex_.
+  std::map<std::string, Group> groups_;
+  mutable boost::mutex mutex_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,31 @@
+/*
+ * PointCloudConversion.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// ROS
+#include <sensor_msgs/PointCloud2.h>
+
+// Elevation Mapping
+#include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
+
+namespace elevation_mapping {
+
+/*!
+ * Converts a point cloud message to the point cloud type used for elevation mapping.
+ * Reads the x, y, z, rgb (or rgba) and confidence_ratio fields in place from the message buffer using
+ * their offsets, without the intermediate pcl::PCLPointCloud2 copy of pcl_conversions::toPCL() and
+ * pcl::fromPCLPointCloud2(). The color is read from a float or unsigned integer rgb or rgba field. Fields which are not in
+ * the message keep the default values of the point type.
+ * @param[in] message the point cloud message.
+ * @param[out] pointCloud the converted point cloud.
+ * @return true if successful, false if the message has no x, y and z fields, a read field ends beyond the point step or its
+ * data is too short.
+ */
+bool fromPointCloud2Message(const sensor_msgs::PointCloud2& message, PointCloudType& pointCloud);
+
+}  // namespace elevation_mapping
@@ -0,0 +1,93 @@
+/*
+ * ThreadPool.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace elevation_mapping {
+
+/*!
+ * A small pool of worker threads to run data parallel loops over independent tasks.
+ * The calling thread participates in the work, so a pool of size 1 runs everything inline.
+ */
+class ThreadPool {
+ public:
+  //! Task function, called with the task index and the index of the executing thread (in [0, size())).
+  using Task = std::function<void(std::size_t taskIndex, std::size_t threadIndex)>;
+
+  /*!
+   * Constructor.
+   * @param numThreads the total number of threads working on a loop (including the calling thread).
+   */
+  explicit ThreadPool(int numThreads = 1);
+
+  /*!
+   * Destructor. Stops and joins all worker threads.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /*!
+   * Gets the total number of threads working on a loop (including the calling thread).
+   * @return the number of threads.
+   */
+  std::size_t size() const;
+
+  /*!
+   * Runs the task for every index in [0, numTasks) and blocks until all tasks are done.
+   * Tasks are handed out dynamically, so the order of execution is undefined. Exceptions thrown
+   * by a task are rethrown in the calling thread after all workers have finished.
+   * @param numTasks the number of tasks.
+   * @param task the task function.
+   */
+  void parallelFor(std::size_t numTasks, const Task& task);
+
+ private:
+  /*!
+   * Main loop of a worker thread.
+   * @param threadIndex the index of the worker thread.
+   */
+  void workerLoop(std::size_t threadIndex);
+
+  /*!
+   * Executes tasks of the current loop until none are left.
+   * @param threadIndex the index of the executing thread.
+   */
+  void runTasks(std::size_t threadIndex);
+
+  //! Worker threads, the calling thread is not part of this list.
+  std::vector<std::thread> workers_;
+
+  //! Serializes calls to parallelFor.
+  std::mutex loopMutex_;
+
+  //! Protects the state of the current loop below.
+  std::mutex stateMutex_;
+  std::condition_variable startCondition_;
+  std::condition_variable doneCondition_;
+
+  //! State of the current loop.
+  const Task* task_;
+  std::size_t numTasks_;
+  std::size_t nextTask_;
+  std::size_t generation_;
+  std::size_t numBusyWorkers_;
+  std::exception_ptr exception_;
+  bool isStopping_;
+};
+
+}  // namespace elevation_mapping
@@ -0,0 +1,154 @@
+/*
+ * TileStore.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Grid Map
+#include <grid_map_core/grid_map_core.hpp>
+
+namespace elevation_mapping {
+
+/*!
+ * Persistent store for the cells of a map which have left the robot-centred map window. The world is split into
+ * square tiles aligned to the map resolution. Every tile is stored in its own file, which is memory-mapped on access,
+ * so only the touched pages are read from disk. At most a given number of tiles is mapped at a time, the least
+ * recently used tiles are unmapped first. Not thread-safe.
+ */
+class TileStore {
+ public:
+  /*!
+   * Constructor.
+   * @param directory the directory of the tile files.
+   * @param tileSize the side length of a tile in cells.
+   * @param resolution the map resolution [m/cell].
+   * @param layers the stored layers. A cell counts as stored if its value of the first layer is finite.
+   * @param maxNumberOfMappedTiles the maximal number of tiles which are mapped at a time.
+   */
+  TileStore(std::string directory, int tileSize, double resolution, std::vector<std::string> layers, std::size_t maxNumberOfMappedTiles);
+
+  /*!
+   * Destructor. Unmaps all tiles, the data is written back by the operating system.
+   */
+  ~TileStore();
+
+  TileStore(const TileStore&) = delete;
+  TileStore& operator=(const TileStore&) = delete;
+
+  /*!
+   * Creates the directory of the tile files if it does not exist.
+   * @return true if successful.
+   */
+  bool initialize();
+
+  /*!
+   * Writes the stored layers of a cell of the map to its tile. An empty cell clears the stored cell.
+   * @param map the map, must contain all stored layers.
+   * @param index the (buffer) index of the cell.
+   * @return true if successful.
+   */
+  bool writeCell(const grid_map::GridMap& map, const grid_map::Index& index);
+
+  /*!
+   * Reads the stored layers of a cell into the map.
+   * @param map the map, must contain all stored layers.
+   * @param index the (buffer) index of the cell.
+   * @return true if the cell was stored, false otherwise.
+   */
+  bool readCell(grid_map::GridMap& map, const grid_map::Index& index);
+
+  /*!
+   * Unmaps all tiles.
+   */
+  void unmapAll();
+
+  /*!
+   * @return the stored layers.
+   */
+  const std::vector<std::string>& getLayers() const { return layers_; }
+
+ private:
+  //! Position of a tile in the world, in number of tiles.
+  using TileKey = std::pair<int64_t, int64_t>;
+
+  //! Memory-mapped tile file.
+  struct MappedTile {
+    void* data;
+    std::list<TileKey>::iterator leastRecentlyUsedPosition;
+  };
+
+  /*!
+   * Computes the tile of a cell and the offset of the cell within the layers of the tile.
+   * @param map the map.
+   * @param index the (buffer) index of the cell.
+   * @param[out] key the tile of the cell.
+   * @param[out] cellOffset the offset of the cell within a layer of the tile.
+   */
+  void getTileOfCell(const grid_map::GridMap& map, const grid_map::Index& index, TileKey& key, std::size_t& cellOffset) const;
+
+  /*!
+   * Gets the data of a tile, maps the tile if needed.
+   * @param key the tile.
+   * @param create if true, the tile is created if it does not exist.
+   * @return the first cell of the first layer, or nullptr if the tile does not exist or could not be mapped.
+   */
+  float* getTileData(const TileKey& key, bool create);
+
+  /*!
+   * Maps a tile file.
+   * @param key the tile.
+   * @param create if true, the tile is created if it does not exist or has an incompatible format.
+   * @return the mapped file, or nullptr if the tile does not exist or could not be mapped.
+   */
+  void* mapTile(const TileKey& key, bool create);
+
+  /*!
+   * @param key the tile.
+   * @return the path of the tile file.
+   */
+  std::string getTilePath(const TileKey& key) const;
+
+  //! Directory of the tile files.
+  std::string directory_;
+
+  //! Side length of a tile in cells.
+  int tileSize_;
+
+  //! Map resolution [m/cell].
+  double resolution_;
+
+  //! Stored layers.
+  std::vector<std::string> layers_;
+
+  //! Maximal number of mapped tiles.
+  std::size_t maxNumberOfMappedTiles_;
+
+  //! Header of the tile files, a tile file is only used if it starts with exactly this header.
+  std::vector<char> header_;
+
+  //! Offset of the cell data in a tile file and size of a tile file [bytes].
+  std::size_t dataOffset_;
+  std::size_t fileSize_;
+
+  //! Mapped tiles, with the most recently used tile at the front of the list.
+  std::map<TileKey, MappedTile> mappedTiles_;
+  std::list<TileKey> leastRecentlyUsedTiles_;
+
+  //! Tiles known to not exist on disk, to avoid looking up the file system for every empty cell.
+  std::set<TileKey> missingTiles_;
+};
+
+}  // namespace elevation_mapping
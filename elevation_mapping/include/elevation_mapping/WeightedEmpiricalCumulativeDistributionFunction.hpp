@@ -8,12 +8,19 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
-#include <map>
 #include <stdexcept>
+#include <utility>
+#include <vector>
 
 namespace elevation_mapping {
 
+/*!
+ * Weighted empirical cumulative distribution function of a set of samples. The samples are stored in
+ * flat arrays, such that an instance can be cleared and reused without reallocating memory.
+ */
 template <typename Type>
 class WeightedEmpiricalCumulativeDistributionFunction {
  public:
@@ -23,11 +30,7 @@ class WeightedEmpiricalCumulativeDistributionFunction {
 
   void add(const Type value, const double weight = 1.0) {
     isComputed_ = false;
-    if (data_.find(value) != data_.end()) {
-      data_[value] += weight;
-    } else {
-      data_.insert(std::pair<Type, double>(value, weight));
-    }
+    data_.push_back(DataPoint{value, weight, data_.size()});
     totalWeight_ += weight;
   }
 
@@ -35,36 +38,48 @@ class WeightedEmpiricalCumulativeDistributionFunction {
     isComputed_ = false;
     totalWeight_ = 0.0;
     data_.clear();
-    distribution_.clear();
+    inverseDistribution_.clear();
   }
 
   bool compute() {
     if (data_.empty()) {
       return false;
     }
-    distribution_.clear();
     inverseDistribution_.clear();
 
+    // Sort by value and merge the weights of equal values (histogram). Equal values keep the order they were added in.
+    std::sort(data_.begin(), data_.end(), [](const DataPoint& a, const DataPoint& b) {
+      return a.value < b.value || (!(b.value < a.value) && a.order < b.order);
+    });
+    std::size_t numberOfValues = 0;
+    for (std::size_t i = 0; i < data_.size(); ++i) {
+      if (numberOfValues > 0 && !(data_[numberOfValues - 1].value < data_[i].value)) {
+        data_[numberOfValues - 1].weight += data_[i].weight;
+      } else {
+        data_[numberOfValues++] = data_[i];
+      }
+    }
+    data_.resize(numberOfValues);
+    for (std::size_t i = 0; i < data_.size(); ++i) {
+      data_[i].order = i;
+    }
+
     if (data_.size() == 1) {
       // Special treatment for size 1.
-      inverseDistribution_.insert(std::pair<double, Type>(0.0, data_.begin()->first));
-      inverseDistribution_.insert(std::pair<double, Type>(1.0, data_.begin()->first));
+      inverseDistribution_.emplace_back(0.0, data_.front().value);
+      inverseDistribution_.emplace_back(1.0, data_.front().value);
       return isComputed_ = true;
     }
 
-    //    double cumulativeWeight = 0.0;
-    //    inverseDistribution_.insert(std::pair<double, Type>(0.0, data_.begin()->first));
-    //    for (const auto& point : data_) {
-    //      cumulativeWeight += point.second;
-    //      inverseDistribution_.insert(inverseDistribution_.end(),
-    //                           std::pair<double, Type>(cumulativeWeight / totalWeight_, point.first));
-    //    }
-
-    double cumulativeWeight = -data_.begin()->second;  // Smallest observation corresponds to a probability of 0.
-    const double adaptedTotalWeight = totalWeight_ - data_.begin()->second;
+    double cumulativeWeight = -data_.front().weight;  // Smallest observation corresponds to a probability of 0.
+    const double adaptedTotalWeight = totalWeight_ - data_.front().weight;
     for (const auto& point : data_) {
-      cumulativeWeight += point.second;
-      inverseDistribution_.insert(inverseDistribution_.end(), std::pair<double, Type>(cumulativeWeight / adaptedTotalWeight, point.first));
+      cumulativeWeight += point.weight;
+      const double probability = cumulativeWeight / adaptedTotalWeight;
+      // Keep the first value of equal probabilities.
+      if (inverseDistribution_.empty() || inverseDistribution_.back().first < probability) {
+        inverseDistribution_.emplace_back(probability, point.value);
+      }
     }
 
     return isComputed_ = true;
@@ -85,14 +100,21 @@ class WeightedEmpiricalCumulativeDistributionFunction {
           "first.");
     }
     if (probability <= 0.0) {
-      return inverseDistribution_.begin()->second;
+      return inverseDistribution_.front().second;
     }
     if (probability >= 1.0) {
-      return inverseDistribution_.rbegin()->second;
+      return inverseDistribution_.back().second;
     }
-    const auto& up = inverseDistribution_.lower_bound(probability);  // First element that is not less than key.
-    auto low = up;                                                   // Copy.
-    --low;
+    // First element that is not less than the probability.
+    const auto up = std::lower_bound(inverseDistribution_.begin(), inverseDistribution_.end(), probability,
+                                     [](const std::pair<double, Type>& point, double value) { return point.first < value; });
+    if (up == inverseDistribution_.end()) {
+      return inverseDistribution_.back().second;
+    }
+    if (up == inverseDistribution_.begin()) {
+      return up->second;
+    }
+    const auto low = up - 1;
     return low->second + (probability - low->first) * (up->second - low->second) / (up->first - low->first);
   }
 
@@ -100,14 +122,7 @@ class WeightedEmpiricalCumulativeDistributionFunction {
     unsigned int i = 0;
     out << "Data points:" << std::endl;
     for (const auto& point : wecdf.data_) {
-      out << "[" << i << "] Value: " << point.first << " Weight: " << point.second << std::endl;
-      ++i;
-    }
-
-    i = 0;
-    out << "Cumulative distribution function:" << std::endl;
-    for (const auto& point : wecdf.distribution_) {
-      out << "[" << i << "] Value: " << point.first << " Prob.: " << point.second << std::endl;
+      out << "[" << i << "] Value: " << point.value << " Weight: " << point.weight << std::endl;
       ++i;
     }
 
@@ -122,12 +137,18 @@ class WeightedEmpiricalCumulativeDistributionFunction {
   }
 
  private:
-  //! Data points stored as value/weight pair (histogram).
-  std::map<Type, double> data_;
-
-  //! Cumulative distribution function (and its inverse) stored as value pair/cumulative probability.
-  std::map<Type, double> distribution_;
-  std::map<double, Type> inverseDistribution_;
+  //! Data point with its weight and the order it was added in.
+  struct DataPoint {
+    Type value;
+    double weight;
+    std::size_t order;
+  };
+
+  //! Data points, sorted by value and merged into a histogram by compute().
+  std::vector<DataPoint> data_;
+
+  //! Inverse cumulative distribution function stored as cumulative probability/value pair, sorted by probability.
+  std::vector<std::pair<double, Type>> inverseDistribution_;
 
   //! Total weight.
   double totalWeight_;
@@ -0,0 +1,115 @@
+/*
+ * WeightedExtremeQuantiles.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace elevation_mapping {
+
+/*!
+ * Quantiles close to the smallest and the largest sample of a weighted set of samples, as computed by
+ * WeightedEmpiricalCumulativeDistributionFunction, but in a single pass without storing or sorting the samples. Only the two
+ * smallest and the two largest values with their weights are kept. The quantiles are exact if they lie between the two
+ * smallest or the two largest values. Otherwise, the second smallest (largest) value is returned, which is a conservative
+ * bound of the exact quantile.
+ */
+template <typename Type>
+class WeightedExtremeQuantiles {
+ public:
+  WeightedExtremeQuantiles() { clear(); }
+
+  void clear() {
+    numberOfSamples_ = 0;
+    totalWeight_ = 0.0;
+    smallest_ = Extremes();
+    largest_ = Extremes();
+  }
+
+  void add(const Type value, const double weight = 1.0) {
+    smallest_.add(value, weight, numberOfSamples_ == 0, [](Type a, Type b) { return a < b; });
+    largest_.add(value, weight, numberOfSamples_ == 0, [](Type a, Type b) { return b < a; });
+    totalWeight_ += weight;
+    ++numberOfSamples_;
+  }
+
+  bool empty() const { return numberOfSamples_ == 0; }
+
+  /*!
+   * Returns a quantile below the lower quartile, the smallest sample corresponds to a probability of 0.
+   * @param probability the order of the quantile, in [0, 0.25].
+   * @return the quantile for the given probability, undefined if there are no samples.
+   */
+  Type lowerQuantile(const double probability) const {
+    if (!smallest_.hasSecond) {
+      return smallest_.first;
+    }
+    // Cumulative probability of the second smallest value.
+    const double secondProbability = smallest_.secondWeight / (totalWeight_ - smallest_.firstWeight);
+    if (probability >= secondProbability) {
+      return smallest_.second;
+    }
+    return smallest_.first + static_cast<Type>(probability / secondProbability) * (smallest_.second - smallest_.first);
+  }
+
+  /*!
+   * Returns a quantile above the upper quartile, the largest sample corresponds to a probability of 1.
+   * @param probability the order of the quantile, in [0.75, 1].
+   * @return the quantile for the given probability, undefined if there are no samples.
+   */
+  Type upperQuantile(const double probability) const {
+    if (!largest_.hasSecond) {
+      return largest_.first;
+    }
+    // Cumulative probability of the second largest value, the weight of the smallest value does not count.
+    const double secondProbability = 1.0 - largest_.firstWeight / (totalWeight_ - smallest_.firstWeight);
+    if (probability <= secondProbability) {
+      return largest_.second;
+    }
+    return largest_.second +
+           static_cast<Type>((probability - secondProbability) / (1.0 - secondProbability)) * (largest_.first - largest_.second);
+  }
+
+ private:
+  //! The two most extreme distinct values in the order of a comparison, with the merged weights of equal samples.
+  struct Extremes {
+    Type first{};
+    double firstWeight = 0.0;
+    Type second{};
+    double secondWeight = 0.0;
+    bool hasSecond = false;
+
+    template <typename Compare>
+    void add(const Type value, const double weight, const bool isFirstSample, Compare isMoreExtreme) {
+      if (isFirstSample) {
+        first = value;
+        firstWeight = weight;
+      } else if (isMoreExtreme(value, first)) {
+        second = first;
+        secondWeight = firstWeight;
+        hasSecond = true;
+        first = value;
+        firstWeight = weight;
+      } else if (!isMoreExtreme(first, value)) {
+        firstWeight += weight;
+      } else if (!hasSecond || isMoreExtreme(value, second)) {
+        second = value;
+        secondWeight = weight;
+        hasSecond = true;
+      } else if (!isMoreExtreme(second, value)) {
+        secondWeight += weight;
+      }
+    }
+  };
+
+  std::size_t numberOfSamples_;
+  double totalWeight_;
+  Extremes smallest_;
+  Extremes largest_;
+};
+
+}  // namespace elevation_mapping
@@ -9,9 +9,14 @@
 #pragma once
 
 #include <XmlRpc.h>
+#include <ros/callback_queue.h>
 #include <ros/ros.h>
+#include <boost/thread.hpp>
+#include <memory>
+#include <mutex>
 #include <string>
 
+#include "elevation_mapping/input_sources/InputScheduler.hpp"
 #include "elevation_mapping/sensor_processors/SensorProcessorBase.hpp"
 
 namespace elevation_mapping {
@@ -33,6 +38,14 @@ class Input {
    */
   explicit Input(ros::NodeHandle nh);
 
+  /**
+   * @brief Destructor. Stops the processing thread.
+   */
+  ~Input();
+
+  Input(Input&&) = default;
+  Input& operator=(Input&&) = default;
+
   /**
    * @brief Configure the input source.
    * @param name Name of this input source.
@@ -44,13 +57,34 @@ class Input {
                  const SensorProcessorBase::GeneralParameters& generalSensorProcessorParameters);
 
   /**
-   * @brief Registers the corresponding callback in the elevationMap.
+   * @brief Registers the corresponding callback in the elevationMap. Unless the transform retry period of the sensor processor is
+   * zero, the callback is also called without a message (nullptr) at that period while the sensor processor has deferred messages,
+   * such that they are processed as soon as their transformations are available. The callbacks of an input never run concurrently.
    * @param map The map we want to link this input source to.
    * @param callback The callback to use for incoming data.
+   * @param useProcessingThread If true, the callback runs on a thread of this input source instead of the global callback queue.
    * @tparam MsgT The message types of the callback.
    */
   template <typename MsgT>
-  void registerCallback(ElevationMapping& map, CallbackT<MsgT> callback);
+  void registerCallback(ElevationMapping& map, CallbackT<MsgT> callback, bool useProcessingThread = false);
+
+  /**
+   * @brief Sets the statistics the sensor processor records in, grouped by the name of this input source.
+   * @param pipelineStatistics The statistics, may be nullptr.
+   */
+  void setPipelineStatistics(PipelineStatistics* pipelineStatistics);
+
+  /**
+   * @brief Registers the priority of this input source with a scheduler.
+   * @param inputScheduler The scheduler.
+   */
+  void setInputScheduler(InputScheduler& inputScheduler) const;
+
+  /**
+   * @brief Stops the retries of deferred messages. Stops the processing thread and unsubscribes, if a processing thread is used.
+   * Waits for a running callback to finish.
+   */
+  void stopProcessingThread();
 
   /**
    * @return The topic (as absolute path, with renames) that this input
@@ -75,26 +109,64 @@ class Input {
   bool configureSensorProcessor(std::string name, const XmlRpc::XmlRpcValue& parameters,
                                 const SensorProcessorBase::GeneralParameters& generalSensorProcessorParameters);
 
+  /**
+   * @brief Starts the thread processing the callbacks of this input source.
+   * @return The callback queue of the thread.
+   */
+  ros::CallbackQueue* startProcessingThread();
+
   // ROS connection.
   ros::Subscriber subscriber_;
   ros::NodeHandle nodeHandle_;
 
+  //! Timer retrying the deferred messages of the sensor processor.
+  ros::Timer retryTimer_;
+
+  //! Serializes the callbacks of the subscriber and of the retry timer.
+  std::unique_ptr<std::mutex> callbackMutex_;
+
   //! Sensor processor
   SensorProcessorBase::Ptr sensorProcessor_;
 
+  //! Callback queue and thread of this input source, if its callbacks are not processed on the global queue.
+  std::unique_ptr<ros::CallbackQueue> callbackQueue_;
+  boost::thread processingThread_;
+
   // Parameters.
   std::string name_;
   std::string type_;
   uint32_t queueSize_;
   std::string topic_;
   bool publishOnUpdate_;
+  int priority_;
 };
 
 template <typename MsgT>
-void Input::registerCallback(ElevationMapping& map, CallbackT<MsgT> callback) {
-  subscriber_ = nodeHandle_.subscribe<MsgT>(
-      topic_, queueSize_, std::bind(callback, std::ref(map), std::placeholders::_1, publishOnUpdate_, std::ref(sensorProcessor_)));
-  ROS_INFO("Subscribing to %s: %s, queue_size: %i.", type_.c_str(), topic_.c_str(), queueSize_);
+void Input::registerCallback(ElevationMapping& map, CallbackT<MsgT> callback, bool useProcessingThread) {
+  ros::SubscribeOptions subscribeOptions;
+  subscribeOptions.template init<MsgT>(topic_, queueSize_, [this, &map, callback](const boost::shared_ptr<const MsgT>& message) {
+    std::lock_guard<std::mutex> lock(*callbackMutex_);
+    (map.*callback)(message, publishOnUpdate_, sensorProcessor_);
+  });
+  if (useProcessingThread) {
+    subscribeOptions.callback_queue = startProcessingThread();
+  }
+  subscriber_ = nodeHandle_.subscribe(subscribeOptions);
+
+  // Retry the deferred messages on the same callback queue, instead of waiting for the next message of the sensor.
+  if (!sensorProcessor_->getTransformRetryPeriod().isZero()) {
+    const ros::TimerOptions timerOptions(sensorProcessor_->getTransformRetryPeriod(),
+                                         [this, &map, callback](const ros::TimerEvent& /*event*/) {
+                                           std::lock_guard<std::mutex> lock(*callbackMutex_);
+                                           if (sensorProcessor_->hasDeferredPointClouds()) {
+                                             (map.*callback)(nullptr, publishOnUpdate_, sensorProcessor_);
+                                           }
+                                         },
+                                         subscribeOptions.callback_queue);
+    retryTimer_ = nodeHandle_.createTimer(timerOptions);
+  }
+  ROS_INFO("Subscribing to %s: %s, queue_size: %i%s.", type_.c_str(), topic_.c_str(), queueSize_,
+           useProcessingThread ? ", on a separate processing thread" : "");
 }
 
 }  // namespace elevation_mapping
\ No newline at end of file
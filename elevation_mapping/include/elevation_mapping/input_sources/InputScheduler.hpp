@@ -0,0 +1,127 @@
+/*
+ *  InputScheduler.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *  Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace elevation_mapping {
+
+/**
+ * @brief Keeps the latency of the map within a budget when the point clouds of the input sources arrive faster than they can be
+ * integrated. Point clouds which are older than the budget when their processing starts are skipped. If the latency from the time
+ * stamp of a point cloud to the end of its integration exceeds the budget, only every n-th point cloud of the input source with the
+ * lowest priority is processed, with n doubling on every further overload. Once the latency is well within the budget again, the
+ * skipping is undone, starting with the sources of the highest priority. Additionally, the points of a point cloud are limited,
+ * such that one point cloud of every input source can be processed and integrated within the budget, at the measured costs per
+ * point. The points are thinned out before the sensor processor, so the costs of processing are measured per processed point and
+ * the costs of integration per integrated point. Thread-safe.
+ */
+class InputScheduler {
+ public:
+  //! Maximal number of point clouds of an input source of which only one is processed.
+  static constexpr unsigned int maxDecimation = 16;
+
+  /**
+   * @brief Constructor.
+   * @param latencyBudget The end-to-end latency budget of the map, in s. 0 disables the scheduling.
+   */
+  explicit InputScheduler(double latencyBudget = 0.0);
+
+  /**
+   * @brief Sets the end-to-end latency budget of the map and resets the scheduling.
+   * @param latencyBudget The latency budget, in s. 0 disables the scheduling.
+   */
+  void setLatencyBudget(double latencyBudget);
+
+  /**
+   * @return True if the point clouds are scheduled.
+   */
+  bool isEnabled() const { return latencyBudget_ > 0.0; }
+
+  /**
+   * @brief Sets the priority of an input source. Unknown input sources have priority 0.
+   * @param source The name of the input source.
+   * @param priority The priority, the point clouds of lower priorities are skipped first.
+   */
+  void setPriority(const std::string& source, int priority);
+
+  /**
+   * @brief Decides whether a point cloud is processed.
+   * @param source The name of the input source.
+   * @param age The time since the time stamp of the point cloud, in s.
+   * @return True if the point cloud should be processed, false if it should be skipped.
+   */
+  bool admit(const std::string& source, double age);
+
+  /**
+   * @brief Reports the integration of a point cloud and adapts the skipping of point clouds to the latency.
+   * @param source The name of the input source.
+   * @param numberOfProcessedPoints The number of points of the point cloud passed to the sensor processor.
+   * @param processingDuration The time spent on processing these points, in s.
+   * @param numberOfIntegratedPoints The number of points left by the sensor processor and integrated into the map.
+   * @param integrationDuration The time spent on integrating these points, in s.
+   * @param latency The time from the time stamp of the point cloud to the end of its integration, in s.
+   * @param time The current time, in s.
+   */
+  void reportIntegration(const std::string& source, std::size_t numberOfProcessedPoints, double processingDuration,
+                         std::size_t numberOfIntegratedPoints, double integrationDuration, double latency, double time);
+
+  /**
+   * @param source The name of the input source.
+   * @return The maximal number of points of a point cloud of the input source passed to the sensor processor.
+   */
+  std::size_t getPointBudget(const std::string& source) const;
+
+  /**
+   * @param source The name of the input source.
+   * @return The current decimation of the input source, only one of this number of point clouds is processed.
+   */
+  unsigned int getDecimation(const std::string& source) const;
+
+ private:
+  //! Scheduling state of an input source.
+  struct Source {
+    int priority = 0;
+    unsigned int decimation = 1;
+    //! Number of point clouds admitted to the decimation, since the last processed one.
+    unsigned int skippedPointClouds = 0;
+    //! Smoothed processing time per processed point, in s. 0 if unknown.
+    double processingCostPerPoint = 0.0;
+    //! Smoothed integration time per integrated point, in s. 0 if unknown.
+    double integrationCostPerPoint = 0.0;
+    //! Smoothed ratio of integrated to processed points, the sensor processor rejects invalid and filtered points. 0 if unknown.
+    double integratedPointRatio = 0.0;
+  };
+
+  /**
+   * @brief Skips more point clouds on overload and fewer once the latency is within the budget again.
+   * @param time The current time, in s.
+   */
+  void adapt(double time);
+
+  //! Protects all members but the latency budget.
+  mutable std::mutex mutex_;
+
+  //! End-to-end latency budget, in s. Also written under the mutex, such that it does not change during an adaptation.
+  std::atomic<double> latencyBudget_;
+
+  //! Input sources by name.
+  std::map<std::string, Source> sources_;
+
+  //! Smoothed end-to-end latency, in s.
+  double latency_;
+
+  //! Time of the last change of a decimation, in s.
+  double lastAdaptationTime_;
+};
+
+}  // namespace elevation_mapping
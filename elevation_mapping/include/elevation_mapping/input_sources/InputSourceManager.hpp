@@ -58,17 +58,37 @@ class InputSourceManager {
   template <typename... MsgT>
   bool registerCallbacks(ElevationMapping& map, std::pair<const char*, Input::CallbackT<MsgT>>... callbacks);
 
+  /**
+   * @brief Sets the statistics the sensor processors of all input sources record in, grouped by the names of the input sources.
+   * @param pipelineStatistics The statistics, may be nullptr.
+   */
+  void setPipelineStatistics(PipelineStatistics* pipelineStatistics);
+
+  /**
+   * @brief Registers the priorities of all input sources with a scheduler.
+   * @param inputScheduler The scheduler.
+   */
+  void setInputScheduler(InputScheduler& inputScheduler) const;
+
   /**
    * @return The number of successfully configured input sources.
    */
   int getNumberOfSources();
 
+  /**
+   * @brief Stops the processing threads of all input sources. Must be called before the callback targets are destroyed.
+   */
+  void stopProcessingThreads();
+
  protected:
   //! A list of input sources.
   std::vector<Input> sources_;
 
   //! Node handle to load.
   ros::NodeHandle nodeHandle_;
+
+  //! If true, every input source processes its data on its own thread.
+  bool useProcessingThreads_;
 };
 
 // Template definitions
@@ -83,7 +103,7 @@ bool InputSourceManager::registerCallbacks(ElevationMapping& map, std::pair<cons
     bool callbackRegistered = false;
     for (auto& callback : {callbacks...}) {
       if (source.getType() == callback.first) {
-        source.registerCallback(map, callback.second);
+        source.registerCallback(map, callback.second, useProcessingThreads_);
         callbackRegistered = true;
       }
     }
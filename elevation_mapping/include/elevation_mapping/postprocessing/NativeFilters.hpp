@@ -0,0 +1,120 @@
+/*
+ * NativeFilters.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// STL
+#include <functional>
+#include <memory>
+#include <string>
+
+// Grid Map
+#include <grid_map_core/GridMap.hpp>
+
+// ROS
+#include <ros/ros.h>
+
+// Elevation Mapping
+#include "elevation_mapping/ThreadPool.hpp"
+
+namespace elevation_mapping {
+
+/*!
+ * Base class of the native postprocessing filters. In contrast to the grid_map filters, they operate in place on the map and
+ * parallelize over tiles of rows. The window based filters evaluate their windows from summed-area tables, which are
+ * computed by separable prefix sums over the unwrapped map.
+ *
+ * All filters read the parameters `input_layer` and `radius` (half the side length of the square window, in m).
+ */
+class NativeFilter {
+ public:
+  //! Creates a filter of a registered type.
+  using Factory = std::function<std::unique_ptr<NativeFilter>()>;
+
+  virtual ~NativeFilter() = default;
+
+  /*!
+   * Creates a native filter.
+   * @param type the type of the filter, e.g. elevation_mapping/BoxFilter.
+   * @return the filter or nullptr if the type is not a native filter.
+   */
+  static std::unique_ptr<NativeFilter> create(const std::string& type);
+
+  /*!
+   * Registers an additional type of native filter, e.g. of another package or a test. Not thread-safe, the types have to be
+   * registered before the pipelines are configured.
+   * @param type the type of the filter, in the elevation_mapping namespace (see isNativeType()).
+   * @param factory creates the filter.
+   * @return false if the type is not a native type or exists already.
+   */
+  static bool registerType(const std::string& type, Factory factory);
+
+  /*!
+   * Checks whether a type refers to a native filter.
+   * @param type the type of the filter.
+   * @return true if the type is in the elevation_mapping namespace.
+   */
+  static bool isNativeType(const std::string& type);
+
+  /*!
+   * Configures the filter.
+   * @param name the name of the filter.
+   * @param parameters the parameters of the filter.
+   * @return true if successful.
+   */
+  bool configure(const std::string& name, const XmlRpc::XmlRpcValue& parameters);
+
+  /*!
+   * Applies the filter in place.
+   * @param map the map to filter.
+   * @param threadPool the threads to parallelize over.
+   * @return true if successful.
+   */
+  bool update(grid_map::GridMap& map, ThreadPool& threadPool);
+
+  /*!
+   * Gets the name of the filter.
+   * @return the name.
+   */
+  const std::string& getName() const { return name_; }
+
+ protected:
+  /*!
+   * Reads the parameters of the derived filter.
+   * @param parameters the parameters of the filter.
+   * @return true if successful.
+   */
+  virtual bool readParameters(const XmlRpc::XmlRpcValue& parameters) = 0;
+
+  /*!
+   * Applies the filter with a window of the given size.
+   * @param map the map to filter, contains the input layer.
+   * @param radiusInCells the number of cells the window spans to each side of its center cell.
+   * @param threadPool the threads to parallelize over.
+   */
+  virtual void apply(grid_map::GridMap& map, int radiusInCells, ThreadPool& threadPool) = 0;
+
+  /*!
+   * Reads a string parameter.
+   * @param parameters the parameters of the filter.
+   * @param name the name of the parameter.
+   * @param value the value, keeps the default if the parameter is not given.
+   * @return false if the parameter has the wrong type.
+   */
+  bool readParameter(const XmlRpc::XmlRpcValue& parameters, const std::string& name, std::string& value) const;
+
+  //! Name of the filter.
+  std::string name_;
+
+  //! Layer to filter.
+  std::string inputLayer_;
+
+  //! Half the side length of the square window, in m.
+  double radius_ = 0.0;
+};
+
+}  // namespace elevation_mapping
@@ -12,11 +12,24 @@
 #include <filters/filter_chain.hpp>
 #include <grid_map_core/GridMap.hpp>
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "elevation_mapping/ThreadPool.hpp"
+#include "elevation_mapping/postprocessing/NativeFilters.hpp"
+
 namespace elevation_mapping {
 
 /**
  * @brief A configurable postprocessing functor, it applies the configured filter pipeline to the input.
  *
+ * The pipeline is either a single filter chain or a list of independent stages. Stages are filter chains which run in parallel on the
+ * same input map, the layers added by each stage are merged into the output. Changes of a stage to the layers of the input map are
+ * discarded with a warning.
+ * Filters of the types elevation_mapping/... are native filters (see NativeFilter), which operate in place on a single copy of the
+ * input map. The grid_map filters between them are run as filter chains.
+ *
  *   Usage:
  *   ========
  *
@@ -47,43 +60,64 @@ class PostprocessingPipelineFunctor {
    * @param inputMap The gridMap on which the postprocessing is applied (not inplace).
    * @return The postprocessed gridMap.
    */
-  GridMap operator()(GridMap& inputMap);
+  GridMap operator()(const GridMap& inputMap);
 
+ private:
   /**
-   * Publishes a given grid map.
-   * @param gridMap   The Grid Map that this functor will publish.
+   * @brief Reads in the parameters from the ROS parameter server.
+   * @return A flag whether the parameters were read successfully.
    */
-  void publish(const GridMap& gridMap) const;
+  void readParameters();
 
   /**
-   * Checks whether there are any subscribers to the result of this functor.
-   *
-   * @return True if someone listens to the topic this functor publishes to.
+   * @brief Runs the stages in parallel and merges the layers they added into a copy of the input.
+   * @param inputMap The gridMap on which the postprocessing is applied.
+   * @return The postprocessed gridMap.
    */
-  bool hasSubscribers() const;
+  GridMap runStages(const GridMap& inputMap);
+
+  //! A step of a pipeline, either a chain of grid_map filters or a native filter.
+  struct PipelineStep {
+    std::unique_ptr<filters::FilterChain<grid_map::GridMap>> filterChain;
+    std::unique_ptr<NativeFilter> nativeFilter;
+  };
+  using Pipeline = std::vector<PipelineStep>;
 
- private:
   /**
-   * @brief Reads in the parameters from the ROS parameter server.
-   * @return A flag whether the parameters were read successfully.
+   * @brief Configures a pipeline from the ROS parameter server.
+   * @param parametersName The name of the filter chain parameters.
+   * @param pipeline The pipeline to configure.
+   * @return True if successful.
    */
-  void readParameters();
+  bool configurePipeline(const std::string& parametersName, Pipeline& pipeline);
+
+  /**
+   * @brief Runs a pipeline.
+   * @param pipeline The pipeline.
+   * @param inputMap The gridMap on which the postprocessing is applied.
+   * @param outputMap The postprocessed gridMap.
+   * @return True if successful.
+   */
+  bool runPipeline(Pipeline& pipeline, const GridMap& inputMap, GridMap& outputMap);
 
   //! ROS nodehandle.
   ros::NodeHandle& nodeHandle_;
 
-  //! Name of the output grid map topic.
-  std::string outputTopic_;
-
-  //! Grid map publisher.
-  ros::Publisher publisher_;
+  //! Pipelines, a single one or one per stage.
+  std::vector<Pipeline> pipelines_;
 
-  //! Filter chain.
-  filters::FilterChain<grid_map::GridMap> filterChain_;
+  //! Thread pool of the native filters.
+  std::unique_ptr<ThreadPool> filterThreadPool_;
 
   //! Filter chain parameters name.
   std::string filterChainParametersName_;
 
+  //! Filter chain parameters names of the stages, empty if the pipeline is a single filter chain.
+  std::vector<std::string> stageParametersNames_;
+
+  //! Thread pool running the stages in parallel.
+  std::unique_ptr<ThreadPool> stageThreadPool_;
+
   //! Flag indicating if the filter chain was successfully configured.
   bool filterChainConfigured_;
 };
@@ -10,6 +10,7 @@
 
 #include <boost/asio.hpp>
 #include <boost/thread.hpp>
+#include <memory>
 #include <thread>
 
 #include <grid_map_core/GridMap.hpp>
@@ -35,8 +36,8 @@ class PostprocessingWorker {
   ///@{
   boost::asio::io_service& ioService() { return ioService_; }
   std::thread& thread() { return thread_; }
-  const GridMap& dataBuffer() { return dataBuffer_; }
-  void setDataBuffer(GridMap data) { dataBuffer_ = std::move(data); }
+  const GridMap& dataBuffer() { return *dataBuffer_; }
+  void setDataBuffer(std::shared_ptr<const GridMap> data) { dataBuffer_ = std::move(data); }
   ///@}
 
   /*! @name Methods */
@@ -47,20 +48,6 @@ class PostprocessingWorker {
    * @return GridMap Processed grid map.
    */
   GridMap processBuffer();
-
-  /**
-   * @brief Publish a given grid map.
-   *
-   * @param gridMap The grid map to publish.
-   */
-  void publish(const GridMap& gridMap) const;
-
-  /**
-   * @brief Checks whether the worker publisher has any active subscribers.
-   *
-   * @return true If there are subscribers to the worker publisher, false otherwise.
-   */
-  bool hasSubscribers() const;
   ///@}
 
  protected:
@@ -78,8 +65,8 @@ class PostprocessingWorker {
   //! The thread on which this worker runs.
   std::thread thread_;
 
-  //! Data container for the worker.
-  GridMap dataBuffer_;
+  //! Data container for the worker. Holds a shared, immutable map, such that no copy is needed.
+  std::shared_ptr<const GridMap> dataBuffer_;
 };
 
 }  // namespace elevation_mapping
@@ -17,6 +17,8 @@
 
 #include <grid_map_core/GridMap.hpp>
 
+#include "elevation_mapping/GridMapDeltaPublisher.hpp"
+#include "elevation_mapping/PipelineStatistics.hpp"
 #include "elevation_mapping/postprocessing/PostprocessingPipelineFunctor.hpp"
 #include "elevation_mapping/postprocessing/PostprocessingWorker.hpp"
 
@@ -26,9 +28,11 @@ namespace elevation_mapping {
  * @brief A handler for executing postprocessing pipelines in parallel.
  *
  * @remark This class starts poolSize threads.
- * It is intentional that if raw maps come in faster than the post processing works some raw maps are skipped.
- * There is a minimal critical section updating the availableServices_ structure.
- * Workers operate on copies of the raw elevation map instead of working on the same data.
+ * Tasks which arrive while all workers are busy wait in a bounded queue. If raw maps come in faster than the post processing works, the
+ * oldest waiting map is replaced by the latest one (latest wins), such that the output is never older than necessary.
+ * There is a minimal critical section updating the availableServices_ and taskQueue_ structures.
+ * Workers share the immutable raw elevation map instead of working on copies. All workers publish through the same publisher, and a
+ * result is only published if no newer result has been published before.
  */
 class PostprocessorPool {
  public:
@@ -38,8 +42,10 @@ class PostprocessorPool {
    * @brief Constructor.
    * @param poolSize The number of worker threads to allocate.
    * @param nodeHandle The node handle used to configure the task to run and to publish the finished tasks.
+   * @param pipelineStatistics The statistics to record the latencies, the queue depth and the dropped tasks in, in the group
+   * "postprocessing". May be nullptr.
    */
-  PostprocessorPool(std::size_t poolSize, ros::NodeHandle nodeHandle);
+  PostprocessorPool(std::size_t poolSize, ros::NodeHandle nodeHandle, PipelineStatistics* pipelineStatistics = nullptr);
 
   /**
    * @brief Destructor.
@@ -49,33 +55,84 @@ class PostprocessorPool {
   ~PostprocessorPool();
 
   /**
-   * @brief Starts a task on a thread from the thread pool if there are some available.
+   * @brief Starts a task on a thread from the thread pool if there are some available, otherwise queues it.
    * @param gridMap The data to be processed by this task.
-   * @return True if the PostprocessorPool accepted the task. If false the PostprocessorPool had no available threads and discarded the
-   * task.
+   * @return True if the PostprocessorPool accepted the task. If false the PostprocessorPool had no available threads and no queue, and
+   * discarded the task.
    */
   bool runTask(const GridMap& gridMap);
 
+  /**
+   * @brief Starts a task on a thread from the thread pool if there are some available, otherwise queues it.
+   * @param gridMap The shared, immutable data to be processed by this task. It is not copied.
+   * @return True if the PostprocessorPool accepted the task. If false the PostprocessorPool had no available threads and no queue, and
+   * discarded the task.
+   */
+  bool runTask(std::shared_ptr<const GridMap> gridMap);
+
   /**
    * @brief Performs a check on the number of subscribers.
-   * @return True if someone listens to the topic that the managed postprocessor_ publishes to.
+   * @return True if someone listens to the topic that the postprocessed maps are published to, or to its delta topic.
    */
   bool pipelineHasSubscribers() const;
 
  private:
+  //! A task waiting for a worker.
+  struct Task {
+    //! Sequence number, increasing with the arrival of the tasks and starting at 1.
+    std::size_t sequence;
+    //! The shared, immutable data to be processed.
+    std::shared_ptr<const GridMap> gridMap;
+  };
+
+  /**
+   * @brief Hands a task over to a worker. Must be called with availableServicesMutex_ locked.
+   * @param serviceIndex The index of the thread / service that will process this task.
+   * @param task The task.
+   */
+  void dispatchTask(size_t serviceIndex, Task task);
+
   /**
    * @brief Wrap a task so that the postprocessor pool gets notified on completion of the task.
    * @param serviceIndex The index of the thread / service that will process this task.
+   * @param sequence The sequence number of the task.
    */
-  void wrapTask(size_t serviceIndex);
+  void wrapTask(size_t serviceIndex, std::size_t sequence);
+
+  /**
+   * @brief Publishes a postprocessed map, unless a result of a newer task has already been published.
+   * @param gridMap The postprocessed map.
+   * @param sequence The sequence number of the task.
+   */
+  void publish(const GridMap& gridMap, std::size_t sequence);
 
   // Post-processing workers.
   std::vector<std::unique_ptr<PostprocessingWorker>> workers_;
 
-  //! Container holding the service ids which have corresponding threads. The only object that is used in a mutual exclusive manner and must
-  //! be protected by availableServicesMutex_.
+  //! Container holding the service ids which have corresponding threads and the queue of the waiting tasks. The only objects that are
+  //! used in a mutual exclusive manner and must be protected by availableServicesMutex_.
   boost::mutex availableServicesMutex_;
   std::deque<size_t> availableServices_;
+  std::deque<Task> taskQueue_;
+  std::size_t nextSequence_ = 0;
+
+  //! Maximum number of waiting tasks.
+  std::size_t queueSize_;
+
+  //! Publisher of the postprocessed maps, shared by all workers.
+  ros::Publisher publisher_;
+
+  //! Mutex lock for publishing, keeps the published maps in order.
+  boost::mutex publisherMutex_;
+
+  //! Sequence number of the latest published task, 0 if none was published yet.
+  std::size_t lastPublishedSequence_ = 0;
+
+  //! Publisher of the postprocessed maps as delta messages, shared by all workers.
+  std::unique_ptr<GridMapDeltaPublisher> deltaPublisher_;
+
+  //! Statistics of the pipeline, may be nullptr.
+  PipelineStatistics* pipelineStatistics_;
 };
 
 }  // namespace elevation_mapping
@@ -0,0 +1,71 @@
+/*
+ * HeightVariancePropagation.hpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#pragma once
+
+// Eigen
+#include <Eigen/Core>
+
+namespace elevation_mapping {
+
+/*!
+ * Error propagation of the sensor noise and the robot rotation uncertainty to the height variance of the points
+ * (error propagation law), shared by all sensor models.
+ *
+ * The height variance of a point is J_s * Sigma_S * J_s^T + J_q * Sigma_q * J_q^T. The sensor Jacobian J_s is the same for
+ * all points, and the rotation Jacobian J_q = P * C_BM^T * ([C_SB^T * S_r_SP]x + [B_r_BS]x) is affine in the point, such that
+ * the per point cloud constants reduce the computation to a few multiply-adds per point, which are evaluated in batches.
+ */
+class HeightVariancePropagation {
+ public:
+  //! Points in sensor frame (S_r_SP), one point per row. Column-major, so each coordinate is contiguous.
+  using Points = Eigen::Array<float, Eigen::Dynamic, 3>;
+  //! Diagonal of the sensor covariance matrices (Sigma_S) as (lateral, normal) per row, the lateral variance is the
+  //! variance in x- and y-direction of the sensor frame, the normal variance the one in z-direction.
+  using SensorVariances = Eigen::Array<float, Eigen::Dynamic, 2>;
+
+  /*!
+   * Constructor, prepares the constants of a point cloud.
+   * @param mapToBaseRotation the rotation from the map to the robot base frame (C_BM).
+   * @param baseToSensorRotation the rotation from the robot base to the sensor frame (C_SB).
+   * @param baseToSensorTranslation the translation from the robot base to the sensor in base frame (B_r_BS).
+   * @param rotationVariance the covariance matrix of the robot rotation (Sigma_q).
+   */
+  HeightVariancePropagation(const Eigen::Matrix3f& mapToBaseRotation, const Eigen::Matrix3f& baseToSensorRotation,
+                            const Eigen::Vector3f& baseToSensorTranslation, const Eigen::Matrix3f& rotationVariance);
+
+  /*!
+   * Computes the height variance of a single point.
+   * @param pointSensorFrame the point in sensor frame (S_r_SP).
+   * @param lateralVariance the lateral variance of the sensor.
+   * @param normalVariance the normal variance of the sensor.
+   * @return the height variance.
+   */
+  float computeHeightVariance(const Eigen::Vector3f& pointSensorFrame, float lateralVariance, float normalVariance) const;
+
+  /*!
+   * Computes the height variances of a batch of points, vectorized over the points.
+   * @param[in] pointsSensorFrame the points in sensor frame.
+   * @param[in] sensorVariances the sensor variances of the points.
+   * @param[out] variances the height variances, of the size of the batch.
+   */
+  void computeHeightVariances(const Eigen::Ref<const Points>& pointsSensorFrame, const Eigen::Ref<const SensorVariances>& sensorVariances,
+                              Eigen::Ref<Eigen::VectorXf> variances) const;
+
+ private:
+  //! The rotation Jacobian of a point is rotationJacobianLinear_ * S_r_SP + rotationJacobianOffset_ (as column vector).
+  Eigen::Matrix3f rotationJacobianLinear_;
+  Eigen::Vector3f rotationJacobianOffset_;
+
+  //! Symmetric robot rotation covariance matrix (Sigma_q).
+  Eigen::Matrix3f rotationVariance_;
+
+  //! Squared entries of the sensor Jacobian, summed for the lateral directions: (J_s,x^2 + J_s,y^2, J_s,z^2).
+  Eigen::Vector2f sensorJacobianSquared_;
+};
+
+}  // namespace elevation_mapping
@@ -37,15 +37,16 @@ class LaserSensorProcessor : public SensorProcessorBase {
   bool readParameters() override;
 
   /*!
-   * Computes the elevation map height variances for each point in a point cloud with the
-   * sensor model and the robot pose covariance.
-   * @param[in] pointCloud the point cloud for which the variances are computed.
-   * @param[in] robotPoseCovariance the robot pose covariance matrix.
-   * @param[out] variances the elevation map height variances.
+   * Processes the point cloud with the laser sensor model.
+   * @param[in] pointCloud the input point cloud.
+   * @param[in] inputToSensor the transformation from the input point cloud frame to the sensor frame.
+   * @param[in] propagation the prepared error propagation of the current point cloud.
+   * @param[out] pointCloudMapFrame the processed point cloud in map frame.
+   * @param[out] variances the measurement variances of the processed points.
    * @return true if successful.
    */
-  bool computeVariances(const PointCloudType::ConstPtr pointCloud, const Eigen::Matrix<double, 6, 6>& robotPoseCovariance,
-                        Eigen::VectorXf& variances) override;
+  bool processPoints(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor, const HeightVariancePropagation& propagation,
+                     PointCloudType& pointCloudMapFrame, Eigen::VectorXf& variances) override;
 };
 
 } /* namespace elevation_mapping */
@@ -10,6 +10,7 @@
 
 // ROS
 #include <ros/ros.h>
+#include <sensor_msgs/PointCloud2.h>
 #include <tf/transform_listener.h>
 
 // Eigen
@@ -19,13 +20,21 @@
 #include <kindr/Core>
 
 // STL
+#include <cmath>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 // PCL
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
 
+// Elevation Mapping
+#include "elevation_mapping/PipelineStatistics.hpp"
+#include "elevation_mapping/sensor_processors/HeightVariancePropagation.hpp"
+
 namespace elevation_mapping {
 
 /*!
@@ -41,6 +50,8 @@ class SensorProcessorBase {
   using Ptr = std::unique_ptr<SensorProcessorBase>;
   friend class ElevationMapping;
   friend class Input;
+  friend class KernelBenchmarkAccess;
+  friend class PipelineBenchmark;
 
   struct GeneralParameters {
     std::string robotBaseFrameId_;
@@ -50,6 +61,26 @@ class SensorProcessorBase {
         : robotBaseFrameId_(std::move(robotBaseFrameId)), mapFrameId_(std::move(mapFrameId)) {}
   };
 
+  /*!
+   * Buffers for the point clouds of one input source. They are taken from a pool of the sensor processor and reused,
+   * such that processing does not allocate anymore once they have grown to the size of the largest point cloud.
+   */
+  struct ScanBuffers {
+    //! Input point cloud converted from the message.
+    PointCloudType::Ptr pointCloud{new PointCloudType};
+    //! Processed point cloud in map frame.
+    PointCloudType::Ptr pointCloudMapFrame{new PointCloudType};
+    //! Measurement variances of the processed points.
+    Eigen::VectorXf variances;
+  };
+
+  //! Returns scan buffers to the pool of their sensor processor.
+  struct ScanBuffersDeleter {
+    SensorProcessorBase* sensorProcessor = nullptr;
+    void operator()(ScanBuffers* scanBuffers) const;
+  };
+  using ScanBuffersPtr = std::unique_ptr<ScanBuffers, ScanBuffersDeleter>;
+
   /*!
    * Constructor.
    * @param nodeHandle the ROS node handle.
@@ -67,7 +98,8 @@ class SensorProcessorBase {
    * @param[in] pointCloudInput the input point cloud.
    * @param[in] targetFrame the frame to which the point cloud should be transformed. // TODO Update.
    * @param[out] pointCloudOutput the processed point cloud.
-   * @param[out] variances the measurement variances expressed in the target frame.
+   * @param[out] variances the measurement variances expressed in the target frame. The vector is only grown, such that it
+   * can be reused, and only the first pointCloudOutput->size() entries are valid.
    * @return true if successful.
    */
   bool process(const PointCloudType::ConstPtr pointCloudInput, const Eigen::Matrix<double, 6, 6>& robotPoseCovariance,
@@ -79,6 +111,58 @@ class SensorProcessorBase {
    */
   bool isTfAvailableInBuffer() { return firstTfAvailable_; }
 
+  /*!
+   * Queues a point cloud message until the transformations for its time stamp are available.
+   * @param pointCloudMsg the point cloud message.
+   */
+  void deferPointCloud(const sensor_msgs::PointCloud2ConstPtr& pointCloudMsg);
+
+  /*!
+   * Takes the oldest deferred point cloud message if its transformations are available, without waiting.
+   * Messages that waited longer than the transform timeout (relative to the newest message) are dropped.
+   * @return the message or nullptr if no message is ready.
+   */
+  sensor_msgs::PointCloud2ConstPtr takeReadyPointCloud();
+
+  /*!
+   * Checks if point cloud messages are waiting for their transformations.
+   * @return true if there are deferred messages.
+   */
+  bool hasDeferredPointClouds() const { return !deferredPointClouds_.empty(); }
+
+  /*!
+   * Gets the period at which the deferred point clouds are retried without waiting for the next point cloud.
+   * @return the period, zero if they are only retried when the next point cloud arrives.
+   */
+  const ros::Duration& getTransformRetryPeriod() const { return transformRetryPeriod_; }
+
+  /*!
+   * Sets the statistics to record the transform wait, filtering and variance latencies and the dropped point clouds in.
+   * @param pipelineStatistics the statistics, may be nullptr.
+   * @param sourceName the name of the input source, used as group of the measurements.
+   */
+  void setPipelineStatistics(PipelineStatistics* pipelineStatistics, std::string sourceName);
+
+  /*!
+   * Gets the name of the input source of this sensor processor.
+   * @return the name.
+   */
+  const std::string& getSourceName() const { return sourceName_; }
+
+  /*!
+   * Gets the statistics of the pipeline.
+   * @return the statistics, nullptr if they are not recorded.
+   */
+  PipelineStatistics* getPipelineStatistics() const { return pipelineStatistics_; }
+
+  /*!
+   * Takes scan buffers from the pool of this sensor processor. They return to the pool when released, so the pool
+   * only grows to the number of point clouds of this sensor that are processed or integrated at the same time.
+   * Thread safe.
+   * @return the scan buffers.
+   */
+  ScanBuffersPtr acquireScanBuffers();
+
  protected:
   /*!
    * Reads and verifies the parameters.
@@ -96,44 +180,64 @@ class SensorProcessorBase {
   bool filterPointCloud(const PointCloudType::Ptr pointCloud);
 
   /*!
-   * Sensor specific point cloud cleaning.
-   * @param pointCloud the point cloud to clean.
+   * Sensor specific processing of the point cloud. Implementations call processPointsWithModel()
+   * with their sensor model.
+   * @param[in] pointCloud the input point cloud.
+   * @param[in] inputToSensor the transformation from the input point cloud frame to the sensor frame.
+   * @param[in] propagation the prepared error propagation of the current point cloud.
+   * @param[out] pointCloudMapFrame the processed point cloud in map frame.
+   * @param[out] variances the measurement variances of the processed points.
    * @return true if successful.
    */
-  virtual bool filterPointCloudSensorType(const PointCloudType::Ptr pointCloud);
+  virtual bool processPoints(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                             const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame, Eigen::VectorXf& variances) = 0;
 
   /*!
-   * Computes the elevation map height variances for each point in a point cloud with the
-   * sensor model and the robot pose covariance.
-   * @param[in] pointCloud the point cloud for which the variances are computed.
-   * @param[in] robotPoseCovariance the robot pose covariance matrix.
-   * @param[out] variances the elevation map height variances.
+   * Runs NaN rejection, the sensor specific point filter, the transformation to map frame, the height limits and
+   * the sensor model in a single pass over the point cloud, then the error propagation in a batched pass over the
+   * remaining points.
+   * @param[in] pointCloud the input point cloud.
+   * @param[in] inputToSensor the transformation from the input point cloud frame to the sensor frame.
+   * @param[in] propagation the prepared error propagation of the current point cloud.
+   * @param[out] pointCloudMapFrame the processed point cloud in map frame.
+   * @param[out] variances the measurement variances of the processed points, only grown.
+   * @param[in] isValidPoint functor `bool(const Eigen::Vector3f& pointSensorFrame)`, rejects points (e.g. depth cutoff).
+   * @param[in] sensorModel functor `Eigen::Vector2f(const PointType& point, const Eigen::Vector3f& pointSensorFrame, size_t
+   * index)` returning the (lateral, normal) variances of the sensor covariance matrix, where index is the position of the
+   * point in the input point cloud.
    * @return true if successful.
    */
-  virtual bool computeVariances(const PointCloudType::ConstPtr pointCloud, const Eigen::Matrix<double, 6, 6>& robotPoseCovariance,
-                                Eigen::VectorXf& variances) = 0;
+  template <typename PointFilter, typename SensorModel>
+  bool processPointsWithModel(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                              const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame, Eigen::VectorXf& variances,
+                              const PointFilter& isValidPoint, const SensorModel& sensorModel);
+
+  /*!
+   * Checks without blocking if all transformations for a point cloud are available.
+   * @param sensorFrameId the frame of the point cloud.
+   * @param timeStamp the time stamp for the transformations.
+   * @return true if the transformations are available.
+   */
+  bool isTransformAvailable(const std::string& sensorFrameId, const ros::Time& timeStamp) const;
 
   /*!
-   * Update the transformations for a given time stamp.
+   * Update the transformations for a given time stamp. Does not wait for tf, the transformations are expected
+   * to be available (see isTransformAvailable()).
    * @param timeStamp the time stamp for the transformation.
    * @return true if successful.
    */
   bool updateTransformations(const ros::Time& timeStamp);
 
   /*!
-   * Transforms the point cloud the a target frame.
-   * @param[in] pointCloud the point cloud to be transformed.
-   * @param[out] pointCloudTransformed the resulting point cloud after transformation.
+   * Looks up the transformation from a frame to a target frame.
+   * @param[in] sourceFrame the frame of the data.
    * @param[in] targetFrame the desired target frame.
+   * @param[in] timeStamp the time stamp for the transformation.
+   * @param[out] transform the resulting transformation.
    * @return true if successful.
    */
-  bool transformPointCloud(PointCloudType::ConstPtr pointCloud, PointCloudType::Ptr pointCloudTransformed, const std::string& targetFrame);
-
-  /*!
-   * Removes points with z-coordinate above a limit in map frame.
-   * @param[in/out] pointCloud the point cloud to be cropped.
-   */
-  void removePointsOutsideLimits(PointCloudType::ConstPtr reference, std::vector<PointCloudType::Ptr>& pointClouds);
+  bool lookupTransform(const std::string& sourceFrame, const std::string& targetFrame, const ros::Time& timeStamp,
+                       Eigen::Affine3d& transform);
 
   //! ROS nodehandle.
   ros::NodeHandle& nodeHandle_;
@@ -156,6 +260,13 @@ class SensorProcessorBase {
   //! Transformation from Sensor to Map frame
   Eigen::Affine3d transformationSensorToMap_;
 
+  //! Transformation from Sensor to Base frame, cached for sensorToBaseFrameId_ if the sensor is static.
+  Eigen::Affine3d transformationSensorToBase_;
+  std::string sensorToBaseFrameId_;
+
+  //! Time stamp of the current transformations from Base to Map frame.
+  ros::Time transformationTimeStamp_;
+
   GeneralParameters generalParameters_;
 
   //! TF frame id of the range sensor for the point clouds.
@@ -173,8 +284,89 @@ class SensorProcessorBase {
   //! Use VoxelGrid filter to cleanup pointcloud if true.
   bool applyVoxelGridFilter_;
 
+  //! If true, the transformation between sensor and robot base is looked up once and reused.
+  bool isSensorTransformStatic_;
+
+  //! Maximal duration a point cloud waits for its transformations.
+  ros::Duration transformTimeout_;
+
+  //! Period at which the deferred point clouds are retried, zero to only retry them with the next point cloud.
+  ros::Duration transformRetryPeriod_;
+
+  //! Point cloud messages waiting for their transformations and the times they were deferred, oldest first.
+  std::deque<std::pair<sensor_msgs::PointCloud2ConstPtr, ros::WallTime>> deferredPointClouds_;
+
   //! Indicates if the requested tf transformation was available.
   bool firstTfAvailable_;
+
+  //! Pool of unused scan buffers.
+  std::vector<std::unique_ptr<ScanBuffers>> freeScanBuffers_;
+  std::mutex scanBuffersMutex_;
+
+  //! Statistics of the pipeline, may be nullptr, and the name of the input source.
+  PipelineStatistics* pipelineStatistics_;
+  std::string sourceName_;
+
+  //! Buffers of the voxel grid filter.
+  PointCloudType::Ptr pointCloudSensorFrame_;
+  PointCloudType filteredPointCloud_;
+  std::vector<int> filteredIndices_;
+
+  //! Buffers of the accepted points for the batched error propagation.
+  HeightVariancePropagation::Points pointsSensorFrame_;
+  HeightVariancePropagation::SensorVariances sensorVariances_;
 };
 
+template <typename PointFilter, typename SensorModel>
+bool SensorProcessorBase::processPointsWithModel(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                                                 const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame,
+                                                 Eigen::VectorXf& variances, const PointFilter& isValidPoint,
+                                                 const SensorModel& sensorModel) {
+  const Eigen::Affine3f sensorToMap = transformationSensorToMap_.cast<float>();
+  const float lowerThreshold = translationMapToBaseInMapFrame_.z() + ignorePointsLowerThreshold_;
+  const float upperThreshold = translationMapToBaseInMapFrame_.z() + ignorePointsUpperThreshold_;
+
+  pointCloudMapFrame.header = pointCloud.header;
+  pointCloudMapFrame.header.frame_id = generalParameters_.mapFrameId_;
+  pointCloudMapFrame.points.resize(pointCloud.size());
+  if (variances.size() < static_cast<Eigen::Index>(pointCloud.size())) {
+    variances.resize(pointCloud.size());
+  }
+  if (pointsSensorFrame_.rows() < static_cast<Eigen::Index>(pointCloud.size())) {
+    pointsSensorFrame_.resize(pointCloud.size(), 3);
+    sensorVariances_.resize(pointCloud.size(), 2);
+  }
+
+  std::size_t numPoints = 0;
+  for (std::size_t i = 0; i < pointCloud.size(); ++i) {
+    const auto& point = pointCloud.points[i];
+    if (!std::isfinite(point.x) || !std::isfinite(point.y) || !std::isfinite(point.z)) {  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      continue;
+    }
+    const Eigen::Vector3f pointSensorFrame = inputToSensor * point.getVector3fMap();  // S_r_SP
+    if (!isValidPoint(pointSensorFrame)) {
+      continue;
+    }
+    const Eigen::Vector3f pointMapFrame = sensorToMap * pointSensorFrame;
+    if (pointMapFrame.z() < lowerThreshold || pointMapFrame.z() > upperThreshold) {
+      continue;
+    }
+
+    auto& pointOut = pointCloudMapFrame.points[numPoints];
+    pointOut = point;
+    pointOut.getVector3fMap() = pointMapFrame;
+    pointsSensorFrame_.row(numPoints) = pointSensorFrame.transpose().array();
+    sensorVariances_.row(numPoints) = sensorModel(point, pointSensorFrame, i).transpose().array();
+    ++numPoints;
+  }
+  propagation.computeHeightVariances(pointsSensorFrame_.topRows(numPoints), sensorVariances_.topRows(numPoints), variances.head(numPoints));
+
+  pointCloudMapFrame.points.resize(numPoints);
+  pointCloudMapFrame.width = numPoints;
+  pointCloudMapFrame.height = 1;
+  pointCloudMapFrame.is_dense = true;
+  ROS_DEBUG_THROTTLE(2, "Sensor processor reduced point cloud to %i points.", static_cast<int>(numPoints));
+  return true;
+}
+
 } /* namespace elevation_mapping */
@@ -0,0 +1,56 @@
+/*
+ * CellPointAggregate.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/CellPointAggregate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+//! Lower bound of the point variances, keeps the weights of the mean finite [m^2].
+const float minPointVariance = 1e-12f;
+}  // namespace
+
+namespace elevation_mapping {
+
+void CellPointAggregate::reset(float elevation, float variance, float mahalanobisDistanceThreshold) {
+  elevation_ = elevation;
+  thresholdVariance_ = mahalanobisDistanceThreshold * mahalanobisDistanceThreshold * variance;
+  meanWeight_ = 0.0f;
+  weightedHeightSum_ = 0.0f;
+  meanHeightPlusUncertainty_ = std::numeric_limits<float>::infinity();
+  numberOfOutliers_ = 0;
+}
+
+void CellPointAggregate::add(float height, float variance, std::size_t pointIndex) {
+  const float difference = height - elevation_;
+  const float heightPlusUncertainty = height + 3.0f * std::sqrt(variance);
+  if (difference * difference > thresholdVariance_) {
+    const Representative outlier{height, variance, heightPlusUncertainty, pointIndex};
+    if (numberOfOutliers_ == 0 || height < lowestOutlier_.height) {
+      lowestOutlier_ = outlier;
+    }
+    if (numberOfOutliers_ == 0 || height > highestOutlier_.height) {
+      highestOutlier_ = outlier;
+    }
+    ++numberOfOutliers_;
+    return;
+  }
+
+  const float weight = 1.0f / std::max(variance, minPointVariance);
+  meanWeight_ += weight;
+  weightedHeightSum_ += weight * difference;
+  meanHeightPlusUncertainty_ = std::min(meanHeightPlusUncertainty_, heightPlusUncertainty);
+  meanPointIndex_ = pointIndex;
+}
+
+CellPointAggregate::Representative CellPointAggregate::getMean() const {
+  return {elevation_ + weightedHeightSum_ / meanWeight_, 1.0f / meanWeight_, meanHeightPlusUncertainty_, meanPointIndex_};
+}
+
+}  // namespace elevation_mapping
@@ -6,19 +6,76 @@
  *	 Institute: ETH Zurich, ANYbotics
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
 
 #include <grid_map_msgs/GridMap.h>
 #include <ros/ros.h>
+#include <boost/make_shared.hpp>
 #include <Eigen/Dense>
 
 #include "elevation_mapping/ElevationMap.hpp"
+#include "elevation_mapping/CellPointAggregate.hpp"
 #include "elevation_mapping/ElevationMapFunctors.hpp"
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
-#include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
 
 namespace {
+//! Side length (in cells) of the tiles the fusion work is split into.
+const int fusionTileSize = 32;
+
+//! Number of accumulated motion updates after which they are applied to the entire map (lazy motion update).
+const std::size_t maxPendingMotionUpdates = 1000;
+
+//! Maximal number of fusion kernels cached per fusion thread.
+const std::size_t maxNumberOfFusionKernels = 4096;
+
+//! Minimal number of points of a point cloud in a cell which are reduced to representatives (point aggregation), fewer
+//! points are integrated one by one.
+const std::size_t minPointsForAggregation = 4;
+
+//! Maximal number of rays traced by one task of the visibility cleanup.
+const std::size_t visibilityCleanupRaysPerTask = 256;
+
+//! Quantization step of the compact lowest scan layers [m]. The quantization error is at most half of the step,
+//! and values up to 32767 steps (65 m) can be stored. Larger values are not stored.
+const float compactLayerStep = 0.002f;
+
+//! Value of an empty cell of a compact layer.
+const int16_t emptyCompactCell = std::numeric_limits<int16_t>::min();
+
+/**
+ * Quantizes a value for a compact layer.
+ * @param value the value.
+ * @param[out] quantizedValue the quantized value.
+ * @return true if the value can be stored in a compact layer, false otherwise.
+ */
+bool quantize(float value, int16_t& quantizedValue) {
+  const float steps = std::round(value / compactLayerStep);
+  if (!(std::abs(steps) <= std::numeric_limits<int16_t>::max())) {
+    return false;
+  }
+  quantizedValue = static_cast<int16_t>(steps);
+  return true;
+}
+
+/**
+ * Restores the value of a cell of a compact layer.
+ * @param quantizedValue the quantized value.
+ * @return the value, NAN for an empty cell.
+ */
+float dequantize(int16_t quantizedValue) {
+  return quantizedValue == emptyCompactCell ? NAN : static_cast<float>(quantizedValue) * compactLayerStep;
+}
+
+//! 95.45% confidence ellipse which is 2.486-sigma for 2 dof problem.
+//! http://www.reid.ai/2012/09/chi-squared-distribution-table-with.html
+const double uncertaintyFactor = 2.486;  // sqrt(6.18)
+
 /**
  * Store an unsigned integer value in a float
  * @param input integer
@@ -29,16 +86,79 @@ float intAsFloat(const uint32_t input) {
   std::memcpy(&output, &input, sizeof(uint32_t));
   return output;
 }
+
+/**
+ * Splits a (possibly wrapping) range of a circular buffer dimension into tile spans.
+ * Tile boundaries are aligned to multiples of the tile size in buffer coordinates.
+ * @param start the first buffer index of the range.
+ * @param length the number of cells of the range.
+ * @param bufferSize the size of the buffer dimension.
+ * @return the spans as pairs of (first buffer index, number of cells).
+ */
+std::vector<std::pair<int, int>> getTileSpans(int start, int length, int bufferSize) {
+  std::vector<std::pair<int, int>> spans;
+  length = std::min(length, bufferSize);
+  grid_map::wrapIndexToRange(start, bufferSize);
+  while (length > 0) {
+    const int tileEnd = std::min((start / fusionTileSize + 1) * fusionTileSize, bufferSize);
+    const int spanLength = std::min(tileEnd - start, length);
+    spans.emplace_back(start, spanLength);
+    length -= spanLength;
+    start = (start + spanLength) % bufferSize;
+  }
+  return spans;
+}
+
+/**
+ * Splits a (possibly wrapping) range of a circular buffer dimension into the spans which are contiguous in the buffer.
+ * @param start the first buffer index of the range.
+ * @param length the number of cells of the range.
+ * @param bufferSize the size of the buffer dimension.
+ * @return the (at most two) spans as pairs of (first buffer index, number of cells).
+ */
+std::vector<std::pair<int, int>> getBufferSpans(int start, int length, int bufferSize) {
+  std::vector<std::pair<int, int>> spans;
+  length = std::min(length, bufferSize);
+  grid_map::wrapIndexToRange(start, bufferSize);
+  const int firstSpanLength = std::min(length, bufferSize - start);
+  spans.emplace_back(start, firstSpanLength);
+  if (firstSpanLength < length) {
+    spans.emplace_back(0, length - firstSpanLength);
+  }
+  return spans;
+}
+
+/**
+ * Computes the number of fusion tiles needed to cover a buffer.
+ * @param bufferSize the size of the buffer.
+ * @return the number of tiles per dimension.
+ */
+grid_map::Size getNumberOfTiles(const grid_map::Size& bufferSize) {
+  return (bufferSize + fusionTileSize - 1) / fusionTileSize;
+}
 }  // namespace
 
 namespace elevation_mapping {
 
 ElevationMap::ElevationMap(ros::NodeHandle nodeHandle)
     : nodeHandle_(nodeHandle),
-      rawMap_({"elevation", "variance", "horizontal_variance_x", "horizontal_variance_y", "horizontal_variance_xy", "color", "time",
-               "dynamic_time", "lowest_scan_point", "sensor_x_at_lowest_scan", "sensor_y_at_lowest_scan", "sensor_z_at_lowest_scan"}),
-      fusedMap_({"elevation", "upper_bound", "lower_bound", "color"}),
-      postprocessorPool_(nodeHandle.param("postprocessor_num_threads", 1), nodeHandle_),
+      rawMap_(getMapLayerNames<RawMapLayer>()),
+      fusedMap_(getMapLayerNames<FusedMapLayer>()),
+      rawMapVersion_(0),
+      fusedMapVersion_(0),
+      rawMapSnapshotVersion_(0),
+      fusedMapSnapshotVersion_(0),
+      rawMapAreaCopy_({"elevation", "variance", "horizontal_variance_x", "horizontal_variance_y", "horizontal_variance_xy", "color"}),
+      fusedMapPyramid_(nodeHandle.param("fused_map_pyramid_levels", 0)),
+      postprocessorPool_(nodeHandle.param("postprocessor_num_threads", 1), nodeHandle_, &pipelineStatistics_),
+      fusionThreadPool_(nodeHandle.param("fusion_num_threads", 1)),
+      fusionBuffers_(fusionThreadPool_.size()),
+      fusionKernelResolution_(0.0),
+      fusionKernelQuantizationStep_(0.0),
+      fusionScheduler_(fusionTileSize),
+      integrationThreadPool_(nodeHandle.param("integration_num_threads", 1)),
+      visibilityCleanupThreadPool_(nodeHandle.param("visibility_cleanup_num_threads", 1)),
+      visibilityCleanupMaxHeights_(visibilityCleanupThreadPool_.size()),
       hasUnderlyingMap_(false),
       minVariance_(0.000009),
       maxVariance_(0.0009),
@@ -49,12 +169,30 @@ ElevationMap::ElevationMap(ros::NodeHandle nodeHandle)
       enableVisibilityCleanup_(true),
       enableContinuousCleanup_(false),
       visibilityCleanupDuration_(0.0),
-      scanningDuration_(1.0) {
-  rawMap_.setBasicLayers({"elevation", "variance"});
-  fusedMap_.setBasicLayers({"elevation", "upper_bound", "lower_bound"});
+      visibilityCleanupTimeBudget_(0.0),
+      scanningDuration_(1.0),
+      enableLazyMotionUpdate_(false),
+      enablePointAggregation_(false),
+      fusionKernelQuantization_(0.0),
+      enableFastFusion_(false),
+      fusionTimeBudget_(0.0),
+      enableCompactLayers_(nodeHandle.param("compact_raw_map_layers", false)) {
+  rawMap_.setBasicLayers(getMapLayerNames<RawMapLayer>(true));
+  if (enableCompactLayers_) {
+    for (const auto layer : {RawMapLayer::LowestScanPoint, RawMapLayer::SensorXAtLowestScan, RawMapLayer::SensorYAtLowestScan,
+                             RawMapLayer::SensorZAtLowestScan}) {
+      rawMap_.erase(MapLayerTraits<RawMapLayer>::getName(layer));
+    }
+  }
+  fusedMap_.setBasicLayers(getMapLayerNames<FusedMapLayer>(true));
+  rawMapAreaCopy_.setBasicLayers(rawMap_.getBasicLayers());
   clear();
 
   elevationMapFusedPublisher_ = nodeHandle_.advertise<grid_map_msgs::GridMap>("elevation_map", 1);
+  elevationMapFusedDeltaPublisher_ = std::make_unique<GridMapDeltaPublisher>(nodeHandle_, "elevation_map");
+  for (int level = 1; level <= fusedMapPyramid_.getNumberOfLevels(); ++level) {
+    elevationMapLevelPublishers_.push_back(nodeHandle_.advertise<grid_map_msgs::GridMap>("elevation_map_level_" + std::to_string(level), 1));
+  }
   if (!underlyingMapTopic_.empty()) {
     underlyingMapSubscriber_ = nodeHandle_.subscribe(underlyingMapTopic_, 1, &ElevationMap::underlyingMapCallback, this);
   }
@@ -64,20 +202,54 @@ ElevationMap::ElevationMap(ros::NodeHandle nodeHandle)
   initialTime_ = ros::Time::now();
 }
 
-ElevationMap::~ElevationMap() = default;
+ElevationMap::~ElevationMap() {
+  // Keep the cells of the map in the tile store.
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  if (tileStore_) {
+    applyPendingMotionUpdates();
+    for (grid_map::GridMapIterator iterator(rawMap_); !iterator.isPastEnd(); ++iterator) {
+      tileStore_->writeCell(rawMap_, *iterator);
+    }
+  }
+}
 
 void ElevationMap::setGeometry(const grid_map::Length& length, const double& resolution, const grid_map::Position& position) {
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
   boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
   rawMap_.setGeometry(length, resolution, position);
+  rawMap_.get("dynamic_time").setZero();
+  if (enableCompactLayers_) {
+    compactLowestScanLayers_.resize(rawMap_.getSize());
+  }
   fusedMap_.setGeometry(length, resolution, position);
+  fusedMapPyramid_.markAllModified();
+  resetPendingMotionUpdates();
+  deferredVisibilityCleanupRays_.clear();
+  markRawMapModified();
+  ++fusedMapVersion_;
   ROS_INFO_STREAM("Elevation map grid resized to " << rawMap_.getSize()(0) << " rows and " << rawMap_.getSize()(1) << " columns.");
 }
-bool ElevationMap::add(const PointCloudType::Ptr pointCloud, Eigen::VectorXf& pointCloudVariances, const ros::Time& timestamp,
-                       const Eigen::Affine3d& transformationSensorToMap) {
-  if (static_cast<unsigned int>(pointCloud->size()) != static_cast<unsigned int>(pointCloudVariances.size())) {
-    ROS_ERROR("ElevationMap::add: Size of point cloud (%i) and variances (%i) do not agree.", (int)pointCloud->size(),
-              (int)pointCloudVariances.size());
+bool ElevationMap::add(const PointCloudType::Ptr pointCloud, const Eigen::Ref<const Eigen::VectorXf>& pointCloudVariances,
+                       const ros::Time& timestamp, const Eigen::Affine3d& transformationSensorToMap) {
+  return add({PointCloudMeasurement(pointCloud, pointCloudVariances, timestamp, transformationSensorToMap)});
+}
+
+bool ElevationMap::add(const std::vector<PointCloudMeasurement>& measurements) {
+  if (measurements.empty()) {
+    return true;
+  }
+  // The points of all point clouds are numbered consecutively, in the order of the measurements.
+  std::vector<std::size_t> pointCloudBegins(1, 0);
+  for (const auto& measurement : measurements) {
+    if (static_cast<unsigned int>(measurement.pointCloud->size()) != static_cast<unsigned int>(measurement.variances.size())) {
+      ROS_ERROR("ElevationMap::add: Size of point cloud (%i) and variances (%i) do not agree.", (int)measurement.pointCloud->size(),
+                (int)measurement.variances.size());
+      return false;
+    }
+    pointCloudBegins.push_back(pointCloudBegins.back() + measurement.pointCloud->size());
+  }
+  if (pointCloudBegins.back() > std::numeric_limits<uint32_t>::max()) {
+    ROS_ERROR("ElevationMap::add: Too many points (%zu).", pointCloudBegins.back());
     return false;
   }
 
@@ -88,145 +260,461 @@ bool ElevationMap::add(const PointCloudType::Ptr pointCloud, Eigen::VectorXf& po
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
 
   // Update initial time if it is not initialized.
+  const auto byTimeStamp = [](const PointCloudMeasurement& a, const PointCloudMeasurement& b) { return a.timeStamp < b.timeStamp; };
   if (initialTime_.toSec() == 0) {
-    initialTime_ = timestamp;
+    initialTime_ = std::min_element(measurements.begin(), measurements.end(), byTimeStamp)->timeStamp;
+  }
+  const ros::Time timestamp = std::max_element(measurements.begin(), measurements.end(), byTimeStamp)->timeStamp;
+  std::vector<float> scanTimesSinceInitialization;
+  for (const auto& measurement : measurements) {
+    scanTimesSinceInitialization.push_back((measurement.timeStamp - initialTime_).toSec());
   }
-  const float scanTimeSinceInitialization = (timestamp - initialTime_).toSec();
+  const auto getPointCloud = [&](std::size_t i) {
+    const auto next = std::upper_bound(pointCloudBegins.begin() + 1, pointCloudBegins.end(), i);
+    return static_cast<std::size_t>(next - pointCloudBegins.begin() - 1);
+  };
 
   // Store references for efficient interation.
-  auto& elevationLayer = rawMap_["elevation"];
-  auto& varianceLayer = rawMap_["variance"];
-  auto& horizontalVarianceXLayer = rawMap_["horizontal_variance_x"];
-  auto& horizontalVarianceYLayer = rawMap_["horizontal_variance_y"];
-  auto& horizontalVarianceXYLayer = rawMap_["horizontal_variance_xy"];
-  auto& colorLayer = rawMap_["color"];
-  auto& timeLayer = rawMap_["time"];
-  auto& dynamicTimeLayer = rawMap_["dynamic_time"];
-  auto& lowestScanPointLayer = rawMap_["lowest_scan_point"];
-  auto& sensorXatLowestScanLayer = rawMap_["sensor_x_at_lowest_scan"];
-  auto& sensorYatLowestScanLayer = rawMap_["sensor_y_at_lowest_scan"];
-  auto& sensorZatLowestScanLayer = rawMap_["sensor_z_at_lowest_scan"];
-
-  std::vector<Eigen::Ref<const grid_map::Matrix>> basicLayers_;
-  for (const std::string& layer : rawMap_.getBasicLayers()) {
-    basicLayers_.push_back(rawMap_.get(layer));
-  }
-
-  for (unsigned int i = 0; i < pointCloud->size(); ++i) {
-    auto& point = pointCloud->points[i];
-    grid_map::Index index;
-    grid_map::Position position(point.x, point.y);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (!rawMap_.getIndex(position, index)) {
-      continue;  // Skip this point if it does not lie within the elevation map.
-    }
-
-    auto& elevation = elevationLayer(index(0), index(1));
-    auto& variance = varianceLayer(index(0), index(1));
-    auto& horizontalVarianceX = horizontalVarianceXLayer(index(0), index(1));
-    auto& horizontalVarianceY = horizontalVarianceYLayer(index(0), index(1));
-    auto& horizontalVarianceXY = horizontalVarianceXYLayer(index(0), index(1));
-    auto& color = colorLayer(index(0), index(1));
-    auto& time = timeLayer(index(0), index(1));
-    auto& dynamicTime = dynamicTimeLayer(index(0), index(1));
-    auto& lowestScanPoint = lowestScanPointLayer(index(0), index(1));
-    auto& sensorXatLowestScan = sensorXatLowestScanLayer(index(0), index(1));
-    auto& sensorYatLowestScan = sensorYatLowestScanLayer(index(0), index(1));
-    auto& sensorZatLowestScan = sensorZatLowestScanLayer(index(0), index(1));
-
-    const float& pointVariance = pointCloudVariances(i);
-    bool isValid = std::all_of(basicLayers_.begin(), basicLayers_.end(),
-                               [&](Eigen::Ref<const grid_map::Matrix> layer) { return std::isfinite(layer(index(0), index(1))); });
-    if (!isValid) {
-      // No prior information in elevation map, use measurement.
-      elevation = point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
-      variance = pointVariance;
-      horizontalVarianceX = minHorizontalVariance_;
-      horizontalVarianceY = minHorizontalVariance_;
-      horizontalVarianceXY = 0.0;
-      grid_map::colorVectorToValue(point.getRGBVector3i(), color);
-      continue;
-    }
+  const RawMapLayers layers(rawMap_);
+  auto& elevationLayer = layers[RawMapLayer::Elevation];
+  auto& varianceLayer = layers[RawMapLayer::Variance];
+  auto& horizontalVarianceXLayer = layers[RawMapLayer::HorizontalVarianceX];
+  auto& horizontalVarianceYLayer = layers[RawMapLayer::HorizontalVarianceY];
+  auto& horizontalVarianceXYLayer = layers[RawMapLayer::HorizontalVarianceXY];
+  auto& colorLayer = layers[RawMapLayer::Color];
+  auto& timeLayer = layers[RawMapLayer::Time];
+  auto& dynamicTimeLayer = layers[RawMapLayer::DynamicTime];
+  grid_map::Matrix* lowestScanPointLayer = nullptr;
+  grid_map::Matrix* sensorXatLowestScanLayer = nullptr;
+  grid_map::Matrix* sensorYatLowestScanLayer = nullptr;
+  grid_map::Matrix* sensorZatLowestScanLayer = nullptr;
+  if (!enableCompactLayers_) {
+    lowestScanPointLayer = &layers[RawMapLayer::LowestScanPoint];
+    sensorXatLowestScanLayer = &layers[RawMapLayer::SensorXAtLowestScan];
+    sensorYatLowestScanLayer = &layers[RawMapLayer::SensorYAtLowestScan];
+    sensorZatLowestScanLayer = &layers[RawMapLayer::SensorZAtLowestScan];
+  }
 
-    // Deal with multiple heights in one cell.
-    const double mahalanobisDistance = fabs(point.z - elevation) / sqrt(variance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (mahalanobisDistance > mahalanobisDistanceThreshold_) {
-      if (scanTimeSinceInitialization - time <= scanningDuration_ &&
-          elevation > point.z) {  // NOLINT(cppcoreguidelines-pro-type-union-access)
-        // Ignore point if measurement is from the same point cloud (time comparison) and
-        // if measurement is lower then the elevation in the map.
-      } else if (scanTimeSinceInitialization - time <= scanningDuration_) {
-        // If point is higher.
-        elevation = point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
-        variance = pointVariance;
-      } else {
-        variance += multiHeightNoise_;
+  const bool hasPendingMotionUpdate = hasPendingMotionUpdates();
+  const auto currentMotionUpdateStamp = static_cast<uint32_t>(motionUpdateHistory_.size() - 1);
+
+  // Compute the cell of every point and sort the points by cell. The key holds the linear (column-major)
+  // cell index in the upper and the point index in the lower bits, such that the points of a cell keep
+  // their order and the cells are visited in memory order. Points outside of the map are sorted to the end.
+  const std::size_t numberOfPoints = pointCloudBegins.back();
+  const std::size_t numberOfChunks = integrationThreadPool_.size() > 1 ? 4 * integrationThreadPool_.size() : 1;
+  const auto getChunkBegin = [&](std::size_t chunk) { return chunk * numberOfPoints / numberOfChunks; };
+  const uint64_t invalidCellPointKey = std::numeric_limits<uint64_t>::max();
+  const auto bufferRows = static_cast<uint64_t>(rawMap_.getSize()(0));
+  std::vector<uint64_t>& cellPointKeys = cellPointKeys_;
+  cellPointKeys.resize(numberOfPoints);
+  integrationThreadPool_.parallelFor(numberOfChunks, [&](std::size_t chunk, std::size_t /*threadIndex*/) {
+    std::size_t pointCloudIndex = getPointCloud(getChunkBegin(chunk));
+    for (std::size_t i = getChunkBegin(chunk); i < getChunkBegin(chunk + 1); ++i) {
+      while (i >= pointCloudBegins[pointCloudIndex + 1]) {
+        ++pointCloudIndex;
       }
+      const auto& point = measurements[pointCloudIndex].pointCloud->points[i - pointCloudBegins[pointCloudIndex]];
+      grid_map::Index index;
+      grid_map::Position position(point.x, point.y);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      if (!rawMap_.getIndex(position, index)) {
+        cellPointKeys[i] = invalidCellPointKey;  // Skip this point if it does not lie within the elevation map.
+        continue;
+      }
+      const uint64_t cellIndex = static_cast<uint64_t>(index(0)) + static_cast<uint64_t>(index(1)) * bufferRows;
+      cellPointKeys[i] = cellIndex << 32 | i;
+    }
+    std::sort(cellPointKeys.begin() + getChunkBegin(chunk), cellPointKeys.begin() + getChunkBegin(chunk + 1));
+  });
+  for (std::size_t width = 1; width < numberOfChunks; width *= 2) {
+    integrationThreadPool_.parallelFor((numberOfChunks + 2 * width - 1) / (2 * width), [&](std::size_t pair, std::size_t /*threadIndex*/) {
+      const std::size_t first = 2 * width * pair;
+      const std::size_t middle = std::min(first + width, numberOfChunks);
+      const std::size_t last = std::min(first + 2 * width, numberOfChunks);
+      std::inplace_merge(cellPointKeys.begin() + getChunkBegin(first), cellPointKeys.begin() + getChunkBegin(middle),
+                         cellPointKeys.begin() + getChunkBegin(last));
+    });
+  }
+  cellPointKeys.erase(std::lower_bound(cellPointKeys.begin(), cellPointKeys.end(), invalidCellPointKey), cellPointKeys.end());
+
+  // Mark the modified tiles and split the points into chunks at cell boundaries, such that each chunk owns
+  // a disjoint set of cells and the chunks can be integrated in parallel without locking.
+  std::vector<std::size_t>& chunkBegins = chunkBegins_;
+  chunkBegins.assign(1, 0);
+  for (std::size_t k = 0; k < cellPointKeys.size(); ++k) {
+    const uint64_t cellIndex = cellPointKeys[k] >> 32;
+    if (k > 0 && cellIndex == cellPointKeys[k - 1] >> 32) {
       continue;
     }
-
-    // Store lowest points from scan for visibility checking.
-    const float pointHeightPlusUncertainty =
-        point.z + 3.0 * sqrt(pointVariance);  // 3 sigma. // NOLINT(cppcoreguidelines-pro-type-union-access)
-    if (std::isnan(lowestScanPoint) || pointHeightPlusUncertainty < lowestScanPoint) {
-      lowestScanPoint = pointHeightPlusUncertainty;
-      const grid_map::Position3 sensorTranslation(transformationSensorToMap.translation());
-      sensorXatLowestScan = sensorTranslation.x();
-      sensorYatLowestScan = sensorTranslation.y();
-      sensorZatLowestScan = sensorTranslation.z();
+    const auto row = static_cast<int>(cellIndex % bufferRows);
+    const auto col = static_cast<int>(cellIndex / bufferRows);
+    dirtyTiles_(row / fusionTileSize, col / fusionTileSize) = true;
+    visibilityCleanupTiles_(row / fusionTileSize, col / fusionTileSize) = true;
+    if (k >= chunkBegins.size() * cellPointKeys.size() / numberOfChunks) {
+      chunkBegins.push_back(k);
     }
+  }
+  chunkBegins.push_back(cellPointKeys.size());
+
+  // Integrate the points cell by cell. The points of a cell are processed in the order of the cloud,
+  // so the result is the same as when integrating the points one by one. The variances of a cell are
+  // clamped after its last point, which replaces a clamping pass over the whole map. With the point aggregation, the
+  // points of a point cloud in a cell are first reduced to a few representatives, see CellPointAggregate.
+  const VarianceClampOperator<float> varianceClamp(minVariance_, maxVariance_);
+  const VarianceClampOperator<float> horizontalVarianceClamp(minHorizontalVariance_, maxHorizontalVariance_);
+  integrationThreadPool_.parallelFor(chunkBegins.size() - 1, [&](std::size_t chunk, std::size_t /*threadIndex*/) {
+    const std::size_t chunkEnd = chunkBegins[chunk + 1];
+    CellPointAggregate aggregate;
+    for (std::size_t k = chunkBegins[chunk]; k < chunkEnd;) {
+      const uint64_t cellKey = cellPointKeys[k] >> 32;
+      const auto cellIndex = static_cast<grid_map::Matrix::Index>(cellKey);
+      const grid_map::Index index(static_cast<int>(cellKey % bufferRows), static_cast<int>(cellKey / bufferRows));
+
+      auto& elevation = elevationLayer(cellIndex);
+      auto& variance = varianceLayer(cellIndex);
+      auto& horizontalVarianceX = horizontalVarianceXLayer(cellIndex);
+      auto& horizontalVarianceY = horizontalVarianceYLayer(cellIndex);
+      auto& horizontalVarianceXY = horizontalVarianceXYLayer(cellIndex);
+      auto& color = colorLayer(cellIndex);
+      auto& time = timeLayer(cellIndex);
+      auto& dynamicTime = dynamicTimeLayer(cellIndex);
+
+      const auto hasCellData = [&]() { return layers.isValid(index); };
+
+      // Bring the variances of the cell up to date before they are used.
+      if (hasPendingMotionUpdate && motionUpdateStamps_(cellIndex) != currentMotionUpdateStamp) {
+        applyPendingMotionUpdate(index, elevation, variance, horizontalVarianceX, horizontalVarianceY, horizontalVarianceXY);
+      }
 
-    // Fuse measurement with elevation map data.
-    elevation =
-        (variance * point.z + pointVariance * elevation) / (variance + pointVariance);  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    variance = (pointVariance * variance) / (pointVariance + variance);
-    // TODO(max): Add color fusion.
-    grid_map::colorVectorToValue(point.getRGBVector3i(), color);
-    time = scanTimeSinceInitialization;
-    dynamicTime = currentTimeSecondsPattern;
+      // Integrates a measurement of the cell, a point or the representative of several points of a point cloud.
+      const auto integrateMeasurement = [&](float height, float pointVariance, float pointHeightPlusUncertainty,
+                                            const PointCloudType::PointType& colorPoint, float scanTimeSinceInitialization,
+                                            const grid_map::Position3& sensorTranslation) {
+        if (!hasCellData()) {
+          // No prior information in elevation map, use measurement.
+          elevation = height;
+          variance = pointVariance;
+          horizontalVarianceX = minHorizontalVariance_;
+          horizontalVarianceY = minHorizontalVariance_;
+          horizontalVarianceXY = 0.0;
+          grid_map::colorVectorToValue(colorPoint.getRGBVector3i(), color);
+          return;
+        }
 
-    // Horizontal variances are reset.
-    horizontalVarianceX = minHorizontalVariance_;
-    horizontalVarianceY = minHorizontalVariance_;
-    horizontalVarianceXY = 0.0;
-  }
+        // Deal with multiple heights in one cell.
+        const double mahalanobisDistance = fabs(height - elevation) / sqrt(variance);
+        if (mahalanobisDistance > mahalanobisDistanceThreshold_) {
+          if (scanTimeSinceInitialization - time <= scanningDuration_ && elevation > height) {
+            // Ignore point if measurement is from the same point cloud (time comparison) and
+            // if measurement is lower then the elevation in the map.
+          } else if (scanTimeSinceInitialization - time <= scanningDuration_) {
+            // If point is higher.
+            elevation = height;
+            variance = pointVariance;
+          } else {
+            variance += multiHeightNoise_;
+          }
+          return;
+        }
+
+        // Store lowest points from scan for visibility checking.
+        if (enableCompactLayers_) {
+          int16_t& lowestScanPoint = compactLowestScanLayers_.lowestScanPoint(cellIndex);
+          if (lowestScanPoint == emptyCompactCell || pointHeightPlusUncertainty < dequantize(lowestScanPoint)) {
+            grid_map::Position cellPosition;
+            rawMap_.getPosition(index, cellPosition);
+            int16_t quantizedLowestScanPoint, sensorX, sensorY, sensorZ;
+            if (quantize(pointHeightPlusUncertainty, quantizedLowestScanPoint) && quantize(sensorTranslation.x() - cellPosition.x(), sensorX) &&
+                quantize(sensorTranslation.y() - cellPosition.y(), sensorY) && quantize(sensorTranslation.z(), sensorZ)) {
+              lowestScanPoint = quantizedLowestScanPoint;
+              compactLowestScanLayers_.sensorX(cellIndex) = sensorX;
+              compactLowestScanLayers_.sensorY(cellIndex) = sensorY;
+              compactLowestScanLayers_.sensorZ(cellIndex) = sensorZ;
+            }
+          }
+        } else {
+          float& lowestScanPoint = (*lowestScanPointLayer)(cellIndex);
+          if (std::isnan(lowestScanPoint) || pointHeightPlusUncertainty < lowestScanPoint) {
+            lowestScanPoint = pointHeightPlusUncertainty;
+            (*sensorXatLowestScanLayer)(cellIndex) = sensorTranslation.x();
+            (*sensorYatLowestScanLayer)(cellIndex) = sensorTranslation.y();
+            (*sensorZatLowestScanLayer)(cellIndex) = sensorTranslation.z();
+          }
+        }
+
+        // Fuse measurement with elevation map data.
+        elevation = (variance * height + pointVariance * elevation) / (variance + pointVariance);
+        variance = (pointVariance * variance) / (pointVariance + variance);
+        // TODO(max): Add color fusion.
+        grid_map::colorVectorToValue(colorPoint.getRGBVector3i(), color);
+        time = scanTimeSinceInitialization;
+        dynamicTime = currentTimeSecondsPattern;
+
+        // Horizontal variances are reset.
+        horizontalVarianceX = minHorizontalVariance_;
+        horizontalVarianceY = minHorizontalVariance_;
+        horizontalVarianceXY = 0.0;
+      };
+
+      while (k < chunkEnd && cellPointKeys[k] >> 32 == cellKey) {
+        // The points of a point cloud are consecutive within the cell.
+        const std::size_t pointCloudIndex = getPointCloud(static_cast<std::size_t>(cellPointKeys[k] & 0xFFFFFFFF));
+        const PointCloudMeasurement& measurement = measurements[pointCloudIndex];
+        const std::size_t pointCloudBegin = pointCloudBegins[pointCloudIndex];
+        const std::size_t pointCloudEnd = pointCloudBegins[pointCloudIndex + 1];
+        std::size_t runEnd = k;
+        while (runEnd < chunkEnd && cellPointKeys[runEnd] >> 32 == cellKey && (cellPointKeys[runEnd] & 0xFFFFFFFF) < pointCloudEnd) {
+          ++runEnd;
+        }
+        const float scanTimeSinceInitialization = scanTimesSinceInitialization[pointCloudIndex];
+        const grid_map::Position3& sensorTranslation = measurement.sensorTranslation;
+        const auto getPointIndex = [&](std::size_t key) {
+          return static_cast<std::size_t>(cellPointKeys[key] & 0xFFFFFFFF) - pointCloudBegin;
+        };
+        const auto integratePoint = [&](std::size_t i) {
+          const auto& point = measurement.pointCloud->points[i];
+          const float pointVariance = measurement.variances(i);
+          const float height = point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
+          const float pointHeightPlusUncertainty = height + 3.0 * sqrt(pointVariance);  // 3 sigma.
+          integrateMeasurement(height, pointVariance, pointHeightPlusUncertainty, point, scanTimeSinceInitialization, sensorTranslation);
+        };
+
+        if (!enablePointAggregation_ || runEnd - k < minPointsForAggregation) {
+          for (; k < runEnd; ++k) {
+            integratePoint(getPointIndex(k));
+          }
+          continue;
+        }
+
+        // Reduce the points of the point cloud to a few representatives. An empty cell is initialized with the first point,
+        // such that the points are split at the same threshold as when integrating them one by one.
+        if (!hasCellData()) {
+          integratePoint(getPointIndex(k++));
+        }
+        aggregate.reset(elevation, variance, mahalanobisDistanceThreshold_);
+        for (; k < runEnd; ++k) {
+          const std::size_t i = getPointIndex(k);
+          const float height = measurement.pointCloud->points[i].z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
+          aggregate.add(height, measurement.variances(i), i);
+        }
+        if (aggregate.hasMean()) {
+          const CellPointAggregate::Representative mean = aggregate.getMean();
+          integrateMeasurement(mean.height, mean.variance, mean.heightPlusUncertainty, measurement.pointCloud->points[mean.pointIndex],
+                               scanTimeSinceInitialization, sensorTranslation);
+        }
+        // The highest outlier comes last, it replaces lower surfaces of the same scan as with the sequential update.
+        if (aggregate.getNumberOfOutliers() > 1) {
+          integratePoint(aggregate.getLowestOutlier().pointIndex);
+        }
+        if (aggregate.getNumberOfOutliers() > 0) {
+          integratePoint(aggregate.getHighestOutlier().pointIndex);
+        }
+      }
+
+      variance = varianceClamp(variance);
+      horizontalVarianceX = horizontalVarianceClamp(horizontalVarianceX);
+      horizontalVarianceY = horizontalVarianceClamp(horizontalVarianceY);
+    }
+  });
 
   clean();
   rawMap_.setTimestamp(timestamp.toNSec());  // Point cloud stores time in microseconds.
+  ++rawMapVersion_;
 
   const ros::WallDuration duration = ros::WallTime::now() - methodStartTime;
-  ROS_DEBUG("Raw map has been updated with a new point cloud in %f s.", duration.toSec());
+  ROS_DEBUG("Raw map has been updated with %zu new point cloud(s) in %f s.", measurements.size(), duration.toSec());
+  pipelineStatistics_.addDuration("map", PipelineStage::Add, duration.toSec());
   return true;
 }
 
-bool ElevationMap::update(const grid_map::Matrix& varianceUpdate, const grid_map::Matrix& horizontalVarianceUpdateX,
-                          const grid_map::Matrix& horizontalVarianceUpdateY, const grid_map::Matrix& horizontalVarianceUpdateXY,
-                          const ros::Time& time) {
+bool ElevationMap::update(const MotionVarianceUpdate& motionUpdate, const ros::Time& time) {
   boost::recursive_mutex::scoped_lock scopedLock(rawMapMutex_);
 
-  const auto& size = rawMap_.getSize();
+  const grid_map::Size& size = rawMap_.getSize();
+  const bool hasUpdate = (motionUpdate.translationVariance.array() != 0.0).any() || motionUpdate.yawVariance != 0.0;
+  if (hasUpdate && enableLazyMotionUpdate_) {
+    accumulateMotionUpdate(motionUpdate);
+    rawMap_.setTimestamp(time.toNSec());
+    ++rawMapVersion_;
+    return true;
+  }
 
-  if (!((grid_map::Index(varianceUpdate.rows(), varianceUpdate.cols()) == size).all() &&
-        (grid_map::Index(horizontalVarianceUpdateX.rows(), horizontalVarianceUpdateX.cols()) == size).all() &&
-        (grid_map::Index(horizontalVarianceUpdateY.rows(), horizontalVarianceUpdateY.cols()) == size).all() &&
-        (grid_map::Index(horizontalVarianceUpdateXY.rows(), horizontalVarianceUpdateXY.cols()) == size).all())) {
-    ROS_ERROR("The size of the update matrices does not match.");
-    return false;
+  if (hasUpdate) {
+    // In the map buffer, the x-position of a cell only depends on its row and the y-position only on its column.
+    cellPositionsX_.resize(size(0));
+    cellPositionsY_.resize(size(1));
+    grid_map::Position position;
+    for (int row = 0; row < size(0); ++row) {
+      rawMap_.getPosition(grid_map::Index(row, 0), position);
+      cellPositionsX_(row) = static_cast<float>(motionUpdate.mapPosition.x() + position.x());
+    }
+    for (int col = 0; col < size(1); ++col) {
+      rawMap_.getPosition(grid_map::Index(0, col), position);
+      cellPositionsY_(col) = static_cast<float>(motionUpdate.mapPosition.y() + position.y());
+    }
+
+    const RawMapLayers layers(rawMap_);
+    grid_map::Matrix& elevationLayer = layers[RawMapLayer::Elevation];
+    grid_map::Matrix& varianceLayer = layers[RawMapLayer::Variance];
+    grid_map::Matrix& horizontalVarianceXLayer = layers[RawMapLayer::HorizontalVarianceX];
+    grid_map::Matrix& horizontalVarianceYLayer = layers[RawMapLayer::HorizontalVarianceY];
+    grid_map::Matrix& horizontalVarianceXYLayer = layers[RawMapLayer::HorizontalVarianceXY];
+    const Eigen::Vector3f& translationVariance = motionUpdate.translationVariance;
+    const Eigen::Vector3f& yawAxis = motionUpdate.yawAxis;
+    const float yawVariance = motionUpdate.yawVariance;
+    const float mapPositionZ = static_cast<float>(motionUpdate.mapPosition.z());
+    const VarianceClampOperator<float> varianceClamp(minVariance_, maxVariance_);
+    const VarianceClampOperator<float> horizontalVarianceClamp(minHorizontalVariance_, maxHorizontalVariance_);
+
+    // Every tile column is updated column by column, the column-major layers are traversed contiguously.
+    integrationThreadPool_.parallelFor(dirtyTiles_.cols(), [&](std::size_t tileCol, std::size_t /*threadIndex*/) {
+      const int colBegin = static_cast<int>(tileCol) * fusionTileSize;
+      const int colEnd = std::min(colBegin + fusionTileSize, size(1));
+      for (int col = colBegin; col < colEnd; ++col) {
+        const auto heights = elevationLayer.col(col).array();
+        const auto isValid = heights.isFinite();
+        // Horizontal part of the rotation Jacobian times the yaw axis, (cellPosition x yawAxis).head<2>() (25).
+        const auto positionZ = heights + mapPositionZ;
+        const auto rotationX = yawAxis.z() * cellPositionsY_(col) - yawAxis.y() * positionZ;
+        const auto rotationY = yawAxis.x() * positionZ - yawAxis.z() * cellPositionsX_;
+
+        auto variance = varianceLayer.col(col).array();
+        auto horizontalVarianceX = horizontalVarianceXLayer.col(col).array();
+        auto horizontalVarianceY = horizontalVarianceYLayer.col(col).array();
+        auto horizontalVarianceXY = horizontalVarianceXYLayer.col(col).array();
+        variance = isValid.select((variance + translationVariance.z()).unaryExpr(varianceClamp), variance);
+        horizontalVarianceX = isValid.select(
+            (horizontalVarianceX + (translationVariance.x() + yawVariance * rotationX.square())).unaryExpr(horizontalVarianceClamp),
+            horizontalVarianceX);
+        horizontalVarianceY = isValid.select(
+            (horizontalVarianceY + (translationVariance.y() + yawVariance * rotationY.square())).unaryExpr(horizontalVarianceClamp),
+            horizontalVarianceY);
+        horizontalVarianceXY = isValid.select(horizontalVarianceXY + yawVariance * rotationX * rotationY, horizontalVarianceXY);
+
+        for (int tileRow = 0; tileRow < dirtyTiles_.rows(); ++tileRow) {
+          const int row = tileRow * fusionTileSize;
+          if (!dirtyTiles_(tileRow, tileCol) && isValid.segment(row, std::min(fusionTileSize, size(0) - row)).any()) {
+            dirtyTiles_(tileRow, tileCol) = true;
+          }
+        }
+      }
+    });
   }
 
-  rawMap_.get("variance") += varianceUpdate;
-  rawMap_.get("horizontal_variance_x") += horizontalVarianceUpdateX;
-  rawMap_.get("horizontal_variance_y") += horizontalVarianceUpdateY;
-  rawMap_.get("horizontal_variance_xy") += horizontalVarianceUpdateXY;
   clean();
   rawMap_.setTimestamp(time.toNSec());
+  ++rawMapVersion_;
+
+  return true;
+}
+
+void ElevationMap::accumulateMotionUpdate(const MotionVarianceUpdate& motionUpdate) {
+  if (motionUpdateStamps_.rows() != rawMap_.getSize()(0) || motionUpdateStamps_.cols() != rawMap_.getSize()(1)) {
+    resetPendingMotionUpdates();
+  }
+
+  // The rotational increments (see update()) are sigma_yaw^2 * (u * (y, height, 1)^T)^2 for the x-direction and
+  // sigma_yaw^2 * (w * (x, height, 1)^T)^2 for the y-direction.
+  const Eigen::Vector3d yawAxis = motionUpdate.yawAxis.cast<double>();
+  const Eigen::Vector3d& mapPosition = motionUpdate.mapPosition;
+  const Eigen::Vector3d u(yawAxis.z(), -yawAxis.y(), yawAxis.z() * mapPosition.y() - yawAxis.y() * mapPosition.z());
+  const Eigen::Vector3d w(-yawAxis.z(), yawAxis.x(), yawAxis.x() * mapPosition.z() - yawAxis.z() * mapPosition.x());
+  const double yawVariance = motionUpdate.yawVariance;
+
+  MotionVarianceAccumulator accumulator = motionUpdateHistory_.back();
+  accumulator.translationVariance += motionUpdate.translationVariance.cast<double>();
+  accumulator.horizontalVarianceX += yawVariance * u * u.transpose();
+  accumulator.horizontalVarianceY += yawVariance * w * w.transpose();
+  accumulator.horizontalVarianceXY += yawVariance * u * w.transpose();
+  motionUpdateHistory_.push_back(accumulator);
+
+  if (motionUpdateHistory_.size() > maxPendingMotionUpdates) {
+    applyPendingMotionUpdates();
+  }
+}
+
+bool ElevationMap::applyPendingMotionUpdate(const grid_map::Index& index, float elevation, float& variance, float& horizontalVarianceX,
+                                            float& horizontalVarianceY, float& horizontalVarianceXY) {
+  uint32_t& stamp = motionUpdateStamps_(index(0), index(1));
+  const MotionVarianceAccumulator& previous = motionUpdateHistory_[stamp];
+  const MotionVarianceAccumulator& current = motionUpdateHistory_.back();
+  stamp = static_cast<uint32_t>(motionUpdateHistory_.size() - 1);
+  if (!std::isfinite(elevation)) {
+    return false;
+  }
 
+  grid_map::Position position;
+  rawMap_.getPosition(index, position);
+  const Eigen::Vector3d positionX(position.y(), elevation, 1.0);
+  const Eigen::Vector3d positionY(position.x(), elevation, 1.0);
+  const Eigen::Vector3d translationVariance = current.translationVariance - previous.translationVariance;
+
+  // Variances only grow, so clamping once gives the same result as clamping after every update.
+  const VarianceClampOperator<float> varianceClamp(minVariance_, maxVariance_);
+  const VarianceClampOperator<float> horizontalVarianceClamp(minHorizontalVariance_, maxHorizontalVariance_);
+  variance = varianceClamp(variance + translationVariance.z());
+  horizontalVarianceX = horizontalVarianceClamp(
+      horizontalVarianceX +
+      (translationVariance.x() + positionX.dot((current.horizontalVarianceX - previous.horizontalVarianceX) * positionX)));
+  horizontalVarianceY = horizontalVarianceClamp(
+      horizontalVarianceY +
+      (translationVariance.y() + positionY.dot((current.horizontalVarianceY - previous.horizontalVarianceY) * positionY)));
+  horizontalVarianceXY += positionX.dot((current.horizontalVarianceXY - previous.horizontalVarianceXY) * positionY);
   return true;
 }
 
+void ElevationMap::applyPendingMotionUpdates() {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  if (!hasPendingMotionUpdates()) {
+    return;
+  }
+
+  const grid_map::Size& size = rawMap_.getSize();
+  const RawMapLayers layers(rawMap_);
+  const grid_map::Matrix& elevationLayer = layers[RawMapLayer::Elevation];
+  grid_map::Matrix& varianceLayer = layers[RawMapLayer::Variance];
+  grid_map::Matrix& horizontalVarianceXLayer = layers[RawMapLayer::HorizontalVarianceX];
+  grid_map::Matrix& horizontalVarianceYLayer = layers[RawMapLayer::HorizontalVarianceY];
+  grid_map::Matrix& horizontalVarianceXYLayer = layers[RawMapLayer::HorizontalVarianceXY];
+  integrationThreadPool_.parallelFor(dirtyTiles_.cols(), [&](std::size_t tileCol, std::size_t /*threadIndex*/) {
+    const int colBegin = static_cast<int>(tileCol) * fusionTileSize;
+    const int colEnd = std::min(colBegin + fusionTileSize, size(1));
+    for (int col = colBegin; col < colEnd; ++col) {
+      for (int row = 0; row < size(0); ++row) {
+        if (applyPendingMotionUpdate(grid_map::Index(row, col), elevationLayer(row, col), varianceLayer(row, col),
+                                     horizontalVarianceXLayer(row, col), horizontalVarianceYLayer(row, col),
+                                     horizontalVarianceXYLayer(row, col))) {
+          dirtyTiles_(row / fusionTileSize, tileCol) = true;
+        }
+      }
+    }
+  });
+  resetPendingMotionUpdates();
+}
+
+void ElevationMap::resetPendingMotionUpdates() {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  motionUpdateHistory_.assign(1, MotionVarianceAccumulator());
+  motionUpdateStamps_.setZero(rawMap_.getSize()(0), rawMap_.getSize()(1));
+}
+
 bool ElevationMap::fuseAll() {
   ROS_DEBUG("Requested to fuse entire elevation map.");
   boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
-  return fuse(grid_map::Index(0, 0), fusedMap_.getSize());
+  if (!fuse(grid_map::Index(0, 0), fusedMap_.getSize())) {
+    return false;
+  }
+  fusionScheduler_.markAllFused(getNumberOfTiles(fusedMap_.getSize()));
+  return true;
+}
+
+bool ElevationMap::fuseWithinTimeBudget() {
+  if (fusionTimeBudget_ <= 0.0) {
+    return fuseAll();
+  }
+  ROS_DEBUG("Requested to fuse the elevation map within %f s.", fusionTimeBudget_);
+  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
+  return fuse(grid_map::Index(0, 0), fusedMap_.getSize(), false, fusionTimeBudget_);
 }
 
 bool ElevationMap::fuseArea(const Eigen::Vector2d& position, const Eigen::Array2d& length) {
@@ -242,15 +730,134 @@ bool ElevationMap::fuseArea(const Eigen::Vector2d& position, const Eigen::Array2
   grid_map::Index requestedIndexInSubmap;
 
   boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
-
+  fusionScheduler_.addPriorityRegion(position, length, ros::WallTime::now().toSec());
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
   grid_map::getSubmapInformation(topLeftIndex, submapBufferSize, submapPosition, submapLength, requestedIndexInSubmap, position, length,
                                  rawMap_.getLength(), rawMap_.getPosition(), rawMap_.getResolution(), rawMap_.getSize(),
                                  rawMap_.getStartIndex());
+  scopedLockForRawData.unlock();
 
-  return fuse(topLeftIndex, submapBufferSize);
+  return fuse(topLeftIndex, submapBufferSize, true);
 }
 
-bool ElevationMap::fuse(const grid_map::Index& topLeftIndex, const grid_map::Index& size) {
+bool ElevationMap::getFusedSubmap(const grid_map::Position& position, const grid_map::Length& length,
+                                  const std::vector<std::string>& layers, grid_map_msgs::GridMap& message) {
+  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  const std::size_t rawMapVersion = rawMapVersion_;
+  scopedLockForRawData.unlock();
+
+  FusedSubmapCache& cache = fusedSubmapCache_;
+  if (cache.isValid && cache.rawMapVersion == rawMapVersion && cache.fusedMapVersion == fusedMapVersion_ && cache.position == position &&
+      (cache.length == length).all() && cache.layers == layers) {
+    message = cache.message;
+    message.info.header.stamp.fromNSec(fusedMap_.getTimestamp());
+    return true;
+  }
+  cache.isValid = false;
+
+  const std::vector<std::string>& submapLayers = layers.empty() ? fusedMap_.getLayers() : layers;
+  for (const auto& layer : submapLayers) {
+    if (!fusedMap_.exists(layer)) {
+      ROS_ERROR("Cannot provide the fused submap, the fused map has no layer %s.", layer.c_str());
+      return false;
+    }
+  }
+  fuseArea(position, length);
+
+  grid_map::Index topLeftIndex;
+  grid_map::Size submapSize;
+  grid_map::Position submapPosition;
+  grid_map::Length submapLength;
+  grid_map::Index requestedIndexInSubmap;
+  if (!grid_map::getSubmapInformation(topLeftIndex, submapSize, submapPosition, submapLength, requestedIndexInSubmap, position, length,
+                                      fusedMap_.getLength(), fusedMap_.getPosition(), fusedMap_.getResolution(), fusedMap_.getSize(),
+                                      fusedMap_.getStartIndex())) {
+    return false;
+  }
+
+  // Serialize the submap directly from the fused map, in the same format as the grid map converter.
+  message.info.header.frame_id = fusedMap_.getFrameId();
+  message.info.header.stamp.fromNSec(fusedMap_.getTimestamp());
+  message.info.resolution = fusedMap_.getResolution();
+  message.info.length_x = submapLength.x();
+  message.info.length_y = submapLength.y();
+  message.info.pose.position.x = submapPosition.x();
+  message.info.pose.position.y = submapPosition.y();
+  message.info.pose.position.z = 0.0;
+  message.info.pose.orientation.x = 0.0;
+  message.info.pose.orientation.y = 0.0;
+  message.info.pose.orientation.z = 0.0;
+  message.info.pose.orientation.w = 1.0;
+  message.layers = submapLayers;
+  message.basic_layers = fusedMap_.getBasicLayers();
+  message.outer_start_index = 0;
+  message.inner_start_index = 0;
+  message.data.resize(submapLayers.size());
+  const std::vector<std::pair<int, int>> rowSpans = getTileSpans(topLeftIndex(0), submapSize(0), fusedMap_.getSize()(0));
+  const std::vector<std::pair<int, int>> colSpans = getTileSpans(topLeftIndex(1), submapSize(1), fusedMap_.getSize()(1));
+  for (std::size_t i = 0; i < submapLayers.size(); ++i) {
+    std_msgs::Float32MultiArray& dataArray = message.data[i];
+    dataArray.layout.dim.resize(2);
+    dataArray.layout.dim[0].label = "column_index";
+    dataArray.layout.dim[0].size = submapSize(1);
+    dataArray.layout.dim[0].stride = submapSize.prod();
+    dataArray.layout.dim[1].label = "row_index";
+    dataArray.layout.dim[1].size = submapSize(0);
+    dataArray.layout.dim[1].stride = submapSize(0);
+    dataArray.layout.data_offset = 0;
+    dataArray.data.resize(submapSize.prod());
+    const grid_map::Matrix& layer = fusedMap_[submapLayers[i]];
+    auto data = dataArray.data.begin();
+    for (const auto& colSpan : colSpans) {
+      for (int col = colSpan.first; col < colSpan.first + colSpan.second; ++col) {
+        for (const auto& rowSpan : rowSpans) {
+          data = std::copy(&layer(rowSpan.first, col), &layer(rowSpan.first, col) + rowSpan.second, data);
+        }
+      }
+    }
+  }
+
+  cache.isValid = true;
+  cache.position = position;
+  cache.length = length;
+  cache.layers = layers;
+  cache.rawMapVersion = rawMapVersion;
+  cache.fusedMapVersion = fusedMapVersion_;
+  cache.message = message;
+  return true;
+}
+
+bool ElevationMap::getFusedSubmapOfLevel(int level, const grid_map::Position& position, const grid_map::Length& length,
+                                         const std::vector<std::string>& layers, grid_map_msgs::GridMap& message) {
+  if (level == 0) {
+    return getFusedSubmap(position, length, layers, message);
+  }
+  if (level < 0 || level > fusedMapPyramid_.getNumberOfLevels()) {
+    ROS_ERROR("Cannot provide the fused submap, the fused map pyramid has no level %i.", level);
+    return false;
+  }
+
+  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
+  fuseArea(position, length);
+  const grid_map::GridMap& levelMap = fusedMapPyramid_.getLevel(level);
+  const std::vector<std::string>& submapLayers = layers.empty() ? levelMap.getLayers() : layers;
+  for (const auto& layer : submapLayers) {
+    if (!levelMap.exists(layer)) {
+      ROS_ERROR("Cannot provide the fused submap, level %i of the fused map pyramid has no layer %s.", level, layer.c_str());
+      return false;
+    }
+  }
+  bool isSuccess;
+  const grid_map::GridMap submap = levelMap.getSubmap(position, length, isSuccess);
+  if (!isSuccess) {
+    return false;
+  }
+  grid_map::GridMapRosConverter::toMessage(submap, submapLayers, message);
+  return true;
+}
+
+bool ElevationMap::fuse(const grid_map::Index& topLeftIndex, const grid_map::Index& size, bool copyOnlyRegion, double timeBudget) {
   ROS_DEBUG("Fusing elevation map...");
 
   // Nothing to do.
@@ -261,157 +868,433 @@ bool ElevationMap::fuse(const grid_map::Index& topLeftIndex, const grid_map::Ind
   // Initializations.
   const ros::WallTime methodStartTime(ros::WallTime::now());
 
-  // Copy raw elevation map data for safe multi-threading.
+  // Get a snapshot of the raw elevation map data for safe multi-threading. A small region only needs a copy of
+  // the raw data around it, but the reach of the modified cells then has to be computed from the raw map itself. Only the
+  // modified tiles are read for it, the bounds of the others are cached.
+  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  auto rawMapCopy = rawMap_;
+  std::shared_ptr<const grid_map::GridMap> rawMapSnapshot;
+  int invalidationRadius = 0;
+  if (copyOnlyRegion) {
+    applyPendingMotionUpdates();
+    copyRawMapArea(topLeftIndex, size);
+    invalidationRadius = getInvalidationRadius(rawMap_, dirtyTiles_);
+  } else {
+    rawMapSnapshot = getRawMapSnapshot();
+  }
+  const TileMask dirtyTiles = dirtyTiles_;
+  dirtyTiles_.setConstant(false);
   scopedLockForRawData.unlock();
+  const grid_map::GridMap& rawMapCopy = copyOnlyRegion ? rawMapAreaCopy_ : *rawMapSnapshot;
+  if (!copyOnlyRegion) {
+    invalidationRadius = getInvalidationRadius(rawMapCopy, dirtyTiles);
+  }
 
-  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
-
-  // More initializations.
-  const double halfResolution = fusedMap_.getResolution() / 2.0;
-  const float minimalWeight = std::numeric_limits<float>::epsilon() * static_cast<float>(2.0);
-  // Conservative cell inclusion for ellipse iterator.
-  const double ellipseExtension = M_SQRT2 * fusedMap_.getResolution();
+  // Align fused map with raw map.
+  if (rawMapCopy.getPosition() != fusedMap_.getPosition()) {
+    std::vector<grid_map::BufferRegion> newRegions;
+    fusedMap_.move(rawMapCopy.getPosition(), newRegions);
+    const grid_map::Size numberOfTiles = getNumberOfTiles(fusedMap_.getSize());
+    TileMask newTiles = TileMask::Constant(numberOfTiles(0), numberOfTiles(1), false);
+    for (const auto& region : newRegions) {
+      fusedMapPyramid_.markModified(region.getStartIndex(), region.getSize());
+      for (const auto& colSpan : getTileSpans(region.getStartIndex()(1), region.getSize()(1), fusedMap_.getSize()(1))) {
+        for (const auto& rowSpan : getTileSpans(region.getStartIndex()(0), region.getSize()(0), fusedMap_.getSize()(0))) {
+          newTiles(rowSpan.first / fusionTileSize, colSpan.first / fusionTileSize) = true;
+        }
+      }
+    }
+    fusionScheduler_.markPending(newTiles);
+    ++fusedMapVersion_;
+  }
 
   // Check if there is the need to reset out-dated data.
-  if (fusedMap_.getTimestamp() != rawMapCopy.getTimestamp()) {
+  if ((fusedMap_.getStartIndex() != rawMapCopy.getStartIndex()).any()) {
     resetFusedData();
+  } else {
+    invalidateFusedData(rawMapCopy.getSize(), dirtyTiles, invalidationRadius);
   }
 
-  // Align fused map with raw map.
-  if (rawMapCopy.getPosition() != fusedMap_.getPosition()) {
-    fusedMap_.move(rawMapCopy.getPosition());
+  // The cached fusion kernels depend on the resolution and on the quantization of the horizontal covariances.
+  const double fusionKernelQuantizationStep = fusionKernelQuantization_ * minHorizontalVariance_;
+  if (fusionKernelResolution_ != rawMapCopy.getResolution() || fusionKernelQuantizationStep_ != fusionKernelQuantizationStep) {
+    for (auto& buffers : fusionBuffers_) {
+      buffers.kernels.clear();
+    }
+    fusionKernelResolution_ = rawMapCopy.getResolution();
+    fusionKernelQuantizationStep_ = fusionKernelQuantizationStep;
   }
 
-  // For each cell in requested area.
-  for (grid_map::SubmapIterator areaIterator(rawMapCopy, topLeftIndex, size); !areaIterator.isPastEnd(); ++areaIterator) {
-    // Check if fusion for this cell has already been done earlier.
-    if (fusedMap_.isValid(*areaIterator)) {
-      continue;
+  // Each fused cell only reads from the raw map copy and only writes to its own cell in the fused map,
+  // so the tiles can be fused independently.
+  const ConstRawMapLayers rawLayers(rawMapCopy);
+  const FusedMapLayers fusedLayers(fusedMap_);
+  if (timeBudget > 0.0) {
+    // Fuse the pending tiles in the order of their priority until the budget is used up, the other tiles stay pending.
+    const std::vector<grid_map::Index> tiles =
+        fusionScheduler_.getPendingTiles(rawMapCopy, rawMapCopy.getPosition(), methodStartTime.toSec());
+    std::vector<char> isFused(tiles.size(), 0);
+    fusionThreadPool_.parallelFor(tiles.size(), [&](std::size_t tile, std::size_t threadIndex) {
+      if ((ros::WallTime::now() - methodStartTime).toSec() > timeBudget) {
+        return;
+      }
+      const int firstRow = tiles[tile](0) * fusionTileSize;
+      const int firstCol = tiles[tile](1) * fusionTileSize;
+      const int lastRow = std::min(firstRow + fusionTileSize, rawMapCopy.getSize()(0));
+      const int lastCol = std::min(firstCol + fusionTileSize, rawMapCopy.getSize()(1));
+      for (int col = firstCol; col < lastCol; ++col) {
+        for (int row = firstRow; row < lastRow; ++row) {
+          fuseCell(rawMapCopy, rawLayers, fusedLayers, grid_map::Index(row, col), fusionBuffers_[threadIndex]);
+        }
+      }
+      isFused[tile] = 1;
+    });
+    std::size_t numberOfFusedTiles = 0;
+    for (std::size_t tile = 0; tile < tiles.size(); ++tile) {
+      if (isFused[tile]) {
+        const grid_map::Index firstIndex = tiles[tile] * fusionTileSize;
+        fusionScheduler_.markFused(tiles[tile]);
+        fusedMapPyramid_.markModified(firstIndex, (rawMapCopy.getSize() - firstIndex).min(fusionTileSize));
+        ++numberOfFusedTiles;
+      }
     }
-
-    if (!rawMapCopy.isValid(*areaIterator)) {
-      // This is an empty cell (hole in the map).
-      // TODO(max):
-      continue;
+    ROS_DEBUG("Fused %zu of %zu pending tiles of the elevation map within the time budget.", numberOfFusedTiles, tiles.size());
+    if (numberOfFusedTiles > 0) {
+      ++fusedMapVersion_;
+    }
+  } else {
+    // Split the requested area into tiles. Fusing the tiles which are not pending again gives the same data.
+    const std::vector<std::pair<int, int>> rowSpans = getTileSpans(topLeftIndex(0), size(0), rawMapCopy.getSize()(0));
+    const std::vector<std::pair<int, int>> colSpans = getTileSpans(topLeftIndex(1), size(1), rawMapCopy.getSize()(1));
+    bool hasPendingTiles = false;
+    for (const auto& colSpan : colSpans) {
+      for (const auto& rowSpan : rowSpans) {
+        hasPendingTiles = hasPendingTiles || fusionScheduler_.isPending(grid_map::Index(rowSpan.first, colSpan.first) / fusionTileSize);
+      }
     }
+    fusionThreadPool_.parallelFor(rowSpans.size() * colSpans.size(), [&](std::size_t tileIndex, std::size_t threadIndex) {
+      const std::pair<int, int>& rowSpan = rowSpans[tileIndex % rowSpans.size()];
+      const std::pair<int, int>& colSpan = colSpans[tileIndex / rowSpans.size()];
+      for (int col = colSpan.first; col < colSpan.first + colSpan.second; ++col) {
+        for (int row = rowSpan.first; row < rowSpan.first + rowSpan.second; ++row) {
+          fuseCell(rawMapCopy, rawLayers, fusedLayers, grid_map::Index(row, col), fusionBuffers_[threadIndex]);
+        }
+      }
+    });
+    fusedMapPyramid_.markModified(topLeftIndex, size);
+
+    // The tiles which are entirely within the area are up to date now.
+    for (const auto& colSpan : colSpans) {
+      for (const auto& rowSpan : rowSpans) {
+        const grid_map::Index firstIndex(rowSpan.first, colSpan.first);
+        const grid_map::Size tileSize = (rawMapCopy.getSize() - firstIndex).min(fusionTileSize);
+        if (firstIndex(0) % fusionTileSize == 0 && firstIndex(1) % fusionTileSize == 0 && rowSpan.second == tileSize(0) &&
+            colSpan.second == tileSize(1)) {
+          fusionScheduler_.markFused(firstIndex / fusionTileSize);
+        }
+      }
+    }
+    if (hasPendingTiles) {
+      ++fusedMapVersion_;
+    }
+  }
 
-    // Get size of error ellipse.
-    const float& sigmaXsquare = rawMapCopy.at("horizontal_variance_x", *areaIterator);
-    const float& sigmaYsquare = rawMapCopy.at("horizontal_variance_y", *areaIterator);
-    const float& sigmaXYsquare = rawMapCopy.at("horizontal_variance_xy", *areaIterator);
-
-    Eigen::Matrix2d covarianceMatrix;
-    covarianceMatrix << sigmaXsquare, sigmaXYsquare, sigmaXYsquare, sigmaYsquare;
-    // 95.45% confidence ellipse which is 2.486-sigma for 2 dof problem.
-    // http://www.reid.ai/2012/09/chi-squared-distribution-table-with.html
-    const double uncertaintyFactor = 2.486;  // sqrt(6.18)
-    Eigen::EigenSolver<Eigen::Matrix2d> solver(covarianceMatrix);
-    Eigen::Array2d eigenvalues(solver.eigenvalues().real().cwiseAbs());
-
-    Eigen::Array2d::Index maxEigenvalueIndex;
-    eigenvalues.maxCoeff(&maxEigenvalueIndex);
-    Eigen::Array2d::Index minEigenvalueIndex;
-    maxEigenvalueIndex == Eigen::Array2d::Index(0) ? minEigenvalueIndex = 1 : minEigenvalueIndex = 0;
-    const grid_map::Length ellipseLength =
-        2.0 * uncertaintyFactor * grid_map::Length(eigenvalues(maxEigenvalueIndex), eigenvalues(minEigenvalueIndex)).sqrt() +
-        ellipseExtension;
-    const double ellipseRotation(
-        atan2(solver.eigenvectors().col(maxEigenvalueIndex).real()(1), solver.eigenvectors().col(maxEigenvalueIndex).real()(0)));
-
-    // Requested length and position (center) of submap in map.
-    grid_map::Position requestedSubmapPosition;
-    rawMapCopy.getPosition(*areaIterator, requestedSubmapPosition);
-    grid_map::EllipseIterator ellipseIterator(rawMapCopy, requestedSubmapPosition, ellipseLength, ellipseRotation);
-
-    // Prepare data fusion.
-    Eigen::ArrayXf means, weights;
-    const unsigned int maxNumberOfCellsToFuse = ellipseIterator.getSubmapSize().prod();
-    means.resize(maxNumberOfCellsToFuse);
-    weights.resize(maxNumberOfCellsToFuse);
-    WeightedEmpiricalCumulativeDistributionFunction<float> lowerBoundDistribution;
-    WeightedEmpiricalCumulativeDistributionFunction<float> upperBoundDistribution;
-
-    float maxStandardDeviation = sqrt(eigenvalues(maxEigenvalueIndex));
-    float minStandardDeviation = sqrt(eigenvalues(minEigenvalueIndex));
-    Eigen::Rotation2Dd rotationMatrix(ellipseRotation);
-    std::string maxEigenvalueLayer, minEigenvalueLayer;
-    if (maxEigenvalueIndex == 0) {
-      maxEigenvalueLayer = "horizontal_variance_x";
-      minEigenvalueLayer = "horizontal_variance_y";
-    } else {
-      maxEigenvalueLayer = "horizontal_variance_y";
-      minEigenvalueLayer = "horizontal_variance_x";
+  // Only the cell data is versioned, the snapshots and the submap cache take the time stamp from the map.
+  fusedMap_.setTimestamp(rawMapCopy.getTimestamp());
+
+  fusedMapPyramid_.update(fusedMap_);
+
+  const ros::WallDuration duration(ros::WallTime::now() - methodStartTime);
+  ROS_DEBUG("Elevation map has been fused in %f s.", duration.toSec());
+  pipelineStatistics_.addDuration("map", PipelineStage::Fuse, duration.toSec());
+
+  return true;
+}
+
+void ElevationMap::copyRawMapArea(const grid_map::Index& topLeftIndex, const grid_map::Index& size) {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  if ((rawMapAreaCopy_.getSize() != rawMap_.getSize()).any() || rawMapAreaCopy_.getResolution() != rawMap_.getResolution()) {
+    rawMapAreaCopy_.setGeometry(rawMap_.getLength(), rawMap_.getResolution(), rawMap_.getPosition());
+  }
+  rawMapAreaCopy_.setPosition(rawMap_.getPosition());
+  rawMapAreaCopy_.setStartIndex(rawMap_.getStartIndex());
+  rawMapAreaCopy_.setTimestamp(rawMap_.getTimestamp());
+  rawMapAreaCopy_.setFrameId(rawMap_.getFrameId());
+
+  // The cells outside of the grown region keep outdated data, they are not read when fusing the region.
+  const int radiusInCells = getFusionRadius(rawMap_, topLeftIndex, size);
+  const grid_map::Size& bufferSize = rawMap_.getSize();
+  const std::vector<std::pair<int, int>> rowSpans = getTileSpans(topLeftIndex(0) - radiusInCells, size(0) + 2 * radiusInCells, bufferSize(0));
+  const std::vector<std::pair<int, int>> colSpans = getTileSpans(topLeftIndex(1) - radiusInCells, size(1) + 2 * radiusInCells, bufferSize(1));
+  for (const std::string& layer : rawMapAreaCopy_.getLayers()) {
+    const grid_map::Matrix& data = rawMap_[layer];
+    grid_map::Matrix& dataCopy = rawMapAreaCopy_[layer];
+    for (const auto& colSpan : colSpans) {
+      for (const auto& rowSpan : rowSpans) {
+        dataCopy.block(rowSpan.first, colSpan.first, rowSpan.second, colSpan.second) =
+            data.block(rowSpan.first, colSpan.first, rowSpan.second, colSpan.second);
+      }
     }
+  }
+}
 
-    // For each cell in error ellipse.
-    size_t i = 0;
-    for (; !ellipseIterator.isPastEnd(); ++ellipseIterator) {
-      if (!rawMapCopy.isValid(*ellipseIterator)) {
-        // Empty cell in submap (cannot be center cell because we checked above).
+int ElevationMap::getFusionRadius(const grid_map::GridMap& map, const grid_map::Index& topLeftIndex, const grid_map::Index& size) const {
+  return getFusionRadius(getMaxEigenvalueBound(map, topLeftIndex, size), map.getResolution());
+}
+
+int ElevationMap::getFusionRadius(float maxEigenvalueBound, double resolution) const {
+  // The fusion kernels are computed for the quantized covariances, which increases the bound by at most one quantization step.
+  const float maxEigenvalue = maxEigenvalueBound + fusionKernelQuantization_ * minHorizontalVariance_;
+  const double maxEllipseRadius = uncertaintyFactor * std::sqrt(maxEigenvalue) + M_SQRT1_2 * resolution;
+  return static_cast<int>(std::ceil(maxEllipseRadius / resolution)) + 1;
+}
+
+int ElevationMap::getInvalidationRadius(const grid_map::GridMap& map, const TileMask& dirtyTiles) {
+  if (!dirtyTiles.any()) {
+    return 0;
+  }
+  const grid_map::Size& bufferSize = map.getSize();
+  const grid_map::Size numberOfTiles = getNumberOfTiles(bufferSize);
+  const bool isCacheValid = tileEigenvalueBounds_.rows() == numberOfTiles(0) && tileEigenvalueBounds_.cols() == numberOfTiles(1) &&
+                            dirtyTiles.rows() == numberOfTiles(0) && dirtyTiles.cols() == numberOfTiles(1);
+  if (!isCacheValid) {
+    tileEigenvalueBounds_.resize(numberOfTiles(0), numberOfTiles(1));
+  }
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+      if (isCacheValid && !dirtyTiles(tileRow, tileCol)) {
         continue;
       }
+      const grid_map::Index topLeftIndex(tileRow * fusionTileSize, tileCol * fusionTileSize);
+      const grid_map::Index size = (grid_map::Index(bufferSize) - topLeftIndex).min(fusionTileSize);
+      tileEigenvalueBounds_(tileRow, tileCol) = getMaxEigenvalueBound(map, topLeftIndex, size);
+    }
+  }
+  return getFusionRadius(tileEigenvalueBounds_.maxCoeff(), map.getResolution());
+}
 
-      means[i] = rawMapCopy.at("elevation", *ellipseIterator);
+float ElevationMap::getMaxEigenvalueBound(const grid_map::GridMap& map, const grid_map::Index& topLeftIndex,
+                                          const grid_map::Index& size) const {
+  // Bound the largest eigenvalue of the horizontal covariances of the region (Gershgorin).
+  const ConstRawMapLayers layers(map);
+  const grid_map::Matrix& horizontalVarianceX = layers[RawMapLayer::HorizontalVarianceX];
+  const grid_map::Matrix& horizontalVarianceY = layers[RawMapLayer::HorizontalVarianceY];
+  const grid_map::Matrix& horizontalVarianceXY = layers[RawMapLayer::HorizontalVarianceXY];
+  float maxEigenvalue = 0.0;
+  for (const auto& colSpan : getTileSpans(topLeftIndex(1), size(1), map.getSize()(1))) {
+    for (int col = colSpan.first; col < colSpan.first + colSpan.second; ++col) {
+      for (const auto& rowSpan : getTileSpans(topLeftIndex(0), size(0), map.getSize()(0))) {
+        for (int row = rowSpan.first; row < rowSpan.first + rowSpan.second; ++row) {
+          const float eigenvalueBound = std::max(std::abs(horizontalVarianceX(row, col)), std::abs(horizontalVarianceY(row, col))) +
+                                        std::abs(horizontalVarianceXY(row, col));
+          if (std::isfinite(eigenvalueBound)) {
+            maxEigenvalue = std::max(maxEigenvalue, eigenvalueBound);
+          }
+        }
+      }
+    }
+  }
+  return maxEigenvalue;
+}
 
-      // Compute weight from probability.
-      grid_map::Position absolutePosition;
-      rawMapCopy.getPosition(*ellipseIterator, absolutePosition);
-      Eigen::Vector2d distanceToCenter = (rotationMatrix * (absolutePosition - requestedSubmapPosition)).cwiseAbs();
+void ElevationMap::fuseCell(const grid_map::GridMap& rawMapCopy, const ConstRawMapLayers& rawLayers, const FusedMapLayers& fusedLayers,
+                            const grid_map::Index& index, FusionBuffers& buffers) {
+  // Check if fusion for this cell has already been done earlier.
+  if (fusedLayers.isValid(index)) {
+    return;
+  }
 
-      float probability1 = cumulativeDistributionFunction(distanceToCenter.x() + halfResolution, 0.0, maxStandardDeviation) -
-                           cumulativeDistributionFunction(distanceToCenter.x() - halfResolution, 0.0, maxStandardDeviation);
-      float probability2 = cumulativeDistributionFunction(distanceToCenter.y() + halfResolution, 0.0, minStandardDeviation) -
-                           cumulativeDistributionFunction(distanceToCenter.y() - halfResolution, 0.0, minStandardDeviation);
+  if (!rawLayers.isValid(index)) {
+    // This is an empty cell (hole in the map).
+    // TODO(max):
+    return;
+  }
+
+  // Get the weights of the cells in the error ellipse.
+  const grid_map::Matrix& elevationLayer = rawLayers[RawMapLayer::Elevation];
+  const grid_map::Matrix& varianceLayer = rawLayers[RawMapLayer::Variance];
+  const grid_map::Matrix& colorLayer = rawLayers[RawMapLayer::Color];
+  const FusionKernel& kernel = getFusionKernel(rawLayers[RawMapLayer::HorizontalVarianceX](index(0), index(1)),
+                                               rawLayers[RawMapLayer::HorizontalVarianceY](index(0), index(1)),
+                                               rawLayers[RawMapLayer::HorizontalVarianceXY](index(0), index(1)), buffers);
+
+  // Prepare data fusion. The buffers only grow, so they are not reallocated for every cell.
+  Eigen::ArrayXf& means = buffers.means;
+  Eigen::ArrayXf& weights = buffers.weights;
+  const auto maxNumberOfCellsToFuse = static_cast<Eigen::Index>(kernel.offsets.size());
+  if (means.size() < maxNumberOfCellsToFuse) {
+    means.resize(maxNumberOfCellsToFuse);
+    weights.resize(maxNumberOfCellsToFuse);
+  }
+  WeightedEmpiricalCumulativeDistributionFunction<float>& lowerBoundDistribution = buffers.lowerBoundDistribution;
+  WeightedEmpiricalCumulativeDistributionFunction<float>& upperBoundDistribution = buffers.upperBoundDistribution;
+  WeightedExtremeQuantiles<float>& lowerBoundQuantiles = buffers.lowerBoundQuantiles;
+  WeightedExtremeQuantiles<float>& upperBoundQuantiles = buffers.upperBoundQuantiles;
+  lowerBoundDistribution.clear();
+  upperBoundDistribution.clear();
+  lowerBoundQuantiles.clear();
+  upperBoundQuantiles.clear();
+
+  // For each cell in error ellipse.
+  const grid_map::Size& bufferSize = rawMapCopy.getSize();
+  const grid_map::Index& bufferStartIndex = rawMapCopy.getStartIndex();
+  const grid_map::Index unwrappedIndex = grid_map::getIndexFromBufferIndex(index, bufferSize, bufferStartIndex);
+  size_t i = 0;
+  for (std::size_t k = 0; k < kernel.offsets.size(); ++k) {
+    const grid_map::Index unwrappedNeighborIndex = unwrappedIndex + kernel.offsets[k];
+    if ((unwrappedNeighborIndex < 0).any() || (unwrappedNeighborIndex >= bufferSize).any()) {
+      // Outside of the map.
+      continue;
+    }
+    const grid_map::Index neighborIndex = grid_map::getBufferIndexFromIndex(unwrappedNeighborIndex, bufferSize, bufferStartIndex);
+    const float elevation = elevationLayer(neighborIndex(0), neighborIndex(1));
+    const float variance = varianceLayer(neighborIndex(0), neighborIndex(1));
+    if (!std::isfinite(elevation) || !std::isfinite(variance)) {
+      // Empty cell in submap (cannot be center cell because we checked above).
+      continue;
+    }
 
-      const float weight = std::max(minimalWeight, probability1 * probability2);
-      weights[i] = weight;
-      const float standardDeviation = sqrt(rawMapCopy.at("variance", *ellipseIterator));
+    means[i] = elevation;
+    const float weight = kernel.weights[k];
+    weights[i] = weight;
+    const float standardDeviation = sqrt(variance);
+    if (enableFastFusion_) {
+      lowerBoundQuantiles.add(means[i] - 2.0 * standardDeviation, weight);
+      upperBoundQuantiles.add(means[i] + 2.0 * standardDeviation, weight);
+    } else {
       lowerBoundDistribution.add(means[i] - 2.0 * standardDeviation, weight);
       upperBoundDistribution.add(means[i] + 2.0 * standardDeviation, weight);
-
-      i++;
     }
 
-    if (i == 0) {
-      // Nothing to fuse.
-      fusedMap_.at("elevation", *areaIterator) = rawMapCopy.at("elevation", *areaIterator);
-      fusedMap_.at("lower_bound", *areaIterator) =
-          rawMapCopy.at("elevation", *areaIterator) - 2.0 * sqrt(rawMapCopy.at("variance", *areaIterator));
-      fusedMap_.at("upper_bound", *areaIterator) =
-          rawMapCopy.at("elevation", *areaIterator) + 2.0 * sqrt(rawMapCopy.at("variance", *areaIterator));
-      fusedMap_.at("color", *areaIterator) = rawMapCopy.at("color", *areaIterator);
-      continue;
-    }
+    i++;
+  }
 
-    // Fuse.
-    means.conservativeResize(i);
-    weights.conservativeResize(i);
+  if (i == 0) {
+    // Nothing to fuse.
+    const float elevation = elevationLayer(index(0), index(1));
+    const float standardDeviation = sqrt(varianceLayer(index(0), index(1)));
+    fusedLayers[FusedMapLayer::Elevation](index(0), index(1)) = elevation;
+    fusedLayers[FusedMapLayer::LowerBound](index(0), index(1)) = elevation - 2.0 * standardDeviation;
+    fusedLayers[FusedMapLayer::UpperBound](index(0), index(1)) = elevation + 2.0 * standardDeviation;
+    fusedLayers[FusedMapLayer::Color](index(0), index(1)) = colorLayer(index(0), index(1));
+    return;
+  }
 
-    float mean = (weights * means).sum() / weights.sum();
+  // Fuse.
+  float mean = (weights.head(i) * means.head(i)).sum() / weights.head(i).sum();
 
-    if (!std::isfinite(mean)) {
-      ROS_ERROR("Something went wrong when fusing the map: Mean = %f", mean);
-      continue;
-    }
+  if (!std::isfinite(mean)) {
+    ROS_ERROR("Something went wrong when fusing the map: Mean = %f", mean);
+    return;
+  }
 
-    // Add to fused map.
-    fusedMap_.at("elevation", *areaIterator) = mean;
+  // Add to fused map.
+  fusedLayers[FusedMapLayer::Elevation](index(0), index(1)) = mean;
+  if (enableFastFusion_) {
+    // Only the two most extreme bounds are needed for these quantiles, no sorting.
+    fusedLayers[FusedMapLayer::LowerBound](index(0), index(1)) = lowerBoundQuantiles.lowerQuantile(0.01);
+    fusedLayers[FusedMapLayer::UpperBound](index(0), index(1)) = upperBoundQuantiles.upperQuantile(0.99);
+  } else {
     lowerBoundDistribution.compute();
     upperBoundDistribution.compute();
-    fusedMap_.at("lower_bound", *areaIterator) = lowerBoundDistribution.quantile(0.01);  // TODO(max):
-    fusedMap_.at("upper_bound", *areaIterator) = upperBoundDistribution.quantile(0.99);  // TODO(max):
-    // TODO(max): Add fusion of colors.
-    fusedMap_.at("color", *areaIterator) = rawMapCopy.at("color", *areaIterator);
+    fusedLayers[FusedMapLayer::LowerBound](index(0), index(1)) = lowerBoundDistribution.quantile(0.01);  // TODO(max):
+    fusedLayers[FusedMapLayer::UpperBound](index(0), index(1)) = upperBoundDistribution.quantile(0.99);  // TODO(max):
   }
+  // TODO(max): Add fusion of colors.
+  fusedLayers[FusedMapLayer::Color](index(0), index(1)) = colorLayer(index(0), index(1));
+}
 
-  fusedMap_.setTimestamp(rawMapCopy.getTimestamp());
+const ElevationMap::FusionKernel& ElevationMap::getFusionKernel(float horizontalVarianceX, float horizontalVarianceY,
+                                                                float horizontalVarianceXY, FusionBuffers& buffers) {
+  // The horizontal variances are mostly reset to the minimum or only differ slightly, so few kernels are needed.
+  Eigen::Matrix2d covariance;
+  FusionKernelKey key;
+  if (fusionKernelQuantizationStep_ > 0.0 && std::isfinite(horizontalVarianceX) && std::isfinite(horizontalVarianceY) &&
+      std::isfinite(horizontalVarianceXY)) {
+    key = {std::llround(horizontalVarianceX / fusionKernelQuantizationStep_),
+           std::llround(horizontalVarianceY / fusionKernelQuantizationStep_),
+           std::llround(horizontalVarianceXY / fusionKernelQuantizationStep_)};
+    covariance << key[0], key[2], key[2], key[1];
+    covariance *= fusionKernelQuantizationStep_;
+  } else {
+    // Exact covariance, keyed by the bit patterns of the variances.
+    const std::array<float, 3> variances{horizontalVarianceX, horizontalVarianceY, horizontalVarianceXY};
+    for (std::size_t i = 0; i < variances.size(); ++i) {
+      uint32_t bits;
+      std::memcpy(&bits, &variances[i], sizeof(bits));
+      key[i] = bits;
+    }
+    covariance << horizontalVarianceX, horizontalVarianceXY, horizontalVarianceXY, horizontalVarianceY;
+  }
 
-  const ros::WallDuration duration(ros::WallTime::now() - methodStartTime);
-  ROS_DEBUG("Elevation map has been fused in %f s.", duration.toSec());
+  const auto kernelIterator = buffers.kernels.find(key);
+  if (kernelIterator != buffers.kernels.end()) {
+    return kernelIterator->second;
+  }
+  if (buffers.kernels.size() >= maxNumberOfFusionKernels) {
+    buffers.kernels.clear();
+  }
+  FusionKernel& kernel = buffers.kernels[key];
+  computeFusionKernel(covariance, fusionKernelResolution_, kernel);
+  return kernel;
+}
 
-  return true;
+void ElevationMap::computeFusionKernel(const Eigen::Matrix2d& covariance, double resolution, FusionKernel& kernel) {
+  kernel.offsets.clear();
+  kernel.weights.clear();
+  if (!covariance.allFinite()) {
+    return;
+  }
+
+  // Initializations.
+  const double halfResolution = resolution / 2.0;
+  const float minimalWeight = std::numeric_limits<float>::epsilon() * static_cast<float>(2.0);
+  // Conservative cell inclusion for ellipse iterator.
+  const double ellipseExtension = M_SQRT2 * resolution;
+
+  // Get size of error ellipse.
+  Eigen::EigenSolver<Eigen::Matrix2d> solver(covariance);
+  Eigen::Array2d eigenvalues(solver.eigenvalues().real().cwiseAbs());
+
+  Eigen::Array2d::Index maxEigenvalueIndex;
+  eigenvalues.maxCoeff(&maxEigenvalueIndex);
+  Eigen::Array2d::Index minEigenvalueIndex;
+  maxEigenvalueIndex == Eigen::Array2d::Index(0) ? minEigenvalueIndex = 1 : minEigenvalueIndex = 0;
+  const grid_map::Length ellipseLength =
+      2.0 * uncertaintyFactor * grid_map::Length(eigenvalues(maxEigenvalueIndex), eigenvalues(minEigenvalueIndex)).sqrt() +
+      ellipseExtension;
+  const double ellipseRotation(
+      atan2(solver.eigenvectors().col(maxEigenvalueIndex).real()(1), solver.eigenvectors().col(maxEigenvalueIndex).real()(0)));
+
+  float maxStandardDeviation = sqrt(eigenvalues(maxEigenvalueIndex));
+  float minStandardDeviation = sqrt(eigenvalues(minEigenvalueIndex));
+  Eigen::Rotation2Dd rotationMatrix(ellipseRotation);
+
+  // Same inclusion test as the grid map ellipse iterator, cells are visited in the order of the iterator.
+  const Eigen::Array2d semiAxisSquare = (0.5 * ellipseLength).square();
+  Eigen::Matrix2d ellipseTransform;
+  ellipseTransform << std::cos(ellipseRotation), std::sin(ellipseRotation), std::sin(ellipseRotation), -std::cos(ellipseRotation);
+  const int radiusInCells = static_cast<int>(std::ceil(0.5 * ellipseLength.maxCoeff() / resolution)) + 1;
+  for (int row = -radiusInCells; row <= radiusInCells; ++row) {
+    for (int col = -radiusInCells; col <= radiusInCells; ++col) {
+      // The position decreases with increasing index.
+      const Eigen::Vector2d offset(-row * resolution, -col * resolution);
+      if (((ellipseTransform * offset).array().square() / semiAxisSquare).sum() > 1.0) {
+        continue;
+      }
+
+      // Compute weight from probability.
+      Eigen::Vector2d distanceToCenter = (rotationMatrix * offset).cwiseAbs();
+
+      float probability1 = cumulativeDistributionFunction(distanceToCenter.x() + halfResolution, 0.0, maxStandardDeviation) -
+                           cumulativeDistributionFunction(distanceToCenter.x() - halfResolution, 0.0, maxStandardDeviation);
+      float probability2 = cumulativeDistributionFunction(distanceToCenter.y() + halfResolution, 0.0, minStandardDeviation) -
+                           cumulativeDistributionFunction(distanceToCenter.y() - halfResolution, 0.0, minStandardDeviation);
+
+      kernel.offsets.emplace_back(row, col);
+      kernel.weights.push_back(std::max(minimalWeight, probability1 * probability2));
+    }
+  }
 }
 
 bool ElevationMap::clear() {
@@ -421,11 +1304,19 @@ bool ElevationMap::clear() {
     rawMap_.clearAll();
     rawMap_.resetTimestamp();
     rawMap_.get("dynamic_time").setZero();
+    if (enableCompactLayers_) {
+      compactLowestScanLayers_.resize(rawMap_.getSize());
+    }
+    resetPendingMotionUpdates();
+    deferredVisibilityCleanupRays_.clear();
+    markRawMapModified();
   }
   {
     boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
     fusedMap_.clearAll();
     fusedMap_.resetTimestamp();
+    fusedMapPyramid_.markAllModified();
+    ++fusedMapVersion_;
   }
   return true;
 }
@@ -435,112 +1326,457 @@ void ElevationMap::visibilityCleanup(const ros::Time& updatedTime) {
   const ros::WallTime methodStartTime(ros::WallTime::now());
   const double timeSinceInitialization = (updatedTime - initialTime_).toSec();
 
-  // Copy raw elevation map data for safe multi-threading.
-  boost::recursive_mutex::scoped_lock scopedLockForVisibilityCleanupData(visibilityCleanupMapMutex_);
+  // Get a snapshot of the raw elevation map data for safe multi-threading and collect the rays of the cells
+  // updated since the last cleanup. Consuming the lowest scan points of the rays does not count as a modification,
+  // they are only read by the cleanup itself, from the raw map.
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  visibilityCleanupMap_ = rawMap_;
-  rawMap_.clear("lowest_scan_point");
-  rawMap_.clear("sensor_x_at_lowest_scan");
-  rawMap_.clear("sensor_y_at_lowest_scan");
-  rawMap_.clear("sensor_z_at_lowest_scan");
+  const std::shared_ptr<const grid_map::GridMap> rawMapSnapshot = getRawMapSnapshot();
+  std::vector<VisibilityCleanupRay> rays;
+  rays.swap(deferredVisibilityCleanupRays_);
+  collectVisibilityCleanupRays(rays);
   scopedLockForRawData.unlock();
-  visibilityCleanupMap_.add("max_height");
-
-  // Create max. height layer with ray tracing.
-  for (grid_map::GridMapIterator iterator(visibilityCleanupMap_); !iterator.isPastEnd(); ++iterator) {
-    if (!visibilityCleanupMap_.isValid(*iterator)) {
-      continue;
+  const grid_map::GridMap& rawMapCopy = *rawMapSnapshot;
+  const ConstRawMapLayers rawLayers(rawMapCopy);
+  const grid_map::Size& size = rawMapCopy.getSize();
+  const grid_map::Size numberOfTiles = getNumberOfTiles(size);
+
+  // Group the rays by their sensor origin, such that the index of the sensor is only computed once per group.
+  // Deferred rays are traced first. Large groups are split to balance the load of the threads.
+  std::stable_sort(rays.begin(), rays.end(), [](const VisibilityCleanupRay& a, const VisibilityCleanupRay& b) {
+    if (a.isDeferred != b.isDeferred) {
+      return a.isDeferred;
     }
-    const auto& lowestScanPoint = visibilityCleanupMap_.at("lowest_scan_point", *iterator);
-    const auto& sensorXatLowestScan = visibilityCleanupMap_.at("sensor_x_at_lowest_scan", *iterator);
-    const auto& sensorYatLowestScan = visibilityCleanupMap_.at("sensor_y_at_lowest_scan", *iterator);
-    const auto& sensorZatLowestScan = visibilityCleanupMap_.at("sensor_z_at_lowest_scan", *iterator);
-    if (std::isnan(lowestScanPoint)) {
-      continue;
+    return std::lexicographical_compare(a.sensorPosition.data(), a.sensorPosition.data() + 3, b.sensorPosition.data(),
+                                        b.sensorPosition.data() + 3);
+  });
+  std::vector<std::size_t> taskBegins;
+  for (std::size_t i = 0; i < rays.size(); ++i) {
+    if (i == 0 || rays[i].sensorPosition != rays[i - 1].sensorPosition || rays[i].isDeferred != rays[i - 1].isDeferred ||
+        i - taskBegins.back() >= visibilityCleanupRaysPerTask) {
+      taskBegins.push_back(i);
     }
+  }
+  taskBegins.push_back(rays.size());
+  const std::size_t numberOfTasks = taskBegins.size() - 1;
+
+  // The x position of a cell only depends on its row and the y position only on its column.
+  Eigen::ArrayXd rowPositions(size(0));
+  Eigen::ArrayXd colPositions(size(1));
+  grid_map::Position position;
+  for (int row = 0; row < size(0); ++row) {
+    rawMapCopy.getPosition(grid_map::Index(row, 0), position);
+    rowPositions(row) = position.x();
+  }
+  for (int col = 0; col < size(1); ++col) {
+    rawMapCopy.getPosition(grid_map::Index(0, col), position);
+    colPositions(col) = position.y();
+  }
+
+  // Create max. height layer with ray tracing. Every thread carves into its own layer, which are merged afterwards.
+  const std::size_t numberOfThreads = visibilityCleanupThreadPool_.size();
+  for (auto& maxHeightLayer : visibilityCleanupMaxHeights_) {
+    maxHeightLayer.setConstant(size(0), size(1), NAN);
+  }
+  std::vector<TileMask> tracedTiles(numberOfThreads, TileMask::Constant(numberOfTiles(0), numberOfTiles(1), false));
+  std::vector<char> isTraced(numberOfTasks, 0);
+  visibilityCleanupThreadPool_.parallelFor(numberOfTasks, [&](std::size_t task, std::size_t threadIndex) {
+    if (visibilityCleanupTimeBudget_ > 0.0 && (ros::WallTime::now() - methodStartTime).toSec() > visibilityCleanupTimeBudget_) {
+      return;
+    }
+    isTraced[task] = 1;
+    const Eigen::Vector3f& sensorPosition = rays[taskBegins[task]].sensorPosition;
     grid_map::Index indexAtSensor;
-    if (!visibilityCleanupMap_.getIndex(grid_map::Position(sensorXatLowestScan, sensorYatLowestScan), indexAtSensor)) {
-      continue;
+    if (!rawMapCopy.getIndex(grid_map::Position(sensorPosition.x(), sensorPosition.y()), indexAtSensor)) {
+      return;
     }
-    grid_map::Position point;
-    visibilityCleanupMap_.getPosition(*iterator, point);
-    float pointDiffX = point.x() - sensorXatLowestScan;
-    float pointDiffY = point.y() - sensorYatLowestScan;
-    float distanceToPoint = sqrt(pointDiffX * pointDiffX + pointDiffY * pointDiffY);
-    if (distanceToPoint > 0.0) {
-      for (grid_map::LineIterator iterator(visibilityCleanupMap_, indexAtSensor, *iterator); !iterator.isPastEnd(); ++iterator) {
-        grid_map::Position cellPosition;
-        visibilityCleanupMap_.getPosition(*iterator, cellPosition);
-        const float cellDiffX = cellPosition.x() - sensorXatLowestScan;
-        const float cellDiffY = cellPosition.y() - sensorYatLowestScan;
+    grid_map::Matrix& maxHeightLayer = visibilityCleanupMaxHeights_[threadIndex];
+    TileMask& tiles = tracedTiles[threadIndex];
+    for (std::size_t k = taskBegins[task]; k < taskBegins[task + 1]; ++k) {
+      const VisibilityCleanupRay& ray = rays[k];
+      grid_map::Index index;
+      if (!rawMapCopy.getIndex(ray.cellPosition, index) || !rawLayers.isValid(index)) {
+        continue;
+      }
+      const float pointDiffX = ray.cellPosition.x() - sensorPosition.x();
+      const float pointDiffY = ray.cellPosition.y() - sensorPosition.y();
+      const float distanceToPoint = sqrt(pointDiffX * pointDiffX + pointDiffY * pointDiffY);
+      if (!(distanceToPoint > 0.0)) {
+        continue;
+      }
+      for (grid_map::LineIterator iterator(rawMapCopy, indexAtSensor, index); !iterator.isPastEnd(); ++iterator) {
+        const grid_map::Index& cellIndex = *iterator;
+        const float cellDiffX = rowPositions(cellIndex(0)) - sensorPosition.x();
+        const float cellDiffY = colPositions(cellIndex(1)) - sensorPosition.y();
         const float distanceToCell = distanceToPoint - sqrt(cellDiffX * cellDiffX + cellDiffY * cellDiffY);
-        const float maxHeightPoint = lowestScanPoint + (sensorZatLowestScan - lowestScanPoint) / distanceToPoint * distanceToCell;
-        auto& cellMaxHeight = visibilityCleanupMap_.at("max_height", *iterator);
+        const float maxHeightPoint =
+            ray.lowestScanPoint + (sensorPosition.z() - ray.lowestScanPoint) / distanceToPoint * distanceToCell;
+        auto& cellMaxHeight = maxHeightLayer(cellIndex(0), cellIndex(1));
         if (std::isnan(cellMaxHeight) || cellMaxHeight > maxHeightPoint) {
           cellMaxHeight = maxHeightPoint;
         }
+        tiles(cellIndex(0) / fusionTileSize, cellIndex(1) / fusionTileSize) = true;
       }
     }
+  });
+
+  // Merge the max. height layers of the threads and find the cells to remove, tile by tile and only in the
+  // tiles which have been traced.
+  TileMask anyTracedTiles = tracedTiles[0];
+  for (std::size_t i = 1; i < numberOfThreads; ++i) {
+    anyTracedTiles = anyTracedTiles || tracedTiles[i];
   }
+  std::vector<grid_map::Index> tileIndices;
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+      if (anyTracedTiles(tileRow, tileCol)) {
+        tileIndices.emplace_back(tileRow, tileCol);
+      }
+    }
+  }
+  grid_map::Matrix maxHeightLayer = grid_map::Matrix::Constant(size(0), size(1), NAN);
+  const grid_map::Matrix& elevationLayer = rawLayers[RawMapLayer::Elevation];
+  const grid_map::Matrix& varianceLayer = rawLayers[RawMapLayer::Variance];
+  const grid_map::Matrix& timeLayer = rawLayers[RawMapLayer::Time];
+  std::vector<std::vector<grid_map::Position>> cellPositionsToRemove(numberOfThreads);
+  visibilityCleanupThreadPool_.parallelFor(tileIndices.size(), [&](std::size_t tile, std::size_t threadIndex) {
+    const int firstRow = tileIndices[tile](0) * fusionTileSize;
+    const int firstCol = tileIndices[tile](1) * fusionTileSize;
+    const int numberOfRows = std::min(fusionTileSize, size(0) - firstRow);
+    const int numberOfCols = std::min(fusionTileSize, size(1) - firstCol);
+    auto maxHeightBlock = maxHeightLayer.block(firstRow, firstCol, numberOfRows, numberOfCols).array();
+    for (const auto& threadMaxHeightLayer : visibilityCleanupMaxHeights_) {
+      const auto threadMaxHeightBlock = threadMaxHeightLayer.block(firstRow, firstCol, numberOfRows, numberOfCols).array();
+      maxHeightBlock = (maxHeightBlock.isNaN() || threadMaxHeightBlock < maxHeightBlock).select(threadMaxHeightBlock, maxHeightBlock);
+    }
+
+    for (int col = firstCol; col < firstCol + numberOfCols; ++col) {
+      for (int row = firstRow; row < firstRow + numberOfRows; ++row) {
+        const auto& maxHeight = maxHeightLayer(row, col);
+        if (std::isnan(maxHeight) || !rawLayers.isValid(grid_map::Index(row, col))) {
+          continue;
+        }
+        // Only remove cells that have not been updated during the last scan duration.
+        // This prevents a.o. removal of overhanging objects.
+        if (timeSinceInitialization - timeLayer(row, col) > scanningDuration_ &&
+            elevationLayer(row, col) - 3.0 * sqrt(varianceLayer(row, col)) > maxHeight) {
+          grid_map::Position cellPosition;
+          rawMapCopy.getPosition(grid_map::Index(row, col), cellPosition);
+          cellPositionsToRemove[threadIndex].push_back(cellPosition);
+        }
+      }
+    }
+  });
 
-  // Vector of indices that will be removed.
-  std::vector<grid_map::Position> cellPositionsToRemove;
-  for (grid_map::GridMapIterator iterator(visibilityCleanupMap_); !iterator.isPastEnd(); ++iterator) {
-    if (!visibilityCleanupMap_.isValid(*iterator)) {
+  // Defer the rays which have not been traced within the time budget. Rays are deferred at most once.
+  std::vector<VisibilityCleanupRay> deferredRays;
+  std::size_t numberOfDroppedRays = 0;
+  for (std::size_t task = 0; task < numberOfTasks; ++task) {
+    if (isTraced[task]) {
       continue;
     }
-    const auto& time = visibilityCleanupMap_.at("time", *iterator);
-    if (timeSinceInitialization - time > scanningDuration_) {
-      // Only remove cells that have not been updated during the last scan duration.
-      // This prevents a.o. removal of overhanging objects.
-      const auto& elevation = visibilityCleanupMap_.at("elevation", *iterator);
-      const auto& variance = visibilityCleanupMap_.at("variance", *iterator);
-      const auto& maxHeight = visibilityCleanupMap_.at("max_height", *iterator);
-      if (!std::isnan(maxHeight) && elevation - 3.0 * sqrt(variance) > maxHeight) {
-        grid_map::Position position;
-        visibilityCleanupMap_.getPosition(*iterator, position);
-        cellPositionsToRemove.push_back(position);
+    for (std::size_t k = taskBegins[task]; k < taskBegins[task + 1]; ++k) {
+      if (rays[k].isDeferred) {
+        ++numberOfDroppedRays;
+      } else {
+        deferredRays.push_back(rays[k]);
+        deferredRays.back().isDeferred = true;
       }
     }
   }
 
-  // Remove points in current raw map.
+  // Remove points in current raw map in one batch.
+  std::size_t numberOfRemovedCells = 0;
   scopedLockForRawData.lock();
-  for (const auto& cellPosition : cellPositionsToRemove) {
-    grid_map::Index index;
-    if (!rawMap_.getIndex(cellPosition, index)) {
-      continue;
-    }
-    if (rawMap_.isValid(index)) {
-      rawMap_.at("elevation", index) = NAN;
-      rawMap_.at("dynamic_time", index) = 0.0f;
+  const RawMapLayers layers(rawMap_);
+  for (const auto& threadCellPositionsToRemove : cellPositionsToRemove) {
+    for (const auto& cellPosition : threadCellPositionsToRemove) {
+      grid_map::Index index;
+      if (!rawMap_.getIndex(cellPosition, index)) {
+        continue;
+      }
+      if (layers.isValid(index)) {
+        layers[RawMapLayer::Elevation](index(0), index(1)) = NAN;
+        layers[RawMapLayer::DynamicTime](index(0), index(1)) = 0.0f;
+        dirtyTiles_(index(0) / fusionTileSize, index(1) / fusionTileSize) = true;
+        ++numberOfRemovedCells;
+      }
     }
   }
+  deferredVisibilityCleanupRays_.insert(deferredVisibilityCleanupRays_.end(), deferredRays.begin(), deferredRays.end());
+  if (numberOfRemovedCells > 0) {
+    ++rawMapVersion_;
+  }
   scopedLockForRawData.unlock();
 
   // Publish visibility cleanup map for debugging.
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForVisibilityCleanupData(visibilityCleanupMapMutex_);
+    visibilityCleanupRawMap_ = rawMapSnapshot;
+    visibilityCleanupMaxHeight_ = std::move(maxHeightLayer);
+  }
   publishVisibilityCleanupMap();
 
   ros::WallDuration duration(ros::WallTime::now() - methodStartTime);
-  ROS_DEBUG("Visibility cleanup has been performed in %f s (%d points).", duration.toSec(), (int)cellPositionsToRemove.size());
+  ROS_DEBUG("Visibility cleanup has been performed in %f s (%d rays, %d points, %d rays deferred).", duration.toSec(), (int)rays.size(),
+            (int)numberOfRemovedCells, (int)deferredRays.size());
+  pipelineStatistics_.addDuration("map", PipelineStage::VisibilityCleanup, duration.toSec());
+  if (numberOfDroppedRays > 0) {
+    ROS_WARN_THROTTLE(10.0, "Visibility cleanup time budget is too low, %d deferred rays have been dropped.", (int)numberOfDroppedRays);
+  }
   if (duration.toSec() > visibilityCleanupDuration_) {
     ROS_WARN("Visibility cleanup duration is too high (current rate is %f).", 1.0 / duration.toSec());
   }
 }
 
+void ElevationMap::collectVisibilityCleanupRays(std::vector<VisibilityCleanupRay>& rays) {
+  const grid_map::Size& size = rawMap_.getSize();
+  for (int tileCol = 0; tileCol < visibilityCleanupTiles_.cols(); ++tileCol) {
+    for (int tileRow = 0; tileRow < visibilityCleanupTiles_.rows(); ++tileRow) {
+      if (!visibilityCleanupTiles_(tileRow, tileCol)) {
+        continue;
+      }
+      const int firstRow = tileRow * fusionTileSize;
+      const int firstCol = tileCol * fusionTileSize;
+      const int numberOfRows = std::min(fusionTileSize, size(0) - firstRow);
+      const int numberOfCols = std::min(fusionTileSize, size(1) - firstCol);
+      if (enableCompactLayers_) {
+        CompactLowestScanLayers& layers = compactLowestScanLayers_;
+        for (int col = firstCol; col < firstCol + numberOfCols; ++col) {
+          for (int row = firstRow; row < firstRow + numberOfRows; ++row) {
+            const int16_t lowestScanPoint = layers.lowestScanPoint(row, col);
+            if (lowestScanPoint == emptyCompactCell) {
+              continue;
+            }
+            grid_map::Position cellPosition;
+            rawMap_.getPosition(grid_map::Index(row, col), cellPosition);
+            rays.push_back({Eigen::Vector3f(cellPosition.x() + dequantize(layers.sensorX(row, col)),
+                                            cellPosition.y() + dequantize(layers.sensorY(row, col)), dequantize(layers.sensorZ(row, col))),
+                            cellPosition, dequantize(lowestScanPoint), false});
+          }
+        }
+        layers.clear(grid_map::Index(firstRow, firstCol), grid_map::Size(numberOfRows, numberOfCols));
+        continue;
+      }
+
+      const RawMapLayers layers(rawMap_);
+      grid_map::Matrix& lowestScanPointLayer = layers[RawMapLayer::LowestScanPoint];
+      grid_map::Matrix& sensorXatLowestScanLayer = layers[RawMapLayer::SensorXAtLowestScan];
+      grid_map::Matrix& sensorYatLowestScanLayer = layers[RawMapLayer::SensorYAtLowestScan];
+      grid_map::Matrix& sensorZatLowestScanLayer = layers[RawMapLayer::SensorZAtLowestScan];
+      for (int col = firstCol; col < firstCol + numberOfCols; ++col) {
+        for (int row = firstRow; row < firstRow + numberOfRows; ++row) {
+          const float lowestScanPoint = lowestScanPointLayer(row, col);
+          if (std::isnan(lowestScanPoint)) {
+            continue;
+          }
+          grid_map::Position cellPosition;
+          rawMap_.getPosition(grid_map::Index(row, col), cellPosition);
+          rays.push_back({Eigen::Vector3f(sensorXatLowestScanLayer(row, col), sensorYatLowestScanLayer(row, col),
+                                          sensorZatLowestScanLayer(row, col)),
+                          cellPosition, lowestScanPoint, false});
+        }
+      }
+      for (grid_map::Matrix* layer : {&lowestScanPointLayer, &sensorXatLowestScanLayer, &sensorYatLowestScanLayer, &sensorZatLowestScanLayer}) {
+        layer->block(firstRow, firstCol, numberOfRows, numberOfCols).setConstant(NAN);
+      }
+    }
+  }
+  visibilityCleanupTiles_.setConstant(false);
+}
+
+void ElevationMap::CompactLowestScanLayers::resize(const grid_map::Size& size) {
+  for (CompactLayer* layer : {&lowestScanPoint, &sensorX, &sensorY, &sensorZ}) {
+    layer->setConstant(size(0), size(1), emptyCompactCell);
+  }
+}
+
+void ElevationMap::CompactLowestScanLayers::clear(const grid_map::Index& startIndex, const grid_map::Size& size) {
+  for (CompactLayer* layer : {&lowestScanPoint, &sensorX, &sensorY, &sensorZ}) {
+    layer->block(startIndex(0), startIndex(1), size(0), size(1)).setConstant(emptyCompactCell);
+  }
+}
+
 void ElevationMap::move(const Eigen::Vector2d& position) {
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
   std::vector<grid_map::BufferRegion> newRegions;
 
+  if (tileStore_) {
+    storeLeavingCells(position);
+  }
   if (rawMap_.move(position, newRegions)) {
     ROS_DEBUG("Elevation map has been moved to position (%f, %f).", rawMap_.getPosition().x(), rawMap_.getPosition().y());
+    ++rawMapVersion_;
 
-    // The "dynamic_time" layer is meant to be interpreted as integer values, therefore nan:s need to be zeroed.
+    // The "dynamic_time" layer is meant to be interpreted as integer values, therefore the nan:s of the new regions need to be zeroed.
     grid_map::Matrix& dynTime{rawMap_.get("dynamic_time")};
-    dynTime = dynTime.array().isNaN().select(grid_map::Matrix::Scalar(0.0f), dynTime.array());
+    for (const auto& region : newRegions) {
+      dynTime.block(region.getStartIndex()(0), region.getStartIndex()(1), region.getSize()(0), region.getSize()(1)).setZero();
+      if (enableCompactLayers_) {
+        compactLowestScanLayers_.clear(region.getStartIndex(), region.getSize());
+      }
+      if (tileStore_) {
+        loadFromTileStore(region);
+      }
+      if (hasUnderlyingMap_) {
+        fillFromUnderlyingMap(region);
+      }
+      markRawMapModified(region.getStartIndex(), region.getSize());
+    }
+  }
+}
+
+bool ElevationMap::enableTileStore(const std::string& directory, int tileSize, int maxNumberOfMappedTiles) {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  std::unique_ptr<TileStore> tileStore(new TileStore(
+      directory, tileSize, rawMap_.getResolution(),
+      {"elevation", "variance", "horizontal_variance_x", "horizontal_variance_y", "horizontal_variance_xy", "color"},
+      static_cast<std::size_t>(std::max(maxNumberOfMappedTiles, 1))));
+  if (!tileStore->initialize()) {
+    return false;
+  }
+  tileStore_ = std::move(tileStore);
+  loadFromTileStore(grid_map::BufferRegion(grid_map::Index(0, 0), rawMap_.getSize(), grid_map::BufferRegion::Quadrant::Undefined));
+  markRawMapModified();
+  ROS_INFO("Tile store in %s enabled.", directory.c_str());
+  return true;
+}
+
+bool ElevationMap::saveSnapshot(const std::string& path) {
+  const ros::WallTime startTime(ros::WallTime::now());
+  if (!writeMapSnapshot(*getRawMapSnapshot(), path)) {
+    return false;
+  }
+  ROS_DEBUG("Raw map snapshot written to %s in %f s.", path.c_str(), (ros::WallTime::now() - startTime).toSec());
+  return true;
+}
+
+bool ElevationMap::loadSnapshot(const std::string& path) {
+  const ros::WallTime startTime(ros::WallTime::now());
+  grid_map::GridMap map;
+  if (!readMapSnapshot(path, map)) {
+    return false;
+  }
+
+  boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  for (const std::string& layer : rawMap_.getLayers()) {
+    if (!map.exists(layer)) {
+      ROS_ERROR("Cannot load the snapshot %s, it has no layer %s.", path.c_str(), layer.c_str());
+      return false;
+    }
+  }
+  if (map.getFrameId() != rawMap_.getFrameId()) {
+    ROS_ERROR("Cannot load the snapshot %s, it is in frame %s instead of %s.", path.c_str(), map.getFrameId().c_str(),
+              rawMap_.getFrameId().c_str());
+    return false;
+  }
+  setRawGridMap(std::move(map));
+  resetFusedData();
+  ROS_INFO("Raw map loaded from the snapshot %s in %f s.", path.c_str(), (ros::WallTime::now() - startTime).toSec());
+  return true;
+}
+
+void ElevationMap::storeLeavingCells(const grid_map::Position& position) {
+  // Same alignment of the position as in grid_map::GridMap::move().
+  grid_map::Index indexShift;
+  grid_map::Vector alignedPositionShift;
+  grid_map::getIndexShiftFromPositionShift(indexShift, position - rawMap_.getPosition(), rawMap_.getResolution());
+  if ((indexShift == 0).all()) {
+    return;
+  }
+  grid_map::getPositionShiftFromIndexShift(alignedPositionShift, indexShift, rawMap_.getResolution());
+  const grid_map::Position newPosition = rawMap_.getPosition() + alignedPositionShift;
+
+  // The x position of a cell only depends on its row and the y position only on its column.
+  const grid_map::Size& size = rawMap_.getSize();
+  std::vector<char> isRowLeaving(size(0));
+  std::vector<char> isColLeaving(size(1));
+  grid_map::Position cellPosition;
+  for (int row = 0; row < size(0); ++row) {
+    rawMap_.getPosition(grid_map::Index(row, 0), cellPosition);
+    isRowLeaving[row] = !grid_map::checkIfPositionWithinMap(grid_map::Position(cellPosition.x(), newPosition.y()), rawMap_.getLength(), newPosition);
+  }
+  for (int col = 0; col < size(1); ++col) {
+    rawMap_.getPosition(grid_map::Index(0, col), cellPosition);
+    isColLeaving[col] = !grid_map::checkIfPositionWithinMap(grid_map::Position(newPosition.x(), cellPosition.y()), rawMap_.getLength(), newPosition);
+  }
+
+  const RawMapLayers layers(rawMap_);
+  grid_map::Matrix& elevationLayer = layers[RawMapLayer::Elevation];
+  grid_map::Matrix& varianceLayer = layers[RawMapLayer::Variance];
+  grid_map::Matrix& horizontalVarianceXLayer = layers[RawMapLayer::HorizontalVarianceX];
+  grid_map::Matrix& horizontalVarianceYLayer = layers[RawMapLayer::HorizontalVarianceY];
+  grid_map::Matrix& horizontalVarianceXYLayer = layers[RawMapLayer::HorizontalVarianceXY];
+  const bool hasPendingMotionUpdate = hasPendingMotionUpdates();
+  for (int col = 0; col < size(1); ++col) {
+    for (int row = 0; row < size(0); ++row) {
+      if (!isRowLeaving[row] && !isColLeaving[col]) {
+        continue;
+      }
+      const grid_map::Index index(row, col);
+      if (hasPendingMotionUpdate) {
+        applyPendingMotionUpdate(index, elevationLayer(row, col), varianceLayer(row, col), horizontalVarianceXLayer(row, col),
+                                 horizontalVarianceYLayer(row, col), horizontalVarianceXYLayer(row, col));
+      }
+      tileStore_->writeCell(rawMap_, index);
+    }
+  }
+}
+
+void ElevationMap::loadFromTileStore(const grid_map::BufferRegion& region) {
+  const bool hasMotionUpdateStamps =
+      motionUpdateStamps_.rows() == rawMap_.getSize()(0) && motionUpdateStamps_.cols() == rawMap_.getSize()(1);
+  const auto currentMotionUpdateStamp = static_cast<uint32_t>(motionUpdateHistory_.size() - 1);
 
-    if (hasUnderlyingMap_) {
-      rawMap_.addDataFrom(underlyingMap_, false, false, true);
+  const grid_map::Index& startIndex = region.getStartIndex();
+  for (int col = startIndex(1); col < startIndex(1) + region.getSize()(1); ++col) {
+    for (int row = startIndex(0); row < startIndex(0) + region.getSize()(0); ++row) {
+      const grid_map::Index index(row, col);
+      if (rawMap_.isValid(index) || !tileStore_->readCell(rawMap_, index)) {
+        continue;
+      }
+      if (hasMotionUpdateStamps) {
+        motionUpdateStamps_(row, col) = currentMotionUpdateStamp;
+      }
+    }
+  }
+}
+
+void ElevationMap::fillFromUnderlyingMap(const grid_map::BufferRegion& region) {
+  // Same as grid_map::GridMap::addDataFrom(underlyingMap_, false, false, true), but limited to the region.
+  std::vector<std::pair<grid_map::Matrix*, const grid_map::Matrix*>> layers;
+  for (const std::string& layer : underlyingMap_.getLayers()) {
+    if (!rawMap_.exists(layer)) {
+      rawMap_.add(layer);
+    }
+    layers.emplace_back(&rawMap_.get(layer), &underlyingMap_.get(layer));
+  }
+  const bool hasMotionUpdateStamps =
+      motionUpdateStamps_.rows() == rawMap_.getSize()(0) && motionUpdateStamps_.cols() == rawMap_.getSize()(1);
+  const auto currentMotionUpdateStamp = static_cast<uint32_t>(motionUpdateHistory_.size() - 1);
+
+  const grid_map::Index& startIndex = region.getStartIndex();
+  for (int col = startIndex(1); col < startIndex(1) + region.getSize()(1); ++col) {
+    for (int row = startIndex(0); row < startIndex(0) + region.getSize()(0); ++row) {
+      const grid_map::Index index(row, col);
+      if (rawMap_.isValid(index)) {
+        continue;
+      }
+      grid_map::Position position;
+      grid_map::Index underlyingIndex;
+      rawMap_.getPosition(index, position);
+      if (!underlyingMap_.getIndex(position, underlyingIndex)) {
+        continue;
+      }
+      for (const auto& layer : layers) {
+        const float value = (*layer.second)(underlyingIndex(0), underlyingIndex(1));
+        if (std::isfinite(value)) {
+          (*layer.first)(row, col) = value;
+        }
+      }
+      if (hasMotionUpdateStamps) {
+        motionUpdateStamps_(row, col) = currentMotionUpdateStamp;
+      }
     }
   }
 }
@@ -549,24 +1785,34 @@ bool ElevationMap::postprocessAndPublishRawElevationMap() {
   if (!hasRawMapSubscribers()) {
     return false;
   }
-  boost::recursive_mutex::scoped_lock scopedLock(rawMapMutex_);
-  grid_map::GridMap rawMapCopy = rawMap_;
-  scopedLock.unlock();
-  return postprocessorPool_.runTask(rawMapCopy);
+  return postprocessorPool_.runTask(getRawMapSnapshot());
 }
 
 bool ElevationMap::publishFusedElevationMap() {
   if (!hasFusedMapSubscribers()) {
     return false;
   }
-  boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
-  grid_map::GridMap fusedMapCopy = fusedMap_;
-  scopedLock.unlock();
-  fusedMapCopy.add("uncertainty_range", fusedMapCopy.get("upper_bound") - fusedMapCopy.get("lower_bound"));
-  grid_map_msgs::GridMap message;
-  grid_map::GridMapRosConverter::toMessage(fusedMapCopy, message);
-  elevationMapFusedPublisher_.publish(message);
-  ROS_DEBUG("Elevation map (fused) has been published.");
+  PipelineStatistics::ScopedTimer timer(&pipelineStatistics_, "map", PipelineStage::Publish);
+  const std::shared_ptr<const grid_map::GridMap> fusedMapSnapshot = getFusedMapSnapshot();
+  // The maps are published as shared pointers, which subscribers in the same nodelet manager receive without serialization.
+  if (elevationMapFusedPublisher_.getNumSubscribers() >= 1) {
+    const grid_map_msgs::GridMapPtr message = boost::make_shared<grid_map_msgs::GridMap>();
+    grid_map::GridMapRosConverter::toMessage(*fusedMapSnapshot, *message);
+    elevationMapFusedPublisher_.publish(message);
+    ROS_DEBUG("Elevation map (fused) has been published.");
+  }
+  elevationMapFusedDeltaPublisher_->publish(*fusedMapSnapshot);
+  for (std::size_t i = 0; i < elevationMapLevelPublishers_.size(); ++i) {
+    if (elevationMapLevelPublishers_[i].getNumSubscribers() < 1) {
+      continue;
+    }
+    const grid_map_msgs::GridMapPtr message = boost::make_shared<grid_map_msgs::GridMap>();
+    {
+      boost::recursive_mutex::scoped_lock scopedLock(fusedMapMutex_);
+      grid_map::GridMapRosConverter::toMessage(fusedMapPyramid_.getLevel(static_cast<int>(i) + 1), *message);
+    }
+    elevationMapLevelPublishers_[i].publish(message);
+  }
   return true;
 }
 
@@ -575,7 +1821,11 @@ bool ElevationMap::publishVisibilityCleanupMap() {
     return false;
   }
   boost::recursive_mutex::scoped_lock scopedLock(visibilityCleanupMapMutex_);
-  grid_map::GridMap visibilityCleanupMapCopy = visibilityCleanupMap_;
+  if (!visibilityCleanupRawMap_) {
+    return false;
+  }
+  grid_map::GridMap visibilityCleanupMapCopy = *visibilityCleanupRawMap_;
+  visibilityCleanupMapCopy.add("max_height", visibilityCleanupMaxHeight_);
   scopedLock.unlock();
   visibilityCleanupMapCopy.erase("elevation");
   visibilityCleanupMapCopy.erase("variance");
@@ -584,20 +1834,55 @@ bool ElevationMap::publishVisibilityCleanupMap() {
   visibilityCleanupMapCopy.erase("horizontal_variance_xy");
   visibilityCleanupMapCopy.erase("color");
   visibilityCleanupMapCopy.erase("time");
-  grid_map_msgs::GridMap message;
-  grid_map::GridMapRosConverter::toMessage(visibilityCleanupMapCopy, message);
+  const grid_map_msgs::GridMapPtr message = boost::make_shared<grid_map_msgs::GridMap>();
+  grid_map::GridMapRosConverter::toMessage(visibilityCleanupMapCopy, *message);
   visibilityCleanupMapPublisher_.publish(message);
   ROS_DEBUG("Visibility cleanup map has been published.");
   return true;
 }
 
 grid_map::GridMap& ElevationMap::getRawGridMap() {
+  applyPendingMotionUpdates();
   return rawMap_;
 }
 
-void ElevationMap::setRawGridMap(const grid_map::GridMap& map) {
+void ElevationMap::setRawGridMap(grid_map::GridMap map) {
+  boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  rawMap_ = map;
+  if ((map.getSize() != rawMap_.getSize()).any() || map.getResolution() != rawMap_.getResolution()) {
+    setGeometry(map.getLength(), map.getResolution(), map.getPosition());
+  }
+  rawMap_ = std::move(map);
+  if (enableCompactLayers_) {
+    for (const auto& layer : {"lowest_scan_point", "sensor_x_at_lowest_scan", "sensor_y_at_lowest_scan", "sensor_z_at_lowest_scan"}) {
+      rawMap_.erase(layer);
+    }
+    compactLowestScanLayers_.resize(rawMap_.getSize());
+  }
+  resetPendingMotionUpdates();
+  deferredVisibilityCleanupRays_.clear();
+  markRawMapModified();
+}
+
+void ElevationMap::markRawMapModified() {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  const grid_map::Size numberOfTiles = getNumberOfTiles(rawMap_.getSize());
+  dirtyTiles_.setConstant(numberOfTiles(0), numberOfTiles(1), true);
+  visibilityCleanupTiles_.setConstant(numberOfTiles(0), numberOfTiles(1), true);
+  cleanupTiles_.setConstant(numberOfTiles(0), numberOfTiles(1), true);
+  ++rawMapVersion_;
+}
+
+void ElevationMap::markRawMapModified(const grid_map::Index& topLeftIndex, const grid_map::Size& size) {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  const grid_map::Size& bufferSize = rawMap_.getSize();
+  for (const auto& colSpan : getTileSpans(topLeftIndex(1), size(1), bufferSize(1))) {
+    for (const auto& rowSpan : getTileSpans(topLeftIndex(0), size(0), bufferSize(0))) {
+      dirtyTiles_(rowSpan.first / fusionTileSize, colSpan.first / fusionTileSize) = true;
+      cleanupTiles_(rowSpan.first / fusionTileSize, colSpan.first / fusionTileSize) = true;
+    }
+  }
+  ++rawMapVersion_;
 }
 
 grid_map::GridMap& ElevationMap::getFusedGridMap() {
@@ -607,6 +1892,45 @@ grid_map::GridMap& ElevationMap::getFusedGridMap() {
 void ElevationMap::setFusedGridMap(const grid_map::GridMap& map) {
   boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
   fusedMap_ = map;
+  fusedMapPyramid_.markAllModified();
+  fusionScheduler_.markAllPending(getNumberOfTiles(fusedMap_.getSize()));
+  ++fusedMapVersion_;
+}
+
+std::shared_ptr<const grid_map::GridMap> ElevationMap::getRawMapSnapshot() {
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  applyPendingMotionUpdates();
+  if (!rawMapSnapshot_ || rawMapSnapshotVersion_ != rawMapVersion_ || rawMapSnapshot_->getTimestamp() != rawMap_.getTimestamp()) {
+    auto rawMapSnapshot = std::make_shared<const grid_map::GridMap>(rawMap_);
+    std::lock_guard<std::mutex> snapshotLock(rawMapSnapshotMutex_);
+    rawMapSnapshot_ = std::move(rawMapSnapshot);
+    rawMapSnapshotVersion_ = rawMapVersion_;
+  }
+  return rawMapSnapshot_;
+}
+
+std::shared_ptr<const grid_map::GridMap> ElevationMap::getLatestRawMapSnapshot() {
+  // The owner of the raw map mutex gets it again, so the writing thread always gets an up to date snapshot.
+  boost::recursive_mutex::scoped_try_lock scopedLockForRawData(rawMapMutex_);
+  if (!scopedLockForRawData.owns_lock()) {
+    std::lock_guard<std::mutex> snapshotLock(rawMapSnapshotMutex_);
+    if (rawMapSnapshot_) {
+      return rawMapSnapshot_;
+    }
+  }
+  return getRawMapSnapshot();
+}
+
+std::shared_ptr<const grid_map::GridMap> ElevationMap::getFusedMapSnapshot() {
+  boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
+  if (!fusedMapSnapshot_ || fusedMapSnapshotVersion_ != fusedMapVersion_ ||
+      fusedMapSnapshot_->getTimestamp() != fusedMap_.getTimestamp()) {
+    auto fusedMapSnapshot = std::make_shared<grid_map::GridMap>(fusedMap_);
+    fusedMapSnapshot->add("uncertainty_range", fusedMapSnapshot->get("upper_bound") - fusedMapSnapshot->get("lower_bound"));
+    fusedMapSnapshot_ = std::move(fusedMapSnapshot);
+    fusedMapSnapshotVersion_ = fusedMapVersion_;
+  }
+  return fusedMapSnapshot_;
 }
 
 ros::Time ElevationMap::getTimeOfLastUpdate() {
@@ -641,11 +1965,35 @@ boost::recursive_mutex& ElevationMap::getRawDataMutex() {
 
 bool ElevationMap::clean() {
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
-  rawMap_.get("variance") = rawMap_.get("variance").unaryExpr(VarianceClampOperator<float>(minVariance_, maxVariance_));
-  rawMap_.get("horizontal_variance_x") =
-      rawMap_.get("horizontal_variance_x").unaryExpr(VarianceClampOperator<float>(minHorizontalVariance_, maxHorizontalVariance_));
-  rawMap_.get("horizontal_variance_y") =
-      rawMap_.get("horizontal_variance_y").unaryExpr(VarianceClampOperator<float>(minHorizontalVariance_, maxHorizontalVariance_));
+  PipelineStatistics::ScopedTimer timer(&pipelineStatistics_, "map", PipelineStage::Clean);
+  if (!cleanupTiles_.any()) {
+    return true;
+  }
+  const VarianceClampOperator<float> varianceClamp(minVariance_, maxVariance_);
+  const VarianceClampOperator<float> horizontalVarianceClamp(minHorizontalVariance_, maxHorizontalVariance_);
+  const RawMapLayers layers(rawMap_);
+  grid_map::Matrix& varianceLayer = layers[RawMapLayer::Variance];
+  grid_map::Matrix& horizontalVarianceXLayer = layers[RawMapLayer::HorizontalVarianceX];
+  grid_map::Matrix& horizontalVarianceYLayer = layers[RawMapLayer::HorizontalVarianceY];
+  const grid_map::Size& size = rawMap_.getSize();
+  for (int tileCol = 0; tileCol < cleanupTiles_.cols(); ++tileCol) {
+    for (int tileRow = 0; tileRow < cleanupTiles_.rows(); ++tileRow) {
+      if (!cleanupTiles_(tileRow, tileCol)) {
+        continue;
+      }
+      const int row = tileRow * fusionTileSize;
+      const int col = tileCol * fusionTileSize;
+      const int rows = std::min(fusionTileSize, size(0) - row);
+      const int cols = std::min(fusionTileSize, size(1) - col);
+      auto variance = varianceLayer.block(row, col, rows, cols);
+      auto horizontalVarianceX = horizontalVarianceXLayer.block(row, col, rows, cols);
+      auto horizontalVarianceY = horizontalVarianceYLayer.block(row, col, rows, cols);
+      variance = variance.unaryExpr(varianceClamp);
+      horizontalVarianceX = horizontalVarianceX.unaryExpr(horizontalVarianceClamp);
+      horizontalVarianceY = horizontalVarianceY.unaryExpr(horizontalVarianceClamp);
+    }
+  }
+  cleanupTiles_.setConstant(false);
   return true;
 }
 
@@ -653,16 +2001,85 @@ void ElevationMap::resetFusedData() {
   boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
   fusedMap_.clearAll();
   fusedMap_.resetTimestamp();
+  fusedMapPyramid_.markAllModified();
+  fusionScheduler_.markAllPending(getNumberOfTiles(fusedMap_.getSize()));
+  ++fusedMapVersion_;
+}
+
+void ElevationMap::invalidateFusedData(const grid_map::Size& bufferSize, const TileMask& dirtyTiles, int radiusInCells) {
+  boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
+  const grid_map::Size numberOfTiles = getNumberOfTiles(bufferSize);
+  if (dirtyTiles.rows() != numberOfTiles(0) || dirtyTiles.cols() != numberOfTiles(1) || (fusedMap_.getSize() != bufferSize).any()) {
+    resetFusedData();
+    return;
+  }
+  if (!dirtyTiles.any()) {
+    return;
+  }
+
+  // A fused cell depends on all raw cells within its error ellipse, grow the modified tiles by the ellipse radius.
+  TileMask affectedTiles = TileMask::Constant(numberOfTiles(0), numberOfTiles(1), false);
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+      if (!dirtyTiles(tileRow, tileCol)) {
+        continue;
+      }
+      const int row = tileRow * fusionTileSize;
+      const int col = tileCol * fusionTileSize;
+      const int rows = std::min(fusionTileSize, bufferSize(0) - row);
+      const int cols = std::min(fusionTileSize, bufferSize(1) - col);
+      for (const auto& colSpan : getTileSpans(col - radiusInCells, cols + 2 * radiusInCells, bufferSize(1))) {
+        for (const auto& rowSpan : getTileSpans(row - radiusInCells, rows + 2 * radiusInCells, bufferSize(0))) {
+          affectedTiles(rowSpan.first / fusionTileSize, colSpan.first / fusionTileSize) = true;
+        }
+      }
+    }
+  }
+
+  // Clear the fused data of the affected tiles, such that they are fused again.
+  fusionScheduler_.markPending(affectedTiles);
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+      if (!affectedTiles(tileRow, tileCol)) {
+        continue;
+      }
+      const int row = tileRow * fusionTileSize;
+      const int col = tileCol * fusionTileSize;
+      const int rows = std::min(fusionTileSize, bufferSize(0) - row);
+      const int cols = std::min(fusionTileSize, bufferSize(1) - col);
+      for (const std::string& layer : fusedMap_.getLayers()) {
+        fusedMap_.get(layer).block(row, col, rows, cols).setConstant(NAN);
+      }
+      fusedMapPyramid_.markModified(grid_map::Index(row, col), grid_map::Size(rows, cols));
+    }
+  }
+  ++fusedMapVersion_;
 }
 
 void ElevationMap::setFrameId(const std::string& frameId) {
-  rawMap_.setFrameId(frameId);
-  fusedMap_.setFrameId(frameId);
+  // Lock raw and fused map object in different scopes to prevent deadlock.
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+    rawMap_.setFrameId(frameId);
+    ++rawMapVersion_;
+  }
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
+    fusedMap_.setFrameId(frameId);
+    ++fusedMapVersion_;
+  }
 }
 
 void ElevationMap::setTimestamp(ros::Time timestamp) {
-  rawMap_.setTimestamp(timestamp.toNSec());
-  fusedMap_.setTimestamp(timestamp.toNSec());
+  // Lock raw and fused map object in different scopes to prevent deadlock. The cell data does not change.
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+    rawMap_.setTimestamp(timestamp.toNSec());
+  }
+  {
+    boost::recursive_mutex::scoped_lock scopedLockForFusedData(fusedMapMutex_);
+    fusedMap_.setTimestamp(timestamp.toNSec());
+  }
 }
 
 const std::string& ElevationMap::getFrameId() {
@@ -674,7 +2091,11 @@ bool ElevationMap::hasRawMapSubscribers() const {
 }
 
 bool ElevationMap::hasFusedMapSubscribers() const {
-  return elevationMapFusedPublisher_.getNumSubscribers() >= 1;
+  if (elevationMapFusedPublisher_.getNumSubscribers() >= 1 || elevationMapFusedDeltaPublisher_->hasSubscribers()) {
+    return true;
+  }
+  return std::any_of(elevationMapLevelPublishers_.begin(), elevationMapLevelPublishers_.end(),
+                     [](const ros::Publisher& publisher) { return publisher.getNumSubscribers() >= 1; });
 }
 
 void ElevationMap::underlyingMapCallback(const grid_map_msgs::GridMap& underlyingMap) {
@@ -703,13 +2124,17 @@ void ElevationMap::underlyingMapCallback(const grid_map_msgs::GridMap& underlyin
   }
   underlyingMap_.setBasicLayers(rawMap_.getBasicLayers());
   hasUnderlyingMap_ = true;
+  boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  applyPendingMotionUpdates();
   rawMap_.addDataFrom(underlyingMap_, false, false, true);
+  markRawMapModified();
 }
 
 void ElevationMap::setRawSubmapHeight(const grid_map::Position& initPosition, float mapHeight, double lengthInXSubmap,
                                       double lengthInYSubmap, double margin) {
   // Set a submap area (lengthInYSubmap + margin, lengthInXSubmap + margin) with a constant height (mapHeight).
   boost::recursive_mutex::scoped_lock scopedLockForRawData(rawMapMutex_);
+  applyPendingMotionUpdates();
 
   // Calculate submap iterator start index.
   const grid_map::Position topLeftPosition(initPosition(0) + lengthInXSubmap / 2, initPosition(1) + lengthInYSubmap / 2);
@@ -723,13 +2148,120 @@ void ElevationMap::setRawSubmapHeight(const grid_map::Position& initPosition, fl
   const Eigen::Array2i submapBufferSize(lengthInYSubmapI, lengthInXSubmapI);
 
   // Iterate through submap and fill height values.
-  grid_map::Matrix& elevationData = rawMap_["elevation"];
-  grid_map::Matrix& varianceData = rawMap_["variance"];
+  const RawMapLayers layers(rawMap_);
+  grid_map::Matrix& elevationData = layers[RawMapLayer::Elevation];
+  grid_map::Matrix& varianceData = layers[RawMapLayer::Variance];
   for (grid_map::SubmapIterator iterator(rawMap_, submapTopLeftIndex, submapBufferSize); !iterator.isPastEnd(); ++iterator) {
     const grid_map::Index index(*iterator);
     elevationData(index(0), index(1)) = mapHeight;
     varianceData(index(0), index(1)) = 0.0;
   }
+  markRawMapModified(submapTopLeftIndex, submapBufferSize);
+}
+
+std::vector<std::string> ElevationMap::maskedReplace(grid_map::GridMap& sourceMap, const std::string& maskLayer) {
+  // With the default start index, the buffer indices of the source map are its unwrapped indices.
+  sourceMap.convertToDefaultStartIndex();
+  const grid_map::Matrix* mask = sourceMap.exists(maskLayer) ? &sourceMap.get(maskLayer) : nullptr;
+
+  PipelineStatistics::ScopedLock scopedLockForRawData(rawMapMutex_, &pipelineStatistics_, "raw_map");
+  applyPendingMotionUpdates();
+
+  std::vector<std::pair<grid_map::Matrix*, const grid_map::Matrix*>> layers;
+  std::vector<std::string> missingLayers;
+  for (const std::string& layer : sourceMap.getLayers()) {
+    if (layer == maskLayer) {
+      continue;
+    }
+    if (rawMap_.exists(layer)) {
+      layers.emplace_back(&rawMap_.get(layer), &sourceMap.get(layer));
+    } else {
+      missingLayers.push_back(layer);
+    }
+  }
+  if (layers.empty()) {
+    return missingLayers;
+  }
+
+  const grid_map::Size& size = rawMap_.getSize();
+  const grid_map::Index& startIndex = rawMap_.getStartIndex();
+  const double resolution = rawMap_.getResolution();
+
+  // Cell k of the source map is at the position of cell i of the raw map for k = i + offset, if the cells are aligned.
+  const grid_map::Position topLeftPosition = rawMap_.getPosition() + 0.5 * rawMap_.getLength().matrix();
+  const grid_map::Position sourceTopLeftPosition = sourceMap.getPosition() + 0.5 * sourceMap.getLength().matrix();
+  const Eigen::Array2d offset = (sourceTopLeftPosition - topLeftPosition).array() / resolution;
+  const bool isAligned = std::abs(sourceMap.getResolution() - resolution) < 1e-6 * resolution &&
+                         ((offset - offset.round()).abs() < 1e-3).all();
+
+  if (isAligned) {
+    const Eigen::Array2i indexOffset = offset.round().cast<int>();
+    const grid_map::Index overlapBegin = (-indexOffset).max(0);
+    const grid_map::Index overlapEnd = (sourceMap.getSize() - indexOffset).min(size);
+    if ((overlapEnd <= overlapBegin).any()) {
+      return missingLayers;
+    }
+
+    // The (unwrapped) overlap is at most four contiguous blocks of the raw map buffer.
+    const grid_map::Size overlapSize = overlapEnd - overlapBegin;
+    const grid_map::Index bufferBegin = grid_map::getBufferIndexFromIndex(overlapBegin, size, startIndex);
+    const std::vector<std::pair<int, int>> rowSpans = getBufferSpans(bufferBegin(0), overlapSize(0), size(0));
+    const std::vector<std::pair<int, int>> colSpans = getBufferSpans(bufferBegin(1), overlapSize(1), size(1));
+    int sourceCol = overlapBegin(1) + indexOffset(1);
+    for (const auto& colSpan : colSpans) {
+      int sourceRow = overlapBegin(0) + indexOffset(0);
+      for (const auto& rowSpan : rowSpans) {
+        for (const auto& layer : layers) {
+          auto destinationBlock = layer.first->block(rowSpan.first, colSpan.first, rowSpan.second, colSpan.second);
+          const auto sourceBlock = layer.second->block(sourceRow, sourceCol, rowSpan.second, colSpan.second);
+          if (mask == nullptr) {
+            destinationBlock = sourceBlock;
+          } else {
+            const auto maskBlock = mask->block(sourceRow, sourceCol, rowSpan.second, colSpan.second);
+            destinationBlock.array() = maskBlock.array().isNaN().select(destinationBlock.array(), sourceBlock.array());
+          }
+        }
+        sourceRow += rowSpan.second;
+      }
+      sourceCol += colSpan.second;
+    }
+    markRawMapModified(bufferBegin, overlapSize);
+    return missingLayers;
+  }
+
+  // Otherwise the cells are copied one by one. The x position of a cell only depends on its row and the y position only
+  // on its column, such that the corresponding source cells are computed once per row and column (-1 if outside).
+  std::vector<int> sourceRows(size(0), -1);
+  std::vector<int> sourceCols(size(1), -1);
+  grid_map::Position position;
+  grid_map::Index sourceIndex;
+  for (int row = 0; row < size(0); ++row) {
+    rawMap_.getPosition(grid_map::Index(row, 0), position);
+    if (sourceMap.getIndex(grid_map::Position(position.x(), sourceMap.getPosition().y()), sourceIndex)) {
+      sourceRows[row] = sourceIndex(0);
+    }
+  }
+  for (int col = 0; col < size(1); ++col) {
+    rawMap_.getPosition(grid_map::Index(0, col), position);
+    if (sourceMap.getIndex(grid_map::Position(sourceMap.getPosition().x(), position.y()), sourceIndex)) {
+      sourceCols[col] = sourceIndex(1);
+    }
+  }
+  for (const auto& layer : layers) {
+    for (int col = 0; col < size(1); ++col) {
+      if (sourceCols[col] < 0) {
+        continue;
+      }
+      for (int row = 0; row < size(0); ++row) {
+        if (sourceRows[row] < 0 || (mask != nullptr && std::isnan((*mask)(sourceRows[row], sourceCols[col])))) {
+          continue;
+        }
+        (*layer.first)(row, col) = (*layer.second)(sourceRows[row], sourceCols[col]);
+      }
+    }
+  }
+  markRawMapModified();
+  return missingLayers;
 }
 
 float ElevationMap::cumulativeDistributionFunction(float x, float mean, float standardDeviation) {
@@ -6,15 +6,17 @@
  *   Institute: ETH Zurich, ANYbotics
  */
 
+#include <algorithm>
 #include <cmath>
+#include <fstream>
+#include <limits>
 #include <string>
+#include <utility>
 
+#include <diagnostic_msgs/DiagnosticArray.h>
 #include <grid_map_msgs/GridMap.h>
-#include <pcl/PCLPointCloud2.h>
-#include <pcl/conversions.h>
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/point_cloud.h>
-#include <pcl_conversions/pcl_conversions.h>
 #include <boost/bind.hpp>
 #include <boost/thread/recursive_mutex.hpp>
 #include <grid_map_ros/grid_map_ros.hpp>
@@ -23,6 +25,7 @@
 
 #include "elevation_mapping/ElevationMap.hpp"
 #include "elevation_mapping/ElevationMapping.hpp"
+#include "elevation_mapping/PointCloudConversion.hpp"
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
 #include "elevation_mapping/sensor_processors/LaserSensorProcessor.hpp"
 #include "elevation_mapping/sensor_processors/PerfectSensorProcessor.hpp"
@@ -41,6 +44,8 @@ ElevationMapping::ElevationMapping(ros::NodeHandle& nodeHandle)
       updatesEnabled_(true),
       isContinuouslyFusing_(false),
       receivedFirstMatchingPointcloudAndPose_(false),
+      asynchronousInputProcessing_(false),
+      isStoppingIntegration_(false),
       initializeElevationMap_(false),
       initializationMethod_(0),
       lengthInXInitSubmap_(1.2),
@@ -75,7 +80,10 @@ void ElevationMapping::setupSubscribers() {  // Handle deprecated point_cloud_to
         pointCloudTopic_, 1,
         std::bind(&ElevationMapping::pointCloudCallback, this, std::placeholders::_1, true, std::ref(sensorProcessor_)));
   }
+  sensorProcessor_->setPipelineStatistics(&map_.getPipelineStatistics(), "point_cloud");
   if (configuredInputSources) {
+    inputSources_.setPipelineStatistics(&map_.getPipelineStatistics());
+    inputSources_.setInputScheduler(inputScheduler_);
     inputSources_.registerCallbacks(*this, make_pair("pointcloud", &ElevationMapping::pointCloudCallback));
   }
 
@@ -99,6 +107,11 @@ void ElevationMapping::setupServices() {
       "get_submap", boost::bind(&ElevationMapping::getFusedSubmapServiceCallback, this, _1, _2), ros::VoidConstPtr(), &fusionServiceQueue_);
   fusedSubmapService_ = nodeHandle_.advertiseService(advertiseServiceOptionsForGetFusedSubmap);
 
+  ros::AdvertiseServiceOptions advertiseServiceOptionsForGetSubmapOfLevel = ros::AdvertiseServiceOptions::create<GetSubmapOfLevel>(
+      "get_submap_of_level", boost::bind(&ElevationMapping::getSubmapOfLevelServiceCallback, this, _1, _2), ros::VoidConstPtr(),
+      &fusionServiceQueue_);
+  submapOfLevelService_ = nodeHandle_.advertiseService(advertiseServiceOptionsForGetSubmapOfLevel);
+
   ros::AdvertiseServiceOptions advertiseServiceOptionsForGetRawSubmap = ros::AdvertiseServiceOptions::create<grid_map_msgs::GetGridMap>(
       "get_raw_submap", boost::bind(&ElevationMapping::getRawSubmapServiceCallback, this, _1, _2), ros::VoidConstPtr(),
       &fusionServiceQueue_);
@@ -110,11 +123,26 @@ void ElevationMapping::setupServices() {
   maskedReplaceService_ = nodeHandle_.advertiseService("masked_replace", &ElevationMapping::maskedReplaceServiceCallback, this);
   saveMapService_ = nodeHandle_.advertiseService("save_map", &ElevationMapping::saveMapServiceCallback, this);
   loadMapService_ = nodeHandle_.advertiseService("load_map", &ElevationMapping::loadMapServiceCallback, this);
+  pipelineStatisticsService_ =
+      nodeHandle_.advertiseService("get_pipeline_statistics", &ElevationMapping::getPipelineStatisticsServiceCallback, this);
+
+  // Snapshots are written and read on their own thread.
+  ros::AdvertiseServiceOptions advertiseServiceOptionsForSaveSnapshot = ros::AdvertiseServiceOptions::create<grid_map_msgs::ProcessFile>(
+      "save_snapshot", boost::bind(&ElevationMapping::saveSnapshotServiceCallback, this, _1, _2), ros::VoidConstPtr(), &snapshotQueue_);
+  saveSnapshotService_ = nodeHandle_.advertiseService(advertiseServiceOptionsForSaveSnapshot);
+  ros::AdvertiseServiceOptions advertiseServiceOptionsForLoadSnapshot = ros::AdvertiseServiceOptions::create<grid_map_msgs::ProcessFile>(
+      "load_snapshot", boost::bind(&ElevationMapping::loadSnapshotServiceCallback, this, _1, _2), ros::VoidConstPtr(), &snapshotQueue_);
+  loadSnapshotService_ = nodeHandle_.advertiseService(advertiseServiceOptionsForLoadSnapshot);
 }
 
 void ElevationMapping::setupTimers() {
   mapUpdateTimer_ = nodeHandle_.createTimer(maxNoUpdateDuration_, &ElevationMapping::mapUpdateTimerCallback, this, true, false);
 
+  if (!diagnosticsTimerDuration_.isZero()) {
+    diagnosticsPublisher_ = nodeHandle_.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 1);
+    diagnosticsTimer_ = nodeHandle_.createTimer(diagnosticsTimerDuration_, &ElevationMapping::publishDiagnosticsCallback, this);
+  }
+
   if (!fusedMapPublishTimerDuration_.isZero()) {
     ros::TimerOptions timerOptions =
         ros::TimerOptions(fusedMapPublishTimerDuration_, boost::bind(&ElevationMapping::publishFusedMapCallback, this, _1),
@@ -129,15 +157,35 @@ void ElevationMapping::setupTimers() {
                           &visibilityCleanupQueue_, false, false);
     visibilityCleanupTimer_ = nodeHandle_.createTimer(timerOptions);
   }
+
+  if (!snapshotFile_.empty() && !snapshotCheckpointTimerDuration_.isZero()) {
+    ros::TimerOptions timerOptions =
+        ros::TimerOptions(snapshotCheckpointTimerDuration_, boost::bind(&ElevationMapping::snapshotCheckpointCallback, this, _1),
+                          &snapshotQueue_, false, false);
+    snapshotCheckpointTimer_ = nodeHandle_.createTimer(timerOptions);
+  }
 }
 
 ElevationMapping::~ElevationMapping() {
+  // Stop the input sources and the integration of their point clouds.
+  inputSources_.stopProcessingThreads();
+  {
+    boost::mutex::scoped_lock lock(integrationQueueMutex_);
+    isStoppingIntegration_ = true;
+  }
+  integrationQueueCondition_.notify_all();
+  if (integrationThread_.joinable()) {
+    integrationThread_.join();
+  }
+  integrationQueue_.clear();
+
   // Shutdown all services.
 
   {  // Fusion Service Queue
     rawSubmapService_.shutdown();
     fusionTriggerService_.shutdown();
     fusedSubmapService_.shutdown();
+    submapOfLevelService_.shutdown();
     fusedMapPublishTimer_.stop();
 
     fusionServiceQueue_.disable();
@@ -151,6 +199,15 @@ ElevationMapping::~ElevationMapping() {
     visibilityCleanupQueue_.clear();
   }
 
+  {  // Snapshot queue
+    saveSnapshotService_.shutdown();
+    loadSnapshotService_.shutdown();
+    snapshotCheckpointTimer_.stop();
+
+    snapshotQueue_.disable();
+    snapshotQueue_.clear();
+  }
+
   nodeHandle_.shutdown();
 
   // Join threads.
@@ -160,6 +217,14 @@ ElevationMapping::~ElevationMapping() {
   if (visibilityCleanupThread_.joinable()) {
     visibilityCleanupThread_.join();
   }
+  if (snapshotThread_.joinable()) {
+    snapshotThread_.join();
+  }
+
+  // Keep the latest map for the next warm start.
+  if (!snapshotFile_.empty() && !snapshotCheckpointTimerDuration_.isZero()) {
+    map_.saveSnapshot(snapshotFile_);
+  }
 }
 
 bool ElevationMapping::readParameters() {
@@ -188,6 +253,12 @@ bool ElevationMapping::readParameters() {
   nodeHandle_.param("time_tolerance", timeTolerance, 0.0);
   timeTolerance_.fromSec(timeTolerance);
 
+  double latencyBudget;
+  nodeHandle_.param("latency_budget", latencyBudget, 0.0);
+  inputScheduler_.setLatencyBudget(latencyBudget);
+
+  nodeHandle_.param("asynchronous_input_processing", asynchronousInputProcessing_, false);
+
   double fusedMapPublishingRate;
   nodeHandle_.param("fused_map_publishing_rate", fusedMapPublishingRate, 1.0);
   if (fusedMapPublishingRate == 0.0) {
@@ -202,6 +273,14 @@ bool ElevationMapping::readParameters() {
     fusedMapPublishTimerDuration_.fromSec(1.0 / fusedMapPublishingRate);
   }
 
+  double diagnosticsPublishingRate;
+  nodeHandle_.param("diagnostics_publishing_rate", diagnosticsPublishingRate, 1.0);
+  if (diagnosticsPublishingRate == 0.0) {
+    diagnosticsTimerDuration_.fromSec(0.0);
+  } else {
+    diagnosticsTimerDuration_.fromSec(1.0 / diagnosticsPublishingRate);
+  }
+
   double visibilityCleanupRate;
   nodeHandle_.param("visibility_cleanup_rate", visibilityCleanupRate, 1.0);
   if (visibilityCleanupRate == 0.0) {
@@ -234,10 +313,28 @@ bool ElevationMapping::readParameters() {
   nodeHandle_.param("max_horizontal_variance", map_.maxHorizontalVariance_, 0.5);
   nodeHandle_.param("underlying_map_topic", map_.underlyingMapTopic_, std::string());
   nodeHandle_.param("enable_visibility_cleanup", map_.enableVisibilityCleanup_, true);
+  nodeHandle_.param("visibility_cleanup_time_budget", map_.visibilityCleanupTimeBudget_, 0.0);
   nodeHandle_.param("enable_continuous_cleanup", map_.enableContinuousCleanup_, false);
   nodeHandle_.param("scanning_duration", map_.scanningDuration_, 1.0);
+  nodeHandle_.param("lazy_motion_update", map_.enableLazyMotionUpdate_, false);
+  nodeHandle_.param("cell_point_aggregation", map_.enablePointAggregation_, false);
+  nodeHandle_.param("fusion_kernel_quantization", map_.fusionKernelQuantization_, 0.0);
+  nodeHandle_.param("fast_fusion", map_.enableFastFusion_, false);
+  nodeHandle_.param("fusion_time_budget", map_.fusionTimeBudget_, 0.0);
   nodeHandle_.param("masked_replace_service_mask_layer_name", maskedReplaceServiceMaskLayerName_, std::string("mask"));
 
+  nodeHandle_.param("snapshot_file", snapshotFile_, std::string());
+  double snapshotCheckpointInterval;
+  nodeHandle_.param("snapshot_checkpoint_interval", snapshotCheckpointInterval, 0.0);
+  snapshotCheckpointTimerDuration_.fromSec(std::max(snapshotCheckpointInterval, 0.0));
+
+  std::string tileStoreDirectory;
+  nodeHandle_.param("tile_store_directory", tileStoreDirectory, std::string());
+  if (!tileStoreDirectory.empty() &&
+      !map_.enableTileStore(tileStoreDirectory, nodeHandle_.param("tile_store_tile_size", 128), nodeHandle_.param("tile_store_max_mapped_tiles", 64))) {
+    return false;
+  }
+
   // Settings for initializing elevation map
   nodeHandle_.param("initialize_elevation_map", initializeElevationMap_, false);
   nodeHandle_.param("initialization_method", initializationMethod_, 0);
@@ -277,12 +374,25 @@ bool ElevationMapping::readParameters() {
 bool ElevationMapping::initialize() {
   ROS_INFO("Elevation mapping node initializing ... ");
   fusionServiceThread_ = boost::thread(boost::bind(&ElevationMapping::runFusionServiceThread, this));
+  if (asynchronousInputProcessing_) {
+    integrationThread_ = boost::thread(boost::bind(&ElevationMapping::runIntegrationThread, this));
+  }
   ros::Duration(1.0).sleep();  // Need this to get the TF caches fill up.
   resetMapUpdateTimer();
   fusedMapPublishTimer_.start();
   visibilityCleanupThread_ = boost::thread(boost::bind(&ElevationMapping::visibilityCleanupThread, this));
   visibilityCleanupTimer_.start();
-  initializeElevationMap();
+
+  // Warm start from the snapshot file, which replaces the initialization of the map.
+  bool isWarmStarted = false;
+  if (!snapshotFile_.empty() && std::ifstream(snapshotFile_).good()) {
+    isWarmStarted = map_.loadSnapshot(snapshotFile_);
+  }
+  if (!isWarmStarted) {
+    initializeElevationMap();
+  }
+  snapshotThread_ = boost::thread(boost::bind(&ElevationMapping::runSnapshotThread, this));
+  snapshotCheckpointTimer_.start();
   return true;
 }
 
@@ -308,8 +418,27 @@ void ElevationMapping::visibilityCleanupThread() {
   }
 }
 
+void ElevationMapping::runSnapshotThread() {
+  ros::Rate loopRate(20);
+
+  while (nodeHandle_.ok()) {
+    snapshotQueue_.callAvailable();
+
+    // Sleep until the next execution.
+    loopRate.sleep();
+  }
+}
+
 void ElevationMapping::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr& pointCloudMsg, bool publishPointCloud,
                                           const SensorProcessorBase::Ptr& sensorProcessor_) {
+  // Without a message, only the deferred point clouds are retried.
+  if (!pointCloudMsg) {
+    if (updatesEnabled_) {
+      processReadyPointClouds(publishPointCloud, sensorProcessor_);
+    }
+    return;
+  }
+
   ROS_DEBUG("Processing data from: %s", pointCloudMsg->header.frame_id.c_str());
   if (!updatesEnabled_) {
     ROS_WARN_THROTTLE(10, "Updating of elevation map is disabled. (Warning message is throttled, 10s.)");
@@ -328,22 +457,69 @@ void ElevationMapping::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr
     if (currentPointCloudTime < oldestPoseTime) {
       ROS_WARN_THROTTLE(5, "No corresponding point cloud and pose are found. Waiting for first match. (Warning message is throttled, 5s.)");
       return;
-    } else {
+    } else if (!receivedFirstMatchingPointcloudAndPose_.exchange(true)) {
+      // Several input processing threads may find their first match at once, only one of them reports it.
       ROS_INFO("First corresponding point cloud and pose found, elevation mapping started. ");
-      receivedFirstMatchingPointcloudAndPose_ = true;
     }
   }
 
-  stopMapUpdateTimer();
+  // Point clouds whose transformations are not available yet are deferred instead of blocking the callback.
+  sensorProcessor_->deferPointCloud(pointCloudMsg);
+  processReadyPointClouds(publishPointCloud, sensorProcessor_);
+}
+
+void ElevationMapping::processReadyPointClouds(bool publishPointCloud, const SensorProcessorBase::Ptr& sensorProcessor) {
+  sensor_msgs::PointCloud2ConstPtr readyPointCloudMsg;
+  ProcessedPointClouds processedPointClouds;
+  while ((readyPointCloudMsg = sensorProcessor->takeReadyPointCloud())) {
+    const std::string& sourceName = sensorProcessor->getSourceName();
+    const ros::Time processingStartTime = ros::Time::now();
+    if (!inputScheduler_.admit(sourceName, (processingStartTime - readyPointCloudMsg->header.stamp).toSec())) {
+      ROS_WARN_THROTTLE(5, "The latency budget is exceeded, skipping point clouds of %s. (Throttled 5s)", sourceName.c_str());
+      map_.getPipelineStatistics().addDroppedFrames(sourceName);
+      continue;
+    }
+    stopMapUpdateTimer();
+
+    ProcessedPointCloud processedPointCloud;
+    if (!processPointCloud(readyPointCloudMsg, sensorProcessor, inputScheduler_.getPointBudget(sourceName), processedPointCloud)) {
+      map_.getPipelineStatistics().addDroppedFrames(sourceName);
+      continue;
+    }
+    processedPointCloud.publishPointCloud = publishPointCloud;
+
+    if (asynchronousInputProcessing_) {
+      queuePointCloudForIntegration(std::move(processedPointCloud));
+      continue;
+    }
+    processedPointClouds.push_back(std::move(processedPointCloud));
+  }
+  integratePointCloudsInBatches(processedPointClouds);
+}
 
+bool ElevationMapping::processPointCloud(const sensor_msgs::PointCloud2ConstPtr& pointCloudMsg,
+                                         const SensorProcessorBase::Ptr& sensorProcessor, std::size_t pointBudget,
+                                         ProcessedPointCloud& processedPointCloud) {
   // Convert the sensor_msgs/PointCloud2 data to pcl/PointCloud.
-  // TODO(max): Double check with http://wiki.ros.org/hydro/Migration
-  pcl::PCLPointCloud2 pcl_pc;
-  pcl_conversions::toPCL(*pointCloudMsg, pcl_pc);
+  // The buffers of the sensor processor are reused to avoid allocations for every point cloud.
+  processedPointCloud.scanBuffers = sensorProcessor->acquireScanBuffers();
+  processedPointCloud.sensorProcessor = sensorProcessor.get();
+  SensorProcessorBase::ScanBuffers& scanBuffers = *processedPointCloud.scanBuffers;
+  const PointCloudType::Ptr& pointCloud = scanBuffers.pointCloud;
+  const ros::WallTime conversionStartTime = ros::WallTime::now();
+  if (!fromPointCloud2Message(*pointCloudMsg, *pointCloud)) {
+    ROS_ERROR("Could not convert the point cloud message.");
+    resetMapUpdateTimer();
+    return false;
+  }
+  map_.getPipelineStatistics().addDuration(sensorProcessor->getSourceName(), PipelineStage::Conversion,
+                                           (ros::WallTime::now() - conversionStartTime).toSec());
+  ros::Time& timeStamp = processedPointCloud.timeStamp;
+  timeStamp.fromNSec(1000 * pointCloud->header.stamp);
 
-  PointCloudType::Ptr pointCloud(new PointCloudType);
-  pcl::fromPCLPointCloud2(pcl_pc, *pointCloud);
-  lastPointCloudUpdateTime_.fromNSec(1000 * pointCloud->header.stamp);
+  // Thinning out the points before the sensor processor saves their processing, not only their integration.
+  const ros::WallTime processingStartTime = ros::WallTime::now();
+  processedPointCloud.numberOfProcessedPoints = decimatePointCloud(pointBudget, *pointCloud);
 
   ROS_DEBUG("ElevationMap received a point cloud (%i points) for elevation mapping.", static_cast<int>(pointCloud->size()));
 
@@ -351,42 +527,59 @@ void ElevationMapping::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr
   Eigen::Matrix<double, 6, 6> robotPoseCovariance;
   robotPoseCovariance.setZero();
   if (!ignoreRobotMotionUpdates_) {
-    boost::shared_ptr<geometry_msgs::PoseWithCovarianceStamped const> poseMessage =
-        robotPoseCache_.getElemBeforeTime(lastPointCloudUpdateTime_);
+    boost::shared_ptr<geometry_msgs::PoseWithCovarianceStamped const> poseMessage = robotPoseCache_.getElemBeforeTime(timeStamp);
     if (!poseMessage) {
       // Tell the user that either for the timestamp no pose is available or that the buffer is possibly empty
-      if (robotPoseCache_.getOldestTime().toSec() > lastPointCloudUpdateTime_.toSec()) {
-        ROS_ERROR("The oldest pose available is at %f, requested pose at %f", robotPoseCache_.getOldestTime().toSec(),
-                  lastPointCloudUpdateTime_.toSec());
+      if (robotPoseCache_.getOldestTime().toSec() > timeStamp.toSec()) {
+        ROS_ERROR("The oldest pose available is at %f, requested pose at %f", robotPoseCache_.getOldestTime().toSec(), timeStamp.toSec());
       } else {
-        ROS_ERROR("Could not get pose information from robot for time %f. Buffer empty?", lastPointCloudUpdateTime_.toSec());
+        ROS_ERROR("Could not get pose information from robot for time %f. Buffer empty?", timeStamp.toSec());
       }
-      return;
+      return false;
     }
     robotPoseCovariance = Eigen::Map<const Eigen::MatrixXd>(poseMessage->pose.covariance.data(), 6, 6);
   }
 
   // Process point cloud.
-  PointCloudType::Ptr pointCloudProcessed(new PointCloudType);
-  Eigen::VectorXf measurementVariances;
-  if (!sensorProcessor_->process(pointCloud, robotPoseCovariance, pointCloudProcessed, measurementVariances,
-                                 pointCloudMsg->header.frame_id)) {
-    if (!sensorProcessor_->isTfAvailableInBuffer()) {
+  if (!sensorProcessor->process(pointCloud, robotPoseCovariance, scanBuffers.pointCloudMapFrame, scanBuffers.variances,
+                                pointCloudMsg->header.frame_id)) {
+    if (!sensorProcessor->isTfAvailableInBuffer()) {
       ROS_INFO_THROTTLE(10, "Waiting for tf transformation to be available. (Message is throttled, 10s.)");
-      return;
+      return false;
     }
     ROS_ERROR_THROTTLE(10, "Point cloud could not be processed. (Throttled 10s)");
     resetMapUpdateTimer();
-    return;
+    return false;
+  }
+  processedPointCloud.transformationSensorToMap = sensorProcessor->transformationSensorToMap_;
+  processedPointCloud.processingDuration = (ros::WallTime::now() - processingStartTime).toSec();
+  return true;
+}
+
+void ElevationMapping::integratePointClouds(const ProcessedPointClouds& processedPointClouds) {
+  std::vector<ElevationMap::PointCloudMeasurement> measurements;
+  bool publishPointCloud = false;
+  ros::Time latestTimeStamp;
+  for (const auto& processedPointCloud : processedPointClouds) {
+    const PointCloudType::Ptr& pointCloudProcessed = processedPointCloud.scanBuffers->pointCloudMapFrame;
+    const Eigen::VectorXf& measurementVariances = processedPointCloud.scanBuffers->variances;
+    measurements.emplace_back(pointCloudProcessed, measurementVariances.head(pointCloudProcessed->size()), processedPointCloud.timeStamp,
+                              processedPointCloud.transformationSensorToMap);
+    publishPointCloud = publishPointCloud || processedPointCloud.publishPointCloud;
+    latestTimeStamp = std::max(latestTimeStamp, processedPointCloud.timeStamp);
   }
 
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getRawDataMutex());
+  PipelineStatistics::ScopedLock scopedLock(map_.getRawDataMutex(), &map_.getPipelineStatistics(), "raw_map");
+  {
+    boost::lock_guard<boost::mutex> lock(lastPointCloudUpdateTimeMutex_);
+    lastPointCloudUpdateTime_ = latestTimeStamp;
+  }
 
   // Update map location.
   updateMapLocation();
 
   // Update map from motion prediction.
-  if (!updatePrediction(lastPointCloudUpdateTime_)) {
+  if (!updatePrediction(latestTimeStamp)) {
     ROS_ERROR("Updating process noise failed.");
     resetMapUpdateTimer();
     return;
@@ -398,19 +591,23 @@ void ElevationMapping::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr
     map_.clear();
   }
 
-  // Add point cloud to elevation map.
-  if (!map_.add(pointCloudProcessed, measurementVariances, lastPointCloudUpdateTime_,
-                Eigen::Affine3d(sensorProcessor_->transformationSensorToMap_))) {
+  // Add point clouds to elevation map.
+  const ros::WallTime integrationStartTime = ros::WallTime::now();
+  if (!map_.add(measurements)) {
     ROS_ERROR("Adding point cloud to elevation map failed.");
     resetMapUpdateTimer();
     return;
   }
+  reportIntegration(processedPointClouds, (ros::WallTime::now() - integrationStartTime).toSec());
+  // Publishing works on snapshots and the fusion locks the raw map only to copy it, the next point cloud
+  // may be integrated meanwhile.
+  scopedLock.unlock();
 
   if (publishPointCloud) {
     // Publish elevation map.
     map_.postprocessAndPublishRawElevationMap();
     if (isFusingEnabled()) {
-      map_.fuseAll();
+      map_.fuseWithinTimeBudget();
       map_.publishFusedElevationMap();
     }
   }
@@ -418,6 +615,112 @@ void ElevationMapping::pointCloudCallback(const sensor_msgs::PointCloud2ConstPtr
   resetMapUpdateTimer();
 }
 
+std::size_t ElevationMapping::decimatePointCloud(std::size_t pointBudget, PointCloudType& pointCloud) {
+  if (pointCloud.size() <= pointBudget) {
+    return pointCloud.size();
+  }
+  // Keep evenly spaced points, the points are ordered by the sensor.
+  const std::size_t stride = (pointCloud.size() + pointBudget - 1) / pointBudget;
+  const std::size_t numberOfPoints = (pointCloud.size() + stride - 1) / stride;
+  if (pointCloud.height > 1) {
+    // The sensor models of organized point clouds use the pixel of a point, so the other points are invalidated instead of
+    // removed. The sensor processor rejects them first.
+    const float invalid = std::numeric_limits<float>::quiet_NaN();
+    for (std::size_t i = 0; i < pointCloud.size(); ++i) {
+      if (i % stride != 0) {
+        pointCloud.points[i].x = invalid;  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      }
+    }
+    pointCloud.is_dense = false;
+    return numberOfPoints;
+  }
+  for (std::size_t i = 0; i < numberOfPoints; ++i) {
+    pointCloud.points[i] = pointCloud.points[i * stride];
+  }
+  pointCloud.points.resize(numberOfPoints);
+  pointCloud.width = static_cast<uint32_t>(numberOfPoints);
+  return numberOfPoints;
+}
+
+void ElevationMapping::reportIntegration(const ProcessedPointClouds& processedPointClouds, double integrationDuration) {
+  if (!inputScheduler_.isEnabled()) {
+    return;
+  }
+  std::size_t totalNumberOfPoints = 0;
+  for (const auto& processedPointCloud : processedPointClouds) {
+    totalNumberOfPoints += processedPointCloud.scanBuffers->pointCloudMapFrame->size();
+  }
+  // The integration time of a batch is shared by its point clouds in proportion to their integrated points.
+  const ros::Time now = ros::Time::now();
+  for (const auto& processedPointCloud : processedPointClouds) {
+    const std::size_t numberOfPoints = processedPointCloud.scanBuffers->pointCloudMapFrame->size();
+    const double integrationShare = totalNumberOfPoints > 0 ? integrationDuration * static_cast<double>(numberOfPoints) /
+                                                                  static_cast<double>(totalNumberOfPoints)
+                                                            : 0.0;
+    inputScheduler_.reportIntegration(processedPointCloud.sensorProcessor->getSourceName(), processedPointCloud.numberOfProcessedPoints,
+                                      processedPointCloud.processingDuration, numberOfPoints, integrationShare,
+                                      (now - processedPointCloud.timeStamp).toSec(), now.toSec());
+  }
+}
+
+void ElevationMapping::integratePointCloudsInBatches(ProcessedPointClouds& processedPointClouds) {
+  std::sort(processedPointClouds.begin(), processedPointClouds.end(),
+            [](const ProcessedPointCloud& a, const ProcessedPointCloud& b) { return a.timeStamp < b.timeStamp; });
+  auto batchBegin = processedPointClouds.begin();
+  while (batchBegin != processedPointClouds.end()) {
+    const ros::Time batchEndTime = batchBegin->timeStamp + timeTolerance_;
+    const auto batchEnd = std::find_if(batchBegin, processedPointClouds.end(),
+                                       [&](const ProcessedPointCloud& other) { return other.timeStamp > batchEndTime; });
+    ProcessedPointClouds batch(std::make_move_iterator(batchBegin), std::make_move_iterator(batchEnd));
+    integratePointClouds(batch);
+    batchBegin = batchEnd;
+  }
+}
+
+void ElevationMapping::queuePointCloudForIntegration(ProcessedPointCloud&& processedPointCloud) {
+  {
+    boost::mutex::scoped_lock lock(integrationQueueMutex_);
+    if (isStoppingIntegration_) {
+      return;
+    }
+    auto pending = std::find_if(integrationQueue_.begin(), integrationQueue_.end(), [&](const ProcessedPointCloud& queued) {
+      return queued.sensorProcessor == processedPointCloud.sensorProcessor;
+    });
+    if (pending != integrationQueue_.end()) {
+      ROS_WARN_THROTTLE(5, "Integration of the point clouds is too slow, dropping an older point cloud. (Throttled 5s)");
+      map_.getPipelineStatistics().addDroppedFrames(pending->sensorProcessor->getSourceName());
+      *pending = std::move(processedPointCloud);
+    } else {
+      integrationQueue_.push_back(std::move(processedPointCloud));
+    }
+    map_.getPipelineStatistics().setQueueDepth("map", "integration", integrationQueue_.size());
+  }
+  integrationQueueCondition_.notify_one();
+}
+
+void ElevationMapping::runIntegrationThread() {
+  while (true) {
+    ProcessedPointClouds batch;
+    {
+      boost::mutex::scoped_lock lock(integrationQueueMutex_);
+      integrationQueueCondition_.wait(lock, [this]() { return isStoppingIntegration_ || !integrationQueue_.empty(); });
+      if (isStoppingIntegration_) {
+        return;
+      }
+      // Integrate the oldest point cloud first, together with the ones within the time tolerance.
+      std::sort(integrationQueue_.begin(), integrationQueue_.end(),
+                [](const ProcessedPointCloud& a, const ProcessedPointCloud& b) { return a.timeStamp < b.timeStamp; });
+      const ros::Time batchEndTime = integrationQueue_.front().timeStamp + timeTolerance_;
+      const auto batchEnd = std::find_if(integrationQueue_.begin(), integrationQueue_.end(),
+                                         [&](const ProcessedPointCloud& queued) { return queued.timeStamp > batchEndTime; });
+      batch.assign(std::make_move_iterator(integrationQueue_.begin()), std::make_move_iterator(batchEnd));
+      integrationQueue_.erase(integrationQueue_.begin(), batchEnd);
+      map_.getPipelineStatistics().setQueueDepth("map", "integration", integrationQueue_.size());
+    }
+    integratePointClouds(batch);
+  }
+}
+
 void ElevationMapping::mapUpdateTimerCallback(const ros::TimerEvent&) {
   if (!updatesEnabled_) {
     ROS_WARN_THROTTLE(10, "Updating of elevation map is disabled. (Warning message is throttled, 10s.)");
@@ -427,12 +730,12 @@ void ElevationMapping::mapUpdateTimerCallback(const ros::TimerEvent&) {
   }
 
   ros::Time time = ros::Time::now();
-  if ((lastPointCloudUpdateTime_ - time) <= maxNoUpdateDuration_) {  // there were updates from sensordata, no need to force an update.
+  if ((getLastPointCloudUpdateTime() - time) <= maxNoUpdateDuration_) {  // there were updates from sensordata, no need to force an update.
     return;
   }
   ROS_WARN_THROTTLE(5, "Elevation map is updated without data from the sensor. (Warning message is throttled, 5s.)");
 
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getRawDataMutex());
+  PipelineStatistics::ScopedLock scopedLock(map_.getRawDataMutex(), &map_.getPipelineStatistics(), "raw_map");
 
   stopMapUpdateTimer();
 
@@ -442,11 +745,12 @@ void ElevationMapping::mapUpdateTimerCallback(const ros::TimerEvent&) {
     resetMapUpdateTimer();
     return;
   }
+  scopedLock.unlock();
 
   // Publish elevation map.
   map_.postprocessAndPublishRawElevationMap();
   if (isFusingEnabled()) {
-    map_.fuseAll();
+    map_.fuseWithinTimeBudget();
     map_.publishFusedElevationMap();
   }
 
@@ -458,24 +762,48 @@ void ElevationMapping::publishFusedMapCallback(const ros::TimerEvent&) {
     return;
   }
   ROS_DEBUG("Elevation map is fused and published from timer.");
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getFusedDataMutex());
-  map_.fuseAll();
+  PipelineStatistics::ScopedLock scopedLock(map_.getFusedDataMutex(), &map_.getPipelineStatistics(), "fused_map");
+  map_.fuseWithinTimeBudget();
   map_.publishFusedElevationMap();
 }
 
 void ElevationMapping::visibilityCleanupCallback(const ros::TimerEvent&) {
   ROS_DEBUG("Elevation map is running visibility cleanup.");
   // Copy constructors for thread-safety.
-  map_.visibilityCleanup(ros::Time(lastPointCloudUpdateTime_));
+  map_.visibilityCleanup(getLastPointCloudUpdateTime());
 }
 
 bool ElevationMapping::fuseEntireMapServiceCallback(std_srvs::Empty::Request&, std_srvs::Empty::Response&) {
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getFusedDataMutex());
+  PipelineStatistics::ScopedLock scopedLock(map_.getFusedDataMutex(), &map_.getPipelineStatistics(), "fused_map");
   map_.fuseAll();
   map_.publishFusedElevationMap();
   return true;
 }
 
+void ElevationMapping::snapshotCheckpointCallback(const ros::TimerEvent&) {
+  ROS_DEBUG("Elevation map is written to the snapshot file.");
+  map_.saveSnapshot(snapshotFile_);
+}
+
+void ElevationMapping::publishDiagnosticsCallback(const ros::TimerEvent&) {
+  if (diagnosticsPublisher_.getNumSubscribers() < 1) {
+    return;
+  }
+  diagnostic_msgs::DiagnosticArray message;
+  message.header.stamp = ros::Time::now();
+  map_.getPipelineStatistics().getStatus(ros::this_node::getName() + ": ", message.status);
+  diagnosticsPublisher_.publish(message);
+}
+
+bool ElevationMapping::getPipelineStatisticsServiceCallback(GetPipelineStatistics::Request& request,
+                                                            GetPipelineStatistics::Response& response) {
+  map_.getPipelineStatistics().getStatus(ros::this_node::getName() + ": ", response.status);
+  if (request.reset) {
+    map_.getPipelineStatistics().reset();
+  }
+  return true;
+}
+
 bool ElevationMapping::isFusingEnabled() {
   return isContinuouslyFusing_ && map_.hasFusedMapSubscribers();
 }
@@ -500,11 +828,12 @@ bool ElevationMapping::updatePrediction(const ros::Time& time) {
   boost::shared_ptr<geometry_msgs::PoseWithCovarianceStamped const> poseMessage = robotPoseCache_.getElemBeforeTime(time);
   if (!poseMessage) {
     // Tell the user that either for the timestamp no pose is available or that the buffer is possibly empty
-    if (robotPoseCache_.getOldestTime().toSec() > lastPointCloudUpdateTime_.toSec()) {
+    const ros::Time lastPointCloudUpdateTime = getLastPointCloudUpdateTime();
+    if (robotPoseCache_.getOldestTime().toSec() > lastPointCloudUpdateTime.toSec()) {
       ROS_ERROR("The oldest pose available is at %f, requested pose at %f", robotPoseCache_.getOldestTime().toSec(),
-                lastPointCloudUpdateTime_.toSec());
+                lastPointCloudUpdateTime.toSec());
     } else {
-      ROS_ERROR("Could not get pose information from robot for time %f. Buffer empty?", lastPointCloudUpdateTime_.toSec());
+      ROS_ERROR("Could not get pose information from robot for time %f. Buffer empty?", lastPointCloudUpdateTime.toSec());
     }
     return false;
   }
@@ -516,6 +845,7 @@ bool ElevationMapping::updatePrediction(const ros::Time& time) {
       Eigen::Map<const Eigen::Matrix<double, 6, 6, Eigen::RowMajor>>(poseMessage->pose.covariance.data(), 6, 6);
 
   // Compute map variance update from motion prediction.
+  PipelineStatistics::ScopedTimer timer(&map_.getPipelineStatistics(), "map", PipelineStage::Prediction);
   robotMotionMapUpdater_.update(map_, robotPose, robotPoseCovariance, time);
 
   return true;
@@ -540,6 +870,7 @@ bool ElevationMapping::updateMapLocation() {
   kindr::Position3D position3d;
   kindr_ros::convertFromRosGeometryMsg(trackPointTransformed.point, position3d);
   grid_map::Position position = position3d.vector().head(2);
+  PipelineStatistics::ScopedTimer timer(&map_.getPipelineStatistics(), "map", PipelineStage::Move);
   map_.move(position);
   return true;
 }
@@ -550,40 +881,32 @@ bool ElevationMapping::getFusedSubmapServiceCallback(grid_map_msgs::GetGridMap::
   grid_map::Length requestedSubmapLength(request.length_x, request.length_y);
   ROS_DEBUG("Elevation submap request: Position x=%f, y=%f, Length x=%f, y=%f.", requestedSubmapPosition.x(), requestedSubmapPosition.y(),
             requestedSubmapLength(0), requestedSubmapLength(1));
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getFusedDataMutex());
-  map_.fuseArea(requestedSubmapPosition, requestedSubmapLength);
-
-  bool isSuccess;
-  grid_map::Index index;
-  grid_map::GridMap subMap = map_.getFusedGridMap().getSubmap(requestedSubmapPosition, requestedSubmapLength, index, isSuccess);
-  scopedLock.unlock();
-
-  if (request.layers.empty()) {
-    grid_map::GridMapRosConverter::toMessage(subMap, response.map);
-  } else {
-    std::vector<std::string> layers;
-    for (const std::string& layer : request.layers) {
-      layers.push_back(layer);
-    }
-    grid_map::GridMapRosConverter::toMessage(subMap, layers, response.map);
-  }
+  const bool isSuccess = map_.getFusedSubmap(requestedSubmapPosition, requestedSubmapLength, request.layers, response.map);
 
   ROS_DEBUG("Elevation submap responded with timestamp %f.", map_.getTimeOfLastFusion().toSec());
   return isSuccess;
 }
 
+bool ElevationMapping::getSubmapOfLevelServiceCallback(GetSubmapOfLevel::Request& request, GetSubmapOfLevel::Response& response) {
+  grid_map::Position requestedSubmapPosition(request.position_x, request.position_y);
+  grid_map::Length requestedSubmapLength(request.length_x, request.length_y);
+  ROS_DEBUG("Elevation submap request of level %i: Position x=%f, y=%f, Length x=%f, y=%f.", request.level, requestedSubmapPosition.x(),
+            requestedSubmapPosition.y(), requestedSubmapLength(0), requestedSubmapLength(1));
+  return map_.getFusedSubmapOfLevel(request.level, requestedSubmapPosition, requestedSubmapLength, request.layers, response.map);
+}
+
 bool ElevationMapping::getRawSubmapServiceCallback(grid_map_msgs::GetGridMap::Request& request,
                                                    grid_map_msgs::GetGridMap::Response& response) {
   grid_map::Position requestedSubmapPosition(request.position_x, request.position_y);
   grid_map::Length requestedSubmapLength(request.length_x, request.length_y);
   ROS_DEBUG("Elevation raw submap request: Position x=%f, y=%f, Length x=%f, y=%f.", requestedSubmapPosition.x(),
             requestedSubmapPosition.y(), requestedSubmapLength(0), requestedSubmapLength(1));
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getRawDataMutex());
+  // Read from the latest snapshot, which does not wait for the integration of a point cloud.
+  const std::shared_ptr<const grid_map::GridMap> rawMapSnapshot = map_.getLatestRawMapSnapshot();
 
   bool isSuccess;
   grid_map::Index index;
-  grid_map::GridMap subMap = map_.getRawGridMap().getSubmap(requestedSubmapPosition, requestedSubmapLength, index, isSuccess);
-  scopedLock.unlock();
+  grid_map::GridMap subMap = rawMapSnapshot->getSubmap(requestedSubmapPosition, requestedSubmapLength, index, isSuccess);
 
   if (request.layers.empty()) {
     grid_map::GridMapRosConverter::toMessage(subMap, response.map);
@@ -656,47 +979,8 @@ bool ElevationMapping::maskedReplaceServiceCallback(grid_map_msgs::SetGridMap::R
   grid_map::GridMap sourceMap;
   grid_map::GridMapRosConverter::fromMessage(request.map, sourceMap);
 
-  // Use the supplied mask or do not use a mask
-  grid_map::Matrix mask;
-  if (sourceMap.exists(maskedReplaceServiceMaskLayerName_)) {
-    mask = sourceMap[maskedReplaceServiceMaskLayerName_];
-  } else {
-    mask = Eigen::MatrixXf::Ones(sourceMap.getSize()(0), sourceMap.getSize()(1));
-  }
-
-  boost::recursive_mutex::scoped_lock scopedLockRawData(map_.getRawDataMutex());
-
-  // Loop over all layers that should be set
-  for (auto sourceLayerIterator = sourceMap.getLayers().begin(); sourceLayerIterator != sourceMap.getLayers().end();
-       sourceLayerIterator++) {
-    // skip "mask" layer
-    if (*sourceLayerIterator == maskedReplaceServiceMaskLayerName_) {
-      continue;
-    }
-    grid_map::Matrix& sourceLayer = sourceMap[*sourceLayerIterator];
-    // Check if the layer exists in the elevation map
-    if (map_.getRawGridMap().exists(*sourceLayerIterator)) {
-      grid_map::Matrix& destinationLayer = map_.getRawGridMap()[*sourceLayerIterator];
-      for (grid_map::GridMapIterator destinationIterator(map_.getRawGridMap()); !destinationIterator.isPastEnd(); ++destinationIterator) {
-        // Use the position to find corresponding indices in source and destination
-        const grid_map::Index destinationIndex(*destinationIterator);
-        grid_map::Position position;
-        map_.getRawGridMap().getPosition(*destinationIterator, position);
-
-        if (!sourceMap.isInside(position)) {
-          continue;
-        }
-
-        grid_map::Index sourceIndex;
-        sourceMap.getIndex(position, sourceIndex);
-        // If the mask allows it, set the value from source to destination
-        if (!std::isnan(mask(sourceIndex(0), sourceIndex(1)))) {
-          destinationLayer(destinationIndex(0), destinationIndex(1)) = sourceLayer(sourceIndex(0), sourceIndex(1));
-        }
-      }
-    } else {
-      ROS_ERROR("Masked replace service: Layer %s does not exist!", sourceLayerIterator->c_str());
-    }
+  for (const std::string& layer : map_.maskedReplace(sourceMap, maskedReplaceServiceMaskLayerName_)) {
+    ROS_ERROR("Masked replace service: Layer %s does not exist!", layer.c_str());
   }
 
   return true;
@@ -705,7 +989,7 @@ bool ElevationMapping::maskedReplaceServiceCallback(grid_map_msgs::SetGridMap::R
 bool ElevationMapping::saveMapServiceCallback(grid_map_msgs::ProcessFile::Request& request,
                                               grid_map_msgs::ProcessFile::Response& response) {
   ROS_INFO("Saving map to file.");
-  boost::recursive_mutex::scoped_lock scopedLock(map_.getFusedDataMutex());
+  PipelineStatistics::ScopedLock scopedLock(map_.getFusedDataMutex(), &map_.getPipelineStatistics(), "fused_map");
   map_.fuseAll();
   std::string topic = nodeHandle_.getNamespace() + "/elevation_map";
   if (!request.topic_name.empty()) {
@@ -713,7 +997,7 @@ bool ElevationMapping::saveMapServiceCallback(grid_map_msgs::ProcessFile::Reques
   }
   response.success = static_cast<unsigned char>(grid_map::GridMapRosConverter::saveToBag(map_.getFusedGridMap(), request.file_path, topic));
   response.success = static_cast<unsigned char>(
-      (grid_map::GridMapRosConverter::saveToBag(map_.getRawGridMap(), request.file_path + "_raw", topic + "_raw")) &&
+      (grid_map::GridMapRosConverter::saveToBag(*map_.getRawMapSnapshot(), request.file_path + "_raw", topic + "_raw")) &&
       static_cast<bool>(response.success));
   return static_cast<bool>(response.success);
 }
@@ -721,8 +1005,8 @@ bool ElevationMapping::saveMapServiceCallback(grid_map_msgs::ProcessFile::Reques
 bool ElevationMapping::loadMapServiceCallback(grid_map_msgs::ProcessFile::Request& request,
                                               grid_map_msgs::ProcessFile::Response& response) {
   ROS_WARN("Loading from bag file.");
-  boost::recursive_mutex::scoped_lock scopedLockFused(map_.getFusedDataMutex());
-  boost::recursive_mutex::scoped_lock scopedLockRaw(map_.getRawDataMutex());
+  PipelineStatistics::ScopedLock scopedLockFused(map_.getFusedDataMutex(), &map_.getPipelineStatistics(), "fused_map");
+  PipelineStatistics::ScopedLock scopedLockRaw(map_.getRawDataMutex(), &map_.getPipelineStatistics(), "raw_map");
 
   std::string topic = nodeHandle_.getNamespace();
   if (!request.topic_name.empty()) {
@@ -731,11 +1015,23 @@ bool ElevationMapping::loadMapServiceCallback(grid_map_msgs::ProcessFile::Reques
     topic += "/elevation_map";
   }
 
-  response.success =
-      static_cast<unsigned char>(grid_map::GridMapRosConverter::loadFromBag(request.file_path, topic, map_.getFusedGridMap()));
-  response.success = static_cast<unsigned char>(
-      grid_map::GridMapRosConverter::loadFromBag(request.file_path + "_raw", topic + "_raw", map_.getRawGridMap()) &&
-      static_cast<bool>(response.success));
+  // The raw map is set as a whole, such that the state depending on its size and layers is reset with it.
+  grid_map::GridMap fusedMap;
+  grid_map::GridMap rawMap;
+  const bool isFusedMapLoaded = grid_map::GridMapRosConverter::loadFromBag(request.file_path, topic, fusedMap);
+  const bool isRawMapLoaded = grid_map::GridMapRosConverter::loadFromBag(request.file_path + "_raw", topic + "_raw", rawMap);
+  if (isRawMapLoaded) {
+    map_.setRawGridMap(std::move(rawMap));
+  }
+  if (isFusedMapLoaded) {
+    const grid_map::GridMap& currentFusedMap = map_.getFusedGridMap();
+    if ((fusedMap.getSize() == currentFusedMap.getSize()).all() && fusedMap.getResolution() == currentFusedMap.getResolution()) {
+      map_.setFusedGridMap(fusedMap);
+    } else {
+      ROS_WARN("The geometry of the loaded fused map does not match the raw map, it is fused again instead.");
+    }
+  }
+  response.success = static_cast<unsigned char>(isRawMapLoaded && isFusedMapLoaded);
 
   // Update timestamp for visualization in ROS
   map_.setTimestamp(ros::Time::now());
@@ -743,7 +1039,29 @@ bool ElevationMapping::loadMapServiceCallback(grid_map_msgs::ProcessFile::Reques
   return static_cast<bool>(response.success);
 }
 
+bool ElevationMapping::saveSnapshotServiceCallback(grid_map_msgs::ProcessFile::Request& request,
+                                                   grid_map_msgs::ProcessFile::Response& response) {
+  const std::string& path = request.file_path.empty() ? snapshotFile_ : request.file_path;
+  ROS_INFO("Saving raw map snapshot to %s.", path.c_str());
+  response.success = static_cast<unsigned char>(!path.empty() && map_.saveSnapshot(path));
+  return static_cast<bool>(response.success);
+}
+
+bool ElevationMapping::loadSnapshotServiceCallback(grid_map_msgs::ProcessFile::Request& request,
+                                                   grid_map_msgs::ProcessFile::Response& response) {
+  const std::string& path = request.file_path.empty() ? snapshotFile_ : request.file_path;
+  ROS_WARN("Loading raw map snapshot from %s.", path.c_str());
+  response.success = static_cast<unsigned char>(!path.empty() && map_.loadSnapshot(path));
+  if (response.success) {
+    // Update timestamp for visualization in ROS
+    map_.setTimestamp(ros::Time::now());
+    map_.postprocessAndPublishRawElevationMap();
+  }
+  return static_cast<bool>(response.success);
+}
+
 void ElevationMapping::resetMapUpdateTimer() {
+  boost::lock_guard<boost::mutex> lock(mapUpdateTimerMutex_);
   mapUpdateTimer_.stop();
   ros::Duration periodSinceLastUpdate = ros::Time::now() - map_.getTimeOfLastUpdate();
   if (periodSinceLastUpdate > maxNoUpdateDuration_) {
@@ -754,7 +1072,13 @@ void ElevationMapping::resetMapUpdateTimer() {
 }
 
 void ElevationMapping::stopMapUpdateTimer() {
+  boost::lock_guard<boost::mutex> lock(mapUpdateTimerMutex_);
   mapUpdateTimer_.stop();
 }
 
+ros::Time ElevationMapping::getLastPointCloudUpdateTime() const {
+  boost::lock_guard<boost::mutex> lock(lastPointCloudUpdateTimeMutex_);
+  return lastPointCloudUpdateTime_;
+}
+
 }  // namespace elevation_mapping
@@ -0,0 +1,20 @@
+/*
+ * ElevationMappingNodelet.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/ElevationMappingNodelet.hpp"
+
+#include <pluginlib/class_list_macros.h>
+
+namespace elevation_mapping {
+
+void ElevationMappingNodelet::onInit() {
+  elevationMapping_ = std::make_unique<ElevationMapping>(getMTPrivateNodeHandle());
+}
+
+}  // namespace elevation_mapping
+
+PLUGINLIB_EXPORT_CLASS(elevation_mapping::ElevationMappingNodelet, nodelet::Nodelet)
@@ -0,0 +1,185 @@
+/*
+ * FusedMapPyramid.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/FusedMapPyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace {
+//! Side length (in cells) of the tiles of the fused map the modifications are tracked in.
+const int tileSize = 32;
+
+//! Layers of the fused map which are downsampled.
+const std::vector<std::string> pyramidLayers{"elevation", "upper_bound", "lower_bound"};
+}  // namespace
+
+namespace elevation_mapping {
+
+FusedMapPyramid::FusedMapPyramid(int numberOfLevels) : fusedMapSize_(0, 0), fusedMapResolution_(0.0) {
+  numberOfLevels = std::max(0, std::min(numberOfLevels, maxNumberOfLevels));
+  for (int level = 1; level <= numberOfLevels; ++level) {
+    levels_.push_back(Level{1 << level, grid_map::GridMap(pyramidLayers), CellMask()});
+    levels_.back().map.setBasicLayers(pyramidLayers);
+  }
+}
+
+void FusedMapPyramid::markModified(const grid_map::Index& topLeftIndex, const grid_map::Size& size) {
+  if (modifiedTiles_.size() == 0 || (size <= 0).any()) {
+    return;
+  }
+  grid_map::Index bufferIndex = topLeftIndex;
+  grid_map::wrapIndexToRange(bufferIndex, fusedMapSize_);
+  const std::vector<int> tileRows = getOverlappedTiles(0, std::min(size(0), fusedMapSize_(0)), fusedMapSize_(0), bufferIndex(0));
+  const std::vector<int> tileCols = getOverlappedTiles(0, std::min(size(1), fusedMapSize_(1)), fusedMapSize_(1), bufferIndex(1));
+  for (const int tileCol : tileCols) {
+    for (const int tileRow : tileRows) {
+      modifiedTiles_(tileRow, tileCol) = true;
+    }
+  }
+}
+
+void FusedMapPyramid::markAllModified() {
+  modifiedTiles_.setConstant(true);
+}
+
+void FusedMapPyramid::update(const grid_map::GridMap& fusedMap) {
+  if (levels_.empty()) {
+    return;
+  }
+  if ((fusedMap.getSize() != fusedMapSize_).any() || fusedMap.getResolution() != fusedMapResolution_) {
+    initialize(fusedMap);
+  }
+
+  for (Level& level : levels_) {
+    // The levels move in steps of their resolution, their cells stay aligned with the cells of the fused map.
+    std::vector<grid_map::BufferRegion> newRegions;
+    level.map.move(fusedMap.getPosition(), newRegions);
+    for (const auto& region : newRegions) {
+      level.staleCells.block(region.getStartIndex()(0), region.getStartIndex()(1), region.getSize()(0), region.getSize()(1))
+          .setConstant(true);
+    }
+    level.map.setFrameId(fusedMap.getFrameId());
+    level.map.setTimestamp(fusedMap.getTimestamp());
+    updateLevel(fusedMap, level);
+  }
+  modifiedTiles_.setConstant(false);
+}
+
+void FusedMapPyramid::initialize(const grid_map::GridMap& fusedMap) {
+  fusedMapSize_ = fusedMap.getSize();
+  fusedMapResolution_ = fusedMap.getResolution();
+  modifiedTiles_.setConstant((fusedMapSize_(0) + tileSize - 1) / tileSize, (fusedMapSize_(1) + tileSize - 1) / tileSize, true);
+
+  for (Level& level : levels_) {
+    // One more cell than needed to cover the fused map, such that it stays covered when the level is not centered on it.
+    const grid_map::Size size = (fusedMapSize_ + level.factor - 1) / level.factor + 1;
+    const double resolution = level.factor * fusedMapResolution_;
+
+    // The cell borders of the level are on cell borders of the fused map. With an even factor, the center of the level is
+    // on a cell border, so it is shifted by half a cell from the center of a fused map with an odd number of cells.
+    grid_map::Position position = fusedMap.getPosition();
+    for (int dimension = 0; dimension < 2; ++dimension) {
+      if (fusedMapSize_(dimension) % 2 != 0) {
+        position(dimension) += 0.5 * fusedMapResolution_;
+      }
+    }
+    level.map.setGeometry(size.cast<double>() * resolution, resolution, position);
+    level.staleCells.setConstant(size(0), size(1), true);
+  }
+}
+
+void FusedMapPyramid::updateLevel(const grid_map::GridMap& fusedMap, Level& level) const {
+  const int factor = level.factor;
+  const grid_map::Size& size = fusedMap.getSize();
+  const grid_map::Index& startIndex = fusedMap.getStartIndex();
+  const double resolution = fusedMap.getResolution();
+  const grid_map::Position topLeftCorner = fusedMap.getPosition() + 0.5 * fusedMap.getLength().matrix();
+
+  // The x position of a cell only depends on its row and the y position only on its column. For every row and column of
+  // the level, get the first (unwrapped) row or column of the fused map it covers, and the tiles of the cells it covers.
+  const grid_map::Size& levelSize = level.map.getSize();
+  std::vector<int> firstRows(levelSize(0));
+  std::vector<int> firstCols(levelSize(1));
+  std::vector<std::vector<int>> tileRows(levelSize(0));
+  std::vector<std::vector<int>> tileCols(levelSize(1));
+  grid_map::Position position;
+  for (int row = 0; row < levelSize(0); ++row) {
+    level.map.getPosition(grid_map::Index(row, 0), position);
+    const double firstCellX = position.x() + 0.5 * (factor - 1) * resolution;
+    firstRows[row] = static_cast<int>(std::lround((topLeftCorner.x() - 0.5 * resolution - firstCellX) / resolution));
+    tileRows[row] = getOverlappedTiles(firstRows[row], factor, size(0), startIndex(0));
+  }
+  for (int col = 0; col < levelSize(1); ++col) {
+    level.map.getPosition(grid_map::Index(0, col), position);
+    const double firstCellY = position.y() + 0.5 * (factor - 1) * resolution;
+    firstCols[col] = static_cast<int>(std::lround((topLeftCorner.y() - 0.5 * resolution - firstCellY) / resolution));
+    tileCols[col] = getOverlappedTiles(firstCols[col], factor, size(1), startIndex(1));
+  }
+
+  const grid_map::Matrix& elevationLayer = fusedMap["elevation"];
+  const grid_map::Matrix& upperBoundLayer = fusedMap["upper_bound"];
+  const grid_map::Matrix& lowerBoundLayer = fusedMap["lower_bound"];
+  grid_map::Matrix& levelElevationLayer = level.map["elevation"];
+  grid_map::Matrix& levelUpperBoundLayer = level.map["upper_bound"];
+  grid_map::Matrix& levelLowerBoundLayer = level.map["lower_bound"];
+  for (int col = 0; col < levelSize(1); ++col) {
+    for (int row = 0; row < levelSize(0); ++row) {
+      bool isStale = level.staleCells(row, col);
+      for (const int tileCol : tileCols[col]) {
+        for (const int tileRow : tileRows[row]) {
+          isStale = isStale || modifiedTiles_(tileRow, tileCol);
+        }
+      }
+      if (!isStale) {
+        continue;
+      }
+      level.staleCells(row, col) = false;
+
+      float elevationSum = 0.0;
+      int numberOfCells = 0;
+      float upperBound = NAN;
+      float lowerBound = NAN;
+      const int colEnd = std::min(firstCols[col] + factor, size(1));
+      const int rowEnd = std::min(firstRows[row] + factor, size(0));
+      for (int fusedCol = std::max(firstCols[col], 0); fusedCol < colEnd; ++fusedCol) {
+        const int bufferCol = (fusedCol + startIndex(1)) % size(1);
+        for (int fusedRow = std::max(firstRows[row], 0); fusedRow < rowEnd; ++fusedRow) {
+          const int bufferRow = (fusedRow + startIndex(0)) % size(0);
+          const float elevation = elevationLayer(bufferRow, bufferCol);
+          if (!std::isfinite(elevation)) {
+            continue;
+          }
+          elevationSum += elevation;
+          ++numberOfCells;
+          upperBound = std::fmax(upperBound, upperBoundLayer(bufferRow, bufferCol));
+          lowerBound = std::fmin(lowerBound, lowerBoundLayer(bufferRow, bufferCol));
+        }
+      }
+      levelElevationLayer(row, col) = numberOfCells > 0 ? elevationSum / static_cast<float>(numberOfCells) : NAN;
+      levelUpperBoundLayer(row, col) = upperBound;
+      levelLowerBoundLayer(row, col) = lowerBound;
+    }
+  }
+}
+
+std::vector<int> FusedMapPyramid::getOverlappedTiles(int firstIndex, int length, int bufferSize, int bufferStartIndex) {
+  std::vector<int> tiles;
+  const int begin = std::max(firstIndex, 0);
+  const int end = std::min(firstIndex + length, bufferSize);
+  int bufferIndex = (begin + bufferStartIndex) % bufferSize;
+  for (int remaining = end - begin; remaining > 0;) {
+    tiles.push_back(bufferIndex / tileSize);
+    const int spanLength = std::min(std::min((bufferIndex / tileSize + 1) * tileSize, bufferSize) - bufferIndex, remaining);
+    remaining -= spanLength;
+    bufferIndex = (bufferIndex + spanLength) % bufferSize;
+  }
+  return tiles;
+}
+
+}  // namespace elevation_mapping
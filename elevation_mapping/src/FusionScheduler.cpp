@@ -0,0 +1,152 @@
+/*
+ * FusionScheduler.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/FusionScheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+/*!
+ * Computes the distance between two intervals, 0 if they overlap.
+ * @param a, b the intervals [min, max].
+ * @return the distance.
+ */
+double getDistance(const Eigen::Vector2d& a, const Eigen::Vector2d& b) {
+  return std::max({0.0, a(0) - b(1), b(0) - a(1)});
+}
+
+/*!
+ * Computes the smallest distance between a set of intervals and an interval.
+ * @param intervals the intervals [min, max].
+ * @param interval the interval [min, max].
+ * @return the distance.
+ */
+double getDistance(const std::vector<Eigen::Vector2d>& intervals, const Eigen::Vector2d& interval) {
+  double distance = std::numeric_limits<double>::infinity();
+  for (const auto& other : intervals) {
+    distance = std::min(distance, getDistance(other, interval));
+  }
+  return distance;
+}
+}  // namespace
+
+namespace elevation_mapping {
+
+FusionScheduler::FusionScheduler(int tileSize, double priorityRegionDuration)
+    : tileSize_(std::max(tileSize, 1)), priorityRegionDuration_(priorityRegionDuration) {}
+
+void FusionScheduler::addPriorityRegion(const grid_map::Position& position, const grid_map::Length& length, double time) {
+  priorityRegions_.push_back({position, length, time});
+}
+
+void FusionScheduler::markAllPending(const grid_map::Size& numberOfTiles) {
+  pendingTiles_.setConstant(numberOfTiles(0), numberOfTiles(1), true);
+}
+
+void FusionScheduler::markPending(const TileMask& tiles) {
+  if (pendingTiles_.rows() != tiles.rows() || pendingTiles_.cols() != tiles.cols()) {
+    pendingTiles_.setConstant(tiles.rows(), tiles.cols(), true);
+    return;
+  }
+  pendingTiles_ = pendingTiles_ || tiles;
+}
+
+void FusionScheduler::markFused(const grid_map::Index& tile) {
+  if ((tile >= 0).all() && tile(0) < pendingTiles_.rows() && tile(1) < pendingTiles_.cols()) {
+    pendingTiles_(tile(0), tile(1)) = false;
+  }
+}
+
+bool FusionScheduler::isPending(const grid_map::Index& tile) const {
+  if ((tile < 0).any() || tile(0) >= pendingTiles_.rows() || tile(1) >= pendingTiles_.cols()) {
+    return true;
+  }
+  return pendingTiles_(tile(0), tile(1));
+}
+
+void FusionScheduler::markAllFused(const grid_map::Size& numberOfTiles) {
+  pendingTiles_.setConstant(numberOfTiles(0), numberOfTiles(1), false);
+}
+
+std::vector<grid_map::Index> FusionScheduler::getPendingTiles(const grid_map::GridMap& map, const grid_map::Position& center,
+                                                               double time) {
+  const grid_map::Size numberOfTiles = (map.getSize() + tileSize_ - 1) / tileSize_;
+  if (pendingTiles_.rows() != numberOfTiles(0) || pendingTiles_.cols() != numberOfTiles(1)) {
+    markAllPending(numberOfTiles);
+  }
+  priorityRegions_.erase(std::remove_if(priorityRegions_.begin(), priorityRegions_.end(),
+                                        [&](const PriorityRegion& region) { return time - region.time > priorityRegionDuration_; }),
+                         priorityRegions_.end());
+
+  // The extents of a tile only depend on its row and its column respectively.
+  std::vector<std::vector<Eigen::Vector2d>> rowExtents(numberOfTiles(0));
+  std::vector<std::vector<Eigen::Vector2d>> colExtents(numberOfTiles(1));
+  for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+    rowExtents[tileRow] = getTileExtents(map, tileRow, 0);
+  }
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    colExtents[tileCol] = getTileExtents(map, tileCol, 1);
+  }
+
+  struct Candidate {
+    grid_map::Index tile;
+    bool isRequested;
+    double distance;
+  };
+  std::vector<Candidate> candidates;
+  for (int tileCol = 0; tileCol < numberOfTiles(1); ++tileCol) {
+    for (int tileRow = 0; tileRow < numberOfTiles(0); ++tileRow) {
+      if (!pendingTiles_(tileRow, tileCol)) {
+        continue;
+      }
+      const std::vector<Eigen::Vector2d>& xExtents = rowExtents[tileRow];
+      const std::vector<Eigen::Vector2d>& yExtents = colExtents[tileCol];
+      const bool isRequested = std::any_of(priorityRegions_.begin(), priorityRegions_.end(), [&](const PriorityRegion& region) {
+        const Eigen::Vector2d halfLength = 0.5 * region.length.matrix();
+        return getDistance(xExtents, Eigen::Vector2d(region.position.x() - halfLength.x(), region.position.x() + halfLength.x())) == 0.0 &&
+               getDistance(yExtents, Eigen::Vector2d(region.position.y() - halfLength.y(), region.position.y() + halfLength.y())) == 0.0;
+      });
+      const double distance = std::hypot(getDistance(xExtents, Eigen::Vector2d::Constant(center.x())),
+                                         getDistance(yExtents, Eigen::Vector2d::Constant(center.y())));
+      candidates.push_back({grid_map::Index(tileRow, tileCol), isRequested, distance});
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+    if (a.isRequested != b.isRequested) {
+      return a.isRequested;
+    }
+    return a.distance < b.distance;
+  });
+
+  std::vector<grid_map::Index> tiles;
+  tiles.reserve(candidates.size());
+  for (const auto& candidate : candidates) {
+    tiles.push_back(candidate.tile);
+  }
+  return tiles;
+}
+
+std::vector<Eigen::Vector2d> FusionScheduler::getTileExtents(const grid_map::GridMap& map, int tile, int dimension) const {
+  const int bufferSize = map.getSize()(dimension);
+  const int firstBufferIndex = tile * tileSize_;
+  const int numberOfCells = std::min(tileSize_, bufferSize - firstBufferIndex);
+  // Index of the first cell of the tile in the map, counted from the border at the largest position.
+  const int firstIndex = (firstBufferIndex - map.getStartIndex()(dimension) + bufferSize) % bufferSize;
+  const double resolution = map.getResolution();
+  const double maxPosition = map.getPosition()(dimension) + 0.5 * map.getLength()(dimension);
+  const auto getExtent = [&](int first, int last) {
+    return Eigen::Vector2d(maxPosition - (last + 1) * resolution, maxPosition - first * resolution);
+  };
+  if (firstIndex + numberOfCells <= bufferSize) {
+    return {getExtent(firstIndex, firstIndex + numberOfCells - 1)};
+  }
+  return {getExtent(firstIndex, bufferSize - 1), getExtent(0, firstIndex + numberOfCells - 1 - bufferSize)};
+}
+
+}  // namespace elevation_mapping
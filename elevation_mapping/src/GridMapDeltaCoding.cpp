@@ -0,0 +1,305 @@
+/*
+ * GridMapDeltaCoding.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/GridMapDeltaCoding.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// ROS
+#include <ros/ros.h>
+
+namespace {
+//! Code of an empty cell in a quantized layer.
+const uint16_t emptyCode = std::numeric_limits<uint16_t>::max();
+
+//! Approximate size of the fields of a tile message besides the cell data [bytes].
+const std::size_t tileMessageOverhead = 32;
+
+/*!
+ * @return true if both values are equal or both are empty.
+ */
+bool isEqual(float value, float otherValue) {
+  return value == otherValue || (std::isnan(value) && std::isnan(otherValue));
+}
+
+/*!
+ * @return true if the value is one of the values.
+ */
+bool contains(const std::vector<std::string>& values, const std::string& value) {
+  return std::find(values.begin(), values.end(), value) != values.end();
+}
+}  // namespace
+
+namespace elevation_mapping {
+
+GridMapDeltaEncoder::GridMapDeltaEncoder(int tileSize, std::vector<std::string> layers, std::vector<std::string> quantizedLayers,
+                                         int keyframeInterval, std::size_t maxMessageSize)
+    : tileSize_(std::max(tileSize, 1)),
+      configuredLayers_(std::move(layers)),
+      quantizedLayers_(std::move(quantizedLayers)),
+      keyframeInterval_(std::max(keyframeInterval, 0)),
+      maxMessageSize_(maxMessageSize),
+      sequence_(0),
+      numberOfMessagesSinceKeyframe_(0),
+      isKeyframeRequested_(true),
+      firstTile_(0) {}
+
+bool GridMapDeltaEncoder::encode(const grid_map::GridMap& map, GridMapDelta& message) {
+  std::vector<std::string> layers = configuredLayers_;
+  if (layers.empty()) {
+    for (const auto& layer : map.getLayers()) {
+      if (!contains(quantizedLayers_, layer)) {
+        layers.push_back(layer);
+      }
+    }
+  }
+  std::vector<std::string> allLayers = layers;
+  allLayers.insert(allLayers.end(), quantizedLayers_.begin(), quantizedLayers_.end());
+  for (const auto& layer : allLayers) {
+    if (!map.exists(layer)) {
+      ROS_ERROR_THROTTLE(10.0, "Cannot encode the grid map delta, the map has no layer %s.", layer.c_str());
+      return false;
+    }
+  }
+
+  const bool isKeyframe = isKeyframeRequested_ || (keyframeInterval_ > 0 && numberOfMessagesSinceKeyframe_ >= keyframeInterval_) ||
+                          layers != layers_ || sentMap_.getFrameId() != map.getFrameId() ||
+                          sentMap_.getResolution() != map.getResolution() || (sentMap_.getSize() != map.getSize()).any();
+  if (isKeyframe) {
+    // Compare against an empty map, such that all non-empty tiles are sent.
+    sentMap_ = grid_map::GridMap(allLayers);
+    sentMap_.setGeometry(map.getLength(), map.getResolution(), map.getPosition());
+    sentMap_.setFrameId(map.getFrameId());
+    layers_ = layers;
+    isKeyframeRequested_ = false;
+    numberOfMessagesSinceKeyframe_ = 0;
+    firstTile_ = 0;
+  } else if (sentMap_.getPosition() != map.getPosition()) {
+    // Moving clears the cells which entered the map, like on the receiving side.
+    sentMap_.move(map.getPosition());
+  }
+
+  message.info.header.frame_id = map.getFrameId();
+  message.info.header.stamp.fromNSec(map.getTimestamp());
+  message.info.resolution = map.getResolution();
+  message.info.length_x = map.getLength().x();
+  message.info.length_y = map.getLength().y();
+  message.info.pose.position.x = map.getPosition().x();
+  message.info.pose.position.y = map.getPosition().y();
+  message.info.pose.position.z = 0.0;
+  message.info.pose.orientation.x = 0.0;
+  message.info.pose.orientation.y = 0.0;
+  message.info.pose.orientation.z = 0.0;
+  message.info.pose.orientation.w = 1.0;
+  message.sequence = sequence_++;
+  message.keyframe = isKeyframe;
+  message.layers = layers_;
+  message.quantized_layers = quantizedLayers_;
+  message.basic_layers.clear();
+  for (const auto& layer : map.getBasicLayers()) {
+    if (contains(allLayers, layer)) {
+      message.basic_layers.push_back(layer);
+    }
+  }
+  message.tiles.clear();
+
+  const grid_map::Size size = map.getSize();
+  const std::size_t numberOfTileRows = (size(0) + tileSize_ - 1) / tileSize_;
+  const std::size_t numberOfTiles = numberOfTileRows * ((size(1) + tileSize_ - 1) / tileSize_);
+  const std::size_t bytesPerCell = layers_.size() * sizeof(float) + quantizedLayers_.size() * sizeof(uint16_t);
+  std::size_t messageSize = 0;
+  std::size_t tile = 0;
+  for (; tile < numberOfTiles; ++tile) {
+    const std::size_t tileNumber = (firstTile_ + tile) % numberOfTiles;
+    const grid_map::Index tileIndex(static_cast<int>(tileNumber % numberOfTileRows) * tileSize_,
+                                    static_cast<int>(tileNumber / numberOfTileRows) * tileSize_);
+    const grid_map::Size tileSize = (size - tileIndex).min(tileSize_);
+    if (!hasTileChanged(map, tileIndex, tileSize)) {
+      continue;
+    }
+    const std::size_t tileMessageSize = tileSize.prod() * bytesPerCell + quantizedLayers_.size() * 2 * sizeof(float) + tileMessageOverhead;
+    if (!isKeyframe && maxMessageSize_ > 0 && !message.tiles.empty() && messageSize + tileMessageSize > maxMessageSize_) {
+      break;
+    }
+    messageSize += tileMessageSize;
+    message.tiles.emplace_back();
+    encodeTile(map, tileIndex, tileSize, message.tiles.back());
+  }
+  if (numberOfTiles > 0) {
+    firstTile_ = (firstTile_ + tile) % numberOfTiles;
+  }
+  ++numberOfMessagesSinceKeyframe_;
+  return true;
+}
+
+void GridMapDeltaEncoder::requestKeyframe() {
+  isKeyframeRequested_ = true;
+}
+
+bool GridMapDeltaEncoder::hasTileChanged(const grid_map::GridMap& map, const grid_map::Index& tileIndex,
+                                         const grid_map::Size& tileSize) const {
+  for (const auto& layer : sentMap_.getLayers()) {
+    const grid_map::Matrix& data = map[layer];
+    const grid_map::Matrix& sentData = sentMap_[layer];
+    for (int column = 0; column < tileSize(1); ++column) {
+      for (int row = 0; row < tileSize(0); ++row) {
+        const grid_map::Index index = tileIndex + grid_map::Index(row, column);
+        const grid_map::Index bufferIndex = grid_map::getBufferIndexFromIndex(index, map.getSize(), map.getStartIndex());
+        const grid_map::Index sentBufferIndex = grid_map::getBufferIndexFromIndex(index, sentMap_.getSize(), sentMap_.getStartIndex());
+        if (!isEqual(data(bufferIndex(0), bufferIndex(1)), sentData(sentBufferIndex(0), sentBufferIndex(1)))) {
+          return true;
+        }
+      }
+    }
+  }
+  return false;
+}
+
+void GridMapDeltaEncoder::encodeTile(const grid_map::GridMap& map, const grid_map::Index& tileIndex, const grid_map::Size& tileSize,
+                                     GridMapDeltaTile& tile) {
+  tile.row = tileIndex(0);
+  tile.column = tileIndex(1);
+  tile.rows = tileSize(0);
+  tile.columns = tileSize(1);
+  const std::size_t numberOfCells = tileSize.prod();
+
+  // Copies the cells of a layer in column-major order and remembers them as sent.
+  auto copyCells = [&](const std::string& layer, float* values) {
+    const grid_map::Matrix& data = map[layer];
+    grid_map::Matrix& sentData = sentMap_[layer];
+    for (int column = 0; column < tileSize(1); ++column) {
+      for (int row = 0; row < tileSize(0); ++row) {
+        const grid_map::Index index = tileIndex + grid_map::Index(row, column);
+        const grid_map::Index bufferIndex = grid_map::getBufferIndexFromIndex(index, map.getSize(), map.getStartIndex());
+        const grid_map::Index sentBufferIndex = grid_map::getBufferIndexFromIndex(index, sentMap_.getSize(), sentMap_.getStartIndex());
+        const float value = data(bufferIndex(0), bufferIndex(1));
+        sentData(sentBufferIndex(0), sentBufferIndex(1)) = value;
+        *values++ = value;
+      }
+    }
+  };
+
+  tile.data.resize(layers_.size() * numberOfCells);
+  for (std::size_t i = 0; i < layers_.size(); ++i) {
+    copyCells(layers_[i], tile.data.data() + i * numberOfCells);
+  }
+
+  tile.offsets.clear();
+  tile.scales.clear();
+  tile.quantized_data.resize(quantizedLayers_.size() * numberOfCells);
+  std::vector<float> values(numberOfCells);
+  for (std::size_t i = 0; i < quantizedLayers_.size(); ++i) {
+    copyCells(quantizedLayers_[i], values.data());
+    float minValue = std::numeric_limits<float>::infinity();
+    float maxValue = -std::numeric_limits<float>::infinity();
+    for (const float value : values) {
+      if (std::isfinite(value)) {
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+      }
+    }
+    const float offset = std::isfinite(minValue) ? minValue : 0.0f;
+    const float scale = std::isfinite(minValue) ? (maxValue - minValue) / (emptyCode - 1) : 0.0f;
+    tile.offsets.push_back(offset);
+    tile.scales.push_back(scale);
+    uint16_t* codes = tile.quantized_data.data() + i * numberOfCells;
+    for (const float value : values) {
+      if (!std::isfinite(value)) {
+        *codes++ = emptyCode;
+      } else {
+        *codes++ = scale > 0.0f ? static_cast<uint16_t>(std::lround((value - offset) / scale)) : 0;
+      }
+    }
+  }
+}
+
+GridMapDeltaDecoder::GridMapDeltaDecoder() : hasMap_(false), sequence_(0) {}
+
+bool GridMapDeltaDecoder::decode(const GridMapDelta& message) {
+  const grid_map::Position position(message.info.pose.position.x, message.info.pose.position.y);
+  if (message.keyframe) {
+    std::vector<std::string> layers = message.layers;
+    layers.insert(layers.end(), message.quantized_layers.begin(), message.quantized_layers.end());
+    map_ = grid_map::GridMap(layers);
+    map_.setGeometry(grid_map::Length(message.info.length_x, message.info.length_y), message.info.resolution, position);
+    hasMap_ = true;
+  } else if (!hasMap_ || message.sequence != sequence_ + 1) {
+    if (hasMap_) {
+      ROS_WARN("Missed a grid map delta message, waiting for the next keyframe.");
+      hasMap_ = false;
+    }
+    return false;
+  } else if (position != map_.getPosition()) {
+    map_.move(position);
+  }
+  sequence_ = message.sequence;
+  map_.setFrameId(message.info.header.frame_id);
+  map_.setTimestamp(message.info.header.stamp.toNSec());
+  map_.setBasicLayers(message.basic_layers);
+
+  for (const auto& tile : message.tiles) {
+    if (!decodeTile(message, tile)) {
+      ROS_ERROR("Received an invalid grid map delta message, waiting for the next keyframe.");
+      hasMap_ = false;
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GridMapDeltaDecoder::decodeTile(const GridMapDelta& message, const GridMapDeltaTile& tile) {
+  const grid_map::Size& size = map_.getSize();
+  const std::size_t numberOfCells = static_cast<std::size_t>(tile.rows) * tile.columns;
+  const std::size_t numberOfQuantizedLayers = message.quantized_layers.size();
+  if (tile.row < 0 || tile.column < 0 || tile.rows < 1 || tile.columns < 1 || tile.row + tile.rows > size(0) ||
+      tile.column + tile.columns > size(1) || tile.data.size() != message.layers.size() * numberOfCells ||
+      tile.quantized_data.size() != numberOfQuantizedLayers * numberOfCells || tile.offsets.size() != numberOfQuantizedLayers ||
+      tile.scales.size() != numberOfQuantizedLayers) {
+    return false;
+  }
+  for (const auto& layer : message.layers) {
+    if (!map_.exists(layer)) {
+      return false;
+    }
+  }
+  for (const auto& layer : message.quantized_layers) {
+    if (!map_.exists(layer)) {
+      return false;
+    }
+  }
+
+  // Writes the cells of a layer from column-major order.
+  auto writeCells = [&](const std::string& layer, auto getValue) {
+    grid_map::Matrix& data = map_[layer];
+    std::size_t cell = 0;
+    for (int column = 0; column < tile.columns; ++column) {
+      for (int row = 0; row < tile.rows; ++row) {
+        const grid_map::Index index(tile.row + row, tile.column + column);
+        const grid_map::Index bufferIndex = grid_map::getBufferIndexFromIndex(index, size, map_.getStartIndex());
+        data(bufferIndex(0), bufferIndex(1)) = getValue(cell++);
+      }
+    }
+  };
+
+  for (std::size_t i = 0; i < message.layers.size(); ++i) {
+    const float* values = tile.data.data() + i * numberOfCells;
+    writeCells(message.layers[i], [values](std::size_t cell) { return values[cell]; });
+  }
+  for (std::size_t i = 0; i < numberOfQuantizedLayers; ++i) {
+    const uint16_t* codes = tile.quantized_data.data() + i * numberOfCells;
+    const float offset = tile.offsets[i];
+    const float scale = tile.scales[i];
+    writeCells(message.quantized_layers[i], [codes, offset, scale](std::size_t cell) {
+      return codes[cell] == emptyCode ? std::numeric_limits<float>::quiet_NaN() : offset + scale * codes[cell];
+    });
+  }
+  return true;
+}
+
+}  // namespace elevation_mapping
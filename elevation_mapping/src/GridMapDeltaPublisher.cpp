@@ -0,0 +1,58 @@
+/*
+ * GridMapDeltaPublisher.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/GridMapDeltaPublisher.hpp"
+
+#include <algorithm>
+#include <vector>
+
+// Boost
+#include <boost/bind.hpp>
+
+namespace elevation_mapping {
+
+GridMapDeltaPublisher::GridMapDeltaPublisher(ros::NodeHandle& nodeHandle, const std::string& topic) {
+  if (!nodeHandle.param("delta_publishing", false)) {
+    return;
+  }
+  std::vector<std::string> layers;
+  std::vector<std::string> quantizedLayers;
+  nodeHandle.param("delta_layers", layers, std::vector<std::string>());
+  nodeHandle.param("delta_quantized_layers", quantizedLayers, std::vector<std::string>());
+  const int tileSize = nodeHandle.param("delta_tile_size", 32);
+  const int keyframeInterval = nodeHandle.param("delta_keyframe_interval", 20);
+  const int maxMessageSize = nodeHandle.param("delta_max_message_size", 0);
+  encoder_ = std::make_unique<GridMapDeltaEncoder>(tileSize, layers, quantizedLayers, keyframeInterval,
+                                                   static_cast<std::size_t>(std::max(maxMessageSize, 0)));
+  publisher_ = nodeHandle.advertise<GridMapDelta>(
+      topic + "_delta", 10, boost::bind(&GridMapDeltaPublisher::subscriberConnectCallback, this, _1));
+}
+
+bool GridMapDeltaPublisher::publish(const grid_map::GridMap& map) {
+  if (!hasSubscribers()) {
+    return false;
+  }
+  GridMapDelta message;
+  boost::mutex::scoped_lock scopedLock(encoderMutex_);
+  if (!encoder_->encode(map, message)) {
+    return false;
+  }
+  publisher_.publish(message);
+  ROS_DEBUG("Grid map delta with %zu tiles has been published on %s.", message.tiles.size(), publisher_.getTopic().c_str());
+  return true;
+}
+
+bool GridMapDeltaPublisher::hasSubscribers() const {
+  return encoder_ && publisher_.getNumSubscribers() > 0;
+}
+
+void GridMapDeltaPublisher::subscriberConnectCallback(const ros::SingleSubscriberPublisher& /*subscriber*/) {
+  boost::mutex::scoped_lock scopedLock(encoderMutex_);
+  encoder_->requestKeyframe();
+}
+
+}  // namespace elevation_mapping
@@ -0,0 +1,245 @@
+/*
+ * MapSnapshotFile.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/MapSnapshotFile.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ROS
+#include <ros/ros.h>
+
+namespace {
+//! Identifies the snapshot files, the last characters encode the version of the format.
+const char snapshotFileMagic[8] = {'E', 'M', 'S', 'N', 'A', 'P', '0', '1'};
+
+//! Alignment of the layer data in a snapshot file [bytes].
+const std::size_t snapshotDataAlignment = 64;
+
+/**
+ * Rounds a size up to the alignment of the layer data.
+ * @param size the size [bytes].
+ * @return the aligned size [bytes].
+ */
+std::size_t alignSize(std::size_t size) {
+  return (size + snapshotDataAlignment - 1) / snapshotDataAlignment * snapshotDataAlignment;
+}
+
+/**
+ * Appends the bytes of a value to a buffer.
+ * @param value the value.
+ * @param buffer the buffer.
+ */
+template <typename T>
+void appendBytes(const T& value, std::vector<char>& buffer) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * Appends a string with its terminating zero to a buffer.
+ * @param value the string.
+ * @param buffer the buffer.
+ */
+void appendString(const std::string& value, std::vector<char>& buffer) {
+  buffer.insert(buffer.end(), value.c_str(), value.c_str() + value.size() + 1);
+}
+
+//! Sequential reader of the header of a mapped snapshot file, which checks the bounds of the file.
+class HeaderReader {
+ public:
+  HeaderReader(const char* data, std::size_t size) : data_(data), size_(size), offset_(0) {}
+
+  template <typename T>
+  bool read(T& value) {
+    if (offset_ + sizeof(T) > size_) {
+      return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return true;
+  }
+
+  bool read(std::string& value) {
+    const void* end = std::memchr(data_ + offset_, '\0', size_ - offset_);
+    if (end == nullptr) {
+      return false;
+    }
+    value.assign(data_ + offset_, static_cast<const char*>(end));
+    offset_ += value.size() + 1;
+    return true;
+  }
+
+  std::size_t getOffset() const { return offset_; }
+
+ private:
+  const char* data_;
+  std::size_t size_;
+  std::size_t offset_;
+};
+
+/**
+ * Writes a buffer to a file at an offset.
+ * @param fileDescriptor the file.
+ * @param data the buffer.
+ * @param size the size of the buffer [bytes].
+ * @param offset the offset in the file [bytes].
+ * @return true if successful.
+ */
+bool writeAll(int fileDescriptor, const void* data, std::size_t size, off_t offset) {
+  const char* bytes = static_cast<const char*>(data);
+  while (size > 0) {
+    const ssize_t written = ::pwrite(fileDescriptor, bytes, size, offset);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    bytes += written;
+    size -= static_cast<std::size_t>(written);
+    offset += written;
+  }
+  return true;
+}
+}  // namespace
+
+namespace elevation_mapping {
+
+bool writeMapSnapshot(const grid_map::GridMap& map, const std::string& path) {
+  // Header: magic, size, resolution, position, start index, timestamp, the number of layers and basic layers and the
+  // zero-terminated frame id, layer names and basic layer names.
+  std::vector<char> header(snapshotFileMagic, snapshotFileMagic + sizeof(snapshotFileMagic));
+  const grid_map::Size& size = map.getSize();
+  appendBytes(static_cast<int32_t>(size(0)), header);
+  appendBytes(static_cast<int32_t>(size(1)), header);
+  appendBytes(map.getResolution(), header);
+  appendBytes(map.getPosition().x(), header);
+  appendBytes(map.getPosition().y(), header);
+  appendBytes(static_cast<int32_t>(map.getStartIndex()(0)), header);
+  appendBytes(static_cast<int32_t>(map.getStartIndex()(1)), header);
+  appendBytes(static_cast<uint64_t>(map.getTimestamp()), header);
+  appendBytes(static_cast<uint32_t>(map.getLayers().size()), header);
+  appendBytes(static_cast<uint32_t>(map.getBasicLayers().size()), header);
+  appendString(map.getFrameId(), header);
+  for (const auto& layer : map.getLayers()) {
+    appendString(layer, header);
+  }
+  for (const auto& layer : map.getBasicLayers()) {
+    appendString(layer, header);
+  }
+
+  const std::string temporaryPath = path + ".tmp";
+  const int fileDescriptor = ::open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fileDescriptor < 0) {
+    ROS_ERROR("Could not open the snapshot file %s: %s.", temporaryPath.c_str(), std::strerror(errno));
+    return false;
+  }
+  bool isSuccess = writeAll(fileDescriptor, header.data(), header.size(), 0);
+  std::size_t offset = alignSize(header.size());
+  const std::size_t layerSize = static_cast<std::size_t>(size.prod()) * sizeof(float);
+  for (const auto& layer : map.getLayers()) {
+    isSuccess = isSuccess && writeAll(fileDescriptor, map.get(layer).data(), layerSize, static_cast<off_t>(offset));
+    offset += alignSize(layerSize);
+  }
+  isSuccess = isSuccess && ::ftruncate(fileDescriptor, static_cast<off_t>(offset)) == 0 && ::fsync(fileDescriptor) == 0;
+  if (!isSuccess) {
+    ROS_ERROR("Could not write the snapshot file %s: %s.", temporaryPath.c_str(), std::strerror(errno));
+  }
+  isSuccess = ::close(fileDescriptor) == 0 && isSuccess;
+  if (!isSuccess || std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+    if (isSuccess) {
+      ROS_ERROR("Could not replace the snapshot file %s: %s.", path.c_str(), std::strerror(errno));
+    }
+    std::remove(temporaryPath.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool readMapSnapshot(const std::string& path, grid_map::GridMap& map) {
+  const int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+  if (fileDescriptor < 0) {
+    ROS_ERROR("Could not open the snapshot file %s: %s.", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  struct stat status {};
+  if (::fstat(fileDescriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(snapshotFileMagic))) {
+    ROS_ERROR("The snapshot file %s is not a snapshot.", path.c_str());
+    ::close(fileDescriptor);
+    return false;
+  }
+  const auto fileSize = static_cast<std::size_t>(status.st_size);
+  void* fileData = ::mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+  ::close(fileDescriptor);
+  if (fileData == MAP_FAILED) {
+    ROS_ERROR("Could not map the snapshot file %s: %s.", path.c_str(), std::strerror(errno));
+    return false;
+  }
+  ::madvise(fileData, fileSize, MADV_SEQUENTIAL);
+  const char* data = static_cast<const char*>(fileData);
+
+  HeaderReader reader(data, fileSize);
+  char magic[sizeof(snapshotFileMagic)];
+  int32_t rows = 0;
+  int32_t cols = 0;
+  double resolution = 0.0;
+  grid_map::Position position;
+  int32_t startRow = 0;
+  int32_t startCol = 0;
+  uint64_t timestamp = 0;
+  uint32_t numberOfLayers = 0;
+  uint32_t numberOfBasicLayers = 0;
+  std::string frameId;
+  bool isValid = reader.read(magic) && std::memcmp(magic, snapshotFileMagic, sizeof(magic)) == 0 && reader.read(rows) &&
+                 reader.read(cols) && reader.read(resolution) && reader.read(position.x()) && reader.read(position.y()) &&
+                 reader.read(startRow) && reader.read(startCol) && reader.read(timestamp) && reader.read(numberOfLayers) &&
+                 reader.read(numberOfBasicLayers) && reader.read(frameId);
+  // Every layer name takes at least one byte of the file.
+  isValid = isValid && static_cast<std::size_t>(numberOfLayers) + numberOfBasicLayers <= fileSize;
+  std::vector<std::string> layers(isValid ? numberOfLayers : 0);
+  std::vector<std::string> basicLayers(isValid ? numberOfBasicLayers : 0);
+  for (auto& layer : layers) {
+    isValid = isValid && reader.read(layer);
+  }
+  for (auto& layer : basicLayers) {
+    isValid = isValid && reader.read(layer);
+  }
+  isValid = isValid && rows > 0 && cols > 0 && resolution > 0.0 && startRow >= 0 && startRow < rows && startCol >= 0 && startCol < cols;
+  const std::size_t layerSize = isValid ? static_cast<std::size_t>(rows) * static_cast<std::size_t>(cols) * sizeof(float) : 0;
+  const std::size_t dataOffset = alignSize(reader.getOffset());
+  isValid = isValid && dataOffset + layers.size() * alignSize(layerSize) <= fileSize;
+  if (!isValid) {
+    ROS_ERROR("The snapshot file %s has a different format or is truncated.", path.c_str());
+    ::munmap(fileData, fileSize);
+    return false;
+  }
+
+  grid_map::GridMap snapshot(layers);
+  snapshot.setGeometry(grid_map::Length(rows * resolution, cols * resolution), resolution, position);
+  snapshot.setStartIndex(grid_map::Index(startRow, startCol));
+  snapshot.setTimestamp(timestamp);
+  snapshot.setFrameId(frameId);
+  snapshot.setBasicLayers(basicLayers);
+  for (std::size_t i = 0; i < layers.size(); ++i) {
+    std::memcpy(snapshot.get(layers[i]).data(), data + dataOffset + i * alignSize(layerSize), layerSize);
+  }
+  ::munmap(fileData, fileSize);
+  map = std::move(snapshot);
+  return true;
+}
+
+}  // namespace elevation_mapping
@@ -0,0 +1,183 @@
+/*
+ * PipelineStatistics.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/PipelineStatistics.hpp"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace elevation_mapping {
+
+namespace {
+
+//! Lower bound of the histogram, in s.
+constexpr double minHistogramDuration = 1e-6;
+
+std::string toMilliseconds(double duration) {
+  std::ostringstream stream;
+  stream << std::fixed << std::setprecision(3) << 1000.0 * duration;
+  return stream.str();
+}
+
+void addValue(diagnostic_msgs::DiagnosticStatus& status, std::string key, std::string value) {
+  diagnostic_msgs::KeyValue keyValue;
+  keyValue.key = std::move(key);
+  keyValue.value = std::move(value);
+  status.values.push_back(std::move(keyValue));
+}
+
+}  // namespace
+
+void LatencyHistogram::add(double duration) {
+  const double octaves = duration > minHistogramDuration ? std::log2(duration / minHistogramDuration) : 0.0;
+  const int bucket = std::min(static_cast<int>(octaves * bucketsPerOctave), numberOfBuckets - 1);
+  ++buckets_[bucket];
+  ++count_;
+  sum_ += duration;
+  max_ = std::max(max_, duration);
+}
+
+double LatencyHistogram::getPercentile(double fraction) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  // Rank of the percentile among the sorted latencies, starting at 1.
+  const std::size_t rank =
+      std::max<std::size_t>(static_cast<std::size_t>(std::ceil(std::min(std::max(fraction, 0.0), 1.0) * static_cast<double>(count_))), 1);
+  std::size_t cumulativeCount = 0;
+  // The last bucket is unbounded.
+  for (int bucket = 0; bucket < numberOfBuckets - 1; ++bucket) {
+    cumulativeCount += buckets_[bucket];
+    if (cumulativeCount >= rank) {
+      const double upperBound = minHistogramDuration * std::exp2(static_cast<double>(bucket + 1) / bucketsPerOctave);
+      return std::min(upperBound, max_);
+    }
+  }
+  return max_;
+}
+
+PipelineStatistics::ScopedTimer::ScopedTimer(PipelineStatistics* statistics, std::string group, PipelineStage stage)
+    : statistics_(statistics), group_(std::move(group)), stage_(stage), startTime_(ros::WallTime::now()) {}
+
+PipelineStatistics::ScopedTimer::~ScopedTimer() {
+  if (statistics_ != nullptr) {
+    statistics_->addDuration(group_, stage_, (ros::WallTime::now() - startTime_).toSec());
+  }
+}
+
+PipelineStatistics::ScopedLock::ScopedLock(boost::recursive_mutex& mutex, PipelineStatistics* statistics, std::string group)
+    : lock_(mutex, boost::defer_lock), statistics_(statistics), group_(std::move(group)) {
+  const ros::WallTime startTime = ros::WallTime::now();
+  lock_.lock();
+  lockTime_ = ros::WallTime::now();
+  if (statistics_ != nullptr) {
+    statistics_->addDuration(group_, PipelineStage::LockWait, (lockTime_ - startTime).toSec());
+  }
+}
+
+PipelineStatistics::ScopedLock::~ScopedLock() {
+  if (lock_.owns_lock()) {
+    unlock();
+  }
+}
+
+void PipelineStatistics::ScopedLock::unlock() {
+  lock_.unlock();
+  if (statistics_ != nullptr) {
+    statistics_->addDuration(group_, PipelineStage::LockHold, (ros::WallTime::now() - lockTime_).toSec());
+  }
+}
+
+const char* PipelineStatistics::getStageName(PipelineStage stage) {
+  switch (stage) {
+    case PipelineStage::Conversion:
+      return "conversion";
+    case PipelineStage::TfWait:
+      return "tf_wait";
+    case PipelineStage::Filtering:
+      return "filtering";
+    case PipelineStage::Variance:
+      return "variance";
+    case PipelineStage::Move:
+      return "move";
+    case PipelineStage::Prediction:
+      return "prediction";
+    case PipelineStage::Add:
+      return "add";
+    case PipelineStage::Clean:
+      return "clean";
+    case PipelineStage::Fuse:
+      return "fuse";
+    case PipelineStage::VisibilityCleanup:
+      return "visibility_cleanup";
+    case PipelineStage::Postprocess:
+      return "postprocess";
+    case PipelineStage::Publish:
+      return "publish";
+    case PipelineStage::LockWait:
+      return "lock_wait";
+    case PipelineStage::LockHold:
+      return "lock_hold";
+  }
+  return "unknown";
+}
+
+void PipelineStatistics::addDuration(const std::string& group, PipelineStage stage, double duration) {
+  boost::mutex::scoped_lock lock(mutex_);
+  groups_[group].latencies[static_cast<std::size_t>(stage)].add(duration);
+}
+
+void PipelineStatistics::addDroppedFrames(const std::string& group, std::size_t numberOfFrames) {
+  boost::mutex::scoped_lock lock(mutex_);
+  groups_[group].numberOfDroppedFrames += numberOfFrames;
+}
+
+void PipelineStatistics::setQueueDepth(const std::string& group, const std::string& queue, std::size_t depth) {
+  boost::mutex::scoped_lock lock(mutex_);
+  QueueDepth& queueDepth = groups_[group].queueDepths[queue];
+  queueDepth.current = depth;
+  queueDepth.max = std::max(queueDepth.max, depth);
+}
+
+void PipelineStatistics::getStatus(const std::string& prefix, std::vector<diagnostic_msgs::DiagnosticStatus>& status) const {
+  boost::mutex::scoped_lock lock(mutex_);
+  for (const auto& group : groups_) {
+    diagnostic_msgs::DiagnosticStatus groupStatus;
+    groupStatus.name = prefix + group.first;
+    groupStatus.level = diagnostic_msgs::DiagnosticStatus::OK;
+    groupStatus.message = std::to_string(group.second.numberOfDroppedFrames) + " dropped frames";
+    addValue(groupStatus, "dropped_frames", std::to_string(group.second.numberOfDroppedFrames));
+    for (const auto& queue : group.second.queueDepths) {
+      addValue(groupStatus, queue.first + " queue_depth", std::to_string(queue.second.current));
+      addValue(groupStatus, queue.first + " max_queue_depth", std::to_string(queue.second.max));
+    }
+    for (std::size_t stage = 0; stage < numberOfPipelineStages; ++stage) {
+      const LatencyHistogram& latencies = group.second.latencies[stage];
+      if (latencies.getCount() == 0) {
+        continue;
+      }
+      const std::string name = getStageName(static_cast<PipelineStage>(stage));
+      addValue(groupStatus, name + " count", std::to_string(latencies.getCount()));
+      addValue(groupStatus, name + " mean [ms]", toMilliseconds(latencies.getMean()));
+      addValue(groupStatus, name + " p50 [ms]", toMilliseconds(latencies.getPercentile(0.5)));
+      addValue(groupStatus, name + " p90 [ms]", toMilliseconds(latencies.getPercentile(0.9)));
+      addValue(groupStatus, name + " p99 [ms]", toMilliseconds(latencies.getPercentile(0.99)));
+      addValue(groupStatus, name + " max [ms]", toMilliseconds(latencies.getMax()));
+    }
+    status.push_back(std::move(groupStatus));
+  }
+}
+
+void PipelineStatistics::reset() {
+  boost::mutex::scoped_lock lock(mutex_);
+  groups_.clear();
+}
+
+}  // namespace elevation_mapping
@@ -0,0 +1,107 @@
+/*
+ * PointCloudConversion.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/PointCloudConversion.hpp"
+
+#include <cstring>
+
+#include <pcl_conversions/pcl_conversions.h>
+#include <ros/ros.h>
+
+namespace elevation_mapping {
+
+namespace {
+//! Marks a field which is not in the message.
+const int noOffset = -1;
+
+//! Size of the fields read from the message.
+const std::size_t fieldSize = 4;
+
+/*!
+ * Copies a 4 byte field of a point from the message buffer, if the field exists.
+ * @param[in] pointData the begin of the point in the message buffer.
+ * @param[in] offset the offset of the field in the point.
+ * @param[out] value the field value.
+ */
+template <typename Scalar>
+inline void readField(const uint8_t* pointData, int offset, Scalar& value) {
+  static_assert(sizeof(Scalar) == fieldSize, "Only 4 byte fields are supported.");
+  if (offset != noOffset) {
+    std::memcpy(&value, pointData + offset, sizeof(Scalar));
+  }
+}
+}  // namespace
+
+bool fromPointCloud2Message(const sensor_msgs::PointCloud2& message, PointCloudType& pointCloud) {
+  // Look up the fields, matching them the same way as pcl::fromPCLPointCloud2.
+  int xOffset = noOffset;
+  int yOffset = noOffset;
+  int zOffset = noOffset;
+  int rgbaOffset = noOffset;
+  int confidenceRatioOffset = noOffset;
+  for (const auto& field : message.fields) {
+    if (field.count != 1) {
+      continue;
+    }
+    int* fieldOffset = nullptr;
+    if (field.datatype == sensor_msgs::PointField::FLOAT32) {
+      if (field.name == "x") {
+        fieldOffset = &xOffset;
+      } else if (field.name == "y") {
+        fieldOffset = &yOffset;
+      } else if (field.name == "z") {
+        fieldOffset = &zOffset;
+      } else if (field.name == "confidence_ratio") {
+        fieldOffset = &confidenceRatioOffset;
+      }
+    }
+    // The packed color is sent as float or as unsigned integer, both under either name.
+    if ((field.datatype == sensor_msgs::PointField::FLOAT32 || field.datatype == sensor_msgs::PointField::UINT32) &&
+        (field.name == "rgb" || field.name == "rgba")) {
+      fieldOffset = &rgbaOffset;
+    }
+    if (fieldOffset == nullptr) {
+      continue;
+    }
+    if (static_cast<std::size_t>(field.offset) + fieldSize > message.point_step) {
+      ROS_ERROR("Point cloud message field %s at offset %u exceeds the point step (%u bytes).", field.name.c_str(), field.offset,
+                message.point_step);
+      return false;
+    }
+    *fieldOffset = static_cast<int>(field.offset);
+  }
+  if (xOffset == noOffset || yOffset == noOffset || zOffset == noOffset) {
+    ROS_ERROR("Point cloud message has no float x, y and z fields.");
+    return false;
+  }
+  if (message.height > 0 && message.data.size() < static_cast<std::size_t>(message.height - 1) * message.row_step +
+                                                      static_cast<std::size_t>(message.width) * message.point_step) {
+    ROS_ERROR("Point cloud message data is too short (%i bytes).", static_cast<int>(message.data.size()));
+    return false;
+  }
+
+  pcl_conversions::toPCL(message.header, pointCloud.header);
+  pointCloud.width = message.width;
+  pointCloud.height = message.height;
+  pointCloud.is_dense = message.is_dense;
+  pointCloud.points.assign(static_cast<std::size_t>(message.width) * message.height, pcl::PointXYZRGBConfidenceRatio());
+
+  auto point = pointCloud.points.begin();
+  for (uint32_t row = 0; row < message.height; ++row) {
+    const uint8_t* pointData = message.data.data() + static_cast<std::size_t>(row) * message.row_step;
+    for (uint32_t col = 0; col < message.width; ++col, ++point, pointData += message.point_step) {
+      readField(pointData, xOffset, point->x);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      readField(pointData, yOffset, point->y);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      readField(pointData, zOffset, point->z);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      readField(pointData, rgbaOffset, point->rgba);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+      readField(pointData, confidenceRatioOffset, point->confidence_ratio);  // NOLINT(cppcoreguidelines-pro-type-union-access)
+    }
+  }
+  return true;
+}
+
+}  // namespace elevation_mapping
@@ -36,13 +36,6 @@ bool RobotMotionMapUpdater::update(ElevationMap& map, const Pose& robotPose, con
     return false;
   }
 
-  // Initialize update data.
-  grid_map::Size size = map.getRawGridMap().getSize();
-  grid_map::Matrix varianceUpdate(size(0), size(1));  // TODO(max): Make as grid map?
-  grid_map::Matrix horizontalVarianceUpdateX(size(0), size(1));
-  grid_map::Matrix horizontalVarianceUpdateY(size(0), size(1));
-  grid_map::Matrix horizontalVarianceUpdateXY(size(0), size(1));
-
   // Relative convariance matrix between two robot poses.
   ReducedCovariance reducedCovariance;
   computeReducedCovariance(robotPose, robotPoseCovarianceScaled, reducedCovariance);
@@ -62,53 +55,23 @@ bool RobotMotionMapUpdater::update(ElevationMap& map, const Pose& robotPose, con
   // Translation Jacobian (J_r) (25).
   Eigen::Matrix3d translationJacobian = -mapToRobotRotation.matrix().transpose();
 
+  ElevationMap::MotionVarianceUpdate motionUpdate;
+
   // Translation variance update (for all points the same).
-  Eigen::Vector3f translationVarianceUpdate =
-      (translationJacobian * positionCovariance * translationJacobian.transpose()).diagonal().cast<float>();
+  motionUpdate.translationVariance = (translationJacobian * positionCovariance * translationJacobian.transpose()).diagonal().cast<float>();
 
   // Map-robot relative position (M_r_Bk_M, for all points the same).
   // Preparation for (25): M_r_BP = R_I_M^T (I_r_I_M - I_r_I_B) + M_r_M_P
   // R_I_M^T (I_r_I_M - I_r_I_B):
-  const kindr::Position3D positionRobotToMap =
-      map.getPose().getRotation().inverseRotate(map.getPose().getPosition() - previousRobotPose_.getPosition());
-
-  auto& heightLayer = map.getRawGridMap()["elevation"];
-
-  // For each cell in map. // TODO(max): Change to new iterator.
-  for (unsigned int i = 0; i < static_cast<unsigned int>(size(0)); ++i) {
-    for (unsigned int j = 0; j < static_cast<unsigned int>(size(1)); ++j) {
-      kindr::Position3D cellPosition;  // M_r_MP
-
-      const auto height = heightLayer(i, j);
-      if (std::isfinite(height)) {
-        grid_map::Position position;
-        map.getRawGridMap().getPosition({i, j}, position);
-        cellPosition = {position.x(), position.y(), height};
-
-        // Rotation Jacobian J_R (25)
-        const Eigen::Matrix3d rotationJacobian =
-            -kindr::getSkewMatrixFromVector((positionRobotToMap + cellPosition).vector()) * mapToPreviousRobotRotationInverted.matrix();
-
-        // Rotation variance update.
-        const Eigen::Matrix2f rotationVarianceUpdate =
-            (rotationJacobian * rotationCovariance * rotationJacobian.transpose()).topLeftCorner<2, 2>().cast<float>();
-
-        // Variance update.
-        varianceUpdate(i, j) = translationVarianceUpdate.z();
-        horizontalVarianceUpdateX(i, j) = translationVarianceUpdate.x() + rotationVarianceUpdate(0, 0);
-        horizontalVarianceUpdateY(i, j) = translationVarianceUpdate.y() + rotationVarianceUpdate(1, 1);
-        horizontalVarianceUpdateXY(i, j) = rotationVarianceUpdate(0, 1);
-      } else {
-        // Cell invalid. // TODO(max): Change to new functions
-        varianceUpdate(i, j) = std::numeric_limits<float>::infinity();
-        horizontalVarianceUpdateX(i, j) = std::numeric_limits<float>::infinity();
-        horizontalVarianceUpdateY(i, j) = std::numeric_limits<float>::infinity();
-        horizontalVarianceUpdateXY(i, j) = std::numeric_limits<float>::infinity();
-      }
-    }
-  }
+  motionUpdate.mapPosition =
+      map.getPose().getRotation().inverseRotate(map.getPose().getPosition() - previousRobotPose_.getPosition()).vector();
+
+  // Rotation Jacobian J_R (25). Only the yaw is uncertain, so J_R * Sigma_R * J_R^T = sigma_yaw^2 * v * v^T with
+  // v = -[M_r_BP]x * R_B_M^T * e_z = (R_B_M^T * e_z) x M_r_BP, which is evaluated per cell by the map.
+  motionUpdate.yawVariance = static_cast<float>(rotationCovariance(2, 2));
+  motionUpdate.yawAxis = mapToPreviousRobotRotationInverted.matrix().col(2).cast<float>();
 
-  map.update(varianceUpdate, horizontalVarianceUpdateX, horizontalVarianceUpdateY, horizontalVarianceUpdateXY, time);
+  map.update(motionUpdate, time);
   previousReducedCovariance_ = reducedCovariance;
   previousRobotPose_ = robotPose;
   return true;
@@ -0,0 +1,126 @@
+/*
+ * ThreadPool.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace elevation_mapping {
+
+ThreadPool::ThreadPool(int numThreads)
+    : task_(nullptr), numTasks_(0), nextTask_(0), generation_(0), numBusyWorkers_(0), isStopping_(false) {
+  const std::size_t numWorkers = static_cast<std::size_t>(std::max(numThreads, 1) - 1);
+  workers_.reserve(numWorkers);
+  for (std::size_t i = 0; i < numWorkers; ++i) {
+    // Worker thread indices start at 1, the calling thread always uses index 0.
+    workers_.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    isStopping_ = true;
+  }
+  startCondition_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+std::size_t ThreadPool::size() const {
+  return workers_.size() + 1;
+}
+
+void ThreadPool::parallelFor(std::size_t numTasks, const Task& task) {
+  if (numTasks == 0) {
+    return;
+  }
+
+  // Nothing to distribute, avoid the synchronization overhead.
+  if (workers_.empty() || numTasks == 1) {
+    for (std::size_t i = 0; i < numTasks; ++i) {
+      task(i, 0);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> loopLock(loopMutex_);
+  {
+    std::lock_guard<std::mutex> lock(stateMutex_);
+    task_ = &task;
+    numTasks_ = numTasks;
+    nextTask_ = 0;
+    numBusyWorkers_ = workers_.size();
+    exception_ = nullptr;
+    ++generation_;
+  }
+  startCondition_.notify_all();
+
+  runTasks(0);
+
+  std::exception_ptr exception;
+  {
+    std::unique_lock<std::mutex> lock(stateMutex_);
+    doneCondition_.wait(lock, [this]() { return numBusyWorkers_ == 0; });
+    task_ = nullptr;
+    exception = exception_;
+  }
+  if (exception) {
+    std::rethrow_exception(exception);
+  }
+}
+
+void ThreadPool::workerLoop(std::size_t threadIndex) {
+  std::size_t lastGeneration = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(stateMutex_);
+      startCondition_.wait(lock, [&]() { return isStopping_ || generation_ != lastGeneration; });
+      if (isStopping_) {
+        return;
+      }
+      lastGeneration = generation_;
+    }
+
+    runTasks(threadIndex);
+
+    {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      --numBusyWorkers_;
+    }
+    doneCondition_.notify_one();
+  }
+}
+
+void ThreadPool::runTasks(std::size_t threadIndex) {
+  while (true) {
+    std::size_t taskIndex;
+    const Task* task;
+    {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      if (nextTask_ >= numTasks_ || exception_) {
+        return;
+      }
+      taskIndex = nextTask_++;
+      task = task_;
+    }
+
+    try {
+      (*task)(taskIndex, threadIndex);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(stateMutex_);
+      if (!exception_) {
+        exception_ = std::current_exception();
+      }
+    }
+  }
+}
+
+}  // namespace elevation_mapping
@@ -0,0 +1,226 @@
+/*
+ * TileStore.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/TileStore.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// ROS
+#include <ros/ros.h>
+
+namespace {
+//! Identifies the tile files, the last characters encode the version of the format.
+const char tileFileMagic[8] = {'E', 'M', 'T', 'I', 'L', 'E', '0', '1'};
+
+//! Alignment of the cell data in a tile file [bytes].
+const std::size_t tileDataAlignment = 64;
+
+/**
+ * Appends the bytes of a value to a buffer.
+ * @param value the value.
+ * @param buffer the buffer.
+ */
+template <typename T>
+void appendBytes(const T& value, std::vector<char>& buffer) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+ * Integer division rounding towards negative infinity.
+ * @param dividend the dividend.
+ * @param divisor the (positive) divisor.
+ * @return the quotient.
+ */
+int64_t floorDivide(int64_t dividend, int64_t divisor) {
+  return dividend >= 0 ? dividend / divisor : -((-dividend + divisor - 1) / divisor);
+}
+}  // namespace
+
+namespace elevation_mapping {
+
+TileStore::TileStore(std::string directory, int tileSize, double resolution, std::vector<std::string> layers,
+                     std::size_t maxNumberOfMappedTiles)
+    : directory_(std::move(directory)),
+      tileSize_(std::max(tileSize, 1)),
+      resolution_(resolution),
+      layers_(std::move(layers)),
+      maxNumberOfMappedTiles_(std::max<std::size_t>(maxNumberOfMappedTiles, 1)) {
+  // Header: magic, tile size, resolution, number of layers and the zero-terminated layer names.
+  header_.assign(tileFileMagic, tileFileMagic + sizeof(tileFileMagic));
+  appendBytes(static_cast<int32_t>(tileSize_), header_);
+  appendBytes(resolution_, header_);
+  appendBytes(static_cast<uint32_t>(layers_.size()), header_);
+  for (const auto& layer : layers_) {
+    header_.insert(header_.end(), layer.c_str(), layer.c_str() + layer.size() + 1);
+  }
+  dataOffset_ = (header_.size() + tileDataAlignment - 1) / tileDataAlignment * tileDataAlignment;
+  fileSize_ = dataOffset_ + layers_.size() * tileSize_ * tileSize_ * sizeof(float);
+}
+
+TileStore::~TileStore() {
+  unmapAll();
+}
+
+bool TileStore::initialize() {
+  if (::mkdir(directory_.c_str(), 0755) != 0 && errno != EEXIST) {
+    ROS_ERROR("Could not create the tile store directory %s: %s.", directory_.c_str(), std::strerror(errno));
+    return false;
+  }
+  struct stat status {};
+  if (::stat(directory_.c_str(), &status) != 0 || !S_ISDIR(status.st_mode)) {
+    ROS_ERROR("The tile store directory %s is not a directory.", directory_.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool TileStore::writeCell(const grid_map::GridMap& map, const grid_map::Index& index) {
+  TileKey key;
+  std::size_t cellOffset;
+  getTileOfCell(map, index, key, cellOffset);
+
+  // Empty cells do not create new tiles.
+  const bool isEmpty = !std::isfinite(map.at(layers_.front(), index));
+  float* data = getTileData(key, !isEmpty);
+  if (data == nullptr) {
+    return isEmpty;
+  }
+  const std::size_t layerSize = tileSize_ * tileSize_;
+  for (std::size_t i = 0; i < layers_.size(); ++i) {
+    data[i * layerSize + cellOffset] = isEmpty ? std::numeric_limits<float>::quiet_NaN() : map.at(layers_[i], index);
+  }
+  return true;
+}
+
+bool TileStore::readCell(grid_map::GridMap& map, const grid_map::Index& index) {
+  TileKey key;
+  std::size_t cellOffset;
+  getTileOfCell(map, index, key, cellOffset);
+  const float* data = getTileData(key, false);
+  if (data == nullptr || !std::isfinite(data[cellOffset])) {
+    return false;
+  }
+  const std::size_t layerSize = tileSize_ * tileSize_;
+  for (std::size_t i = 0; i < layers_.size(); ++i) {
+    map.at(layers_[i], index) = data[i * layerSize + cellOffset];
+  }
+  return true;
+}
+
+void TileStore::unmapAll() {
+  for (auto& tile : mappedTiles_) {
+    ::munmap(tile.second.data, fileSize_);
+  }
+  mappedTiles_.clear();
+  leastRecentlyUsedTiles_.clear();
+}
+
+void TileStore::getTileOfCell(const grid_map::GridMap& map, const grid_map::Index& index, TileKey& key, std::size_t& cellOffset) const {
+  grid_map::Position position;
+  map.getPosition(index, position);
+  // Cell centers usually lie on multiples of the resolution or half of it, the quarter cell offset keeps
+  // them away from the rounding boundaries.
+  const auto cellX = static_cast<int64_t>(std::floor(position.x() / resolution_ + 0.25));
+  const auto cellY = static_cast<int64_t>(std::floor(position.y() / resolution_ + 0.25));
+  key = TileKey(floorDivide(cellX, tileSize_), floorDivide(cellY, tileSize_));
+  cellOffset = static_cast<std::size_t>((cellX - key.first * tileSize_) + (cellY - key.second * tileSize_) * tileSize_);
+}
+
+float* TileStore::getTileData(const TileKey& key, bool create) {
+  auto tile = mappedTiles_.find(key);
+  if (tile != mappedTiles_.end()) {
+    leastRecentlyUsedTiles_.splice(leastRecentlyUsedTiles_.begin(), leastRecentlyUsedTiles_, tile->second.leastRecentlyUsedPosition);
+    return reinterpret_cast<float*>(static_cast<char*>(tile->second.data) + dataOffset_);
+  }
+  if (!create && missingTiles_.count(key) > 0) {
+    return nullptr;
+  }
+
+  void* data = mapTile(key, create);
+  if (data == nullptr) {
+    if (!create) {
+      missingTiles_.insert(key);
+    }
+    return nullptr;
+  }
+  missingTiles_.erase(key);
+
+  if (mappedTiles_.size() >= maxNumberOfMappedTiles_) {
+    const TileKey& leastRecentlyUsedTile = leastRecentlyUsedTiles_.back();
+    ::munmap(mappedTiles_.at(leastRecentlyUsedTile).data, fileSize_);
+    mappedTiles_.erase(leastRecentlyUsedTile);
+    leastRecentlyUsedTiles_.pop_back();
+  }
+  leastRecentlyUsedTiles_.push_front(key);
+  mappedTiles_[key] = MappedTile{data, leastRecentlyUsedTiles_.begin()};
+  return reinterpret_cast<float*>(static_cast<char*>(data) + dataOffset_);
+}
+
+void* TileStore::mapTile(const TileKey& key, bool create) {
+  const std::string path = getTilePath(key);
+  const int fileDescriptor = ::open(path.c_str(), create ? O_RDWR | O_CREAT : O_RDWR, 0644);
+  if (fileDescriptor < 0) {
+    if (errno != ENOENT) {
+      ROS_ERROR("Could not open the tile file %s: %s.", path.c_str(), std::strerror(errno));
+    }
+    return nullptr;
+  }
+
+  // Check the format of an existing file.
+  bool isCompatible = false;
+  struct stat status {};
+  if (::fstat(fileDescriptor, &status) == 0 && static_cast<std::size_t>(status.st_size) == fileSize_) {
+    std::vector<char> header(header_.size());
+    isCompatible = ::pread(fileDescriptor, header.data(), header.size(), 0) == static_cast<ssize_t>(header.size()) && header == header_;
+  }
+  const bool isNew = !isCompatible;
+  if (isNew) {
+    if (!create) {
+      ROS_WARN_THROTTLE(10.0, "Ignoring the tile file %s, it has a different format.", path.c_str());
+      ::close(fileDescriptor);
+      return nullptr;
+    }
+    if (status.st_size > 0) {
+      ROS_WARN("Overwriting the tile file %s, it has a different format.", path.c_str());
+    }
+    if (::ftruncate(fileDescriptor, 0) != 0 || ::ftruncate(fileDescriptor, static_cast<off_t>(fileSize_)) != 0) {
+      ROS_ERROR("Could not resize the tile file %s: %s.", path.c_str(), std::strerror(errno));
+      ::close(fileDescriptor);
+      return nullptr;
+    }
+  }
+
+  void* data = ::mmap(nullptr, fileSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+  ::close(fileDescriptor);
+  if (data == MAP_FAILED) {
+    ROS_ERROR("Could not map the tile file %s: %s.", path.c_str(), std::strerror(errno));
+    return nullptr;
+  }
+  if (isNew) {
+    std::memcpy(data, header_.data(), header_.size());
+    float* cells = reinterpret_cast<float*>(static_cast<char*>(data) + dataOffset_);
+    std::fill(cells, cells + layers_.size() * tileSize_ * tileSize_, std::numeric_limits<float>::quiet_NaN());
+  }
+  return data;
+}
+
+std::string TileStore::getTilePath(const TileKey& key) const {
+  return directory_ + "/tile_" + std::to_string(key.first) + "_" + std::to_string(key.second) + ".bin";
+}
+
+}  // namespace elevation_mapping
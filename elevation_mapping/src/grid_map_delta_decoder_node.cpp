@@ -0,0 +1,39 @@
+/*
+ * grid_map_delta_decoder_node.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ *
+ *  Reconstructs the grid map from delta messages and republishes it as a regular grid map, e.g. on the operator station.
+ */
+
+#include <grid_map_ros/grid_map_ros.hpp>
+#include <ros/ros.h>
+
+#include "elevation_mapping/GridMapDeltaCoding.hpp"
+
+namespace {
+elevation_mapping::GridMapDeltaDecoder decoder;
+ros::Publisher publisher;
+
+void deltaCallback(const elevation_mapping::GridMapDelta& message) {
+  if (!decoder.decode(message)) {
+    return;
+  }
+  grid_map_msgs::GridMap outputMessage;
+  grid_map::GridMapRosConverter::toMessage(decoder.getMap(), outputMessage);
+  publisher.publish(outputMessage);
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "grid_map_delta_decoder");
+  ros::NodeHandle nodeHandle("~");
+  const std::string inputTopic = nodeHandle.param("input_topic", std::string("/elevation_mapping/elevation_map_delta"));
+  const std::string outputTopic = nodeHandle.param("output_topic", std::string("elevation_map"));
+  publisher = nodeHandle.advertise<grid_map_msgs::GridMap>(outputTopic, 1, true);
+  ros::Subscriber subscriber = nodeHandle.subscribe(inputTopic, 10, &deltaCallback);
+
+  ros::spin();
+  return 0;
+}
@@ -15,7 +15,12 @@
 
 namespace elevation_mapping {
 
-Input::Input(ros::NodeHandle nh) : nodeHandle_(nh), queueSize_(0), publishOnUpdate_(true) {}
+Input::Input(ros::NodeHandle nh)
+    : nodeHandle_(nh), callbackMutex_(new std::mutex), queueSize_(0), publishOnUpdate_(true), priority_(0) {}
+
+Input::~Input() {
+  stopProcessingThread();
+}
 
 bool Input::configure(std::string name, const XmlRpc::XmlRpcValue& parameters,
                       const SensorProcessorBase::GeneralParameters& generalSensorProcessorParameters) {
@@ -59,6 +64,13 @@ bool Input::configure(std::string name, const XmlRpc::XmlRpcValue& parameters,
     return false;
   }
   publishOnUpdate_ = static_cast<bool>(parameters["publish_on_update"]);
+  if (parameters.hasMember("priority")) {
+    if (parameters["priority"].getType() != XmlRpc::XmlRpcValue::TypeInt) {
+      ROS_ERROR("Could not configure input source %s because member priority has the wrong type.", name.c_str());
+      return false;
+    }
+    priority_ = static_cast<int>(parameters["priority"]);
+  }
 
   // SensorProcessor
   if (!configureSensorProcessor(name, parameters, generalSensorProcessorParameters)) {
@@ -71,6 +83,42 @@ bool Input::configure(std::string name, const XmlRpc::XmlRpcValue& parameters,
   return true;
 }
 
+ros::CallbackQueue* Input::startProcessingThread() {
+  stopProcessingThread();
+  callbackQueue_.reset(new ros::CallbackQueue);
+  ros::CallbackQueue* callbackQueue = callbackQueue_.get();
+  processingThread_ = boost::thread([callbackQueue]() {
+    while (callbackQueue->isEnabled()) {
+      callbackQueue->callAvailable(ros::WallDuration(0.1));
+    }
+  });
+  return callbackQueue;
+}
+
+void Input::stopProcessingThread() {
+  retryTimer_.stop();
+  if (!callbackQueue_) {
+    return;
+  }
+  subscriber_.shutdown();
+  callbackQueue_->disable();
+  if (processingThread_.joinable()) {
+    processingThread_.join();
+  }
+  callbackQueue_->clear();
+  callbackQueue_.reset();
+}
+
+void Input::setPipelineStatistics(PipelineStatistics* pipelineStatistics) {
+  if (sensorProcessor_) {
+    sensorProcessor_->setPipelineStatistics(pipelineStatistics, name_);
+  }
+}
+
+void Input::setInputScheduler(InputScheduler& inputScheduler) const {
+  inputScheduler.setPriority(name_, priority_);
+}
+
 std::string Input::getSubscribedTopic() const {
   return nodeHandle_.resolveName(topic_);
 }
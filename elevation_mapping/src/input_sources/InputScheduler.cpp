@@ -0,0 +1,152 @@
+/*
+ *  InputScheduler.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *  Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/input_sources/InputScheduler.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+//! Weight of a new measurement in the smoothed latency and costs.
+const double smoothingFactor = 0.2;
+
+//! The skipping is undone when the latency is below this fraction of the budget.
+const double relaxationThreshold = 0.5;
+
+/**
+ * @brief Adds a measurement to a smoothed value.
+ * @param value The smoothed value, initialized with the measurement if 0.
+ * @param measurement The measurement.
+ */
+void smooth(double& value, double measurement) {
+  value = value == 0.0 ? measurement : value + smoothingFactor * (measurement - value);
+}
+}  // namespace
+
+namespace elevation_mapping {
+
+constexpr unsigned int InputScheduler::maxDecimation;
+
+InputScheduler::InputScheduler(double latencyBudget) : latencyBudget_(0.0), latency_(0.0), lastAdaptationTime_(0.0) {
+  setLatencyBudget(latencyBudget);
+}
+
+void InputScheduler::setLatencyBudget(double latencyBudget) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  latencyBudget_ = std::max(latencyBudget, 0.0);
+  for (auto& source : sources_) {
+    source.second.decimation = 1;
+    source.second.skippedPointClouds = 0;
+  }
+  latency_ = 0.0;
+  lastAdaptationTime_ = 0.0;
+}
+
+void InputScheduler::setPriority(const std::string& source, int priority) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sources_[source].priority = priority;
+}
+
+bool InputScheduler::admit(const std::string& source, double age) {
+  if (!isEnabled()) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  // A point cloud which already missed the deadline would only delay the following ones.
+  if (age > latencyBudget_) {
+    return false;
+  }
+  Source& state = sources_[source];
+  if (state.skippedPointClouds + 1 < state.decimation) {
+    ++state.skippedPointClouds;
+    return false;
+  }
+  state.skippedPointClouds = 0;
+  return true;
+}
+
+void InputScheduler::reportIntegration(const std::string& source, std::size_t numberOfProcessedPoints, double processingDuration,
+                                       std::size_t numberOfIntegratedPoints, double integrationDuration, double latency, double time) {
+  if (!isEnabled()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Source& state = sources_[source];
+  // Every cost is divided by the number of points that caused it, such that it does not depend on the point budget.
+  if (numberOfProcessedPoints > 0) {
+    smooth(state.processingCostPerPoint, processingDuration / static_cast<double>(numberOfProcessedPoints));
+    smooth(state.integratedPointRatio, static_cast<double>(numberOfIntegratedPoints) / static_cast<double>(numberOfProcessedPoints));
+  }
+  if (numberOfIntegratedPoints > 0) {
+    smooth(state.integrationCostPerPoint, integrationDuration / static_cast<double>(numberOfIntegratedPoints));
+  }
+  smooth(latency_, latency);
+  adapt(time);
+}
+
+void InputScheduler::adapt(double time) {
+  // A change needs about one latency budget to take effect.
+  if (time - lastAdaptationTime_ < latencyBudget_) {
+    return;
+  }
+  const auto byPriority = [](const std::pair<const std::string, Source>& a, const std::pair<const std::string, Source>& b) {
+    return a.second.priority < b.second.priority;
+  };
+  if (latency_ > latencyBudget_) {
+    // Skip more point clouds of the source with the lowest priority which can still be decimated.
+    auto lowest = sources_.end();
+    for (auto source = sources_.begin(); source != sources_.end(); ++source) {
+      if (source->second.decimation < maxDecimation && (lowest == sources_.end() || byPriority(*source, *lowest))) {
+        lowest = source;
+      }
+    }
+    if (lowest != sources_.end()) {
+      lowest->second.decimation *= 2;
+      lastAdaptationTime_ = time;
+    }
+  } else if (latency_ < relaxationThreshold * latencyBudget_) {
+    // Skip fewer point clouds of the decimated source with the highest priority.
+    auto highest = sources_.end();
+    for (auto source = sources_.begin(); source != sources_.end(); ++source) {
+      if (source->second.decimation > 1 && (highest == sources_.end() || byPriority(*highest, *source))) {
+        highest = source;
+      }
+    }
+    if (highest != sources_.end()) {
+      highest->second.decimation /= 2;
+      lastAdaptationTime_ = time;
+    }
+  }
+}
+
+std::size_t InputScheduler::getPointBudget(const std::string& source) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto state = sources_.find(source);
+  if (!isEnabled() || state == sources_.end()) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  // The cost of a processed point includes the integration of the points the sensor processor leaves of it.
+  const double costPerPoint =
+      state->second.processingCostPerPoint + state->second.integratedPointRatio * state->second.integrationCostPerPoint;
+  if (costPerPoint == 0.0) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  // Every input source gets the same share of the budget.
+  const double budget = latencyBudget_ / static_cast<double>(sources_.size()) / costPerPoint;
+  if (budget >= static_cast<double>(std::numeric_limits<std::size_t>::max())) {
+    return std::numeric_limits<std::size_t>::max();
+  }
+  return std::max(static_cast<std::size_t>(budget), std::size_t(1));
+}
+
+unsigned int InputScheduler::getDecimation(const std::string& source) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto state = sources_.find(source);
+  return state == sources_.end() ? 1 : state->second.decimation;
+}
+
+}  // namespace elevation_mapping
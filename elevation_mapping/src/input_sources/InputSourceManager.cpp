@@ -11,7 +11,7 @@
 
 namespace elevation_mapping {
 
-InputSourceManager::InputSourceManager(const ros::NodeHandle& nodeHandle) : nodeHandle_(nodeHandle) {}
+InputSourceManager::InputSourceManager(const ros::NodeHandle& nodeHandle) : nodeHandle_(nodeHandle), useProcessingThreads_(false) {}
 
 bool InputSourceManager::configureFromRos(const std::string& inputSourcesNamespace) {
   XmlRpc::XmlRpcValue inputSourcesConfiguration;
@@ -41,6 +41,8 @@ bool InputSourceManager::configure(const XmlRpc::XmlRpcValue& config, const std:
     return false;
   }
 
+  nodeHandle_.param("asynchronous_input_processing", useProcessingThreads_, false);
+
   bool successfulConfiguration = true;
   std::set<std::string> subscribedTopics;
   SensorProcessorBase::GeneralParameters generalSensorProcessorConfig{nodeHandle_.param("robot_base_frame_id", std::string("/robot")),
@@ -76,4 +78,22 @@ int InputSourceManager::getNumberOfSources() {
   return static_cast<int>(sources_.size());
 }
 
+void InputSourceManager::setPipelineStatistics(PipelineStatistics* pipelineStatistics) {
+  for (Input& source : sources_) {
+    source.setPipelineStatistics(pipelineStatistics);
+  }
+}
+
+void InputSourceManager::setInputScheduler(InputScheduler& inputScheduler) const {
+  for (const Input& source : sources_) {
+    source.setInputScheduler(inputScheduler);
+  }
+}
+
+void InputSourceManager::stopProcessingThreads() {
+  for (Input& source : sources_) {
+    source.stopProcessingThread();
+  }
+}
+
 }  // namespace elevation_mapping
\ No newline at end of file
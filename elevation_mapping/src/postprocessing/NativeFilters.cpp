@@ -0,0 +1,460 @@
+/*
+ * NativeFilters.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/postprocessing/NativeFilters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace elevation_mapping {
+
+namespace {
+//! Number of rows processed as one task.
+const int rowsPerTile = 32;
+
+//! Prefix of the types of the native filters.
+const std::string nativeTypePrefix = "elevation_mapping/";
+
+//! Native filter types registered in addition to the built-in ones.
+std::unordered_map<std::string, elevation_mapping::NativeFilter::Factory>& getRegisteredTypes() {
+  static std::unordered_map<std::string, elevation_mapping::NativeFilter::Factory> registeredTypes;
+  return registeredTypes;
+}
+
+/*!
+ * Calls the function for each of the up to four contiguous blocks of the circular buffer, with the block's top left index in
+ * unwrapped index space, its top left index in the buffer and its size.
+ */
+void forEachBufferBlock(const grid_map::GridMap& map,
+                        const std::function<void(int unwrappedRow, int unwrappedCol, int row, int col, int rows, int cols)>& function) {
+  const grid_map::Size& size = map.getSize();
+  const grid_map::Index& startIndex = map.getStartIndex();
+  const int rowSpans[2][3] = {{0, startIndex(0), size(0) - startIndex(0)}, {size(0) - startIndex(0), 0, startIndex(0)}};
+  const int colSpans[2][3] = {{0, startIndex(1), size(1) - startIndex(1)}, {size(1) - startIndex(1), 0, startIndex(1)}};
+  for (const auto& colSpan : colSpans) {
+    for (const auto& rowSpan : rowSpans) {
+      if (rowSpan[2] > 0 && colSpan[2] > 0) {
+        function(rowSpan[0], colSpan[0], rowSpan[1], colSpan[1], rowSpan[2], colSpan[2]);
+      }
+    }
+  }
+}
+
+//! Copies a layer into unwrapped index order.
+grid_map::Matrix unwrapLayer(const grid_map::GridMap& map, const std::string& layer) {
+  const grid_map::Matrix& data = map.get(layer);
+  grid_map::Matrix unwrapped(data.rows(), data.cols());
+  forEachBufferBlock(map, [&](int unwrappedRow, int unwrappedCol, int row, int col, int rows, int cols) {
+    unwrapped.block(unwrappedRow, unwrappedCol, rows, cols) = data.block(row, col, rows, cols);
+  });
+  return unwrapped;
+}
+
+//! Writes values in unwrapped index order into a layer, which is added if it does not exist.
+void wrapLayer(const grid_map::Matrix& unwrapped, const std::string& layer, grid_map::GridMap& map) {
+  if (!map.exists(layer)) {
+    map.add(layer);
+  }
+  grid_map::Matrix& data = map.get(layer);
+  forEachBufferBlock(map, [&](int unwrappedRow, int unwrappedCol, int row, int col, int rows, int cols) {
+    data.block(row, col, rows, cols) = unwrapped.block(unwrappedRow, unwrappedCol, rows, cols);
+  });
+}
+
+//! Runs the function for the rows of every tile of rows in parallel.
+void parallelForRows(int numRows, ThreadPool& threadPool, const std::function<void(int row, std::size_t threadIndex)>& function) {
+  const std::size_t numTiles = static_cast<std::size_t>((numRows + rowsPerTile - 1) / rowsPerTile);
+  threadPool.parallelFor(numTiles, [&](std::size_t tile, std::size_t threadIndex) {
+    const int rowEnd = std::min(numRows, static_cast<int>(tile + 1) * rowsPerTile);
+    for (int row = static_cast<int>(tile) * rowsPerTile; row < rowEnd; ++row) {
+      function(row, threadIndex);
+    }
+  });
+}
+
+/*!
+ * Summed-area table, gives the sum over any rectangular window in constant time.
+ */
+class SummedAreaTable {
+ public:
+  /*!
+   * Computes the table by separable prefix sums, first along the columns and then along the rows.
+   * @param values the values to sum, in unwrapped index order.
+   * @param threadPool the threads to parallelize over.
+   */
+  void compute(const Eigen::MatrixXd& values, ThreadPool& threadPool) {
+    // The first row and column are zero, such that no window needs special treatment.
+    table_.setZero(values.rows() + 1, values.cols() + 1);
+    table_.bottomRightCorner(values.rows(), values.cols()) = values;
+    threadPool.parallelFor(static_cast<std::size_t>(values.cols()), [&](std::size_t col, std::size_t /*threadIndex*/) {
+      for (Eigen::Index row = 1; row < table_.rows(); ++row) {
+        table_(row, col + 1) += table_(row - 1, col + 1);
+      }
+    });
+    threadPool.parallelFor(static_cast<std::size_t>(values.rows()), [&](std::size_t row, std::size_t /*threadIndex*/) {
+      for (Eigen::Index col = 1; col < table_.cols(); ++col) {
+        table_(row + 1, col) += table_(row + 1, col - 1);
+      }
+    });
+  }
+
+  /*!
+   * Gets the sum over a window.
+   * @param rowMin the first row of the window.
+   * @param colMin the first column of the window.
+   * @param rowMax the last row of the window.
+   * @param colMax the last column of the window.
+   * @return the sum.
+   */
+  double sum(int rowMin, int colMin, int rowMax, int colMax) const {
+    return table_(rowMax + 1, colMax + 1) - table_(rowMin, colMax + 1) - table_(rowMax + 1, colMin) + table_(rowMin, colMin);
+  }
+
+ private:
+  //! Sums over the rows and columns before each entry.
+  Eigen::MatrixXd table_;
+};
+
+//! Window around a cell, clamped to the map.
+struct Window {
+  Window(int row, int col, int radiusInCells, const grid_map::Matrix& map)
+      : rowMin(std::max(row - radiusInCells, 0)),
+        colMin(std::max(col - radiusInCells, 0)),
+        rowMax(std::min(row + radiusInCells, static_cast<int>(map.rows()) - 1)),
+        colMax(std::min(col + radiusInCells, static_cast<int>(map.cols()) - 1)) {}
+  int rowMin;
+  int colMin;
+  int rowMax;
+  int colMax;
+};
+
+/*!
+ * Mean of the valid cells in the window around each valid cell.
+ */
+class BoxFilter : public NativeFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& parameters) override {
+    if (!readParameter(parameters, "output_layer", outputLayer_) || outputLayer_.empty()) {
+      ROS_ERROR("Native filter %s needs an output_layer.", name_.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  void apply(grid_map::GridMap& map, int radiusInCells, ThreadPool& threadPool) override {
+    const grid_map::Matrix input = unwrapLayer(map, inputLayer_);
+    const Eigen::MatrixXd isValid = input.array().isFinite().cast<double>().matrix();
+    SummedAreaTable sums;
+    SummedAreaTable counts;
+    sums.compute(input.array().isFinite().select(input.array(), 0.0f).cast<double>().matrix(), threadPool);
+    counts.compute(isValid, threadPool);
+
+    grid_map::Matrix output = grid_map::Matrix::Constant(input.rows(), input.cols(), NAN);
+    parallelForRows(static_cast<int>(input.rows()), threadPool, [&](int row, std::size_t /*threadIndex*/) {
+      for (int col = 0; col < input.cols(); ++col) {
+        if (std::isfinite(input(row, col))) {
+          const Window window(row, col, radiusInCells, input);
+          output(row, col) = static_cast<float>(sums.sum(window.rowMin, window.colMin, window.rowMax, window.colMax) /
+                                                counts.sum(window.rowMin, window.colMin, window.rowMax, window.colMax));
+        }
+      }
+    });
+    wrapLayer(output, outputLayer_, map);
+  }
+
+ private:
+  //! Layer to write the result to.
+  std::string outputLayer_;
+};
+
+/*!
+ * Median of the valid cells in the window around each valid cell.
+ */
+class MedianFilter : public NativeFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& parameters) override {
+    if (!readParameter(parameters, "output_layer", outputLayer_) || outputLayer_.empty()) {
+      ROS_ERROR("Native filter %s needs an output_layer.", name_.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  void apply(grid_map::GridMap& map, int radiusInCells, ThreadPool& threadPool) override {
+    const grid_map::Matrix input = unwrapLayer(map, inputLayer_);
+    grid_map::Matrix output = grid_map::Matrix::Constant(input.rows(), input.cols(), NAN);
+    std::vector<std::vector<float>> windowValues(threadPool.size());
+    parallelForRows(static_cast<int>(input.rows()), threadPool, [&](int row, std::size_t threadIndex) {
+      std::vector<float>& values = windowValues[threadIndex];
+      for (int col = 0; col < input.cols(); ++col) {
+        if (!std::isfinite(input(row, col))) {
+          continue;
+        }
+        const Window window(row, col, radiusInCells, input);
+        values.clear();
+        for (int windowCol = window.colMin; windowCol <= window.colMax; ++windowCol) {
+          for (int windowRow = window.rowMin; windowRow <= window.rowMax; ++windowRow) {
+            const float value = input(windowRow, windowCol);
+            if (std::isfinite(value)) {
+              values.push_back(value);
+            }
+          }
+        }
+        auto median = values.begin() + values.size() / 2;
+        std::nth_element(values.begin(), median, values.end());
+        output(row, col) = *median;
+      }
+    });
+    wrapLayer(output, outputLayer_, map);
+  }
+
+ private:
+  //! Layer to write the result to.
+  std::string outputLayer_;
+};
+
+//! Least squares plane fitted to the window around a cell.
+struct PlaneFit {
+  //! Gradient of the plane along the x and y axis of the map frame.
+  double gradientX;
+  double gradientY;
+  //! Variance of the heights around the plane.
+  double residualVariance;
+};
+
+/*!
+ * Base class of the filters which fit a plane to the valid cells in the window around each valid cell. The plane is fitted from
+ * the first and second moments of the window, which are summed from summed-area tables.
+ */
+class PlaneFitFilter : public NativeFilter {
+ protected:
+  /*!
+   * Computes the output values from the fitted plane.
+   * @param fit the plane.
+   * @param values the output values, one per output layer.
+   */
+  virtual void evaluate(const PlaneFit& fit, float* values) const = 0;
+
+  void apply(grid_map::GridMap& map, int radiusInCells, ThreadPool& threadPool) override {
+    const grid_map::Matrix input = unwrapLayer(map, inputLayer_);
+    const auto isValid = input.array().isFinite();
+    const Eigen::Index numValid = isValid.count();
+    // Subtract the mean height to keep the second moments well-conditioned.
+    const double referenceHeight = numValid > 0 ? isValid.select(input.array(), 0.0f).cast<double>().sum() / numValid : 0.0;
+    const Eigen::MatrixXd heights = isValid.select(input.cast<double>().array() - referenceHeight, 0.0).matrix();
+    const Eigen::MatrixXd counts = isValid.cast<double>().matrix();
+    Eigen::MatrixXd rows(input.rows(), input.cols());
+    Eigen::MatrixXd cols(input.rows(), input.cols());
+    for (Eigen::Index col = 0; col < input.cols(); ++col) {
+      rows.col(col) = counts.col(col).cwiseProduct(Eigen::VectorXd::LinSpaced(input.rows(), 0, input.rows() - 1));
+      cols.col(col) = counts.col(col) * static_cast<double>(col);
+    }
+
+    // Moments of the valid cells: n, i, j, z, ii, ij, jj, iz, jz, zz.
+    std::vector<SummedAreaTable> moments(10);
+    moments[0].compute(counts, threadPool);
+    moments[1].compute(rows, threadPool);
+    moments[2].compute(cols, threadPool);
+    moments[3].compute(heights, threadPool);
+    moments[4].compute(rows.cwiseProduct(rows), threadPool);
+    moments[5].compute(rows.cwiseProduct(cols), threadPool);
+    moments[6].compute(cols.cwiseProduct(cols), threadPool);
+    moments[7].compute(rows.cwiseProduct(heights), threadPool);
+    moments[8].compute(cols.cwiseProduct(heights), threadPool);
+    moments[9].compute(heights.cwiseProduct(heights), threadPool);
+
+    const double resolution = map.getResolution();
+    std::vector<grid_map::Matrix> outputs(outputLayers_.size(), grid_map::Matrix::Constant(input.rows(), input.cols(), NAN));
+    parallelForRows(static_cast<int>(input.rows()), threadPool, [&](int row, std::size_t /*threadIndex*/) {
+      std::vector<float> values(outputLayers_.size());
+      for (int col = 0; col < input.cols(); ++col) {
+        if (!std::isfinite(input(row, col))) {
+          continue;
+        }
+        const Window window(row, col, radiusInCells, input);
+        double sums[10];
+        for (std::size_t i = 0; i < moments.size(); ++i) {
+          sums[i] = moments[i].sum(window.rowMin, window.colMin, window.rowMax, window.colMax);
+        }
+        const double n = sums[0];
+        if (n < 3.0) {
+          continue;
+        }
+        const double meanI = sums[1] / n;
+        const double meanJ = sums[2] / n;
+        const double meanZ = sums[3] / n;
+        const double covII = sums[4] / n - meanI * meanI;
+        const double covIJ = sums[5] / n - meanI * meanJ;
+        const double covJJ = sums[6] / n - meanJ * meanJ;
+        const double covIZ = sums[7] / n - meanI * meanZ;
+        const double covJZ = sums[8] / n - meanJ * meanZ;
+        const double covZZ = sums[9] / n - meanZ * meanZ;
+        const double determinant = covII * covJJ - covIJ * covIJ;
+        if (determinant < 1e-9) {
+          // All valid cells are on a line.
+          continue;
+        }
+        // Gradient along the row and column index, the x and y axis of the map point into the opposite directions.
+        const double gradientI = (covJJ * covIZ - covIJ * covJZ) / determinant;
+        const double gradientJ = (covII * covJZ - covIJ * covIZ) / determinant;
+        const PlaneFit fit{-gradientI / resolution, -gradientJ / resolution,
+                           std::max(covZZ - gradientI * covIZ - gradientJ * covJZ, 0.0)};
+        evaluate(fit, values.data());
+        for (std::size_t i = 0; i < outputs.size(); ++i) {
+          outputs[i](row, col) = values[i];
+        }
+      }
+    });
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+      wrapLayer(outputs[i], outputLayers_[i], map);
+    }
+  }
+
+  //! Layers to write the results to.
+  std::vector<std::string> outputLayers_;
+};
+
+/*!
+ * Surface normals of the fitted planes, pointing upwards.
+ */
+class NormalsFilter : public PlaneFitFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& parameters) override {
+    std::string prefix = "normal_vectors_";
+    if (!readParameter(parameters, "output_layers_prefix", prefix)) {
+      return false;
+    }
+    outputLayers_ = {prefix + "x", prefix + "y", prefix + "z"};
+    return true;
+  }
+
+  void evaluate(const PlaneFit& fit, float* values) const override {
+    const Eigen::Vector3d normal = Eigen::Vector3d(-fit.gradientX, -fit.gradientY, 1.0).normalized();
+    values[0] = static_cast<float>(normal.x());
+    values[1] = static_cast<float>(normal.y());
+    values[2] = static_cast<float>(normal.z());
+  }
+};
+
+/*!
+ * Slope of the fitted planes, in rad.
+ */
+class SlopeFilter : public PlaneFitFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& parameters) override {
+    std::string outputLayer = "slope";
+    if (!readParameter(parameters, "output_layer", outputLayer)) {
+      return false;
+    }
+    outputLayers_ = {outputLayer};
+    return true;
+  }
+
+  void evaluate(const PlaneFit& fit, float* values) const override {
+    values[0] = static_cast<float>(std::atan(std::sqrt(fit.gradientX * fit.gradientX + fit.gradientY * fit.gradientY)));
+  }
+};
+
+/*!
+ * Roughness, the standard deviation of the heights around the fitted planes, in m.
+ */
+class RoughnessFilter : public PlaneFitFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& parameters) override {
+    std::string outputLayer = "roughness";
+    if (!readParameter(parameters, "output_layer", outputLayer)) {
+      return false;
+    }
+    outputLayers_ = {outputLayer};
+    return true;
+  }
+
+  void evaluate(const PlaneFit& fit, float* values) const override { values[0] = static_cast<float>(std::sqrt(fit.residualVariance)); }
+};
+}  // namespace
+
+std::unique_ptr<NativeFilter> NativeFilter::create(const std::string& type) {
+  if (type == nativeTypePrefix + "BoxFilter") {
+    return std::make_unique<BoxFilter>();
+  } else if (type == nativeTypePrefix + "MedianFilter") {
+    return std::make_unique<MedianFilter>();
+  } else if (type == nativeTypePrefix + "NormalsFilter") {
+    return std::make_unique<NormalsFilter>();
+  } else if (type == nativeTypePrefix + "SlopeFilter") {
+    return std::make_unique<SlopeFilter>();
+  } else if (type == nativeTypePrefix + "RoughnessFilter") {
+    return std::make_unique<RoughnessFilter>();
+  }
+  const auto registeredType = getRegisteredTypes().find(type);
+  if (registeredType != getRegisteredTypes().end()) {
+    return registeredType->second();
+  }
+  return nullptr;
+}
+
+bool NativeFilter::registerType(const std::string& type, Factory factory) {
+  if (!isNativeType(type) || create(type)) {
+    return false;
+  }
+  getRegisteredTypes().emplace(type, std::move(factory));
+  return true;
+}
+
+bool NativeFilter::isNativeType(const std::string& type) {
+  return type.compare(0, nativeTypePrefix.size(), nativeTypePrefix) == 0;
+}
+
+bool NativeFilter::configure(const std::string& name, const XmlRpc::XmlRpcValue& parameters) {
+  name_ = name;
+  if (parameters.getType() != XmlRpc::XmlRpcValue::TypeStruct) {
+    ROS_ERROR("Native filter %s needs its params as map.", name_.c_str());
+    return false;
+  }
+  if (!readParameter(parameters, "input_layer", inputLayer_) || inputLayer_.empty()) {
+    ROS_ERROR("Native filter %s needs an input_layer.", name_.c_str());
+    return false;
+  }
+  if (!parameters.hasMember("radius") || (parameters["radius"].getType() != XmlRpc::XmlRpcValue::TypeDouble &&
+                                          parameters["radius"].getType() != XmlRpc::XmlRpcValue::TypeInt)) {
+    ROS_ERROR("Native filter %s needs a radius.", name_.c_str());
+    return false;
+  }
+  radius_ = parameters["radius"].getType() == XmlRpc::XmlRpcValue::TypeInt ? static_cast<int>(parameters["radius"])
+                                                                           : static_cast<double>(parameters["radius"]);
+  if (radius_ < 0.0) {
+    ROS_ERROR("The radius of native filter %s is negative.", name_.c_str());
+    return false;
+  }
+  return readParameters(parameters);
+}
+
+bool NativeFilter::update(grid_map::GridMap& map, ThreadPool& threadPool) {
+  if (!map.exists(inputLayer_)) {
+    ROS_ERROR("Native filter %s: the input layer %s does not exist.", name_.c_str(), inputLayer_.c_str());
+    return false;
+  }
+  apply(map, static_cast<int>(std::round(radius_ / map.getResolution())), threadPool);
+  return true;
+}
+
+bool NativeFilter::readParameter(const XmlRpc::XmlRpcValue& parameters, const std::string& name, std::string& value) const {
+  if (!parameters.hasMember(name)) {
+    return true;
+  }
+  if (parameters[name].getType() != XmlRpc::XmlRpcValue::TypeString) {
+    ROS_ERROR("Parameter %s of native filter %s has the wrong type.", name.c_str(), name_.c_str());
+    return false;
+  }
+  value = static_cast<std::string>(parameters[name]);
+  return true;
+}
+
+}  // namespace elevation_mapping
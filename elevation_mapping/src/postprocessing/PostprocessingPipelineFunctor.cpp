@@ -8,24 +8,47 @@
  *  Note. Large parts are adopted from grid_map_demos/FiltersDemo.cpp.
  */
 
-#include <grid_map_ros/grid_map_ros.hpp>
-
 #include "elevation_mapping/postprocessing/PostprocessingPipelineFunctor.hpp"
 
 namespace elevation_mapping {
 
+namespace {
+//! Checks whether two layers are equal, invalid cells are equal if both are invalid.
+bool isEqual(const grid_map::Matrix& layer, const grid_map::Matrix& otherLayer) {
+  return (layer.array() == otherLayer.array() || (layer.array().isNaN() && otherLayer.array().isNaN())).all();
+}
+}  // namespace
+
 PostprocessingPipelineFunctor::PostprocessingPipelineFunctor(ros::NodeHandle& nodeHandle)
-    : nodeHandle_(nodeHandle), filterChain_("grid_map::GridMap"), filterChainConfigured_(false) {
+    : nodeHandle_(nodeHandle), filterChainConfigured_(false) {
   // TODO (magnus) Add logic when setting up failed. What happens actually if it is not configured?
   readParameters();
 
-  publisher_ = nodeHandle_.advertise<grid_map_msgs::GridMap>(outputTopic_, 1, true);
+  // Setup filter chains.
+  const std::vector<std::string> chainParametersNames =
+      stageParametersNames_.empty() ? std::vector<std::string>{filterChainParametersName_} : stageParametersNames_;
+  std::vector<std::string> configuredStages;
+  for (const auto& chainParametersName : chainParametersNames) {
+    Pipeline pipeline;
+    if (!nodeHandle.hasParam(chainParametersName) || !configurePipeline(chainParametersName, pipeline)) {
+      // A single pipeline is reported below, together with the fallback to publishing the raw map.
+      if (!stageParametersNames_.empty()) {
+        ROS_WARN("Could not configure the filter chain of stage %s.", chainParametersName.c_str());
+      }
+      continue;
+    }
+    pipelines_.push_back(std::move(pipeline));
+    configuredStages.push_back(chainParametersName);
+  }
 
-  // Setup filter chain.
-  if (!nodeHandle.hasParam(filterChainParametersName_) || !filterChain_.configure(filterChainParametersName_, nodeHandle)) {
+  if (pipelines_.empty()) {
     ROS_WARN("Could not configure the filter chain. Will publish the raw elevation map without postprocessing!");
     return;
   }
+  if (!stageParametersNames_.empty()) {
+    stageParametersNames_ = configuredStages;
+    stageThreadPool_ = std::make_unique<ThreadPool>(static_cast<int>(pipelines_.size()));
+  }
 
   filterChainConfigured_ = true;
 }
@@ -33,18 +56,118 @@ PostprocessingPipelineFunctor::PostprocessingPipelineFunctor(ros::NodeHandle& no
 PostprocessingPipelineFunctor::~PostprocessingPipelineFunctor() = default;
 
 void PostprocessingPipelineFunctor::readParameters() {
-  nodeHandle_.param("output_topic", outputTopic_, std::string("elevation_map_raw"));
   nodeHandle_.param("postprocessor_pipeline_name", filterChainParametersName_, std::string("postprocessor_pipeline"));
+  nodeHandle_.param("postprocessor_pipeline_stages", stageParametersNames_, std::vector<std::string>());
+  filterThreadPool_ = std::make_unique<ThreadPool>(nodeHandle_.param("postprocessor_filter_num_threads", 1));
 }
 
-grid_map::GridMap PostprocessingPipelineFunctor::operator()(GridMap& inputMap) {
+bool PostprocessingPipelineFunctor::configurePipeline(const std::string& parametersName, Pipeline& pipeline) {
+  XmlRpc::XmlRpcValue config;
+  if (!nodeHandle_.getParam(parametersName, config) || config.getType() != XmlRpc::XmlRpcValue::TypeArray) {
+    ROS_ERROR("The filter chain %s must be specified as list.", parametersName.c_str());
+    return false;
+  }
+
+  // Without native filters, the pipeline is a single filter chain.
+  const auto isNativeFilter = [&config](int i) {
+    return config[i].getType() == XmlRpc::XmlRpcValue::TypeStruct && config[i].hasMember("type") &&
+           config[i]["type"].getType() == XmlRpc::XmlRpcValue::TypeString &&
+           NativeFilter::isNativeType(static_cast<std::string>(config[i]["type"]));
+  };
+  bool hasNativeFilters = false;
+  for (int i = 0; i < config.size(); ++i) {
+    hasNativeFilters = hasNativeFilters || isNativeFilter(i);
+  }
+  if (!hasNativeFilters) {
+    PipelineStep step;
+    step.filterChain = std::make_unique<filters::FilterChain<grid_map::GridMap>>("grid_map::GridMap");
+    if (!step.filterChain->configure(parametersName, nodeHandle_)) {
+      return false;
+    }
+    pipeline.push_back(std::move(step));
+    return true;
+  }
+
+  // Otherwise, the grid_map filters between the native filters form filter chains.
+  XmlRpc::XmlRpcValue chainConfig;
+  int chainLength = 0;
+  const auto addFilterChain = [&]() {
+    if (chainLength == 0) {
+      return true;
+    }
+    PipelineStep step;
+    step.filterChain = std::make_unique<filters::FilterChain<grid_map::GridMap>>("grid_map::GridMap");
+    if (!step.filterChain->configure(chainConfig, nodeHandle_.getNamespace())) {
+      return false;
+    }
+    pipeline.push_back(std::move(step));
+    chainConfig = XmlRpc::XmlRpcValue();
+    chainLength = 0;
+    return true;
+  };
+  for (int i = 0; i < config.size(); ++i) {
+    if (!isNativeFilter(i)) {
+      chainConfig[chainLength++] = config[i];
+      continue;
+    }
+    if (!addFilterChain()) {
+      return false;
+    }
+    const std::string type = static_cast<std::string>(config[i]["type"]);
+    const bool hasName = config[i].hasMember("name") && config[i]["name"].getType() == XmlRpc::XmlRpcValue::TypeString;
+    const std::string name = hasName ? static_cast<std::string>(config[i]["name"]) : type;
+    PipelineStep step;
+    step.nativeFilter = NativeFilter::create(type);
+    if (!step.nativeFilter) {
+      ROS_ERROR("The native filter type %s of filter %s does not exist.", type.c_str(), name.c_str());
+      return false;
+    }
+    if (!step.nativeFilter->configure(name, config[i].hasMember("params") ? config[i]["params"] : XmlRpc::XmlRpcValue())) {
+      return false;
+    }
+    pipeline.push_back(std::move(step));
+  }
+  return addFilterChain();
+}
+
+bool PostprocessingPipelineFunctor::runPipeline(Pipeline& pipeline, const GridMap& inputMap, GridMap& outputMap) {
+  // The map is only copied once, native filters work in place on the copy.
+  const GridMap* map = &inputMap;
+  for (auto& step : pipeline) {
+    if (step.filterChain) {
+      GridMap stepOutputMap;
+      if (!step.filterChain->update(*map, stepOutputMap)) {
+        return false;
+      }
+      outputMap = std::move(stepOutputMap);
+    } else {
+      if (map != &outputMap) {
+        outputMap = *map;
+      }
+      if (!step.nativeFilter->update(outputMap, *filterThreadPool_)) {
+        return false;
+      }
+    }
+    map = &outputMap;
+  }
+  if (map != &outputMap) {
+    outputMap = *map;
+  }
+  return true;
+}
+
+grid_map::GridMap PostprocessingPipelineFunctor::operator()(const GridMap& inputMap) {
   if (not filterChainConfigured_) {
     ROS_WARN_ONCE("No postprocessing pipeline was configured. Forwarding the raw elevation map!");
     return inputMap;
   }
 
+  if (stageThreadPool_) {
+    return runStages(inputMap);
+  }
+
   grid_map::GridMap outputMap;
-  if (not filterChain_.update(inputMap, outputMap)) {
+  if (not runPipeline(pipelines_.front(), inputMap, outputMap)) {
     ROS_ERROR("Could not perform the grid map filter chain! Forwarding the raw elevation map!");
     return inputMap;
   }
@@ -52,16 +175,38 @@ grid_map::GridMap PostprocessingPipelineFunctor::operator()(GridMap& inputMap) {
   return outputMap;
 }
 
-void PostprocessingPipelineFunctor::publish(const GridMap& gridMap) const {
-  // Publish filtered output grid map.
-  grid_map_msgs::GridMap outputMessage;
-  grid_map::GridMapRosConverter::toMessage(gridMap, outputMessage);
-  publisher_.publish(outputMessage);
-  ROS_DEBUG("Elevation map raw has been published.");
-}
+grid_map::GridMap PostprocessingPipelineFunctor::runStages(const GridMap& inputMap) {
+  // The stages only read the shared input, every stage writes into its own output map.
+  std::vector<GridMap> stageOutputMaps(pipelines_.size());
+  std::vector<char> stageSucceeded(pipelines_.size(), false);
+  stageThreadPool_->parallelFor(pipelines_.size(), [&](std::size_t stage, std::size_t /*threadIndex*/) {
+    stageSucceeded[stage] = runPipeline(pipelines_[stage], inputMap, stageOutputMaps[stage]);
+  });
 
-bool PostprocessingPipelineFunctor::hasSubscribers() const {
-  return publisher_.getNumSubscribers() > 0;
+  GridMap outputMap = inputMap;
+  for (std::size_t stage = 0; stage < pipelines_.size(); ++stage) {
+    const GridMap& stageOutputMap = stageOutputMaps[stage];
+    if (!stageSucceeded[stage]) {
+      ROS_ERROR("Could not perform the grid map filter chain of stage %s! Skipping its layers.", stageParametersNames_[stage].c_str());
+      continue;
+    }
+    if ((stageOutputMap.getSize() != inputMap.getSize()).any() || stageOutputMap.getResolution() != inputMap.getResolution() ||
+        stageOutputMap.getPosition() != inputMap.getPosition() || (stageOutputMap.getStartIndex() != inputMap.getStartIndex()).any()) {
+      ROS_ERROR("The stage %s changed the geometry of the map! Skipping its layers.", stageParametersNames_[stage].c_str());
+      continue;
+    }
+    for (const auto& layer : stageOutputMap.getLayers()) {
+      if (!inputMap.exists(layer)) {
+        outputMap.add(layer, stageOutputMap.get(layer));
+      } else if (!isEqual(stageOutputMap.get(layer), inputMap.get(layer))) {
+        // The stages share the input layers, changes by a stage would depend on the order of the stages and are discarded.
+        ROS_WARN_ONCE("The stage %s changed the input layer %s! Stages can only add layers, the change is discarded.",
+                      stageParametersNames_[stage].c_str(), layer.c_str());
+      }
+    }
+  }
+
+  return outputMap;
 }
 
 }  // namespace elevation_mapping
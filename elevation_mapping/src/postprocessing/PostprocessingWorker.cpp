@@ -14,15 +14,10 @@ PostprocessingWorker::PostprocessingWorker(ros::NodeHandle nodeHandle)
     : functor_(nodeHandle), work_(ioService_), thread_(boost::bind(&boost::asio::io_service::run, &ioService_)) {}
 
 PostprocessingWorker::GridMap PostprocessingWorker::processBuffer() {
-  return functor_(dataBuffer_);
-}
-
-void PostprocessingWorker::publish(const GridMap& gridMap) const {
-  functor_.publish(gridMap);
-}
-
-bool PostprocessingWorker::hasSubscribers() const {
-  return functor_.hasSubscribers();
+  const GridMap result = functor_(*dataBuffer_);
+  // Release the shared map as soon as it is not needed anymore.
+  dataBuffer_.reset();
+  return result;
 }
 
 }  // namespace elevation_mapping
@@ -8,15 +8,30 @@
 
 #include "elevation_mapping/postprocessing/PostprocessorPool.hpp"
 
+#include <algorithm>
+
+#include <grid_map_ros/grid_map_ros.hpp>
+#include <boost/make_shared.hpp>
+
 namespace elevation_mapping {
 
-PostprocessorPool::PostprocessorPool(std::size_t poolSize, ros::NodeHandle nodeHandle) {
+namespace {
+//! Group of the postprocessing measurements in the pipeline statistics.
+const std::string statisticsGroup = "postprocessing";
+}  // namespace
+
+PostprocessorPool::PostprocessorPool(std::size_t poolSize, ros::NodeHandle nodeHandle, PipelineStatistics* pipelineStatistics)
+    : queueSize_(static_cast<std::size_t>(std::max(nodeHandle.param("postprocessor_queue_size", 1), 0))),
+      pipelineStatistics_(pipelineStatistics) {
   for (std::size_t i = 0; i < poolSize; ++i) {
     // Add worker to the collection.
     workers_.emplace_back(std::make_unique<PostprocessingWorker>(nodeHandle));
     // Create one service per thread
     availableServices_.push_back(i);
   }
+  const std::string outputTopic = nodeHandle.param("output_topic", std::string("elevation_map_raw"));
+  publisher_ = nodeHandle.advertise<grid_map_msgs::GridMap>(outputTopic, 1, true);
+  deltaPublisher_ = std::make_unique<GridMapDeltaPublisher>(nodeHandle, outputTopic);
 }
 
 PostprocessorPool::~PostprocessorPool() {
@@ -37,45 +52,104 @@ PostprocessorPool::~PostprocessorPool() {
 }
 
 bool PostprocessorPool::runTask(const GridMap& gridMap) {
+  return runTask(std::make_shared<const GridMap>(gridMap));
+}
+
+bool PostprocessorPool::runTask(std::shared_ptr<const GridMap> gridMap) {
+  boost::lock_guard<boost::mutex> lock(availableServicesMutex_);
+  Task task{nextSequence_ + 1, std::move(gridMap)};
+
   // Get an available service id from the shared services pool in a mutually exclusive manner.
-  size_t serviceIndex;
-  {
-    boost::lock_guard<boost::mutex> lock(availableServicesMutex_);
-    if (availableServices_.empty()) {
-      return false;
-    }
-    serviceIndex = availableServices_.back();
+  if (!availableServices_.empty()) {
+    const size_t serviceIndex = availableServices_.back();
     availableServices_.pop_back();
+    ++nextSequence_;
+    dispatchTask(serviceIndex, std::move(task));
+    return true;
+  }
+
+  // All workers are busy, wait in the queue. The latest map wins over the oldest waiting one.
+  if (queueSize_ == 0) {
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->addDroppedFrames(statisticsGroup);
+    }
+    return false;
+  }
+  if (taskQueue_.size() >= queueSize_) {
+    ROS_DEBUG("Postprocessor pool replaces the waiting task %zu by task %zu.", taskQueue_.front().sequence, task.sequence);
+    taskQueue_.pop_front();
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->addDroppedFrames(statisticsGroup);
+    }
   }
+  ++nextSequence_;
+  taskQueue_.push_back(std::move(task));
+  if (pipelineStatistics_ != nullptr) {
+    pipelineStatistics_->setQueueDepth(statisticsGroup, "task", taskQueue_.size());
+  }
+  return true;
+}
 
-  // Copy data to the buffer for the worker.
-  workers_.at(serviceIndex)->setDataBuffer(gridMap);
+void PostprocessorPool::dispatchTask(size_t serviceIndex, Task task) {
+  // Hand the data over to the worker.
+  workers_.at(serviceIndex)->setDataBuffer(std::move(task.gridMap));
 
   // Create a task with the post-processor and dispatch it.
-  auto task = std::bind(&PostprocessorPool::wrapTask, this, serviceIndex);
-  workers_.at(serviceIndex)->ioService().post(task);
-  return true;
+  auto wrappedTask = std::bind(&PostprocessorPool::wrapTask, this, serviceIndex, task.sequence);
+  workers_.at(serviceIndex)->ioService().post(wrappedTask);
 }
 
-void PostprocessorPool::wrapTask(size_t serviceIndex) {
+void PostprocessorPool::wrapTask(size_t serviceIndex, std::size_t sequence) {
   // Run the user supplied task.
   try {
-    GridMap postprocessedMap = workers_.at(serviceIndex)->processBuffer();
-    workers_.at(serviceIndex)->publish(postprocessedMap);
+    const ros::WallTime startTime = ros::WallTime::now();
+    const GridMap postprocessedMap = workers_.at(serviceIndex)->processBuffer();
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->addDuration(statisticsGroup, PipelineStage::Postprocess, (ros::WallTime::now() - startTime).toSec());
+    }
+    publish(postprocessedMap, sequence);
   }
   // Suppress all exceptions.
   catch (const std::exception& exception) {
     ROS_ERROR_STREAM("Postprocessor pipeline, thread " << serviceIndex << " experienced an error: " << exception.what());
   }
 
-  // Task has finished, so increment count of available threads.
+  // Task has finished, so continue with the oldest waiting task or increment count of available threads.
   boost::unique_lock<boost::mutex> lock(availableServicesMutex_);
+  if (!taskQueue_.empty()) {
+    Task task = std::move(taskQueue_.front());
+    taskQueue_.pop_front();
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->setQueueDepth(statisticsGroup, "task", taskQueue_.size());
+    }
+    dispatchTask(serviceIndex, std::move(task));
+    return;
+  }
   availableServices_.push_back(serviceIndex);
 }
 
+void PostprocessorPool::publish(const GridMap& gridMap, std::size_t sequence) {
+  boost::lock_guard<boost::mutex> lock(publisherMutex_);
+  if (sequence < lastPublishedSequence_) {
+    ROS_DEBUG("Postprocessor pool discards the result of task %zu, task %zu has already been published.", sequence, lastPublishedSequence_);
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->addDroppedFrames(statisticsGroup);
+    }
+    return;
+  }
+  lastPublishedSequence_ = sequence;
+  PipelineStatistics::ScopedTimer timer(pipelineStatistics_, statisticsGroup, PipelineStage::Publish);
+
+  // Publish filtered output grid map, as shared pointer to avoid the serialization for subscribers in the same nodelet manager.
+  const grid_map_msgs::GridMapPtr outputMessage = boost::make_shared<grid_map_msgs::GridMap>();
+  grid_map::GridMapRosConverter::toMessage(gridMap, *outputMessage);
+  publisher_.publish(outputMessage);
+  ROS_DEBUG("Elevation map raw has been published.");
+  deltaPublisher_->publish(gridMap);
+}
+
 bool PostprocessorPool::pipelineHasSubscribers() const {
-  return std::all_of(workers_.cbegin(), workers_.cend(),
-                     [](const std::unique_ptr<PostprocessingWorker>& worker) { return worker->hasSubscribers(); });
+  return publisher_.getNumSubscribers() > 0 || deltaPublisher_->hasSubscribers();
 }
 
-}  // namespace elevation_mapping
\ No newline at end of file
+}  // namespace elevation_mapping
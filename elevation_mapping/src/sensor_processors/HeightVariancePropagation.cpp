@@ -0,0 +1,70 @@
+/*
+ * HeightVariancePropagation.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/sensor_processors/HeightVariancePropagation.hpp"
+
+// Eigen
+#include <Eigen/Geometry>
+
+// STL
+#include <algorithm>
+
+namespace elevation_mapping {
+
+HeightVariancePropagation::HeightVariancePropagation(const Eigen::Matrix3f& mapToBaseRotation, const Eigen::Matrix3f& baseToSensorRotation,
+                                                     const Eigen::Vector3f& baseToSensorTranslation, const Eigen::Matrix3f& rotationVariance)
+    : rotationVariance_(0.5f * (rotationVariance + rotationVariance.transpose())) {
+  const Eigen::RowVector3f projectionVector = Eigen::RowVector3f::UnitZ();  // P
+
+  // Sensor Jacobian (J_s), only the squares of its entries are needed for the diagonal sensor covariance.
+  const Eigen::RowVector3f sensorJacobian = projectionVector * (baseToSensorRotation * mapToBaseRotation).transpose();
+  sensorJacobianSquared_ << sensorJacobian(0) * sensorJacobian(0) + sensorJacobian(1) * sensorJacobian(1), sensorJacobian(2) * sensorJacobian(2);
+
+  // Rotation Jacobian (J_q). With a = (P * C_BM^T)^T, since a^T * [v]x = (a x v)^T:
+  // J_q^T = a x (C_SB^T * S_r_SP + B_r_BS) = [a]x * C_SB^T * S_r_SP + a x B_r_BS.
+  const Eigen::Vector3f a = (projectionVector * mapToBaseRotation.transpose()).transpose();
+  const Eigen::Matrix3f C_SB_transpose = baseToSensorRotation.transpose();
+  for (int i = 0; i < 3; ++i) {
+    rotationJacobianLinear_.col(i) = a.cross(C_SB_transpose.col(i));
+  }
+  rotationJacobianOffset_ = a.cross(baseToSensorTranslation);
+}
+
+float HeightVariancePropagation::computeHeightVariance(const Eigen::Vector3f& pointSensorFrame, float lateralVariance,
+                                                       float normalVariance) const {
+  const Eigen::Vector3f rotationJacobian = rotationJacobianLinear_ * pointSensorFrame + rotationJacobianOffset_;
+  return rotationJacobian.dot(rotationVariance_ * rotationJacobian) + sensorJacobianSquared_(0) * lateralVariance +
+         sensorJacobianSquared_(1) * normalVariance;
+}
+
+void HeightVariancePropagation::computeHeightVariances(const Eigen::Ref<const Points>& pointsSensorFrame,
+                                                       const Eigen::Ref<const SensorVariances>& sensorVariances,
+                                                       Eigen::Ref<Eigen::VectorXf> variances) const {
+  // Blocks of points whose rotation Jacobians fit into the cache, each step is a vectorized pass over a block.
+  constexpr Eigen::Index blockSize = 256;
+  Eigen::Array<float, blockSize, 3> rotationJacobians;
+  const Eigen::Index numPoints = pointsSensorFrame.rows();
+  for (Eigen::Index begin = 0; begin < numPoints; begin += blockSize) {
+    const Eigen::Index size = std::min(blockSize, numPoints - begin);
+    const auto points = pointsSensorFrame.middleRows(begin, size);
+    for (int i = 0; i < 3; ++i) {
+      rotationJacobians.col(i).head(size) = rotationJacobianLinear_(i, 0) * points.col(0) + rotationJacobianLinear_(i, 1) * points.col(1) +
+                                            rotationJacobianLinear_(i, 2) * points.col(2) + rotationJacobianOffset_(i);
+    }
+    const auto j0 = rotationJacobians.col(0).head(size);
+    const auto j1 = rotationJacobians.col(1).head(size);
+    const auto j2 = rotationJacobians.col(2).head(size);
+    const auto lateralVariances = sensorVariances.col(0).segment(begin, size);
+    const auto normalVariances = sensorVariances.col(1).segment(begin, size);
+    variances.segment(begin, size).array() =
+        rotationVariance_(0, 0) * j0.square() + rotationVariance_(1, 1) * j1.square() + rotationVariance_(2, 2) * j2.square() +
+        2.0f * (rotationVariance_(0, 1) * j0 * j1 + rotationVariance_(0, 2) * j0 * j2 + rotationVariance_(1, 2) * j1 * j2) +
+        sensorJacobianSquared_(0) * lateralVariances + sensorJacobianSquared_(1) * normalVariances;
+  }
+}
+
+}  // namespace elevation_mapping
@@ -8,7 +8,6 @@
 
 #include "elevation_mapping/sensor_processors/LaserSensorProcessor.hpp"
 
-#include <pcl/filters/passthrough.h>
 #include <limits>
 #include <string>
 #include <vector>
@@ -40,62 +39,24 @@ bool LaserSensorProcessor::readParameters() {
   return true;
 }
 
-bool LaserSensorProcessor::computeVariances(const PointCloudType::ConstPtr pointCloud,
-                                            const Eigen::Matrix<double, 6, 6>& robotPoseCovariance, Eigen::VectorXf& variances) {
-  variances.resize(pointCloud->size());
-
-  // Projection vector (P).
-  const Eigen::RowVector3f projectionVector = Eigen::RowVector3f::UnitZ();
-
-  // Sensor Jacobian (J_s).
-  const Eigen::RowVector3f sensorJacobian =
-      projectionVector * (rotationMapToBase_.transposed() * rotationBaseToSensor_.transposed()).toImplementation().cast<float>();
-
-  // Robot rotation covariance matrix (Sigma_q).
-  Eigen::Matrix3f rotationVariance = robotPoseCovariance.bottomRightCorner(3, 3).cast<float>();
-
-  // Preparations for robot rotation Jacobian (J_q) to minimize computation for every point in point cloud.
-  const Eigen::Matrix3f C_BM_transpose = rotationMapToBase_.transposed().toImplementation().cast<float>();
-  const Eigen::RowVector3f P_mul_C_BM_transpose = projectionVector * C_BM_transpose;
-  const Eigen::Matrix3f C_SB_transpose = rotationBaseToSensor_.transposed().toImplementation().cast<float>();
-  const Eigen::Matrix3f B_r_BS_skew =
-      kindr::getSkewMatrixFromVector(Eigen::Vector3f(translationBaseToSensorInBaseFrame_.toImplementation().cast<float>()));
-
+bool LaserSensorProcessor::processPoints(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                                         const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame,
+                                         Eigen::VectorXf& variances) {
   const float varianceNormal = sensorParameters_.at("min_radius") * sensorParameters_.at("min_radius");
   const float beamConstant = sensorParameters_.at("beam_constant");
   const float beamAngle = sensorParameters_.at("beam_angle");
-  for (size_t i = 0; i < pointCloud->size(); ++i) {
-    // TODO(needs assignment): Move this loop body into a function for better unit testing.
-    // For every point in point cloud.
-
-    // Preparation.
-    const auto& point = pointCloud->points[i];
-    const Eigen::Vector3f pointVector(point.x, point.y, point.z);  // S_r_SP // NOLINT(cppcoreguidelines-pro-type-union-access)
-
-    // Measurement distance.
-    const float measurementDistance = pointVector.norm();
 
-    // Compute sensor covariance matrix (Sigma_S) with sensor model.
-    float varianceLateral = beamConstant + beamAngle * measurementDistance;
-    varianceLateral *= varianceLateral;
-
-    Eigen::Matrix3f sensorVariance = Eigen::Matrix3f::Zero();
-    sensorVariance.diagonal() << varianceLateral, varianceLateral, varianceNormal;
-
-    // Robot rotation Jacobian (J_q).
-    const Eigen::Matrix3f C_SB_transpose_times_S_r_SP_skew = kindr::getSkewMatrixFromVector(Eigen::Vector3f(C_SB_transpose * pointVector));
-    const Eigen::RowVector3f rotationJacobian = P_mul_C_BM_transpose * (C_SB_transpose_times_S_r_SP_skew + B_r_BS_skew);
-
-    // Measurement variance for map (error propagation law).
-    float heightVariance = 0.0;  // sigma_p
-    heightVariance = rotationJacobian * rotationVariance * rotationJacobian.transpose();
-    heightVariance += sensorJacobian * sensorVariance * sensorJacobian.transpose();
-
-    // Copy to list.
-    variances(i) = heightVariance;
-  }
-
-  return true;
+  return processPointsWithModel(
+      pointCloud, inputToSensor, propagation, pointCloudMapFrame, variances, [](const Eigen::Vector3f& /*pointSensorFrame*/) { return true; },
+      [&](const pcl::PointXYZRGBConfidenceRatio& /*point*/, const Eigen::Vector3f& pointSensorFrame, std::size_t /*index*/) {
+        // Measurement distance.
+        const float measurementDistance = pointSensorFrame.norm();
+
+        // Compute sensor covariance matrix (Sigma_S) with sensor model.
+        float varianceLateral = beamConstant + beamAngle * measurementDistance;
+        varianceLateral *= varianceLateral;
+        return Eigen::Vector2f(varianceLateral, varianceNormal);
+      });
 }
 
 }  // namespace elevation_mapping
@@ -11,8 +11,7 @@
 // PCL
 #include <pcl/common/io.h>
 #include <pcl/common/transforms.h>
-#include <pcl/filters/extract_indices.h>
-#include <pcl/filters/passthrough.h>
+#include <pcl/filters/filter.h>
 #include <pcl/filters/voxel_grid.h>
 #include <pcl/pcl_base.h>
 
@@ -22,6 +21,7 @@
 // STL
 #include <cmath>
 #include <limits>
+#include <string>
 #include <vector>
 
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
@@ -33,9 +33,16 @@ SensorProcessorBase::SensorProcessorBase(ros::NodeHandle& nodeHandle, const Gene
       ignorePointsUpperThreshold_(std::numeric_limits<double>::infinity()),
       ignorePointsLowerThreshold_(-std::numeric_limits<double>::infinity()),
       applyVoxelGridFilter_(false),
-      firstTfAvailable_(false) {
+      isSensorTransformStatic_(true),
+      transformTimeout_(1.0),
+      transformRetryPeriod_(0.01),
+      firstTfAvailable_(false),
+      pipelineStatistics_(nullptr),
+      sourceName_("point_cloud"),
+      pointCloudSensorFrame_(new PointCloudType) {
   pcl::console::setVerbosityLevel(pcl::console::L_ERROR);
   transformationSensorToMap_.setIdentity();
+  transformationSensorToBase_.setIdentity();
   generalParameters_ = generalConfig;
   ROS_DEBUG(
       "Sensor processor general parameters are:"
@@ -52,6 +59,14 @@ bool SensorProcessorBase::readParameters() {
 
   nodeHandle_.param("sensor_processor/apply_voxelgrid_filter", applyVoxelGridFilter_, false);
   nodeHandle_.param("sensor_processor/voxelgrid_filter_size", sensorParameters_["voxelgrid_filter_size"], 0.0);
+
+  nodeHandle_.param("sensor_processor/static_sensor_transform", isSensorTransformStatic_, true);
+  double transformTimeout;
+  nodeHandle_.param("sensor_processor/transform_timeout", transformTimeout, 1.0);
+  transformTimeout_.fromSec(transformTimeout);
+  double transformRetryPeriod;
+  nodeHandle_.param("sensor_processor/transform_retry_period", transformRetryPeriod, 0.01);
+  transformRetryPeriod_.fromSec(transformRetryPeriod);
   return true;
 }
 
@@ -67,47 +82,124 @@ bool SensorProcessorBase::process(const PointCloudType::ConstPtr pointCloudInput
     return false;
   }
 
-  // Transform into sensor frame.
-  PointCloudType::Ptr pointCloudSensorFrame(new PointCloudType);
-  transformPointCloud(pointCloudInput, pointCloudSensorFrame, sensorFrameId_);
+  // Transformation into sensor frame, applied on the fly to every point.
+  Eigen::Affine3d inputToSensor = Eigen::Affine3d::Identity();
+  if (pointCloudInput->header.frame_id != sensorFrameId_ &&
+      !lookupTransform(pointCloudInput->header.frame_id, sensorFrameId_, timeStamp, inputToSensor)) {
+    return false;
+  }
 
-  // Remove Nans (optional voxel grid filter)
-  filterPointCloud(pointCloudSensorFrame);
+  // Prepare the error propagation, which is the same for every point.
+  const HeightVariancePropagation propagation(rotationMapToBase_.toImplementation().cast<float>(),
+                                              rotationBaseToSensor_.toImplementation().cast<float>(),
+                                              translationBaseToSensorInBaseFrame_.toImplementation().cast<float>(),
+                                              robotPoseCovariance.bottomRightCorner(3, 3).cast<float>());
 
-  // Specific filtering per sensor type
-  filterPointCloudSensorType(pointCloudSensorFrame);
+  // The single pass also rejects the invalid points, it is recorded as variance computation.
+  if (!applyVoxelGridFilter_) {
+    PipelineStatistics::ScopedTimer timer(pipelineStatistics_, sourceName_, PipelineStage::Variance);
+    return processPoints(*pointCloudInput, inputToSensor.cast<float>(), propagation, *pointCloudMapFrame, variances);
+  }
 
-  // Remove outside limits in map frame
-  if (!transformPointCloud(pointCloudSensorFrame, pointCloudMapFrame, generalParameters_.mapFrameId_)) {
-    return false;
+  // The voxel grid filter needs the whole point cloud, so it is applied in sensor frame before the single pass.
+  {
+    PipelineStatistics::ScopedTimer timer(pipelineStatistics_, sourceName_, PipelineStage::Filtering);
+    pcl::transformPointCloud(*pointCloudInput, *pointCloudSensorFrame_, inputToSensor.cast<float>());
+    pointCloudSensorFrame_->header.frame_id = sensorFrameId_;
+    filterPointCloud(pointCloudSensorFrame_);
+  }
+  PipelineStatistics::ScopedTimer timer(pipelineStatistics_, sourceName_, PipelineStage::Variance);
+  return processPoints(*pointCloudSensorFrame_, Eigen::Affine3f::Identity(), propagation, *pointCloudMapFrame, variances);
+}
+
+SensorProcessorBase::ScanBuffersPtr SensorProcessorBase::acquireScanBuffers() {
+  std::lock_guard<std::mutex> lock(scanBuffersMutex_);
+  if (freeScanBuffers_.empty()) {
+    return ScanBuffersPtr(new ScanBuffers, ScanBuffersDeleter{this});
+  }
+  ScanBuffersPtr scanBuffers(freeScanBuffers_.back().release(), ScanBuffersDeleter{this});
+  freeScanBuffers_.pop_back();
+  return scanBuffers;
+}
+
+void SensorProcessorBase::ScanBuffersDeleter::operator()(ScanBuffers* scanBuffers) const {
+  std::lock_guard<std::mutex> lock(sensorProcessor->scanBuffersMutex_);
+  sensorProcessor->freeScanBuffers_.emplace_back(scanBuffers);
+}
+
+void SensorProcessorBase::setPipelineStatistics(PipelineStatistics* pipelineStatistics, std::string sourceName) {
+  pipelineStatistics_ = pipelineStatistics;
+  sourceName_ = std::move(sourceName);
+}
+
+void SensorProcessorBase::deferPointCloud(const sensor_msgs::PointCloud2ConstPtr& pointCloudMsg) {
+  deferredPointClouds_.emplace_back(pointCloudMsg, ros::WallTime::now());
+  if (pipelineStatistics_ != nullptr) {
+    pipelineStatistics_->setQueueDepth(sourceName_, "deferred", deferredPointClouds_.size());
+  }
+}
+
+sensor_msgs::PointCloud2ConstPtr SensorProcessorBase::takeReadyPointCloud() {
+  while (!deferredPointClouds_.empty()) {
+    sensor_msgs::PointCloud2ConstPtr pointCloudMsg = deferredPointClouds_.front().first;
+    if (isTransformAvailable(pointCloudMsg->header.frame_id, pointCloudMsg->header.stamp)) {
+      if (pipelineStatistics_ != nullptr) {
+        const ros::WallDuration waitDuration = ros::WallTime::now() - deferredPointClouds_.front().second;
+        pipelineStatistics_->addDuration(sourceName_, PipelineStage::TfWait, waitDuration.toSec());
+      }
+      deferredPointClouds_.pop_front();
+      return pointCloudMsg;
+    }
+    if (deferredPointClouds_.back().first->header.stamp - pointCloudMsg->header.stamp <= transformTimeout_) {
+      // Keep waiting, the messages are processed in order.
+      return nullptr;
+    }
+    if (firstTfAvailable_) {
+      ROS_ERROR_THROTTLE(5, "No transformation available for the point cloud in frame %s at time %f, dropping it. (Throttled 5s)",
+                         pointCloudMsg->header.frame_id.c_str(), pointCloudMsg->header.stamp.toSec());
+    }
+    deferredPointClouds_.pop_front();
+    if (pipelineStatistics_ != nullptr) {
+      pipelineStatistics_->addDroppedFrames(sourceName_);
+    }
   }
-  std::vector<PointCloudType::Ptr> pointClouds({pointCloudMapFrame, pointCloudSensorFrame});
-  removePointsOutsideLimits(pointCloudMapFrame, pointClouds);
+  return nullptr;
+}
 
-  // Compute variances
-  return computeVariances(pointCloudSensorFrame, robotPoseCovariance, variances);
+bool SensorProcessorBase::isTransformAvailable(const std::string& sensorFrameId, const ros::Time& timeStamp) const {
+  const bool isSensorTransformCached = isSensorTransformStatic_ && sensorToBaseFrameId_ == sensorFrameId;
+  if (!isSensorTransformCached && !transformListener_.canTransform(generalParameters_.robotBaseFrameId_, sensorFrameId, timeStamp)) {
+    return false;
+  }
+  return transformListener_.canTransform(generalParameters_.mapFrameId_, generalParameters_.robotBaseFrameId_, timeStamp);
 }
 
 bool SensorProcessorBase::updateTransformations(const ros::Time& timeStamp) {
   try {
-    transformListener_.waitForTransform(sensorFrameId_, generalParameters_.mapFrameId_, timeStamp, ros::Duration(1.0));
-
     tf::StampedTransform transformTf;
-    transformListener_.lookupTransform(generalParameters_.mapFrameId_, sensorFrameId_, timeStamp, transformTf);
-    poseTFToEigen(transformTf, transformationSensorToMap_);
-
-    transformListener_.lookupTransform(generalParameters_.robotBaseFrameId_, sensorFrameId_, timeStamp,
-                                       transformTf);  // TODO(max): Why wrong direction?
     Eigen::Affine3d transform;
-    poseTFToEigen(transformTf, transform);
-    rotationBaseToSensor_.setMatrix(transform.rotation().matrix());
-    translationBaseToSensorInBaseFrame_.toImplementation() = transform.translation();
 
-    transformListener_.lookupTransform(generalParameters_.mapFrameId_, generalParameters_.robotBaseFrameId_, timeStamp,
-                                       transformTf);  // TODO(max): Why wrong direction?
-    poseTFToEigen(transformTf, transform);
-    rotationMapToBase_.setMatrix(transform.rotation().matrix());
-    translationMapToBaseInMapFrame_.toImplementation() = transform.translation();
+    // The transformation of a static sensor is only looked up once.
+    if (!isSensorTransformStatic_ || sensorToBaseFrameId_ != sensorFrameId_) {
+      transformListener_.lookupTransform(generalParameters_.robotBaseFrameId_, sensorFrameId_, timeStamp,
+                                         transformTf);  // TODO(max): Why wrong direction?
+      poseTFToEigen(transformTf, transformationSensorToBase_);
+      rotationBaseToSensor_.setMatrix(transformationSensorToBase_.rotation().matrix());
+      translationBaseToSensorInBaseFrame_.toImplementation() = transformationSensorToBase_.translation();
+      sensorToBaseFrameId_ = isSensorTransformStatic_ ? sensorFrameId_ : std::string();
+      transformationTimeStamp_ = ros::Time();
+    }
+
+    // Point clouds with the same time stamp share the robot pose.
+    if (transformationTimeStamp_.isZero() || timeStamp != transformationTimeStamp_) {
+      transformListener_.lookupTransform(generalParameters_.mapFrameId_, generalParameters_.robotBaseFrameId_, timeStamp,
+                                         transformTf);  // TODO(max): Why wrong direction?
+      poseTFToEigen(transformTf, transform);
+      rotationMapToBase_.setMatrix(transform.rotation().matrix());
+      translationMapToBaseInMapFrame_.toImplementation() = transform.translation();
+      transformationSensorToMap_ = transform * transformationSensorToBase_;
+      transformationTimeStamp_ = timeStamp;
+    }
 
     if (!firstTfAvailable_) {
       firstTfAvailable_ = true;
@@ -115,6 +207,8 @@ bool SensorProcessorBase::updateTransformations(const ros::Time& timeStamp) {
 
     return true;
   } catch (tf::TransformException& ex) {
+    sensorToBaseFrameId_.clear();
+    transformationTimeStamp_ = ros::Time();
     if (!firstTfAvailable_) {
       return false;
     }
@@ -123,66 +217,27 @@ bool SensorProcessorBase::updateTransformations(const ros::Time& timeStamp) {
   }
 }
 
-bool SensorProcessorBase::transformPointCloud(PointCloudType::ConstPtr pointCloud, PointCloudType::Ptr pointCloudTransformed,
-                                              const std::string& targetFrame) {
-  ros::Time timeStamp;
-  timeStamp.fromNSec(1000 * pointCloud->header.stamp);
-  const std::string inputFrameId(pointCloud->header.frame_id);
-
+bool SensorProcessorBase::lookupTransform(const std::string& sourceFrame, const std::string& targetFrame, const ros::Time& timeStamp,
+                                          Eigen::Affine3d& transform) {
   tf::StampedTransform transformTf;
   try {
-    transformListener_.waitForTransform(targetFrame, inputFrameId, timeStamp, ros::Duration(1.0), ros::Duration(0.001));
-    transformListener_.lookupTransform(targetFrame, inputFrameId, timeStamp, transformTf);
+    transformListener_.lookupTransform(targetFrame, sourceFrame, timeStamp, transformTf);
   } catch (tf::TransformException& ex) {
     ROS_ERROR("%s", ex.what());
     return false;
   }
 
-  Eigen::Affine3d transform;
   poseTFToEigen(transformTf, transform);
-  pcl::transformPointCloud(*pointCloud, *pointCloudTransformed, transform.cast<float>());
-  pointCloudTransformed->header.frame_id = targetFrame;
-
-  ROS_DEBUG_THROTTLE(5, "Point cloud transformed to frame %s for time stamp %f.", targetFrame.c_str(),
-                     pointCloudTransformed->header.stamp / 1000.0);
   return true;
 }
 
-void SensorProcessorBase::removePointsOutsideLimits(PointCloudType::ConstPtr reference, std::vector<PointCloudType::Ptr>& pointClouds) {
-  if (!std::isfinite(ignorePointsLowerThreshold_) && !std::isfinite(ignorePointsUpperThreshold_)) {
-    return;
-  }
-  ROS_DEBUG("Limiting point cloud to the height interval of [%f, %f] relative to the robot base.", ignorePointsLowerThreshold_,
-            ignorePointsUpperThreshold_);
-
-  pcl::PassThrough<pcl::PointXYZRGBConfidenceRatio> passThroughFilter(true);
-  passThroughFilter.setInputCloud(reference);
-  passThroughFilter.setFilterFieldName("z");  // TODO(max): Should this be configurable?
-  double relativeLowerThreshold = translationMapToBaseInMapFrame_.z() + ignorePointsLowerThreshold_;
-  double relativeUpperThreshold = translationMapToBaseInMapFrame_.z() + ignorePointsUpperThreshold_;
-  passThroughFilter.setFilterLimits(relativeLowerThreshold, relativeUpperThreshold);
-  pcl::IndicesPtr insideIndeces(new std::vector<int>);
-  passThroughFilter.filter(*insideIndeces);
-
-  for (auto& pointCloud : pointClouds) {
-    pcl::ExtractIndices<pcl::PointXYZRGBConfidenceRatio> extractIndicesFilter;
-    extractIndicesFilter.setInputCloud(pointCloud);
-    extractIndicesFilter.setIndices(insideIndeces);
-    PointCloudType tempPointCloud;
-    extractIndicesFilter.filter(tempPointCloud);
-    pointCloud->swap(tempPointCloud);
-  }
-
-  ROS_DEBUG("removePointsOutsideLimits() reduced point cloud to %i points.", (int)pointClouds[0]->size());
-}
-
 bool SensorProcessorBase::filterPointCloud(const PointCloudType::Ptr pointCloud) {
-  PointCloudType tempPointCloud;
+  // Swapping with the member buffer keeps the capacity of both point clouds for the next call.
+  PointCloudType& tempPointCloud = filteredPointCloud_;
 
   // Remove nan points.
-  std::vector<int> indices;
   if (!pointCloud->is_dense) {
-    pcl::removeNaNFromPointCloud(*pointCloud, tempPointCloud, indices);
+    pcl::removeNaNFromPointCloud(*pointCloud, tempPointCloud, filteredIndices_);
     tempPointCloud.is_dense = true;
     pointCloud->swap(tempPointCloud);
   }
@@ -200,8 +255,4 @@ bool SensorProcessorBase::filterPointCloud(const PointCloudType::Ptr pointCloud)
   return true;
 }
 
-bool SensorProcessorBase::filterPointCloudSensorType(const PointCloudType::Ptr /*pointCloud*/) {
-  return true;
-}
-
 } /* namespace elevation_mapping */
@@ -7,12 +7,9 @@
 
 #include "elevation_mapping/sensor_processors/StereoSensorProcessor.hpp"
 
-// PCL
-#include <pcl/filters/filter.h>
-#include <pcl/filters/passthrough.h>
-
 // STD
-#include <vector>
+#include <algorithm>
+#include <cmath>
 
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
 
@@ -37,86 +34,50 @@ bool StereoSensorProcessor::readParameters() {
   return true;
 }
 
-bool StereoSensorProcessor::computeVariances(const PointCloudType::ConstPtr pointCloud,
-                                             const Eigen::Matrix<double, 6, 6>& robotPoseCovariance, Eigen::VectorXf& variances) {
-  variances.resize(pointCloud->size());
-
-  // Projection vector (P).
-  const Eigen::RowVector3f projectionVector = Eigen::RowVector3f::UnitZ();
-
-  // Sensor Jacobian (J_s).
-  const Eigen::RowVector3f sensorJacobian =
-      projectionVector * (rotationMapToBase_.transposed() * rotationBaseToSensor_.transposed()).toImplementation().cast<float>();
-
-  // Robot rotation covariance matrix (Sigma_q).
-  Eigen::Matrix3f rotationVariance = robotPoseCovariance.bottomRightCorner(3, 3).cast<float>();
-
-  // Preparations for#include <pcl/common/transforms.h> robot rotation Jacobian (J_q) to minimize computation for every point in point
-  // cloud.
-  const Eigen::Matrix3f C_BM_transpose = rotationMapToBase_.transposed().toImplementation().cast<float>();
-  const Eigen::RowVector3f P_mul_C_BM_transpose = projectionVector * C_BM_transpose;
-  const Eigen::Matrix3f C_SB_transpose = rotationBaseToSensor_.transposed().toImplementation().cast<float>();
-  const Eigen::Matrix3f B_r_BS_skew =
-      kindr::getSkewMatrixFromVector(Eigen::Vector3f(translationBaseToSensorInBaseFrame_.toImplementation().cast<float>()));
-
-  for (unsigned int i = 0; i < pointCloud->size(); ++i) {
-    // For every point in point cloud.
-
-    // Preparation.
-    pcl::PointXYZRGBConfidenceRatio point = pointCloud->points[i];
-    double disparity = sensorParameters_.at("depth_to_disparity_factor") / point.z;  // NOLINT(cppcoreguidelines-pro-type-union-access)
-    Eigen::Vector3f pointVector(point.x, point.y, point.z);  // S_r_SP // NOLINT(cppcoreguidelines-pro-type-union-access)
-    float heightVariance = 0.0;                              // sigma_p
-
-    // Measurement distance.
-    float measurementDistance = pointVector.norm();
-
-    // Compute sensor covariance matrix (Sigma_S) with sensor model.
-    float varianceNormal =
-        pow(sensorParameters_.at("depth_to_disparity_factor") / pow(disparity, 2), 2) *
-        ((sensorParameters_.at("p_5") * disparity + sensorParameters_.at("p_2")) *
-             sqrt(pow(sensorParameters_.at("p_3") * disparity + sensorParameters_.at("p_4") - getJ(i), 2) + pow(240 - getI(i), 2)) +
-         sensorParameters_.at("p_1"));
-    float varianceLateral = pow(sensorParameters_.at("lateral_factor") * measurementDistance, 2);
-    Eigen::Matrix3f sensorVariance = Eigen::Matrix3f::Zero();
-    sensorVariance.diagonal() << varianceLateral, varianceLateral, varianceNormal;
-
-    // Robot rotation Jacobian (J_q).
-    const Eigen::Matrix3f C_SB_transpose_times_S_r_SP_skew = kindr::getSkewMatrixFromVector(Eigen::Vector3f(C_SB_transpose * pointVector));
-    Eigen::RowVector3f rotationJacobian = P_mul_C_BM_transpose * (C_SB_transpose_times_S_r_SP_skew + B_r_BS_skew);
-
-    // Measurement variance for map (error propagation law).
-    heightVariance = rotationJacobian * rotationVariance * rotationJacobian.transpose();
-    heightVariance += sensorJacobian * sensorVariance * sensorJacobian.transpose();
-
-    // Copy to list.
-    variances(i) = heightVariance;
-  }
-
-  return true;
-}
-
-bool StereoSensorProcessor::filterPointCloudSensorType(const PointCloudType::Ptr pointCloud) {
-  pcl::PassThrough<pcl::PointXYZRGBConfidenceRatio> passThroughFilter;
-  PointCloudType tempPointCloud;
-
-  // cutoff points with z values
-  passThroughFilter.setInputCloud(pointCloud);
-  passThroughFilter.setFilterFieldName("z");
-  passThroughFilter.setFilterLimits(sensorParameters_.at("cutoff_min_depth"), sensorParameters_.at("cutoff_max_depth"));
-  passThroughFilter.filter(tempPointCloud);
-  pointCloud->swap(tempPointCloud);
-
-  return true;
+bool StereoSensorProcessor::processPoints(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                                          const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame,
+                                          Eigen::VectorXf& variances) {
+  originalWidth_ = std::max(static_cast<int>(pointCloud.width), 1);
+  const float cutoffMinDepth = sensorParameters_.at("cutoff_min_depth");
+  const float cutoffMaxDepth = sensorParameters_.at("cutoff_max_depth");
+  const double depthToDisparityFactor = sensorParameters_.at("depth_to_disparity_factor");
+  const double p1 = sensorParameters_.at("p_1");
+  const double p2 = sensorParameters_.at("p_2");
+  const double p3 = sensorParameters_.at("p_3");
+  const double p4 = sensorParameters_.at("p_4");
+  const double p5 = sensorParameters_.at("p_5");
+  const double lateralFactor = sensorParameters_.at("lateral_factor");
+
+  return processPointsWithModel(
+      pointCloud, inputToSensor, propagation, pointCloudMapFrame, variances,
+      [&](const Eigen::Vector3f& pointSensorFrame) {
+        // Cutoff points with z values.
+        return pointSensorFrame.z() >= cutoffMinDepth && pointSensorFrame.z() <= cutoffMaxDepth;
+      },
+      [&](const pcl::PointXYZRGBConfidenceRatio& /*point*/, const Eigen::Vector3f& pointSensorFrame, std::size_t index) {
+        const double disparity = depthToDisparityFactor / pointSensorFrame.z();
+
+        // Measurement distance.
+        const float measurementDistance = pointSensorFrame.norm();
+
+        // Compute sensor covariance matrix (Sigma_S) with sensor model.
+        const int i = static_cast<int>(index);
+        const double normalFactor = depthToDisparityFactor / (disparity * disparity);
+        const double column = p3 * disparity + p4 - getJ(i);
+        const double row = 240 - getI(i);
+        const float varianceNormal = normalFactor * normalFactor * ((p5 * disparity + p2) * std::sqrt(column * column + row * row) + p1);
+        const float deviationLateral = lateralFactor * measurementDistance;
+        const float varianceLateral = deviationLateral * deviationLateral;
+        return Eigen::Vector2f(varianceLateral, varianceNormal);
+      });
 }
 
-int StereoSensorProcessor::getI(int index) {
-  // TODO(max): Figure out originalWidth_ value.
-  return indices_[index] / originalWidth_;
+int StereoSensorProcessor::getI(int index) const {
+  return index / originalWidth_;
 }
 
-int StereoSensorProcessor::getJ(int index) {
-  return indices_[index] % originalWidth_;
+int StereoSensorProcessor::getJ(int index) const {
+  return index % originalWidth_;
 }
 
 }  // namespace elevation_mapping
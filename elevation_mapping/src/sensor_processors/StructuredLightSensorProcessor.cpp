@@ -5,13 +5,11 @@
  *      Author: Péter Fankhauser
  *   Institute: ETH Zurich, ANYbotics
  */
+#include <cmath>
 #include <limits>
 #include <string>
 #include <vector>
 
-#include <pcl/filters/passthrough.h>
-#include <pcl/filters/voxel_grid.h>
-
 #include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
 #include "elevation_mapping/sensor_processors/StructuredLightSensorProcessor.hpp"
 
@@ -42,81 +40,42 @@ bool StructuredLightSensorProcessor::readParameters() {
   return true;
 }
 
-bool StructuredLightSensorProcessor::computeVariances(const PointCloudType::ConstPtr pointCloud,
-                                                      const Eigen::Matrix<double, 6, 6>& robotPoseCovariance, Eigen::VectorXf& variances) {
-  variances.resize(pointCloud->size());
-
-  // Projection vector (P).
-  const Eigen::RowVector3f projectionVector = Eigen::RowVector3f::UnitZ();
-
-  // Sensor Jacobian (J_s).
-  const Eigen::RowVector3f sensorJacobian =
-      projectionVector * (rotationMapToBase_.transposed() * rotationBaseToSensor_.transposed()).toImplementation().cast<float>();
-
-  // Robot rotation covariance matrix (Sigma_q).
-  const Eigen::Matrix3f rotationVariance = robotPoseCovariance.bottomRightCorner(3, 3).cast<float>();
-
-  // Preparations for robot rotation Jacobian (J_q) to minimize computation for every point in point cloud.
-  const Eigen::Matrix3f C_BM_transpose = rotationMapToBase_.transposed().toImplementation().cast<float>();
-  const Eigen::RowVector3f P_mul_C_BM_transpose = projectionVector * C_BM_transpose;
-  const Eigen::Matrix3f C_SB_transpose = rotationBaseToSensor_.transposed().toImplementation().cast<float>();
-  const Eigen::Matrix3f B_r_BS_skew =
-      kindr::getSkewMatrixFromVector(Eigen::Vector3f(translationBaseToSensorInBaseFrame_.toImplementation().cast<float>()));
+bool StructuredLightSensorProcessor::processPoints(const PointCloudType& pointCloud, const Eigen::Affine3f& inputToSensor,
+                                                   const HeightVariancePropagation& propagation, PointCloudType& pointCloudMapFrame,
+                                                   Eigen::VectorXf& variances) {
+  const float cutoffMinDepth = sensorParameters_.at("cutoff_min_depth");
+  const float cutoffMaxDepth = sensorParameters_.at("cutoff_max_depth");
+  const double normalFactorA = sensorParameters_.at("normal_factor_a");
+  const double normalFactorB = sensorParameters_.at("normal_factor_b");
+  const double normalFactorC = sensorParameters_.at("normal_factor_c");
+  const double normalFactorD = sensorParameters_.at("normal_factor_d");
+  const double normalFactorE = sensorParameters_.at("normal_factor_e");
+  const double lateralFactor = sensorParameters_.at("lateral_factor");
   const float epsilon = std::numeric_limits<float>::min();
 
-  for (unsigned int i = 0; i < pointCloud->size(); ++i) {
-    // For every point in point cloud.
-
-    // Preparation.
-    auto& point = pointCloud->points[i];
-    const float& confidenceRatio = point.confidence_ratio;
-    Eigen::Vector3f pointVector(point.x, point.y, point.z);  // S_r_SP // NOLINT(cppcoreguidelines-pro-type-union-access)
-
-    // Measurement distance.
-    const float measurementDistance = pointVector.z();
-
-    // Compute sensor covariance matrix (Sigma_S) with sensor model.
-    const float deviationNormal =
-        sensorParameters_.at("normal_factor_a") +
-        sensorParameters_.at("normal_factor_b") * (measurementDistance - sensorParameters_.at("normal_factor_c")) *
-            (measurementDistance - sensorParameters_.at("normal_factor_c")) +
-        sensorParameters_.at("normal_factor_d") * pow(measurementDistance, sensorParameters_.at("normal_factor_e"));
-    const float varianceNormal = deviationNormal * deviationNormal;
-    const float deviationLateral = sensorParameters_.at("lateral_factor") * measurementDistance;
-    const float varianceLateral = deviationLateral * deviationLateral;
-    Eigen::Matrix3f sensorVariance = Eigen::Matrix3f::Zero();
-    sensorVariance.diagonal() << varianceLateral, varianceLateral, varianceNormal;
-
-    // Robot rotation Jacobian (J_q).
-    const Eigen::Matrix3f C_SB_transpose_times_S_r_SP_skew = kindr::getSkewMatrixFromVector(Eigen::Vector3f(C_SB_transpose * pointVector));
-    const Eigen::RowVector3f rotationJacobian = P_mul_C_BM_transpose * (C_SB_transpose_times_S_r_SP_skew + B_r_BS_skew);
-
-    // Measurement variance for map (error propagation law).
-    float heightVariance = 0.0;  // sigma_p
-    heightVariance = rotationJacobian * rotationVariance * rotationJacobian.transpose();
-    // Scale the sensor variance by the inverse, squared confidence ratio
-    heightVariance +=
-        static_cast<float>(sensorJacobian * sensorVariance * sensorJacobian.transpose()) / (epsilon + confidenceRatio * confidenceRatio);
-
-    // Copy to list.
-    variances(i) = heightVariance;
-  }
-
-  return true;
-}
-
-bool StructuredLightSensorProcessor::filterPointCloudSensorType(const PointCloudType::Ptr pointCloud) {
-  pcl::PassThrough<pcl::PointXYZRGBConfidenceRatio> passThroughFilter;
-  PointCloudType tempPointCloud;
-
-  // cutoff points with z values
-  passThroughFilter.setInputCloud(pointCloud);
-  passThroughFilter.setFilterFieldName("z");
-  passThroughFilter.setFilterLimits(sensorParameters_.at("cutoff_min_depth"), sensorParameters_.at("cutoff_max_depth"));
-  passThroughFilter.filter(tempPointCloud);
-  pointCloud->swap(tempPointCloud);
-
-  return true;
+  return processPointsWithModel(
+      pointCloud, inputToSensor, propagation, pointCloudMapFrame, variances,
+      [&](const Eigen::Vector3f& pointSensorFrame) {
+        // Cutoff points with z values.
+        return pointSensorFrame.z() >= cutoffMinDepth && pointSensorFrame.z() <= cutoffMaxDepth;
+      },
+      [&](const pcl::PointXYZRGBConfidenceRatio& point, const Eigen::Vector3f& pointSensorFrame, std::size_t /*index*/) {
+        const float& confidenceRatio = point.confidence_ratio;
+
+        // Measurement distance.
+        const float measurementDistance = pointSensorFrame.z();
+
+        // Compute sensor covariance matrix (Sigma_S) with sensor model.
+        const float deviationNormal = normalFactorA +
+                                      normalFactorB * (measurementDistance - normalFactorC) * (measurementDistance - normalFactorC) +
+                                      normalFactorD * pow(measurementDistance, normalFactorE);
+        const float varianceNormal = deviationNormal * deviationNormal;
+        const float deviationLateral = lateralFactor * measurementDistance;
+        const float varianceLateral = deviationLateral * deviationLateral;
+
+        // Scale the sensor variance by the inverse, squared confidence ratio
+        return Eigen::Vector2f(Eigen::Vector2f(varianceLateral, varianceNormal) / (epsilon + confidenceRatio * confidenceRatio));
+      });
 }
 
 }  // namespace elevation_mapping
@@ -0,0 +1,77 @@
+/*
+ * CellPointAggregateTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/CellPointAggregate.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// gtest
+#include <gtest/gtest.h>
+
+TEST(CellPointAggregate, MeanMatchesSequentialFusion) {  // NOLINT
+  std::mt19937 generator(0);
+  std::normal_distribution<float> noise(0.0f, 0.005f);
+  std::uniform_real_distribution<float> variances(0.0001f, 0.0004f);
+
+  float elevation = 0.5f;
+  float variance = 0.0009f;
+  elevation_mapping::CellPointAggregate aggregate;
+  aggregate.reset(elevation, variance, 2.5f);
+  float lowestHeightPlusUncertainty = 1.0f;
+  for (std::size_t i = 0; i < 20; ++i) {
+    const float height = 0.5f + noise(generator);
+    const float pointVariance = variances(generator);
+    aggregate.add(height, pointVariance, i);
+    lowestHeightPlusUncertainty = std::min(lowestHeightPlusUncertainty, height + 3.0f * std::sqrt(pointVariance));
+    // Kalman update of the map.
+    elevation = (variance * height + pointVariance * elevation) / (variance + pointVariance);
+    variance = (pointVariance * variance) / (pointVariance + variance);
+  }
+  ASSERT_TRUE(aggregate.hasMean());
+  EXPECT_EQ(0u, aggregate.getNumberOfOutliers());
+
+  // Fusing the mean once gives the same cell as fusing every point.
+  const elevation_mapping::CellPointAggregate::Representative mean = aggregate.getMean();
+  const float priorVariance = 0.0009f;
+  const float fusedElevation = (priorVariance * mean.height + mean.variance * 0.5f) / (priorVariance + mean.variance);
+  const float fusedVariance = (mean.variance * priorVariance) / (mean.variance + priorVariance);
+  EXPECT_NEAR(elevation, fusedElevation, 1e-5);
+  EXPECT_NEAR(variance, fusedVariance, 1e-9);
+  EXPECT_FLOAT_EQ(lowestHeightPlusUncertainty, mean.heightPlusUncertainty);
+  EXPECT_EQ(19u, mean.pointIndex);
+}
+
+TEST(CellPointAggregate, Outliers) {  // NOLINT
+  elevation_mapping::CellPointAggregate aggregate;
+  aggregate.reset(0.0f, 0.0001f, 2.5f);
+  aggregate.add(0.01f, 0.0001f, 0);
+  aggregate.add(0.3f, 0.0001f, 1);
+  aggregate.add(-0.2f, 0.0001f, 2);
+  aggregate.add(0.5f, 0.0002f, 3);
+  aggregate.add(-0.01f, 0.0001f, 4);
+  aggregate.add(0.4f, 0.0001f, 5);
+
+  ASSERT_TRUE(aggregate.hasMean());
+  EXPECT_NEAR(0.0f, aggregate.getMean().height, 1e-6);
+  EXPECT_FLOAT_EQ(0.00005f, aggregate.getMean().variance);
+  EXPECT_EQ(4u, aggregate.getMean().pointIndex);
+  ASSERT_EQ(4u, aggregate.getNumberOfOutliers());
+  EXPECT_EQ(2u, aggregate.getLowestOutlier().pointIndex);
+  EXPECT_FLOAT_EQ(-0.2f, aggregate.getLowestOutlier().height);
+  EXPECT_EQ(3u, aggregate.getHighestOutlier().pointIndex);
+  EXPECT_FLOAT_EQ(0.0002f, aggregate.getHighestOutlier().variance);
+
+  // No point within the threshold.
+  aggregate.reset(0.0f, 0.0001f, 2.5f);
+  aggregate.add(1.0f, 0.0001f, 0);
+  EXPECT_FALSE(aggregate.hasMean());
+  ASSERT_EQ(1u, aggregate.getNumberOfOutliers());
+  EXPECT_EQ(0u, aggregate.getLowestOutlier().pointIndex);
+  EXPECT_EQ(0u, aggregate.getHighestOutlier().pointIndex);
+}
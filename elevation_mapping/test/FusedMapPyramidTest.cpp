@@ -0,0 +1,125 @@
+/*
+ * FusedMapPyramidTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/FusedMapPyramid.hpp"
+
+#include <cmath>
+#include <random>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+grid_map::GridMap makeFusedMap(const grid_map::Length& length) {
+  grid_map::GridMap map({"elevation", "upper_bound", "lower_bound"});
+  map.setBasicLayers({"elevation", "upper_bound", "lower_bound"});
+  map.setGeometry(length, 0.1, grid_map::Position(0.0, 0.0));
+  return map;
+}
+
+void setCell(grid_map::GridMap& map, const grid_map::Index& index, std::mt19937& generator) {
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  // Leave some cells empty.
+  if (uniform(generator) < -0.8f) {
+    map.at("elevation", index) = NAN;
+    map.at("upper_bound", index) = NAN;
+    map.at("lower_bound", index) = NAN;
+    return;
+  }
+  const float elevation = uniform(generator);
+  map.at("elevation", index) = elevation;
+  map.at("upper_bound", index) = elevation + 0.5f * (1.0f + uniform(generator));
+  map.at("lower_bound", index) = elevation - 0.5f * (1.0f + uniform(generator));
+}
+
+//! Compares a level with the cells of the fused map at the positions of its cells.
+void expectLevelMatches(const grid_map::GridMap& fusedMap, const grid_map::GridMap& levelMap) {
+  const grid_map::Size& size = levelMap.getSize();
+  grid_map::Matrix elevationSum = grid_map::Matrix::Zero(size(0), size(1));
+  grid_map::Matrix numberOfCells = grid_map::Matrix::Zero(size(0), size(1));
+  grid_map::Matrix upperBound = grid_map::Matrix::Constant(size(0), size(1), NAN);
+  grid_map::Matrix lowerBound = grid_map::Matrix::Constant(size(0), size(1), NAN);
+  for (grid_map::GridMapIterator iterator(fusedMap); !iterator.isPastEnd(); ++iterator) {
+    grid_map::Position position;
+    fusedMap.getPosition(*iterator, position);
+    grid_map::Index levelIndex;
+    ASSERT_TRUE(levelMap.getIndex(position, levelIndex));
+    const float elevation = fusedMap.at("elevation", *iterator);
+    if (!std::isfinite(elevation)) {
+      continue;
+    }
+    elevationSum(levelIndex(0), levelIndex(1)) += elevation;
+    numberOfCells(levelIndex(0), levelIndex(1)) += 1.0f;
+    upperBound(levelIndex(0), levelIndex(1)) = std::fmax(upperBound(levelIndex(0), levelIndex(1)), fusedMap.at("upper_bound", *iterator));
+    lowerBound(levelIndex(0), levelIndex(1)) = std::fmin(lowerBound(levelIndex(0), levelIndex(1)), fusedMap.at("lower_bound", *iterator));
+  }
+
+  for (grid_map::GridMapIterator iterator(levelMap); !iterator.isPastEnd(); ++iterator) {
+    const grid_map::Index index(*iterator);
+    if (numberOfCells(index(0), index(1)) == 0.0f) {
+      EXPECT_TRUE(std::isnan(levelMap.at("elevation", index)));
+      continue;
+    }
+    EXPECT_NEAR(elevationSum(index(0), index(1)) / numberOfCells(index(0), index(1)), levelMap.at("elevation", index), 1e-5);
+    EXPECT_FLOAT_EQ(upperBound(index(0), index(1)), levelMap.at("upper_bound", index));
+    EXPECT_FLOAT_EQ(lowerBound(index(0), index(1)), levelMap.at("lower_bound", index));
+  }
+}
+}  // namespace
+
+TEST(FusedMapPyramid, Levels) {  // NOLINT
+  std::mt19937 generator(0);
+  // An even and an odd number of cells.
+  grid_map::GridMap fusedMap = makeFusedMap(grid_map::Length(6.4, 5.7));
+  for (grid_map::GridMapIterator iterator(fusedMap); !iterator.isPastEnd(); ++iterator) {
+    setCell(fusedMap, *iterator, generator);
+  }
+
+  elevation_mapping::FusedMapPyramid pyramid(3);
+  ASSERT_EQ(3, pyramid.getNumberOfLevels());
+  pyramid.update(fusedMap);
+  for (int level = 1; level <= 3; ++level) {
+    EXPECT_DOUBLE_EQ((1 << level) * fusedMap.getResolution(), pyramid.getLevel(level).getResolution());
+    expectLevelMatches(fusedMap, pyramid.getLevel(level));
+  }
+}
+
+TEST(FusedMapPyramid, IncrementalUpdate) {  // NOLINT
+  std::mt19937 generator(1);
+  grid_map::GridMap fusedMap = makeFusedMap(grid_map::Length(5.0, 4.1));
+  for (grid_map::GridMapIterator iterator(fusedMap); !iterator.isPastEnd(); ++iterator) {
+    setCell(fusedMap, *iterator, generator);
+  }
+  elevation_mapping::FusedMapPyramid pyramid(4);
+  pyramid.update(fusedMap);
+
+  const std::vector<grid_map::Position> positions{{0.13, -0.21}, {0.45, 0.08}, {-1.02, 0.77}, {-0.95, 0.8}, {6.0, -3.0}};
+  for (const auto& position : positions) {
+    // Move the map and fill the new cells.
+    std::vector<grid_map::BufferRegion> newRegions;
+    fusedMap.move(position, newRegions);
+    for (const auto& region : newRegions) {
+      for (grid_map::SubmapIterator iterator(fusedMap, region); !iterator.isPastEnd(); ++iterator) {
+        setCell(fusedMap, *iterator, generator);
+      }
+      pyramid.markModified(region.getStartIndex(), region.getSize());
+    }
+
+    // Modify a region which wraps around the buffer.
+    const grid_map::Index topLeftIndex(fusedMap.getSize()(0) - 7, fusedMap.getSize()(1) - 3);
+    const grid_map::Size size(20, 35);
+    for (grid_map::SubmapIterator iterator(fusedMap, topLeftIndex, size); !iterator.isPastEnd(); ++iterator) {
+      setCell(fusedMap, *iterator, generator);
+    }
+    pyramid.markModified(topLeftIndex, size);
+
+    pyramid.update(fusedMap);
+    for (int level = 1; level <= pyramid.getNumberOfLevels(); ++level) {
+      expectLevelMatches(fusedMap, pyramid.getLevel(level));
+    }
+  }
+}
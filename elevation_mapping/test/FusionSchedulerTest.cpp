@@ -0,0 +1,101 @@
+/*
+ * FusionSchedulerTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/FusionScheduler.hpp"
+
+#include <algorithm>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+//! 32 x 32 cells, i.e. 4 x 4 tiles of 8 x 8 cells.
+grid_map::GridMap makeMap() {
+  grid_map::GridMap map({"elevation"});
+  map.setGeometry(grid_map::Length(3.2, 3.2), 0.1, grid_map::Position(1.0, 2.0));
+  return map;
+}
+
+bool isInner(const grid_map::Index& tile) {
+  return (tile >= 1).all() && (tile <= 2).all();
+}
+}  // namespace
+
+TEST(FusionScheduler, OrdersByDistance) {  // NOLINT
+  elevation_mapping::FusionScheduler scheduler(8);
+  const grid_map::GridMap map = makeMap();
+  const std::vector<grid_map::Index> tiles = scheduler.getPendingTiles(map, map.getPosition(), 0.0);
+  ASSERT_EQ(16u, tiles.size());
+  // The four tiles around the center come first, the corners last.
+  for (std::size_t i = 0; i < tiles.size(); ++i) {
+    EXPECT_EQ(i < 4, isInner(tiles[i]));
+  }
+  for (std::size_t i = 12; i < tiles.size(); ++i) {
+    EXPECT_TRUE((tiles[i] == 0 || tiles[i] == 3).all());
+  }
+}
+
+TEST(FusionScheduler, WrappedBuffer) {  // NOLINT
+  elevation_mapping::FusionScheduler scheduler(8);
+  grid_map::GridMap map = makeMap();
+  map.setStartIndex(grid_map::Index(4, 4));
+  // The cells around the center are at the buffer indices 19 and 20, in the tile 2.
+  const std::vector<grid_map::Index> tiles = scheduler.getPendingTiles(map, map.getPosition(), 0.0);
+  ASSERT_EQ(16u, tiles.size());
+  EXPECT_TRUE((tiles[0] == grid_map::Index(2, 2)).all());
+  // The tile 0 covers both borders of the map.
+  EXPECT_TRUE((tiles.back() == grid_map::Index(0, 0)).all());
+}
+
+TEST(FusionScheduler, PriorityRegions) {  // NOLINT
+  elevation_mapping::FusionScheduler scheduler(8, 5.0);
+  const grid_map::GridMap map = makeMap();
+  // A region within the tile at the largest x and y position.
+  scheduler.addPriorityRegion(grid_map::Position(2.4, 3.4), grid_map::Length(0.2, 0.2), 10.0);
+  std::vector<grid_map::Index> tiles = scheduler.getPendingTiles(map, map.getPosition(), 12.0);
+  ASSERT_EQ(16u, tiles.size());
+  EXPECT_TRUE((tiles[0] == grid_map::Index(0, 0)).all());
+  EXPECT_TRUE(isInner(tiles[1]));
+
+  // The region has expired.
+  tiles = scheduler.getPendingTiles(map, map.getPosition(), 15.5);
+  ASSERT_EQ(16u, tiles.size());
+  EXPECT_TRUE(isInner(tiles[0]));
+}
+
+TEST(FusionScheduler, PendingTiles) {  // NOLINT
+  elevation_mapping::FusionScheduler scheduler(8);
+  const grid_map::GridMap map = makeMap();
+  std::vector<grid_map::Index> tiles = scheduler.getPendingTiles(map, map.getPosition(), 0.0);
+  ASSERT_EQ(16u, tiles.size());
+
+  // The tiles which have not been fused are carried over.
+  for (std::size_t i = 0; i < 4; ++i) {
+    scheduler.markFused(tiles[i]);
+  }
+  tiles = scheduler.getPendingTiles(map, map.getPosition(), 0.0);
+  ASSERT_EQ(12u, tiles.size());
+  EXPECT_TRUE(std::none_of(tiles.begin(), tiles.end(), isInner));
+
+  scheduler.markAllFused(grid_map::Size(4, 4));
+  EXPECT_TRUE(scheduler.getPendingTiles(map, map.getPosition(), 0.0).empty());
+
+  elevation_mapping::FusionScheduler::TileMask modifiedTiles = elevation_mapping::FusionScheduler::TileMask::Constant(4, 4, false);
+  modifiedTiles(1, 2) = true;
+  scheduler.markPending(modifiedTiles);
+  tiles = scheduler.getPendingTiles(map, map.getPosition(), 0.0);
+  ASSERT_EQ(1u, tiles.size());
+  EXPECT_TRUE((tiles[0] == grid_map::Index(1, 2)).all());
+  EXPECT_TRUE(scheduler.isPending(grid_map::Index(1, 2)));
+  EXPECT_FALSE(scheduler.isPending(grid_map::Index(2, 1)));
+  EXPECT_TRUE(scheduler.isPending(grid_map::Index(4, 0)));
+
+  // All tiles are pending when the size of the map changes.
+  grid_map::GridMap largerMap({"elevation"});
+  largerMap.setGeometry(grid_map::Length(4.0, 3.2), 0.1);
+  EXPECT_EQ(20u, scheduler.getPendingTiles(largerMap, largerMap.getPosition(), 0.0).size());
+}
@@ -0,0 +1,168 @@
+/*
+ * GridMapDeltaCodingTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/GridMapDeltaCoding.hpp"
+
+#include <cmath>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+grid_map::GridMap makeMap() {
+  grid_map::GridMap map({"elevation", "variance"});
+  map.setBasicLayers({"elevation"});
+  map.setFrameId("odom");
+  map.setGeometry(grid_map::Length(4.0, 3.0), 0.1, grid_map::Position(0.0, 0.0));
+  return map;
+}
+
+void fillCell(grid_map::GridMap& map, const grid_map::Index& index) {
+  grid_map::Position position;
+  map.getPosition(index, position);
+  map.at("elevation", index) = static_cast<float>(std::sin(position.x()) + position.y());
+  map.at("variance", index) = static_cast<float>(0.001 * (1.0 + position.x() * position.x()));
+}
+
+void expectEqualLayer(const grid_map::GridMap& map, const grid_map::GridMap& decodedMap, const std::string& layer, float tolerance) {
+  ASSERT_EQ(map.getSize()(0), decodedMap.getSize()(0));
+  ASSERT_EQ(map.getSize()(1), decodedMap.getSize()(1));
+  EXPECT_EQ(map.getPosition(), decodedMap.getPosition());
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    grid_map::Position position;
+    map.getPosition(*iterator, position);
+    grid_map::Index index;
+    ASSERT_TRUE(decodedMap.getIndex(position, index));
+    const float value = map.at(layer, *iterator);
+    const float decodedValue = decodedMap.at(layer, index);
+    if (std::isnan(value)) {
+      EXPECT_TRUE(std::isnan(decodedValue));
+    } else {
+      EXPECT_NEAR(value, decodedValue, tolerance);
+    }
+  }
+}
+}  // namespace
+
+TEST(GridMapDeltaCoding, SendsChangedTiles) {  // NOLINT
+  grid_map::GridMap map = makeMap();
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    if ((*iterator)(0) < 20) {
+      fillCell(map, *iterator);
+    }
+  }
+  elevation_mapping::GridMapDeltaEncoder encoder(8, {}, {}, 0, 0);
+  elevation_mapping::GridMapDeltaDecoder decoder;
+  elevation_mapping::GridMapDelta message;
+
+  // The first message is a keyframe without the empty tiles.
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_TRUE(message.keyframe);
+  EXPECT_EQ(12u, message.tiles.size());
+  ASSERT_TRUE(decoder.decode(message));
+  EXPECT_EQ(map.getBasicLayers(), decoder.getMap().getBasicLayers());
+  EXPECT_EQ("odom", decoder.getMap().getFrameId());
+  expectEqualLayer(map, decoder.getMap(), "elevation", 0.0f);
+  expectEqualLayer(map, decoder.getMap(), "variance", 0.0f);
+
+  // Nothing changed.
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_FALSE(message.keyframe);
+  EXPECT_TRUE(message.tiles.empty());
+  ASSERT_TRUE(decoder.decode(message));
+
+  // A changed and a cleared cell in two tiles.
+  map.at("variance", grid_map::Index(3, 3)) = 0.5;
+  map.at("elevation", grid_map::Index(12, 20)) = NAN;
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_EQ(2u, message.tiles.size());
+  ASSERT_TRUE(decoder.decode(message));
+  expectEqualLayer(map, decoder.getMap(), "elevation", 0.0f);
+  expectEqualLayer(map, decoder.getMap(), "variance", 0.0f);
+
+  // Moving the map only sends the tiles with cells which entered the map.
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    fillCell(map, *iterator);
+  }
+  ASSERT_TRUE(encoder.encode(map, message));
+  ASSERT_TRUE(decoder.decode(message));
+  map.move(grid_map::Position(0.5, 0.3));
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    if (!map.isValid(*iterator)) {
+      fillCell(map, *iterator);
+    }
+  }
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_FALSE(message.keyframe);
+  EXPECT_EQ(8u, message.tiles.size());
+  ASSERT_TRUE(decoder.decode(message));
+  expectEqualLayer(map, decoder.getMap(), "elevation", 0.0f);
+  expectEqualLayer(map, decoder.getMap(), "variance", 0.0f);
+}
+
+TEST(GridMapDeltaCoding, QuantizesLayers) {  // NOLINT
+  grid_map::GridMap map = makeMap();
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    if ((*iterator)(1) != 7) {
+      fillCell(map, *iterator);
+    }
+  }
+  elevation_mapping::GridMapDeltaEncoder encoder(16, {"variance"}, {"elevation"}, 0, 0);
+  elevation_mapping::GridMapDeltaDecoder decoder;
+  elevation_mapping::GridMapDelta message;
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_EQ(std::vector<std::string>({"variance"}), message.layers);
+  EXPECT_EQ(std::vector<std::string>({"elevation"}), message.quantized_layers);
+  ASSERT_TRUE(decoder.decode(message));
+  // The values of a tile span less than 4 m.
+  expectEqualLayer(map, decoder.getMap(), "elevation", 4.0f / 65534.0f);
+  expectEqualLayer(map, decoder.getMap(), "variance", 0.0f);
+
+  // A missing layer cannot be encoded.
+  elevation_mapping::GridMapDeltaEncoder otherEncoder(16, {"color"}, {}, 0, 0);
+  EXPECT_FALSE(otherEncoder.encode(map, message));
+}
+
+TEST(GridMapDeltaCoding, LimitsMessageSize) {  // NOLINT
+  grid_map::GridMap map = makeMap();
+  elevation_mapping::GridMapDeltaEncoder encoder(10, {}, {}, 4, 4000);
+  elevation_mapping::GridMapDeltaDecoder decoder;
+  elevation_mapping::GridMapDelta message;
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_TRUE(message.keyframe);
+  ASSERT_TRUE(decoder.decode(message));
+
+  // All 12 tiles change, 4 tiles fit into a message.
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    fillCell(map, *iterator);
+  }
+  std::size_t numberOfTiles = 0;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(encoder.encode(map, message));
+    EXPECT_FALSE(message.keyframe);
+    EXPECT_LE(message.tiles.size(), 4u);
+    numberOfTiles += message.tiles.size();
+    ASSERT_TRUE(decoder.decode(message));
+  }
+  EXPECT_EQ(12u, numberOfTiles);
+  expectEqualLayer(map, decoder.getMap(), "elevation", 0.0f);
+
+  // A lost message stops decoding until the next keyframe.
+  map.at("elevation", grid_map::Index(0, 0)) = 1.0;
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_TRUE(message.keyframe);
+  map.at("elevation", grid_map::Index(0, 0)) = 2.0;
+  ASSERT_TRUE(encoder.encode(map, message));
+  EXPECT_FALSE(decoder.decode(message));
+  EXPECT_FALSE(decoder.hasMap());
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(encoder.encode(map, message));
+    EXPECT_EQ(i == 2, decoder.decode(message));
+  }
+  EXPECT_TRUE(decoder.hasMap());
+  expectEqualLayer(map, decoder.getMap(), "elevation", 0.0f);
+}
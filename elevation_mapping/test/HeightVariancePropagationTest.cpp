@@ -0,0 +1,77 @@
+/*
+ * HeightVariancePropagationTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/sensor_processors/HeightVariancePropagation.hpp"
+
+#include <random>
+
+// Eigen
+#include <Eigen/Geometry>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+
+Eigen::Matrix3f getSkewMatrix(const Eigen::Vector3f& vector) {
+  Eigen::Matrix3f skewMatrix;
+  skewMatrix << 0.0f, -vector.z(), vector.y(), vector.z(), 0.0f, -vector.x(), -vector.y(), vector.x(), 0.0f;
+  return skewMatrix;
+}
+
+//! The error propagation with full matrices, as formulated in the paper.
+float computeReferenceHeightVariance(const Eigen::Matrix3f& C_BM, const Eigen::Matrix3f& C_SB, const Eigen::Vector3f& B_r_BS,
+                                     const Eigen::Matrix3f& rotationVariance, const Eigen::Vector3f& S_r_SP,
+                                     const Eigen::Vector3f& sensorVariance) {
+  const Eigen::RowVector3f P = Eigen::RowVector3f::UnitZ();
+  const Eigen::RowVector3f sensorJacobian = P * C_BM.transpose() * C_SB.transpose();
+  const Eigen::RowVector3f rotationJacobian = P * C_BM.transpose() * (getSkewMatrix(C_SB.transpose() * S_r_SP) + getSkewMatrix(B_r_BS));
+  const float rotationPart = rotationJacobian * rotationVariance * rotationJacobian.transpose();
+  const float sensorPart = sensorJacobian * sensorVariance.asDiagonal() * sensorJacobian.transpose();
+  return rotationPart + sensorPart;
+}
+
+}  // namespace
+
+TEST(HeightVariancePropagation, MatchesFullErrorPropagation) {  // NOLINT
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+  const auto randomVector = [&]() { return Eigen::Vector3f(uniform(generator), uniform(generator), uniform(generator)); };
+  const auto randomRotation = [&]() { return Eigen::Quaternionf(Eigen::Vector4f(randomVector().homogeneous())).normalized().toRotationMatrix(); };
+
+  for (int test = 0; test < 10; ++test) {
+    const Eigen::Matrix3f C_BM = randomRotation();
+    const Eigen::Matrix3f C_SB = randomRotation();
+    const Eigen::Vector3f B_r_BS = randomVector();
+    Eigen::Matrix3f rotationVariance = Eigen::Matrix3f::Zero();
+    for (int i = 0; i < 3; ++i) {
+      const Eigen::Vector3f sample = 0.1f * randomVector();
+      rotationVariance += sample * sample.transpose();
+    }
+    const elevation_mapping::HeightVariancePropagation propagation(C_BM, C_SB, B_r_BS, rotationVariance);
+
+    // More points than a block of the batched computation, with a remainder.
+    const int numPoints = 1000;
+    elevation_mapping::HeightVariancePropagation::Points points(numPoints, 3);
+    elevation_mapping::HeightVariancePropagation::SensorVariances sensorVariances(numPoints, 2);
+    for (int i = 0; i < numPoints; ++i) {
+      points.row(i) = 5.0f * randomVector().transpose();
+      sensorVariances(i, 0) = 1e-4f * (1.0f + uniform(generator));
+      sensorVariances(i, 1) = 1e-3f * (1.0f + uniform(generator));
+    }
+    Eigen::VectorXf variances(numPoints);
+    propagation.computeHeightVariances(points, sensorVariances, variances);
+
+    for (int i = 0; i < numPoints; ++i) {
+      const Eigen::Vector3f point = points.row(i).transpose();
+      const float expected = computeReferenceHeightVariance(
+          C_BM, C_SB, B_r_BS, rotationVariance, point, Eigen::Vector3f(sensorVariances(i, 0), sensorVariances(i, 0), sensorVariances(i, 1)));
+      EXPECT_NEAR(expected, variances(i), 1e-5f * expected);
+      EXPECT_NEAR(variances(i), propagation.computeHeightVariance(point, sensorVariances(i, 0), sensorVariances(i, 1)), 1e-5f * expected);
+    }
+  }
+}
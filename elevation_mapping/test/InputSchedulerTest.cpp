@@ -0,0 +1,96 @@
+/*
+ * InputSchedulerTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/input_sources/InputScheduler.hpp"
+
+#include <algorithm>
+#include <limits>
+
+// gtest
+#include <gtest/gtest.h>
+
+TEST(InputScheduler, Disabled) {  // NOLINT
+  elevation_mapping::InputScheduler scheduler;
+  EXPECT_FALSE(scheduler.isEnabled());
+  scheduler.reportIntegration("front", 1000, 5.0, 1000, 5.0, 10.0, 100.0);
+  EXPECT_TRUE(scheduler.admit("front", 10.0));
+  EXPECT_EQ(1u, scheduler.getDecimation("front"));
+  EXPECT_EQ(std::numeric_limits<std::size_t>::max(), scheduler.getPointBudget("front"));
+}
+
+TEST(InputScheduler, SkipsStalePointClouds) {  // NOLINT
+  elevation_mapping::InputScheduler scheduler(0.5);
+  EXPECT_TRUE(scheduler.admit("front", 0.1));
+  EXPECT_FALSE(scheduler.admit("front", 0.6));
+}
+
+TEST(InputScheduler, ShedsLowPriorityFirst) {  // NOLINT
+  elevation_mapping::InputScheduler scheduler(0.5);
+  scheduler.setPriority("front", 1);
+  scheduler.setPriority("rear", 0);
+
+  // Overload: the rear source is decimated first, at most once per budget.
+  double time = 10.0;
+  scheduler.reportIntegration("front", 1000, 0.05, 1000, 0.05, 1.0, time);
+  scheduler.reportIntegration("front", 1000, 0.05, 1000, 0.05, 1.0, time + 0.1);
+  EXPECT_EQ(1u, scheduler.getDecimation("front"));
+  EXPECT_EQ(2u, scheduler.getDecimation("rear"));
+  for (int i = 0; i < 5; ++i) {
+    time += 0.5;
+    scheduler.reportIntegration("front", 1000, 0.05, 1000, 0.05, 1.0, time);
+  }
+  EXPECT_EQ(elevation_mapping::InputScheduler::maxDecimation, scheduler.getDecimation("rear"));
+  EXPECT_EQ(4u, scheduler.getDecimation("front"));
+
+  // Only one of every decimation point clouds is processed.
+  int admitted = 0;
+  for (int i = 0; i < 32; ++i) {
+    admitted += scheduler.admit("rear", 0.0) ? 1 : 0;
+  }
+  EXPECT_EQ(2, admitted);
+
+  // Recovery: the front source is restored first.
+  for (int i = 0; i < 40; ++i) {
+    time += 0.5;
+    scheduler.reportIntegration("front", 1000, 0.05, 1000, 0.05, 0.05, time);
+    if (scheduler.getDecimation("front") == 1) {
+      break;
+    }
+  }
+  EXPECT_EQ(1u, scheduler.getDecimation("front"));
+  EXPECT_LT(1u, scheduler.getDecimation("rear"));
+}
+
+TEST(InputScheduler, PointBudget) {  // NOLINT
+  elevation_mapping::InputScheduler scheduler(0.4);
+  scheduler.setPriority("front", 0);
+  scheduler.setPriority("rear", 0);
+  EXPECT_EQ(std::numeric_limits<std::size_t>::max(), scheduler.getPointBudget("front"));
+
+  // Processing takes 0.5 us per point, the sensor processor leaves half of the points, which take 1 us each to integrate.
+  // That is 1 us per processed point, each of the two sources gets 0.2 s.
+  scheduler.reportIntegration("front", 20000, 0.01, 10000, 0.01, 0.1, 1.0);
+  EXPECT_NEAR(200000.0, static_cast<double>(scheduler.getPointBudget("front")), 1.0);
+  EXPECT_EQ(std::numeric_limits<std::size_t>::max(), scheduler.getPointBudget("rear"));
+}
+
+TEST(InputScheduler, PointBudgetSettles) {  // NOLINT
+  elevation_mapping::InputScheduler scheduler(0.1);
+
+  // The full point cloud takes 0.2 s to process, twice the budget. Processing and integration cost 2 us and 1 us per point.
+  const std::size_t numberOfPoints = 100000;
+  double time = 10.0;
+  for (int i = 0; i < 50; ++i) {
+    const std::size_t numberOfProcessedPoints = std::min(numberOfPoints, scheduler.getPointBudget("front"));
+    const double processingDuration = 2e-6 * static_cast<double>(numberOfProcessedPoints);
+    const double integrationDuration = 1e-6 * static_cast<double>(numberOfProcessedPoints);
+    time += 0.1;
+    scheduler.reportIntegration("front", numberOfProcessedPoints, processingDuration, numberOfProcessedPoints, integrationDuration,
+                                processingDuration + integrationDuration, time);
+  }
+  EXPECT_NEAR(33333.0, static_cast<double>(scheduler.getPointBudget("front")), 1.0);
+}
@@ -0,0 +1,78 @@
+/*
+ * MapLayersTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/MapLayers.hpp"
+
+#include <cmath>
+
+// gtest
+#include <gtest/gtest.h>
+
+TEST(MapLayers, LayerNames) {  // NOLINT
+  const std::vector<std::string> rawMapLayers{"elevation",
+                                              "variance",
+                                              "horizontal_variance_x",
+                                              "horizontal_variance_y",
+                                              "horizontal_variance_xy",
+                                              "color",
+                                              "time",
+                                              "dynamic_time",
+                                              "lowest_scan_point",
+                                              "sensor_x_at_lowest_scan",
+                                              "sensor_y_at_lowest_scan",
+                                              "sensor_z_at_lowest_scan"};
+  EXPECT_EQ(rawMapLayers, elevation_mapping::getMapLayerNames<elevation_mapping::RawMapLayer>());
+  EXPECT_EQ(std::vector<std::string>({"elevation", "variance"}), elevation_mapping::getMapLayerNames<elevation_mapping::RawMapLayer>(true));
+  const std::vector<std::string> fusedMapLayers{"elevation", "upper_bound", "lower_bound", "color"};
+  EXPECT_EQ(fusedMapLayers, elevation_mapping::getMapLayerNames<elevation_mapping::FusedMapLayer>());
+  const std::vector<std::string> fusedMapBasicLayers{"elevation", "upper_bound", "lower_bound"};
+  EXPECT_EQ(fusedMapBasicLayers, elevation_mapping::getMapLayerNames<elevation_mapping::FusedMapLayer>(true));
+}
+
+TEST(MapLayers, Access) {  // NOLINT
+  grid_map::GridMap map({"elevation", "variance", "horizontal_variance_x", "color"});
+  map.setBasicLayers(elevation_mapping::getMapLayerNames<elevation_mapping::RawMapLayer>(true));
+  map.setGeometry(grid_map::Length(1.0, 1.0), 0.1);
+  map["elevation"].setConstant(1.0);
+  map["variance"].setConstant(0.01);
+
+  const elevation_mapping::RawMapLayers layers(map);
+  EXPECT_TRUE(layers.has(elevation_mapping::RawMapLayer::Elevation));
+  EXPECT_TRUE(layers.has(elevation_mapping::RawMapLayer::Color));
+  EXPECT_FALSE(layers.has(elevation_mapping::RawMapLayer::Time));
+  EXPECT_FALSE(layers.has(elevation_mapping::RawMapLayer::LowestScanPoint));
+  EXPECT_EQ(&map["horizontal_variance_x"], &layers[elevation_mapping::RawMapLayer::HorizontalVarianceX]);
+
+  // Writes through the handles are visible in the named layers.
+  const grid_map::Index index(3, 4);
+  layers[elevation_mapping::RawMapLayer::Elevation](index(0), index(1)) = 2.0;
+  EXPECT_FLOAT_EQ(2.0, map.at("elevation", index));
+
+  const elevation_mapping::ConstRawMapLayers constLayers(static_cast<const grid_map::GridMap&>(map));
+  EXPECT_FLOAT_EQ(2.0, constLayers[elevation_mapping::RawMapLayer::Elevation](index(0), index(1)));
+}
+
+TEST(MapLayers, IsValid) {  // NOLINT
+  grid_map::GridMap map(elevation_mapping::getMapLayerNames<elevation_mapping::FusedMapLayer>());
+  map.setBasicLayers(elevation_mapping::getMapLayerNames<elevation_mapping::FusedMapLayer>(true));
+  map.setGeometry(grid_map::Length(1.0, 1.0), 0.1);
+  map["elevation"].setConstant(1.0);
+  map["upper_bound"].setConstant(1.1);
+  map["lower_bound"].setConstant(0.9);
+  map.at("upper_bound", grid_map::Index(1, 2)) = NAN;
+  map.at("lower_bound", grid_map::Index(2, 1)) = INFINITY;
+  // The color is not a basic layer.
+  map.at("color", grid_map::Index(3, 3)) = NAN;
+
+  const elevation_mapping::FusedMapLayers layers(map);
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    EXPECT_EQ(map.isValid(*iterator), layers.isValid(*iterator));
+  }
+  EXPECT_FALSE(layers.isValid(grid_map::Index(1, 2)));
+  EXPECT_FALSE(layers.isValid(grid_map::Index(2, 1)));
+  EXPECT_TRUE(layers.isValid(grid_map::Index(3, 3)));
+}
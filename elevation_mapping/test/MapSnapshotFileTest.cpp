@@ -0,0 +1,92 @@
+/*
+ * MapSnapshotFileTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/MapSnapshotFile.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+// POSIX
+#include <unistd.h>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+std::string makeTemporaryPath() {
+  char directory[] = "/tmp/elevation_mapping_snapshot_XXXXXX";
+  return ::mkdtemp(directory) != nullptr ? std::string(directory) + "/map.snapshot" : std::string();
+}
+
+grid_map::GridMap makeMap() {
+  grid_map::GridMap map({"elevation", "variance", "color"});
+  map.setBasicLayers({"elevation", "variance"});
+  map.setFrameId("odom");
+  map.setGeometry(grid_map::Length(2.0, 1.5), 0.1, grid_map::Position(0.3, -0.2));
+  // Move the map, such that the start index of the circular buffer is not zero.
+  map.move(grid_map::Position(0.6, 0.1));
+  map.setTimestamp(1234567890123ull);
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    const grid_map::Index index(*iterator);
+    if ((index(0) + index(1)) % 7 != 0) {
+      map.at("elevation", index) = static_cast<float>(index(0) - 2 * index(1));
+      map.at("variance", index) = 0.001f * static_cast<float>(index(0));
+    }
+  }
+  return map;
+}
+}  // namespace
+
+TEST(MapSnapshotFile, WriteAndRead) {  // NOLINT
+  const std::string path = makeTemporaryPath();
+  ASSERT_FALSE(path.empty());
+  const grid_map::GridMap map = makeMap();
+  ASSERT_TRUE(elevation_mapping::writeMapSnapshot(map, path));
+  EXPECT_NE(0, ::access((path + ".tmp").c_str(), F_OK));
+
+  grid_map::GridMap readMap;
+  ASSERT_TRUE(elevation_mapping::readMapSnapshot(path, readMap));
+  EXPECT_EQ(map.getLayers(), readMap.getLayers());
+  EXPECT_EQ(map.getBasicLayers(), readMap.getBasicLayers());
+  EXPECT_EQ(map.getFrameId(), readMap.getFrameId());
+  EXPECT_EQ(map.getTimestamp(), readMap.getTimestamp());
+  EXPECT_DOUBLE_EQ(map.getResolution(), readMap.getResolution());
+  EXPECT_TRUE((map.getSize() == readMap.getSize()).all());
+  EXPECT_TRUE((map.getStartIndex() == readMap.getStartIndex()).all());
+  EXPECT_TRUE(map.getPosition().isApprox(readMap.getPosition()));
+  for (const auto& layer : map.getLayers()) {
+    const grid_map::Matrix& data = map[layer];
+    const grid_map::Matrix& readData = readMap[layer];
+    for (int i = 0; i < data.size(); ++i) {
+      if (std::isnan(data(i))) {
+        EXPECT_TRUE(std::isnan(readData(i)));
+      } else {
+        EXPECT_EQ(data(i), readData(i));
+      }
+    }
+  }
+}
+
+TEST(MapSnapshotFile, RejectsInvalidFiles) {  // NOLINT
+  const std::string path = makeTemporaryPath();
+  ASSERT_FALSE(path.empty());
+  grid_map::GridMap readMap;
+  EXPECT_FALSE(elevation_mapping::readMapSnapshot(path, readMap));
+
+  ASSERT_TRUE(elevation_mapping::writeMapSnapshot(makeMap(), path));
+  ASSERT_TRUE(elevation_mapping::readMapSnapshot(path, readMap));
+
+  // A truncated snapshot is not read.
+  ASSERT_EQ(0, ::truncate(path.c_str(), 200));
+  EXPECT_FALSE(elevation_mapping::readMapSnapshot(path, readMap));
+
+  // Neither is another file.
+  std::ofstream(path) << "not a snapshot";
+  EXPECT_FALSE(elevation_mapping::readMapSnapshot(path, readMap));
+}
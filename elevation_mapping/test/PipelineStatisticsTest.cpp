@@ -0,0 +1,85 @@
+/*
+ * PipelineStatisticsTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/PipelineStatistics.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+std::map<std::string, std::string> getValues(const diagnostic_msgs::DiagnosticStatus& status) {
+  std::map<std::string, std::string> values;
+  for (const auto& keyValue : status.values) {
+    values[keyValue.key] = keyValue.value;
+  }
+  return values;
+}
+}  // namespace
+
+TEST(PipelineStatistics, Percentiles) {  // NOLINT
+  elevation_mapping::LatencyHistogram histogram;
+  EXPECT_EQ(0.0, histogram.getPercentile(0.5));
+  // 1 ms to 100 ms.
+  for (int i = 1; i <= 100; ++i) {
+    histogram.add(0.001 * i);
+  }
+  EXPECT_EQ(100u, histogram.getCount());
+  EXPECT_NEAR(0.0505, histogram.getMean(), 1e-9);
+  EXPECT_EQ(0.1, histogram.getMax());
+  // The percentiles are the upper bounds of their buckets, which are less than 19% wide.
+  for (double fraction : {0.01, 0.5, 0.9, 0.99}) {
+    EXPECT_GE(histogram.getPercentile(fraction), 0.1 * fraction);
+    EXPECT_LE(histogram.getPercentile(fraction), 0.1 * fraction * 1.19);
+  }
+  EXPECT_EQ(0.1, histogram.getPercentile(1.0));
+
+  // Out of range values are kept in the first and last bucket.
+  histogram.add(0.0);
+  histogram.add(1000.0);
+  EXPECT_EQ(1000.0, histogram.getPercentile(1.0));
+}
+
+TEST(PipelineStatistics, Status) {  // NOLINT
+  elevation_mapping::PipelineStatistics statistics;
+  statistics.addDuration("lidar", elevation_mapping::PipelineStage::Conversion, 0.002);
+  statistics.addDuration("lidar", elevation_mapping::PipelineStage::Conversion, 0.004);
+  statistics.addDroppedFrames("lidar", 3);
+  statistics.setQueueDepth("map", "integration", 2);
+  statistics.setQueueDepth("map", "integration", 1);
+  { elevation_mapping::PipelineStatistics::ScopedTimer timer(&statistics, "map", elevation_mapping::PipelineStage::Fuse); }
+
+  std::vector<diagnostic_msgs::DiagnosticStatus> status;
+  statistics.getStatus("node: ", status);
+  ASSERT_EQ(2u, status.size());
+  EXPECT_EQ("node: lidar", status[0].name);
+  EXPECT_EQ("node: map", status[1].name);
+
+  std::map<std::string, std::string> values = getValues(status[0]);
+  EXPECT_EQ("3", values["dropped_frames"]);
+  EXPECT_EQ("2", values["conversion count"]);
+  EXPECT_EQ("3.000", values["conversion mean [ms]"]);
+  EXPECT_EQ("4.000", values["conversion max [ms]"]);
+  EXPECT_EQ(0u, values.count("fuse count"));
+
+  values = getValues(status[1]);
+  EXPECT_EQ("0", values["dropped_frames"]);
+  EXPECT_EQ("1", values["integration queue_depth"]);
+  EXPECT_EQ("2", values["integration max_queue_depth"]);
+  EXPECT_EQ("1", values["fuse count"]);
+
+  // A timer without statistics does not record anything.
+  { elevation_mapping::PipelineStatistics::ScopedTimer timer(nullptr, "map", elevation_mapping::PipelineStage::Fuse); }
+
+  statistics.reset();
+  status.clear();
+  statistics.getStatus("node: ", status);
+  EXPECT_TRUE(status.empty());
+}
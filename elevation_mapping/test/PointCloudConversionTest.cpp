@@ -0,0 +1,139 @@
+/*
+ * PointCloudConversionTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/PointCloudConversion.hpp"
+
+#include <cstring>
+#include <string>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+sensor_msgs::PointField makeField(const std::string& name, uint32_t offset, uint8_t datatype) {
+  sensor_msgs::PointField field;
+  field.name = name;
+  field.offset = offset;
+  field.datatype = datatype;
+  field.count = 1;
+  return field;
+}
+
+template <typename Scalar>
+void writeField(sensor_msgs::PointCloud2& message, std::size_t point, uint32_t offset, Scalar value) {
+  std::memcpy(message.data.data() + point * message.point_step + offset, &value, sizeof(Scalar));
+}
+}  // namespace
+
+TEST(PointCloudConversion, XYZ) {  // NOLINT
+  // Padded layout with an unused intensity field, as sent by many LiDAR drivers.
+  sensor_msgs::PointCloud2 message;
+  message.header.stamp.fromNSec(1234567000);
+  message.header.frame_id = "sensor";
+  message.height = 1;
+  message.width = 2;
+  message.point_step = 20;
+  message.row_step = message.width * message.point_step;
+  message.fields = {makeField("x", 0, sensor_msgs::PointField::FLOAT32), makeField("y", 4, sensor_msgs::PointField::FLOAT32),
+                    makeField("z", 8, sensor_msgs::PointField::FLOAT32), makeField("intensity", 16, sensor_msgs::PointField::FLOAT32)};
+  message.data.resize(message.row_step);
+  for (std::size_t i = 0; i < 2; ++i) {
+    writeField(message, i, 0, 1.0f + i);
+    writeField(message, i, 4, 2.0f + i);
+    writeField(message, i, 8, 3.0f + i);
+    writeField(message, i, 16, 100.0f);
+  }
+
+  elevation_mapping::PointCloudType pointCloud;
+  ASSERT_TRUE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+  ASSERT_EQ(2u, pointCloud.size());
+  EXPECT_EQ(1234567u, pointCloud.header.stamp);
+  EXPECT_EQ("sensor", pointCloud.header.frame_id);
+  for (std::size_t i = 0; i < 2; ++i) {
+    EXPECT_FLOAT_EQ(1.0f + i, pointCloud.points[i].x);
+    EXPECT_FLOAT_EQ(2.0f + i, pointCloud.points[i].y);
+    EXPECT_FLOAT_EQ(3.0f + i, pointCloud.points[i].z);
+    // Missing fields keep the defaults of the point type.
+    EXPECT_EQ(0, pointCloud.points[i].r);
+    EXPECT_FLOAT_EQ(1.0f, pointCloud.points[i].confidence_ratio);
+  }
+}
+
+TEST(PointCloudConversion, ColorAndConfidenceRatio) {  // NOLINT
+  sensor_msgs::PointCloud2 message;
+  message.height = 1;
+  message.width = 1;
+  message.point_step = 20;
+  message.row_step = message.point_step;
+  message.fields = {makeField("x", 0, sensor_msgs::PointField::FLOAT32), makeField("y", 4, sensor_msgs::PointField::FLOAT32),
+                    makeField("z", 8, sensor_msgs::PointField::FLOAT32), makeField("rgb", 12, sensor_msgs::PointField::FLOAT32),
+                    makeField("confidence_ratio", 16, sensor_msgs::PointField::FLOAT32)};
+  message.data.resize(message.row_step);
+  const uint32_t rgba = (255u << 24) | (10u << 16) | (20u << 8) | 30u;
+  writeField(message, 0, 12, rgba);
+  writeField(message, 0, 16, 0.5f);
+
+  elevation_mapping::PointCloudType pointCloud;
+  ASSERT_TRUE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+  ASSERT_EQ(1u, pointCloud.size());
+  EXPECT_EQ(10, pointCloud.points[0].r);
+  EXPECT_EQ(20, pointCloud.points[0].g);
+  EXPECT_EQ(30, pointCloud.points[0].b);
+  EXPECT_FLOAT_EQ(0.5f, pointCloud.points[0].confidence_ratio);
+}
+
+TEST(PointCloudConversion, ColorTypes) {  // NOLINT
+  // Drivers send the packed color as float or unsigned integer under either name.
+  const uint32_t rgba = (255u << 24) | (10u << 16) | (20u << 8) | 30u;
+  for (const std::string name : {"rgb", "rgba"}) {
+    for (const uint8_t datatype : {sensor_msgs::PointField::FLOAT32, sensor_msgs::PointField::UINT32}) {
+      sensor_msgs::PointCloud2 message;
+      message.height = 1;
+      message.width = 1;
+      message.point_step = 16;
+      message.row_step = message.point_step;
+      message.fields = {makeField("x", 0, sensor_msgs::PointField::FLOAT32), makeField("y", 4, sensor_msgs::PointField::FLOAT32),
+                        makeField("z", 8, sensor_msgs::PointField::FLOAT32), makeField(name, 12, datatype)};
+      message.data.resize(message.row_step);
+      writeField(message, 0, 12, rgba);
+
+      elevation_mapping::PointCloudType pointCloud;
+      ASSERT_TRUE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+      ASSERT_EQ(1u, pointCloud.size());
+      EXPECT_EQ(10, pointCloud.points[0].r) << name << " " << static_cast<int>(datatype);
+      EXPECT_EQ(20, pointCloud.points[0].g) << name << " " << static_cast<int>(datatype);
+      EXPECT_EQ(30, pointCloud.points[0].b) << name << " " << static_cast<int>(datatype);
+    }
+  }
+}
+
+TEST(PointCloudConversion, InvalidMessage) {  // NOLINT
+  sensor_msgs::PointCloud2 message;
+  message.height = 1;
+  message.width = 10;
+  message.point_step = 12;
+  message.row_step = message.width * message.point_step;
+  message.fields = {makeField("x", 0, sensor_msgs::PointField::FLOAT32), makeField("y", 4, sensor_msgs::PointField::FLOAT32)};
+  message.data.resize(message.row_step);
+
+  elevation_mapping::PointCloudType pointCloud;
+  EXPECT_FALSE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+
+  // Data is shorter than announced by the header.
+  message.fields.push_back(makeField("z", 8, sensor_msgs::PointField::FLOAT32));
+  message.data.resize(message.row_step - 1);
+  EXPECT_FALSE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+
+  // A field ends beyond the point step.
+  message.data.resize(message.row_step);
+  message.fields.push_back(makeField("rgb", 10, sensor_msgs::PointField::FLOAT32));
+  EXPECT_FALSE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+  message.fields.back() = makeField("z", 9, sensor_msgs::PointField::FLOAT32);
+  EXPECT_FALSE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+  message.fields.back() = makeField("rgb", 8, sensor_msgs::PointField::UINT32);
+  EXPECT_TRUE(elevation_mapping::fromPointCloud2Message(message, pointCloud));
+}
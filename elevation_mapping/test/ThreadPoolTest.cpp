@@ -0,0 +1,57 @@
+/*
+ * ThreadPoolTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/ThreadPool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+TEST(ThreadPool, Size) {  // NOLINT
+  EXPECT_EQ(1u, elevation_mapping::ThreadPool().size());
+  EXPECT_EQ(1u, elevation_mapping::ThreadPool(0).size());
+  EXPECT_EQ(4u, elevation_mapping::ThreadPool(4).size());
+}
+
+TEST(ThreadPool, RunsEveryTaskOnce) {  // NOLINT
+  for (int numThreads : {1, 2, 4}) {
+    elevation_mapping::ThreadPool threadPool(numThreads);
+    // Run several loops to check that the pool can be reused.
+    for (std::size_t numTasks : {0u, 1u, 3u, 100u}) {
+      std::vector<std::atomic<int>> counters(numTasks);
+      for (auto& counter : counters) {
+        counter = 0;
+      }
+      threadPool.parallelFor(numTasks, [&](std::size_t taskIndex, std::size_t threadIndex) {
+        EXPECT_LT(threadIndex, threadPool.size());
+        ++counters[taskIndex];
+      });
+      for (const auto& counter : counters) {
+        EXPECT_EQ(1, counter);
+      }
+    }
+  }
+}
+
+TEST(ThreadPool, RethrowsException) {  // NOLINT
+  elevation_mapping::ThreadPool threadPool(3);
+  EXPECT_THROW(threadPool.parallelFor(10,
+                                      [](std::size_t taskIndex, std::size_t /*threadIndex*/) {
+                                        if (taskIndex == 5) {
+                                          throw std::runtime_error("Task failed.");
+                                        }
+                                      }),
+               std::runtime_error);
+
+  // The pool is still usable afterwards.
+  std::atomic<int> counter(0);
+  threadPool.parallelFor(10, [&](std::size_t /*taskIndex*/, std::size_t /*threadIndex*/) { ++counter; });
+  EXPECT_EQ(10, counter);
+}
@@ -0,0 +1,123 @@
+/*
+ * TileStoreTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/TileStore.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+// POSIX
+#include <dirent.h>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+std::string makeTemporaryDirectory() {
+  char directory[] = "/tmp/elevation_mapping_tile_store_XXXXXX";
+  return ::mkdtemp(directory) != nullptr ? std::string(directory) + "/tiles" : std::string();
+}
+
+int countFiles(const std::string& directory) {
+  int numberOfFiles = 0;
+  DIR* dir = ::opendir(directory.c_str());
+  if (dir == nullptr) {
+    return 0;
+  }
+  while (dirent* entry = ::readdir(dir)) {
+    numberOfFiles += entry->d_name[0] != '.';
+  }
+  ::closedir(dir);
+  return numberOfFiles;
+}
+
+grid_map::GridMap makeMap(const grid_map::Position& position) {
+  grid_map::GridMap map({"elevation", "variance"});
+  map.setBasicLayers({"elevation"});
+  map.setGeometry(grid_map::Length(2.0, 1.5), 0.1, position);
+  return map;
+}
+}  // namespace
+
+TEST(TileStore, WriteAndRead) {  // NOLINT
+  const std::string directory = makeTemporaryDirectory();
+  ASSERT_FALSE(directory.empty());
+
+  grid_map::GridMap map = makeMap(grid_map::Position(0.0, 0.0));
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    grid_map::Position position;
+    map.getPosition(*iterator, position);
+    // Leave one quadrant empty.
+    if (position.x() > 0.0 || position.y() > 0.0) {
+      map.at("elevation", *iterator) = static_cast<float>(position.x() + 10.0 * position.y());
+      map.at("variance", *iterator) = 0.01f;
+    }
+  }
+  {
+    // Only the newest tiles stay mapped.
+    elevation_mapping::TileStore tileStore(directory, 8, map.getResolution(), {"elevation", "variance"}, 2);
+    ASSERT_TRUE(tileStore.initialize());
+    for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+      EXPECT_TRUE(tileStore.writeCell(map, *iterator));
+    }
+  }
+  EXPECT_GT(countFiles(directory), 0);
+
+  // Read the data back into a shifted map, which only partly overlaps with the stored cells.
+  elevation_mapping::TileStore tileStore(directory, 8, map.getResolution(), {"elevation", "variance"}, 2);
+  ASSERT_TRUE(tileStore.initialize());
+  grid_map::GridMap shiftedMap = makeMap(grid_map::Position(0.5, -0.3));
+  for (grid_map::GridMapIterator iterator(shiftedMap); !iterator.isPastEnd(); ++iterator) {
+    grid_map::Position position;
+    shiftedMap.getPosition(*iterator, position);
+    grid_map::Index index;
+    const bool isStored = map.getIndex(position, index) && map.isValid(index);
+    ASSERT_EQ(isStored, tileStore.readCell(shiftedMap, *iterator));
+    if (isStored) {
+      EXPECT_EQ(map.at("elevation", index), shiftedMap.at("elevation", *iterator));
+      EXPECT_EQ(map.at("variance", index), shiftedMap.at("variance", *iterator));
+    } else {
+      EXPECT_TRUE(std::isnan(shiftedMap.at("elevation", *iterator)));
+    }
+  }
+
+  // Empty cells clear the stored cells.
+  grid_map::GridMap emptyMap = makeMap(grid_map::Position(0.0, 0.0));
+  for (grid_map::GridMapIterator iterator(emptyMap); !iterator.isPastEnd(); ++iterator) {
+    EXPECT_TRUE(tileStore.writeCell(emptyMap, *iterator));
+  }
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    grid_map::GridMap readMap = makeMap(grid_map::Position(0.0, 0.0));
+    EXPECT_FALSE(tileStore.readCell(readMap, *iterator));
+  }
+}
+
+TEST(TileStore, IgnoresIncompatibleTiles) {  // NOLINT
+  const std::string directory = makeTemporaryDirectory();
+  ASSERT_FALSE(directory.empty());
+
+  grid_map::GridMap map = makeMap(grid_map::Position(0.0, 0.0));
+  map["elevation"].setConstant(1.0f);
+  map["variance"].setConstant(0.01f);
+  const grid_map::Index index(3, 4);
+  {
+    elevation_mapping::TileStore tileStore(directory, 8, map.getResolution(), {"elevation", "variance"}, 4);
+    ASSERT_TRUE(tileStore.initialize());
+    EXPECT_TRUE(tileStore.writeCell(map, index));
+  }
+
+  // Tiles of a different size or with different layers are not read.
+  grid_map::GridMap readMap = makeMap(grid_map::Position(0.0, 0.0));
+  elevation_mapping::TileStore otherSizeTileStore(directory, 16, map.getResolution(), {"elevation", "variance"}, 4);
+  EXPECT_FALSE(otherSizeTileStore.readCell(readMap, index));
+  elevation_mapping::TileStore otherLayersTileStore(directory, 8, map.getResolution(), {"elevation"}, 4);
+  EXPECT_FALSE(otherLayersTileStore.readCell(readMap, index));
+  elevation_mapping::TileStore tileStore(directory, 8, map.getResolution(), {"elevation", "variance"}, 4);
+  EXPECT_TRUE(tileStore.readCell(readMap, index));
+  EXPECT_EQ(1.0f, readMap.at("elevation", index));
+}
@@ -71,3 +71,24 @@ TEST(WeightedEmpiricalCumulativeDistributionFunction, SyntheticDataDebug) {  //
   EXPECT_DOUBLE_EQ(1.05, wecdf.quantile(0.05));
   EXPECT_DOUBLE_EQ(1.95, wecdf.quantile(0.95));
 }
+
+TEST(WeightedEmpiricalCumulativeDistributionFunction, WeightedReuse) {  // NOLINT
+  elevation_mapping::WeightedEmpiricalCumulativeDistributionFunction<double> wecdf;
+  wecdf.add(5.0);
+  wecdf.add(-1.0);
+  EXPECT_TRUE(wecdf.compute());
+  EXPECT_DOUBLE_EQ(-1.0, wecdf.quantile(0.0));
+  EXPECT_DOUBLE_EQ(5.0, wecdf.quantile(1.0));
+
+  // The weights of equal values are merged, independent of the order they are added in.
+  wecdf.clear();
+  wecdf.add(2.0, 1.0);
+  wecdf.add(0.0, 2.0);
+  wecdf.add(1.0, 1.0);
+  wecdf.add(2.0, 2.0);
+  EXPECT_TRUE(wecdf.compute());
+  EXPECT_DOUBLE_EQ(0.0, wecdf.quantile(0.0));
+  EXPECT_DOUBLE_EQ(1.0, wecdf.quantile(0.25));
+  EXPECT_DOUBLE_EQ(1.5, wecdf.quantile(0.625));
+  EXPECT_DOUBLE_EQ(2.0, wecdf.quantile(1.0));
+}
@@ -0,0 +1,72 @@
+/*
+ * WeightedExtremeQuantilesTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
+#include "elevation_mapping/WeightedExtremeQuantiles.hpp"
+
+#include <random>
+#include <utility>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+TEST(WeightedExtremeQuantiles, SingleValue) {  // NOLINT
+  elevation_mapping::WeightedExtremeQuantiles<float> quantiles;
+  EXPECT_TRUE(quantiles.empty());
+  quantiles.add(1.5f, 0.2);
+  quantiles.add(1.5f, 0.3);
+  EXPECT_FALSE(quantiles.empty());
+  EXPECT_FLOAT_EQ(1.5f, quantiles.lowerQuantile(0.01));
+  EXPECT_FLOAT_EQ(1.5f, quantiles.upperQuantile(0.99));
+}
+
+TEST(WeightedExtremeQuantiles, MatchesEmpiricalDistribution) {  // NOLINT
+  std::mt19937 generator(0);
+  std::uniform_real_distribution<float> values(-1.0f, 1.0f);
+  std::uniform_real_distribution<double> weights(0.5, 1.0);
+  std::uniform_int_distribution<int> numbersOfSamples(1, 60);
+  elevation_mapping::WeightedExtremeQuantiles<float> quantiles;
+  elevation_mapping::WeightedEmpiricalCumulativeDistributionFunction<float> distribution;
+  for (int test = 0; test < 200; ++test) {
+    quantiles.clear();
+    distribution.clear();
+    const int numberOfSamples = numbersOfSamples(generator);
+    for (int i = 0; i < numberOfSamples; ++i) {
+      // Some equal values.
+      const float value = i % 5 == 4 ? 0.25f : values(generator);
+      const double weight = weights(generator);
+      quantiles.add(value, weight);
+      distribution.add(value, weight);
+    }
+    ASSERT_TRUE(distribution.compute());
+    // With similar weights, the quantiles lie between the two most extreme values for up to 50 samples.
+    if (numberOfSamples <= 50) {
+      EXPECT_NEAR(distribution.quantile(0.01), quantiles.lowerQuantile(0.01), 1e-5);
+      EXPECT_NEAR(distribution.quantile(0.99), quantiles.upperQuantile(0.99), 1e-5);
+    } else {
+      EXPECT_LE(quantiles.lowerQuantile(0.01), distribution.quantile(0.01) + 1e-5);
+      EXPECT_GE(quantiles.upperQuantile(0.99), distribution.quantile(0.99) - 1e-5);
+    }
+  }
+}
+
+TEST(WeightedExtremeQuantiles, ConservativeWithSmallWeights) {  // NOLINT
+  elevation_mapping::WeightedExtremeQuantiles<double> quantiles;
+  elevation_mapping::WeightedEmpiricalCumulativeDistributionFunction<double> distribution;
+  // The second smallest and the largest value carry less than 1% of the weight.
+  const std::vector<std::pair<double, double>> samples{{0.0, 1.0}, {0.1, 0.001}, {0.2, 1.0}, {0.5, 10.0}, {0.9, 1.0}, {1.0, 0.001}};
+  for (const auto& sample : samples) {
+    quantiles.add(sample.first, sample.second);
+    distribution.add(sample.first, sample.second);
+  }
+  ASSERT_TRUE(distribution.compute());
+  EXPECT_DOUBLE_EQ(0.1, quantiles.lowerQuantile(0.01));
+  EXPECT_LT(quantiles.lowerQuantile(0.01), distribution.quantile(0.01));
+  EXPECT_DOUBLE_EQ(0.9, quantiles.upperQuantile(0.99));
+  EXPECT_GT(quantiles.upperQuantile(0.99), distribution.quantile(0.99));
+}
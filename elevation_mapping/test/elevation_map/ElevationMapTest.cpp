@@ -0,0 +1,396 @@
+/*
+ * ElevationMapTest.cpp
+ *
+ *  Created on: Nov 27, 2015
+ *      Author: Péter Fankhauser
+ *	 Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/ElevationMap.hpp"
+#include "elevation_mapping/MapLayers.hpp"
+#include "elevation_mapping/PointXYZRGBConfidenceRatio.hpp"
+#include "elevation_mapping/WeightedEmpiricalCumulativeDistributionFunction.hpp"
+
+// STL
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+// ROS
+#include <ros/ros.h>
+
+namespace elevation_mapping {
+
+namespace {
+float cumulativeDistributionFunction(float x, float mean, float standardDeviation) {
+  return 0.5 * erfc(-(x - mean) / (standardDeviation * sqrt(2.0)));
+}
+
+/*!
+ * Fuses a raw map like the original implementation of ElevationMap::fuse(), cell by cell with the grid map ellipse iterator,
+ * as reference for the tiled fusion with cached kernels.
+ * @param rawMap the raw map.
+ * @return the fused map, with the layers of the fused map of the elevation map.
+ */
+grid_map::GridMap fuseReference(const grid_map::GridMap& rawMap) {
+  grid_map::GridMap fusedMap(getMapLayerNames<FusedMapLayer>());
+  fusedMap.setGeometry(rawMap.getLength(), rawMap.getResolution(), rawMap.getPosition());
+  fusedMap.setStartIndex(rawMap.getStartIndex());
+  const double halfResolution = rawMap.getResolution() / 2.0;
+  const float minimalWeight = std::numeric_limits<float>::epsilon() * static_cast<float>(2.0);
+  const double ellipseExtension = M_SQRT2 * rawMap.getResolution();
+  const double uncertaintyFactor = 2.486;  // sqrt(6.18)
+
+  for (grid_map::GridMapIterator iterator(rawMap); !iterator.isPastEnd(); ++iterator) {
+    if (!rawMap.isValid(*iterator, {"elevation", "variance"})) {
+      continue;
+    }
+    Eigen::Matrix2d covarianceMatrix;
+    covarianceMatrix << rawMap.at("horizontal_variance_x", *iterator), rawMap.at("horizontal_variance_xy", *iterator),
+        rawMap.at("horizontal_variance_xy", *iterator), rawMap.at("horizontal_variance_y", *iterator);
+    Eigen::EigenSolver<Eigen::Matrix2d> solver(covarianceMatrix);
+    Eigen::Array2d eigenvalues(solver.eigenvalues().real().cwiseAbs());
+    Eigen::Array2d::Index maxEigenvalueIndex;
+    eigenvalues.maxCoeff(&maxEigenvalueIndex);
+    const Eigen::Array2d::Index minEigenvalueIndex = maxEigenvalueIndex == 0 ? 1 : 0;
+    const grid_map::Length ellipseLength =
+        2.0 * uncertaintyFactor * grid_map::Length(eigenvalues(maxEigenvalueIndex), eigenvalues(minEigenvalueIndex)).sqrt() +
+        ellipseExtension;
+    const double ellipseRotation(
+        atan2(solver.eigenvectors().col(maxEigenvalueIndex).real()(1), solver.eigenvectors().col(maxEigenvalueIndex).real()(0)));
+    grid_map::Position position;
+    rawMap.getPosition(*iterator, position);
+
+    Eigen::ArrayXf means;
+    Eigen::ArrayXf weights;
+    grid_map::EllipseIterator ellipseIterator(rawMap, position, ellipseLength, ellipseRotation);
+    means.resize(ellipseIterator.getSubmapSize().prod());
+    weights.resize(ellipseIterator.getSubmapSize().prod());
+    WeightedEmpiricalCumulativeDistributionFunction<float> lowerBoundDistribution;
+    WeightedEmpiricalCumulativeDistributionFunction<float> upperBoundDistribution;
+    const float maxStandardDeviation = sqrt(eigenvalues(maxEigenvalueIndex));
+    const float minStandardDeviation = sqrt(eigenvalues(minEigenvalueIndex));
+    const Eigen::Rotation2Dd rotationMatrix(ellipseRotation);
+    Eigen::Index i = 0;
+    for (; !ellipseIterator.isPastEnd(); ++ellipseIterator) {
+      if (!rawMap.isValid(*ellipseIterator, {"elevation", "variance"})) {
+        continue;
+      }
+      means[i] = rawMap.at("elevation", *ellipseIterator);
+      grid_map::Position absolutePosition;
+      rawMap.getPosition(*ellipseIterator, absolutePosition);
+      const Eigen::Vector2d distanceToCenter = (rotationMatrix * (absolutePosition - position)).cwiseAbs();
+      const float probability1 = cumulativeDistributionFunction(distanceToCenter.x() + halfResolution, 0.0, maxStandardDeviation) -
+                                 cumulativeDistributionFunction(distanceToCenter.x() - halfResolution, 0.0, maxStandardDeviation);
+      const float probability2 = cumulativeDistributionFunction(distanceToCenter.y() + halfResolution, 0.0, minStandardDeviation) -
+                                 cumulativeDistributionFunction(distanceToCenter.y() - halfResolution, 0.0, minStandardDeviation);
+      const float weight = std::max(minimalWeight, probability1 * probability2);
+      weights[i] = weight;
+      const float standardDeviation = sqrt(rawMap.at("variance", *ellipseIterator));
+      lowerBoundDistribution.add(means[i] - 2.0 * standardDeviation, weight);
+      upperBoundDistribution.add(means[i] + 2.0 * standardDeviation, weight);
+      ++i;
+    }
+    means.conservativeResize(i);
+    weights.conservativeResize(i);
+    fusedMap.at("elevation", *iterator) = (weights * means).sum() / weights.sum();
+    lowerBoundDistribution.compute();
+    upperBoundDistribution.compute();
+    fusedMap.at("lower_bound", *iterator) = lowerBoundDistribution.quantile(0.01);
+    fusedMap.at("upper_bound", *iterator) = upperBoundDistribution.quantile(0.99);
+    fusedMap.at("color", *iterator) = rawMap.at("color", *iterator);
+  }
+  return fusedMap;
+}
+}  // namespace
+
+/*!
+ * Creates maps like the benchmarks do and gives the tests access to their internals.
+ */
+class ElevationMapTest : public ::testing::Test {
+ protected:
+  //! Start of the simulated time.
+  const ros::Time startTime_{1000.0};
+
+  /*!
+   * Creates a map of 4 x 4 m at 5 cm centered at the origin, with the variance limits of the node.
+   * @param nodeHandleNamespace the namespace of the node handle of the map, for its parameters.
+   * @return the map.
+   */
+  static std::unique_ptr<ElevationMap> createMap(const std::string& nodeHandleNamespace = "~") {
+    ros::NodeHandle nodeHandle(nodeHandleNamespace);
+    auto map = std::make_unique<ElevationMap>(nodeHandle);
+    const double resolution = 0.05;
+    map->setFrameId("map");
+    map->setGeometry(grid_map::Length(4.0, 4.0), resolution, grid_map::Position::Zero());
+    map->minVariance_ = std::pow(0.003, 2);
+    map->maxVariance_ = std::pow(0.03, 2);
+    map->multiHeightNoise_ = std::pow(0.003, 2);
+    map->minHorizontalVariance_ = std::pow(resolution / 2.0, 2);
+    map->maxHorizontalVariance_ = 0.5;
+    return map;
+  }
+
+  /*!
+   * Generates a point cloud of a terrain with hills and a step, seen from a sensor 1 m above the origin.
+   * @param seed the seed of the point positions and the measurement noise.
+   * @param timeStamp the time of the point cloud.
+   * @return the measurements of the point cloud.
+   */
+  std::vector<ElevationMap::PointCloudMeasurement> generateMeasurements(unsigned int seed, const ros::Time& timeStamp) {
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> position(-2.2f, 2.2f);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    PointCloudType::Ptr pointCloud(new PointCloudType);
+    for (int i = 0; i < 20000; ++i) {
+      PointXYZRGBConfidenceRatio point;
+      point.x = position(generator);
+      point.y = position(generator);
+      point.z = 0.2f * std::sin(point.x) * std::cos(2.0f * point.y) + (point.x > 0.5f ? 0.3f : 0.0f) + noise(generator);
+      pointCloud->push_back(point);
+    }
+    variances_.emplace_back(std::make_unique<Eigen::VectorXf>(Eigen::VectorXf::Constant(pointCloud->size(), 1e-4)));
+    Eigen::Affine3d sensorToMap = Eigen::Affine3d::Identity();
+    sensorToMap.translation() = Eigen::Vector3d(0.0, 0.0, 1.0);
+    return {ElevationMap::PointCloudMeasurement(pointCloud, *variances_.back(), timeStamp, sensorToMap)};
+  }
+
+  /*!
+   * Expects two maps to have the same layers with the same values, where invalid cells have to be invalid in both maps.
+   * @param expected the expected map.
+   * @param actual the map to compare.
+   * @param relativeTolerance the tolerance of the values, relative to the largest finite magnitude of the layer.
+   */
+  static void expectEqualLayers(const grid_map::GridMap& expected, const grid_map::GridMap& actual, double relativeTolerance = 0.0) {
+    ASSERT_EQ(expected.getLayers(), actual.getLayers());
+    ASSERT_TRUE((expected.getSize() == actual.getSize()).all());
+    ASSERT_TRUE((expected.getStartIndex() == actual.getStartIndex()).all());
+    for (const auto& layer : expected.getLayers()) {
+      const grid_map::Matrix& expectedData = expected.get(layer);
+      const grid_map::Matrix& actualData = actual.get(layer);
+      const float tolerance = relativeTolerance * expectedData.array().isFinite().select(expectedData.array().abs(), 0.0f).maxCoeff();
+      int numberOfMismatches = 0;
+      for (int col = 0; col < expectedData.cols(); ++col) {
+        for (int row = 0; row < expectedData.rows(); ++row) {
+          const float expectedValue = expectedData(row, col);
+          const float actualValue = actualData(row, col);
+          if (std::isnan(expectedValue) || std::isnan(actualValue)) {
+            numberOfMismatches += std::isnan(expectedValue) != std::isnan(actualValue) ? 1 : 0;
+          } else if (std::abs(expectedValue - actualValue) > tolerance) {
+            ++numberOfMismatches;
+          }
+        }
+      }
+      EXPECT_EQ(0, numberOfMismatches) << "Layer " << layer << " differs.";
+    }
+  }
+
+  //! Sets the quantization of the fusion kernels of a map, which the node reads from the fusion_kernel_quantization parameter.
+  static void setFusionKernelQuantization(ElevationMap& map, double quantization) { map.fusionKernelQuantization_ = quantization; }
+
+  //! Enables the lazy motion update of a map, which the node reads from the lazy_motion_update parameter.
+  static void enableLazyMotionUpdate(ElevationMap& map) { map.enableLazyMotionUpdate_ = true; }
+
+  //! Gets the response of the last submap request, as cached by the map.
+  static grid_map_msgs::GridMap& getCachedSubmap(ElevationMap& map) { return map.fusedSubmapCache_.message; }
+
+ private:
+  //! Variances of the generated point clouds, referenced by their measurements.
+  std::vector<std::unique_ptr<Eigen::VectorXf>> variances_;
+};
+
+}  // namespace elevation_mapping
+
+using elevation_mapping::ElevationMap;
+using elevation_mapping::ElevationMapTest;
+
+TEST_F(ElevationMapTest, RepeatedSubmapRequestIsCached) {  // NOLINT
+  auto map = createMap();
+  ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+  ASSERT_TRUE(map->fuseAll());
+
+  const grid_map::Position position(0.3, -0.2);
+  const grid_map::Length length(1.0, 1.0);
+  grid_map_msgs::GridMap message;
+  ASSERT_TRUE(map->getFusedSubmap(position, length, {}, message));
+  ASSERT_FALSE(message.data.empty());
+  ASSERT_FALSE(message.data[0].data.empty());
+
+  // Mark the cached response, which is returned as long as no cell changes. The timers fuse the unchanged map and set
+  // the time stamp in between.
+  getCachedSubmap(*map).data[0].data[0] = 42.0f;
+  ASSERT_TRUE(map->fuseAll());
+  const ros::Time timeStamp = startTime_ + ros::Duration(1.0);
+  map->setTimestamp(timeStamp);
+  ASSERT_TRUE(map->getFusedSubmap(position, length, {}, message));
+  EXPECT_EQ(42.0f, message.data[0].data[0]);
+  EXPECT_EQ(timeStamp, message.info.header.stamp);
+
+  // New data invalidates the cached response.
+  ASSERT_TRUE(map->add(generateMeasurements(1, timeStamp)));
+  ASSERT_TRUE(map->getFusedSubmap(position, length, {}, message));
+  EXPECT_NE(42.0f, message.data[0].data[0]);
+}
+
+TEST_F(ElevationMapTest, VisibilityCleanupWithoutRemovalKeepsSnapshot) {  // NOLINT
+  auto map = createMap();
+  ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+  const std::shared_ptr<const grid_map::GridMap> snapshot = map->getRawMapSnapshot();
+
+  // The cells have just been updated, the cleanup does not remove any of them and the snapshot stays valid.
+  map->visibilityCleanup(startTime_);
+  EXPECT_EQ(snapshot, map->getRawMapSnapshot());
+}
+
+TEST_F(ElevationMapTest, ParallelFusionMatchesSerialFusion) {  // NOLINT
+  ros::NodeHandle("~parallel_fusion").setParam("fusion_num_threads", 4);
+  auto serialMap = createMap();
+  auto parallelMap = createMap("~parallel_fusion");
+
+  // The move shifts the start of the circular buffer, such that some tiles cover two borders of the map.
+  for (ElevationMap* map : {serialMap.get(), parallelMap.get()}) {
+    ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+    map->move(Eigen::Vector2d(0.37, -0.61));
+    ASSERT_TRUE(map->add(generateMeasurements(1, startTime_ + ros::Duration(0.1))));
+    ASSERT_TRUE(map->fuseAll());
+  }
+  expectEqualLayers(serialMap->getFusedGridMap(), parallelMap->getFusedGridMap());
+
+  // Fusing an area only fuses the tiles overlapping it.
+  for (ElevationMap* map : {serialMap.get(), parallelMap.get()}) {
+    ASSERT_TRUE(map->add(generateMeasurements(2, startTime_ + ros::Duration(0.2))));
+    ASSERT_TRUE(map->fuseArea(Eigen::Vector2d(0.2, 0.3), Eigen::Array2d(1.3, 0.9)));
+  }
+  expectEqualLayers(serialMap->getFusedGridMap(), parallelMap->getFusedGridMap());
+}
+
+TEST_F(ElevationMapTest, ParallelIntegrationMatchesSerialIntegration) {  // NOLINT
+  ros::NodeHandle("~parallel_integration").setParam("integration_num_threads", 4);
+  auto serialMap = createMap();
+  auto parallelMap = createMap("~parallel_integration");
+
+  // The second cloud updates the cells of the first one, the move shifts the start of the circular buffer.
+  for (ElevationMap* map : {serialMap.get(), parallelMap.get()}) {
+    ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+    ASSERT_TRUE(map->add(generateMeasurements(1, startTime_ + ros::Duration(0.1))));
+    map->move(Eigen::Vector2d(-0.52, 0.24));
+    ASSERT_TRUE(map->add(generateMeasurements(2, startTime_ + ros::Duration(0.2))));
+  }
+  expectEqualLayers(serialMap->getRawGridMap(), parallelMap->getRawGridMap());
+}
+
+TEST_F(ElevationMapTest, LazyMotionUpdateMatchesEagerMotionUpdate) {  // NOLINT
+  auto eagerMap = createMap();
+  auto lazyMap = createMap();
+  enableLazyMotionUpdate(*lazyMap);
+
+  // The cells of the second cloud receive the pending updates when they are integrated, the others when they are read.
+  for (ElevationMap* map : {eagerMap.get(), lazyMap.get()}) {
+    ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+    for (int i = 1; i <= 10; ++i) {
+      ElevationMap::MotionVarianceUpdate motionUpdate;
+      motionUpdate.translationVariance = Eigen::Vector3f(1e-6f * i, 2e-6f, 3e-6f * i);
+      motionUpdate.yawVariance = 1e-5f * i;
+      motionUpdate.yawAxis = Eigen::Vector3f(0.1f, -0.05f, 1.0f).normalized();
+      motionUpdate.mapPosition = Eigen::Vector3d(0.1 * i, -0.2, -0.5);
+      const ros::Time time = startTime_ + ros::Duration(0.1 * i);
+      ASSERT_TRUE(map->update(motionUpdate, time));
+      if (i == 5) {
+        ASSERT_TRUE(map->add(generateMeasurements(1, time)));
+      }
+    }
+    ASSERT_TRUE(map->fuseAll());
+  }
+
+  // The lazy update sums the increments before adding them to a cell, which only changes the rounding.
+  expectEqualLayers(eagerMap->getRawGridMap(), lazyMap->getRawGridMap(), 1e-4);
+  expectEqualLayers(eagerMap->getFusedGridMap(), lazyMap->getFusedGridMap(), 1e-4);
+}
+
+TEST_F(ElevationMapTest, SetRawGridMapOfDifferentSizeInCompactMode) {  // NOLINT
+  ros::NodeHandle("~compact").setParam("compact_raw_map_layers", true);
+  auto compactMap = createMap("~compact");
+  enableLazyMotionUpdate(*compactMap);
+  ASSERT_TRUE(compactMap->add(generateMeasurements(0, startTime_)));
+  ElevationMap::MotionVarianceUpdate motionUpdate;
+  motionUpdate.translationVariance = Eigen::Vector3f(1e-4f, 1e-4f, 1e-4f);
+  motionUpdate.yawVariance = 0.0f;
+  motionUpdate.yawAxis = Eigen::Vector3f::UnitZ();
+  motionUpdate.mapPosition = Eigen::Vector3d::Zero();
+  ASSERT_TRUE(compactMap->update(motionUpdate, startTime_ + ros::Duration(0.1)));
+
+  // A map saved by a node without the compact storage mode, e.g. to a bag, with the float lowest scan layers.
+  auto otherMap = createMap();
+  otherMap->setGeometry(grid_map::Length(3.0, 2.0), 0.05, grid_map::Position(0.5, 0.0));
+  ASSERT_TRUE(otherMap->add(generateMeasurements(1, startTime_)));
+  const grid_map::GridMap loadedMap = otherMap->getRawGridMap();
+  ASSERT_TRUE(loadedMap.exists("lowest_scan_point"));
+
+  compactMap->setRawGridMap(loadedMap);
+  EXPECT_TRUE((compactMap->getFusedGridMap().getSize() == loadedMap.getSize()).all());
+
+  // The lowest scan layers are stored compactly again, and the motion update pending before the map was set is not
+  // applied to the loaded cells.
+  grid_map::GridMap expectedMap = loadedMap;
+  for (const auto& layer : {"lowest_scan_point", "sensor_x_at_lowest_scan", "sensor_y_at_lowest_scan", "sensor_z_at_lowest_scan"}) {
+    expectedMap.erase(layer);
+  }
+  expectEqualLayers(expectedMap, compactMap->getRawGridMap());
+
+  // The compact layers have the size of the loaded map.
+  ASSERT_TRUE(compactMap->add(generateMeasurements(2, startTime_ + ros::Duration(0.2))));
+  compactMap->visibilityCleanup(startTime_ + ros::Duration(0.2));
+  ASSERT_TRUE(compactMap->fuseAll());
+}
+
+TEST_F(ElevationMapTest, AreaFusionMatchesFullFusion) {  // NOLINT
+  auto areaMap = createMap();
+  auto fullMap = createMap();
+  const Eigen::Vector2d position(-0.4, 0.6);
+  const Eigen::Array2d length(1.0, 1.2);
+
+  // The area is fused before and after further clouds modify the map, the fused cells around the modified cells are fused
+  // again.
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(areaMap->add(generateMeasurements(i, startTime_ + ros::Duration(0.1 * i))));
+    ASSERT_TRUE(fullMap->add(generateMeasurements(i, startTime_ + ros::Duration(0.1 * i))));
+    ASSERT_TRUE(areaMap->fuseArea(position, length));
+  }
+  ASSERT_TRUE(fullMap->fuseAll());
+
+  bool isSuccess = false;
+  const grid_map::GridMap areaSubmap = areaMap->getFusedGridMap().getSubmap(position, length, isSuccess);
+  ASSERT_TRUE(isSuccess);
+  const grid_map::GridMap fullSubmap = fullMap->getFusedGridMap().getSubmap(position, length, isSuccess);
+  ASSERT_TRUE(isSuccess);
+  expectEqualLayers(fullSubmap, areaSubmap);
+}
+
+TEST_F(ElevationMapTest, FusionMatchesReferenceFusion) {  // NOLINT
+  auto map = createMap();
+  setFusionKernelQuantization(*map, 0.0);
+  ASSERT_TRUE(map->add(generateMeasurements(0, startTime_)));
+  map->move(Eigen::Vector2d(0.37, -0.61));
+  ASSERT_TRUE(map->add(generateMeasurements(1, startTime_ + ros::Duration(0.1))));
+
+  // The yaw uncertainty gives every cell a different, correlated horizontal covariance.
+  ElevationMap::MotionVarianceUpdate motionUpdate;
+  motionUpdate.translationVariance = Eigen::Vector3f(1e-4f, 4e-4f, 1e-5f);
+  motionUpdate.yawVariance = 2e-3f;
+  motionUpdate.yawAxis = Eigen::Vector3f(0.1f, -0.05f, 1.0f).normalized();
+  motionUpdate.mapPosition = Eigen::Vector3d(0.3, -0.2, -0.5);
+  ASSERT_TRUE(map->update(motionUpdate, startTime_ + ros::Duration(0.2)));
+
+  ASSERT_TRUE(map->fuseAll());
+  const grid_map::GridMap referenceMap = fuseReference(map->getRawGridMap());
+  grid_map::GridMap fusedMap = map->getFusedGridMap();
+  expectEqualLayers(referenceMap, fusedMap);
+}
@@ -0,0 +1,11 @@
+#include <gtest/gtest.h>
+#include <ros/ros.h>
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "elevation_map");
+  ros::start();
+  testing::InitGoogleTest(&argc, argv);
+  int res = RUN_ALL_TESTS();
+  ros::shutdown();
+  return res;
+}
@@ -0,0 +1,144 @@
+/*
+ * NativeFiltersTest.cpp
+ *
+ *  Created on: Oct 14, 2026
+ *   Institute: ETH Zurich, ANYbotics
+ */
+
+#include "elevation_mapping/postprocessing/NativeFilters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// gtest
+#include <gtest/gtest.h>
+
+namespace {
+grid_map::GridMap makeMap() {
+  grid_map::GridMap map({"elevation"});
+  map.setGeometry(grid_map::Length(3.0, 2.0), 0.1, grid_map::Position(0.0, 0.0));
+  // Move the map such that the circular buffer wraps.
+  map.move(grid_map::Position(0.55, -0.35));
+  return map;
+}
+
+std::unique_ptr<elevation_mapping::NativeFilter> makeFilter(const std::string& type, const std::string& outputLayer, double radius) {
+  XmlRpc::XmlRpcValue parameters;
+  parameters["input_layer"] = "elevation";
+  parameters["radius"] = radius;
+  if (!outputLayer.empty()) {
+    parameters["output_layer"] = outputLayer;
+  }
+  std::unique_ptr<elevation_mapping::NativeFilter> filter = elevation_mapping::NativeFilter::create(type);
+  if (!filter || !filter->configure(type, parameters)) {
+    return nullptr;
+  }
+  return filter;
+}
+}  // namespace
+
+TEST(NativeFilters, PlaneFit) {  // NOLINT
+  grid_map::GridMap map = makeMap();
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    grid_map::Position position;
+    map.getPosition(*iterator, position);
+    map.at("elevation", *iterator) = static_cast<float>(0.3 * position.x() + 0.1 * position.y() + 1.0);
+  }
+  map.at("elevation", grid_map::Index(10, 10)) = NAN;
+
+  elevation_mapping::ThreadPool threadPool(2);
+  for (const std::string type : {"NormalsFilter", "SlopeFilter", "RoughnessFilter"}) {
+    auto filter = makeFilter("elevation_mapping/" + type, "", 0.2);
+    ASSERT_TRUE(filter);
+    ASSERT_TRUE(filter->update(map, threadPool));
+  }
+
+  const Eigen::Vector3d normal = Eigen::Vector3d(-0.3, -0.1, 1.0).normalized();
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    if ((*iterator)(0) == 10 && (*iterator)(1) == 10) {
+      EXPECT_TRUE(std::isnan(map.at("slope", *iterator)));
+      continue;
+    }
+    EXPECT_NEAR(normal.x(), map.at("normal_vectors_x", *iterator), 1e-4);
+    EXPECT_NEAR(normal.y(), map.at("normal_vectors_y", *iterator), 1e-4);
+    EXPECT_NEAR(normal.z(), map.at("normal_vectors_z", *iterator), 1e-4);
+    EXPECT_NEAR(std::atan(std::sqrt(0.1)), map.at("slope", *iterator), 1e-4);
+    EXPECT_NEAR(0.0, map.at("roughness", *iterator), 1e-3);
+  }
+}
+
+TEST(NativeFilters, Smoothing) {  // NOLINT
+  grid_map::GridMap map = makeMap();
+  for (grid_map::GridMapIterator iterator(map); !iterator.isPastEnd(); ++iterator) {
+    const grid_map::Index index(*iterator);
+    map.at("elevation", index) = (index(0) * 7 + index(1) * 3) % 5 == 0 ? NAN : static_cast<float>((index(0) * 13 + index(1)) % 11);
+  }
+
+  elevation_mapping::ThreadPool threadPool(3);
+  auto boxFilter = makeFilter("elevation_mapping/BoxFilter", "box", 0.2);
+  auto medianFilter = makeFilter("elevation_mapping/MedianFilter", "median", 0.1);
+  ASSERT_TRUE(boxFilter);
+  ASSERT_TRUE(medianFilter);
+  ASSERT_TRUE(boxFilter->update(map, threadPool));
+  ASSERT_TRUE(medianFilter->update(map, threadPool));
+
+  // Compare against the windows in the unwrapped index space.
+  const grid_map::Size& size = map.getSize();
+  const grid_map::Index& startIndex = map.getStartIndex();
+  const auto valueAt = [&](int row, int col, const std::string& layer) {
+    return map.at(layer, grid_map::Index((row + startIndex(0)) % size(0), (col + startIndex(1)) % size(1)));
+  };
+  for (int row = 0; row < size(0); ++row) {
+    for (int col = 0; col < size(1); ++col) {
+      if (std::isnan(valueAt(row, col, "elevation"))) {
+        EXPECT_TRUE(std::isnan(valueAt(row, col, "box")));
+        EXPECT_TRUE(std::isnan(valueAt(row, col, "median")));
+        continue;
+      }
+      double sum = 0.0;
+      int count = 0;
+      std::vector<float> values;
+      for (int windowRow = std::max(row - 2, 0); windowRow <= std::min(row + 2, size(0) - 1); ++windowRow) {
+        for (int windowCol = std::max(col - 2, 0); windowCol <= std::min(col + 2, size(1) - 1); ++windowCol) {
+          const float value = valueAt(windowRow, windowCol, "elevation");
+          if (std::isnan(value)) {
+            continue;
+          }
+          sum += value;
+          ++count;
+          if (std::abs(windowRow - row) <= 1 && std::abs(windowCol - col) <= 1) {
+            values.push_back(value);
+          }
+        }
+      }
+      EXPECT_NEAR(sum / count, valueAt(row, col, "box"), 1e-4);
+      std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+      EXPECT_EQ(values[values.size() / 2], valueAt(row, col, "median"));
+    }
+  }
+}
+
+TEST(NativeFilters, Configuration) {  // NOLINT
+  EXPECT_FALSE(elevation_mapping::NativeFilter::create("elevation_mapping/UnknownFilter"));
+  EXPECT_TRUE(elevation_mapping::NativeFilter::isNativeType("elevation_mapping/BoxFilter"));
+  EXPECT_FALSE(elevation_mapping::NativeFilter::isNativeType("gridMapFilters/MockFilter"));
+  // The box filter needs an output layer.
+  EXPECT_FALSE(makeFilter("elevation_mapping/BoxFilter", "", 0.2));
+
+  // A missing input layer is reported by the update.
+  auto filter = makeFilter("elevation_mapping/SlopeFilter", "", 0.2);
+  ASSERT_TRUE(filter);
+  grid_map::GridMap map({"variance"});
+  map.setGeometry(grid_map::Length(1.0, 1.0), 0.1);
+  elevation_mapping::ThreadPool threadPool(1);
+  EXPECT_FALSE(filter->update(map, threadPool));
+
+  // Additional types have to be native types and must not replace the built-in ones.
+  const auto factory = []() { return elevation_mapping::NativeFilter::create("elevation_mapping/BoxFilter"); };
+  EXPECT_FALSE(elevation_mapping::NativeFilter::registerType("elevation_mapping/BoxFilter", factory));
+  EXPECT_FALSE(elevation_mapping::NativeFilter::registerType("gridMapFilters/BoxFilter", factory));
+  EXPECT_TRUE(elevation_mapping::NativeFilter::registerType("elevation_mapping/AliasedBoxFilter", factory));
+  EXPECT_TRUE(elevation_mapping::NativeFilter::create("elevation_mapping/AliasedBoxFilter"));
+}
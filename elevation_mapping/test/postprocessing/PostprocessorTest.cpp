@@ -7,13 +7,72 @@
 #include <gtest/gtest.h>
 #include <ros/ros.h>
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <grid_map_msgs/GridMap.h>
+
+#include "elevation_mapping/postprocessing/NativeFilters.hpp"
 #include "elevation_mapping/postprocessing/PostprocessingPipelineFunctor.hpp"
 #include "elevation_mapping/postprocessing/PostprocessorPool.hpp"
 
 /**
  * We read in a postprocessing (mock) configuration that takes 150ms to execute. We test whether the postprocessorPool accepts/discards the
  * tasks for various configurations of time between tasks and number of threads in the pool.
+ * Further, we test the latest-wins queue and the parallel stages.
+ */
+
+namespace {
+//! Time after which a test gives up waiting, long enough to never be reached on a loaded machine.
+constexpr std::chrono::seconds waitTimeout(10);
+
+/**
+ * Counts down the stages which have reached their latch filter.
+ */
+struct StageLatch {
+  boost::mutex mutex;
+  boost::condition_variable condition;
+  int count = 0;
+  std::atomic<int> numberOfTimeouts{0};
+};
+StageLatch stageLatch;
+
+/**
+ * Native filter which waits until the filters of all stages have been reached. The stages only pass it if they run in parallel.
  */
+class LatchFilter : public elevation_mapping::NativeFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& /*parameters*/) override { return true; }
+
+  void apply(grid_map::GridMap& /*map*/, int /*radiusInCells*/, elevation_mapping::ThreadPool& /*threadPool*/) override {
+    boost::unique_lock<boost::mutex> lock(stageLatch.mutex);
+    --stageLatch.count;
+    stageLatch.condition.notify_all();
+    if (!stageLatch.condition.wait_for(lock, boost::chrono::seconds(waitTimeout.count()), [] { return stageLatch.count <= 0; })) {
+      ++stageLatch.numberOfTimeouts;
+    }
+  }
+};
+
+/**
+ * Native filter which changes the input layer and adds a layer with the original input.
+ */
+class OverwriteFilter : public elevation_mapping::NativeFilter {
+ protected:
+  bool readParameters(const XmlRpc::XmlRpcValue& /*parameters*/) override { return true; }
+
+  void apply(grid_map::GridMap& map, int /*radiusInCells*/, elevation_mapping::ThreadPool& /*threadPool*/) override {
+    map.add("original_elevation", map.get("elevation"));
+    map.get("elevation").setConstant(1.0);
+  }
+};
+}  // namespace
+
 class RosFixture : public ::testing::Test {
   void SetUp() override {
     const std::map<std::string, std::string> remappings{};
@@ -27,6 +86,8 @@ class RosFixture : public ::testing::Test {
   static void checkAcceptedTasks(uint poolSize, uint timeBetweenConsecutiveTasks, std::vector<bool> expectedAcceptanceOutcomes) {
     // Set up ROS node handle.
     ros::NodeHandle nodeHandle("~");
+    // Without a queue, tasks are discarded if no thread is available.
+    nodeHandle.setParam("postprocessor_queue_size", 0);
 
     elevation_mapping::PostprocessorPool pool{poolSize, nodeHandle};
     int taskNumber = 0;
@@ -40,6 +101,7 @@ class RosFixture : public ::testing::Test {
       taskNumber++;
       std::this_thread::sleep_for(std::chrono::milliseconds(timeBetweenConsecutiveTasks));
     }
+    nodeHandle.deleteParam("postprocessor_queue_size");
   }
 };
 
@@ -66,3 +128,85 @@ TEST_F(RosFixture, ProcessEverySecond) {  // NOLINT
 TEST_F(RosFixture, TwoThreadsWithMiss) {  // NOLINT
   checkAcceptedTasks(2, 60, {true, true, false, true, true, false});
 }
+
+TEST_F(RosFixture, LatestTaskWins) {  // NOLINT
+  ros::NodeHandle nodeHandle("~");
+  ros::AsyncSpinner spinner(1);
+  spinner.start();
+  std::vector<double> receivedLengths;
+  boost::mutex receivedLengthsMutex;
+  boost::condition_variable receivedLengthsCondition;
+  ros::Subscriber subscriber = nodeHandle.subscribe<grid_map_msgs::GridMap>(
+      "elevation_map_raw", 10, [&](const grid_map_msgs::GridMapConstPtr& message) {
+        boost::lock_guard<boost::mutex> lock(receivedLengthsMutex);
+        receivedLengths.push_back(message->info.length_x);
+        receivedLengthsCondition.notify_all();
+      });
+
+  elevation_mapping::PostprocessorPool pool{1, nodeHandle};
+  for (int i = 0; i < 20 && !pool.pipelineHasSubscribers(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  ASSERT_TRUE(pool.pipelineHasSubscribers());
+
+  // The first task is processed right away, the later ones replace each other in the queue of size one.
+  for (int i = 1; i <= 5; ++i) {
+    grid_map::GridMap map({"elevation"});
+    map.setGeometry(grid_map::Length(i, 1.0), 0.5);
+    ASSERT_TRUE(pool.runTask(map)) << "Postprocessor pool did not accept task number: " << i;
+  }
+
+  // The last task is published last, the results of older tasks are discarded after it.
+  boost::unique_lock<boost::mutex> lock(receivedLengthsMutex);
+  ASSERT_TRUE(receivedLengthsCondition.wait_for(lock, boost::chrono::seconds(waitTimeout.count()),
+                                                [&] { return !receivedLengths.empty() && receivedLengths.back() == 5.0; }));
+  ASSERT_EQ(2u, receivedLengths.size());
+  EXPECT_DOUBLE_EQ(1.0, receivedLengths.front());
+  EXPECT_DOUBLE_EQ(5.0, receivedLengths.back());
+}
+
+TEST_F(RosFixture, StagesRunInParallel) {  // NOLINT
+  static const bool isLatchFilterRegistered = elevation_mapping::NativeFilter::registerType(
+      "elevation_mapping/TestLatchFilter", []() { return std::make_unique<LatchFilter>(); });
+  ASSERT_TRUE(isLatchFilterRegistered);
+
+  ros::NodeHandle nodeHandle("~");
+  nodeHandle.setParam("postprocessor_pipeline_stages", std::vector<std::string>{"test_stage_a", "test_stage_b"});
+  elevation_mapping::PostprocessingPipelineFunctor functor(nodeHandle);
+  nodeHandle.deleteParam("postprocessor_pipeline_stages");
+
+  grid_map::GridMap map({"elevation"});
+  map.setGeometry(grid_map::Length(1.0, 1.0), 0.5);
+  {
+    boost::lock_guard<boost::mutex> lock(stageLatch.mutex);
+    stageLatch.count = 2;
+    stageLatch.numberOfTimeouts = 0;
+  }
+  const grid_map::GridMap processedMap = functor(map);
+
+  // Both stages have reached their latch filter before either of them passed it.
+  EXPECT_EQ(0, stageLatch.numberOfTimeouts);
+  EXPECT_EQ(0, stageLatch.count);
+  EXPECT_TRUE(processedMap.exists("elevation"));
+}
+
+TEST_F(RosFixture, StagesOnlyAddLayers) {  // NOLINT
+  static const bool isOverwriteFilterRegistered = elevation_mapping::NativeFilter::registerType(
+      "elevation_mapping/TestOverwriteFilter", []() { return std::make_unique<OverwriteFilter>(); });
+  ASSERT_TRUE(isOverwriteFilterRegistered);
+
+  ros::NodeHandle nodeHandle("~");
+  nodeHandle.setParam("postprocessor_pipeline_stages", std::vector<std::string>{"test_stage_overwrite"});
+  elevation_mapping::PostprocessingPipelineFunctor functor(nodeHandle);
+  nodeHandle.deleteParam("postprocessor_pipeline_stages");
+
+  grid_map::GridMap map({"elevation"});
+  map.setGeometry(grid_map::Length(1.0, 1.0), 0.5);
+  map.get("elevation").setConstant(0.5);
+  const grid_map::GridMap processedMap = functor(map);
+
+  // The added layer is merged, the change of the input layer is discarded.
+  ASSERT_TRUE(processedMap.exists("original_elevation"));
+  EXPECT_TRUE((processedMap.get("original_elevation").array() == 0.5).all());
+  EXPECT_TRUE((processedMap.get("elevation").array() == 0.5).all());
+}